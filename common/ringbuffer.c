@@ -76,3 +76,36 @@ bool oe_ringbuffer_empty(const oe_ringbuffer_t* rb)
     oe_assert(rb);
     return rb->_front == rb->_back && !rb->_full;
 }
+
+size_t oe_ringbuffer_size(const oe_ringbuffer_t* rb)
+{
+    oe_assert(rb);
+    if (rb->_full)
+        return rb->_capacity;
+    return (rb->_back + rb->_capacity - rb->_front) % rb->_capacity;
+}
+
+size_t oe_ringbuffer_capacity(const oe_ringbuffer_t* rb)
+{
+    oe_assert(rb);
+    return rb->_capacity;
+}
+
+oe_ringbuffer_t* oe_ringbuffer_resize(oe_ringbuffer_t* rb, size_t size)
+{
+    oe_assert(rb);
+    const size_t used = oe_ringbuffer_size(rb);
+    oe_assert(size >= used);
+
+    oe_ringbuffer_t* const result = oe_ringbuffer_alloc(size);
+    if (!result)
+        return NULL;
+
+    // The contents start at the front of the new buffer.
+    oe_ringbuffer_read(rb, result->_buf, used);
+    result->_back = size ? used % size : 0;
+    result->_full = used == size;
+
+    oe_ringbuffer_free(rb);
+    return result;
+}
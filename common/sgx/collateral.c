@@ -20,6 +20,7 @@
 #include <openenclave/internal/utils.h>
 #include "../common.h"
 #include "tcbinfo.h"
+#include "verifycache.h"
 
 // Defaults to Intel SGX 1.8 Release Date.
 oe_datetime_t _sgx_minimim_crl_tcb_issue_date = {2017, 3, 17};
@@ -38,6 +39,9 @@ oe_result_t __oe_sgx_set_minimum_crl_tcb_issue_date(
     OE_CHECK(oe_datetime_is_valid(&tmp));
     _sgx_minimim_crl_tcb_issue_date = tmp;
 
+    // Cached verification results were checked against the old date.
+    oe_sgx_verify_cache_clear();
+
     result = OE_OK;
 done:
     return result;
@@ -234,6 +238,12 @@ oe_result_t oe_validate_revocation_list(
     oe_datetime_t latest_from = {0};
     oe_datetime_t earliest_until = {0};
 
+    const void* tcb_info_items[2];
+    size_t tcb_info_sizes[2];
+    OE_SHA256 tcb_info_key;
+    oe_sgx_verify_cache_entry_t tcb_info_entry = {{0}};
+    bool has_tcb_info = false;
+
     if (pck_cert == NULL || sgx_endorsements == NULL)
         OE_RAISE(OE_INVALID_PARAMETER);
 
@@ -256,15 +266,35 @@ oe_result_t oe_validate_revocation_list(
         "Failed to parse SGX extensions from leaf cert. %s",
         oe_result_str(result));
 
-    OE_CHECK_MSG(
-        oe_cert_chain_read_pem(
-            &tcb_issuer_chain,
-            sgx_endorsements->items[OE_SGX_ENDORSEMENT_FIELD_TCB_ISSUER_CHAIN]
-                .data,
-            sgx_endorsements->items[OE_SGX_ENDORSEMENT_FIELD_TCB_ISSUER_CHAIN]
-                .size),
-        "Failed to read TCB chain certificate. %s",
-        oe_result_str(result));
+    // The TCB info signature only needs to be verified once for each pair of
+    // TCB info and issuer chain.
+    for (uint32_t i = 0; i < OE_COUNTOF(tcb_info_items); ++i)
+    {
+        tcb_info_items[i] =
+            sgx_endorsements->items[OE_SGX_ENDORSEMENT_FIELD_TCB_INFO + i].data;
+        tcb_info_sizes[i] =
+            sgx_endorsements->items[OE_SGX_ENDORSEMENT_FIELD_TCB_INFO + i].size;
+    }
+    OE_CHECK(oe_sgx_verify_cache_key(
+        OE_SGX_VERIFY_CACHE_TCB_INFO,
+        tcb_info_items,
+        tcb_info_sizes,
+        OE_COUNTOF(tcb_info_items),
+        &tcb_info_key));
+    has_tcb_info = oe_sgx_verify_cache_get(&tcb_info_key, &tcb_info_entry);
+
+    if (!has_tcb_info)
+        OE_CHECK_MSG(
+            oe_cert_chain_read_pem(
+                &tcb_issuer_chain,
+                sgx_endorsements
+                    ->items[OE_SGX_ENDORSEMENT_FIELD_TCB_ISSUER_CHAIN]
+                    .data,
+                sgx_endorsements
+                    ->items[OE_SGX_ENDORSEMENT_FIELD_TCB_ISSUER_CHAIN]
+                    .size),
+            "Failed to read TCB chain certificate. %s",
+            oe_result_str(result));
 
     OE_CHECK_MSG(
         oe_cert_chain_read_pem(
@@ -362,14 +392,29 @@ oe_result_t oe_validate_revocation_list(
             oe_result_str(result));
     }
 
-    OE_CHECK_MSG(
-        oe_verify_ecdsa256_signature(
-            parsed_tcb_info.tcb_info_start,
-            parsed_tcb_info.tcb_info_size,
-            (sgx_ecdsa256_signature_t*)parsed_tcb_info.signature,
-            &tcb_issuer_chain),
-        "Failed to verify ECDSA 256 signature in TCB. %s",
-        oe_result_str(result));
+    if (!has_tcb_info)
+    {
+        OE_CHECK_MSG(
+            oe_verify_ecdsa256_signature(
+                parsed_tcb_info.tcb_info_start,
+                parsed_tcb_info.tcb_info_size,
+                (sgx_ecdsa256_signature_t*)parsed_tcb_info.signature,
+                &tcb_issuer_chain),
+            "Failed to verify ECDSA 256 signature in TCB. %s",
+            oe_result_str(result));
+
+        // Get TCB cert validity period.
+        OE_CHECK_MSG(
+            oe_cert_chain_get_leaf_cert(&tcb_issuer_chain, &tcb_cert),
+            "Failed to get TCB certificate.",
+            NULL);
+        oe_cert_get_validity_dates(
+            &tcb_cert, &tcb_info_entry.from, &tcb_info_entry.until);
+
+        OE_CHECK(oe_sgx_verify_cache_get_chain_expiry(
+            &tcb_issuer_chain, &tcb_info_entry.expires));
+        oe_sgx_verify_cache_put(&tcb_info_key, &tcb_info_entry);
+    }
 
     OE_CHECK_MSG(
         _get_revocation_validity(
@@ -406,12 +451,8 @@ oe_result_t oe_validate_revocation_list(
             oe_result_str(result));
     }
 
-    // Get TCB cert validity period.
-    OE_CHECK_MSG(
-        oe_cert_chain_get_leaf_cert(&tcb_issuer_chain, &tcb_cert),
-        "Failed to get TCB certificate.",
-        NULL);
-    oe_cert_get_validity_dates(&tcb_cert, &from, &until);
+    from = tcb_info_entry.from;
+    until = tcb_info_entry.until;
     oe_datetime_log("TCB cert issue date: ", &from);
     oe_datetime_log("TCB cert next update: ", &until);
 
@@ -437,9 +478,12 @@ done:
     {
         oe_crl_free(&crls[i]);
     }
-    oe_cert_chain_free(&tcb_issuer_chain);
+    if (tcb_issuer_chain.impl[0] != 0)
+    {
+        oe_cert_chain_free(&tcb_issuer_chain);
+        oe_cert_free(&tcb_cert);
+    }
     oe_cert_chain_free(&crl_issuer_chain);
-    oe_cert_free(&tcb_cert);
 
     return result;
 }
@@ -289,6 +289,33 @@ done:
     return result;
 }
 
+/* Measure npages copies of the same page. */
+static oe_result_t _add_same_pages(
+    oe_sha256_context_t* hctx,
+    uint64_t base,
+    void* page,
+    size_t npages,
+    uint64_t* vaddr,
+    bool t)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    OE_CHECK(oe_sgx_measure_load_enclave_pages(
+        hctx,
+        base,
+        base + *vaddr,
+        (uint64_t)page,
+        npages,
+        0,
+        SGX_SECINFO_REG | SGX_SECINFO_R | SGX_SECINFO_W,
+        t));
+    *vaddr += npages * OE_PAGE_SIZE;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 oe_result_t oe_remeasure_memory_pages(
     const oe_eeid_t* eeid,
     struct _OE_SHA256* computed_enclave_hash,
@@ -310,15 +337,25 @@ oe_result_t oe_remeasure_memory_pages(
     // the base image hash, for which there are no EEID pages, but one TCS
     // page.
 
-    for (size_t i = 0; i < eeid->size_settings.num_heap_pages; i++)
-        OE_CHECK(_add_page(&hctx, base, &blank_pg, &vaddr, false));
+    OE_CHECK(_add_same_pages(
+        &hctx,
+        base,
+        &blank_pg,
+        eeid->size_settings.num_heap_pages,
+        &vaddr,
+        false));
 
     for (size_t i = 0; i < eeid->size_settings.num_tcs; i++)
     {
         vaddr += OE_PAGE_SIZE; /* guard page */
 
-        for (size_t i = 0; i < eeid->size_settings.num_stack_pages; i++)
-            OE_CHECK(_add_page(&hctx, base, &stack_pg, &vaddr, true));
+        OE_CHECK(_add_same_pages(
+            &hctx,
+            base,
+            &stack_pg,
+            eeid->size_settings.num_stack_pages,
+            &vaddr,
+            true));
 
         vaddr += OE_PAGE_SIZE; /* guard page */
 
@@ -7,6 +7,7 @@
 #include <openenclave/internal/utils.h>
 #include "../common.h"
 #include "tcbinfo.h"
+#include "verifycache.h"
 
 extern oe_datetime_t _sgx_minimim_crl_tcb_issue_date;
 
@@ -37,6 +38,11 @@ oe_result_t oe_validate_qe_identity(
     oe_qe_identity_info_tcb_level_t platform_tcb_level = {{0}};
     oe_datetime_t from = {0};
     oe_datetime_t until = {0};
+    const void* items[2];
+    size_t sizes[2];
+    OE_SHA256 key;
+    oe_sgx_verify_cache_entry_t entry = {{0}};
+    bool cached = false;
 
     OE_TRACE_INFO("Calling %s\n", __FUNCTION__);
 
@@ -44,6 +50,25 @@ oe_result_t oe_validate_qe_identity(
         (validity_until == NULL))
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    // The QE identity signature only needs to be verified once for each pair
+    // of QE identity and issuer chain.
+    for (uint32_t i = 0; i < OE_COUNTOF(items); ++i)
+    {
+        items[i] =
+            sgx_endorsements->items[OE_SGX_ENDORSEMENT_FIELD_QE_ID_INFO + i]
+                .data;
+        sizes[i] =
+            sgx_endorsements->items[OE_SGX_ENDORSEMENT_FIELD_QE_ID_INFO + i]
+                .size;
+    }
+    OE_CHECK(oe_sgx_verify_cache_key(
+        OE_SGX_VERIFY_CACHE_QE_IDENTITY,
+        items,
+        sizes,
+        OE_COUNTOF(items),
+        &key));
+    cached = oe_sgx_verify_cache_get(&key, &entry);
+
     // Use QE Identity info to validate QE
     // Check against fetched qe identityinfo
     OE_TRACE_INFO(
@@ -59,8 +84,9 @@ oe_result_t oe_validate_qe_identity(
             .size;
 
     // validate the cert chain.
-    OE_CHECK(oe_cert_chain_read_pem(
-        &pck_cert_chain, pem_pck_certificate, pem_pck_certificate_size));
+    if (!cached)
+        OE_CHECK(oe_cert_chain_read_pem(
+            &pck_cert_chain, pem_pck_certificate, pem_pck_certificate_size));
 
     // Configure the platform isvsvn from the QE report.
     // The platform isvsvn is needed for matching tcb level
@@ -77,24 +103,34 @@ oe_result_t oe_validate_qe_identity(
         &platform_tcb_level,
         &parsed_info));
 
-    // verify qe identity signature
-    OE_TRACE_INFO("Calling oe_verify_ecdsa256_signature\n");
-    OE_CHECK(oe_verify_ecdsa256_signature(
-        parsed_info.info_start,
-        parsed_info.info_size,
-        (sgx_ecdsa256_signature_t*)parsed_info.signature,
-        &pck_cert_chain));
-    OE_TRACE_INFO("oe_verify_ecdsa256_signature succeeded\n");
-
-    // Get leaf certificate
-    OE_CHECK_MSG(
-        oe_cert_chain_get_leaf_cert(&pck_cert_chain, &leaf_cert),
-        "Failed to get leaf certificate. %s",
-        oe_result_str(result));
-    OE_CHECK_MSG(
-        oe_cert_get_validity_dates(&leaf_cert, &from, &until),
-        "Failed to get validity dates from cert. %s",
-        oe_result_str(result));
+    if (!cached)
+    {
+        // verify qe identity signature
+        OE_TRACE_INFO("Calling oe_verify_ecdsa256_signature\n");
+        OE_CHECK(oe_verify_ecdsa256_signature(
+            parsed_info.info_start,
+            parsed_info.info_size,
+            (sgx_ecdsa256_signature_t*)parsed_info.signature,
+            &pck_cert_chain));
+        OE_TRACE_INFO("oe_verify_ecdsa256_signature succeeded\n");
+
+        // Get leaf certificate
+        OE_CHECK_MSG(
+            oe_cert_chain_get_leaf_cert(&pck_cert_chain, &leaf_cert),
+            "Failed to get leaf certificate. %s",
+            oe_result_str(result));
+        OE_CHECK_MSG(
+            oe_cert_get_validity_dates(&leaf_cert, &entry.from, &entry.until),
+            "Failed to get validity dates from cert. %s",
+            oe_result_str(result));
+
+        OE_CHECK(oe_sgx_verify_cache_get_chain_expiry(
+            &pck_cert_chain, &entry.expires));
+        oe_sgx_verify_cache_put(&key, &entry);
+    }
+
+    from = entry.from;
+    until = entry.until;
 
     oe_datetime_log("QE identity cert issue date: ", &from);
     oe_datetime_log("QE identity cert next update: ", &until);
@@ -210,8 +246,10 @@ oe_result_t oe_validate_qe_identity(
 
 done:
     if (pck_cert_chain.impl[0] != 0)
+    {
         oe_cert_chain_free(&pck_cert_chain);
-    oe_cert_free(&leaf_cert);
+        oe_cert_free(&leaf_cert);
+    }
 
     return result;
 }
@@ -13,6 +13,7 @@
 #include "collateral.h"
 #include "endorsements.h"
 #include "qeidentity.h"
+#include "verifycache.h"
 
 #include <time.h>
 
@@ -205,6 +206,206 @@ done:
     return result;
 }
 
+static void _update_validity(
+    oe_datetime_t* latest_from,
+    oe_datetime_t* earliest_until,
+    oe_datetime_t* from,
+    oe_datetime_t* until)
+{
+    if (oe_datetime_compare(from, latest_from) > 0)
+    {
+        *latest_from = *from;
+    }
+
+    if (oe_datetime_compare(until, earliest_until) < 0)
+    {
+        *earliest_until = *until;
+    }
+}
+
+static oe_result_t _get_pck_cert_chain_validity(
+    const oe_cert_chain_t* pck_cert_chain,
+    oe_datetime_t* latest_from,
+    oe_datetime_t* earliest_until)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_cert_t root_cert = {0};
+    oe_cert_t intermediate_cert = {0};
+    oe_cert_t pck_cert = {0};
+    oe_datetime_t from;
+    oe_datetime_t until;
+
+    // Fetch certificates.
+    OE_CHECK_MSG(
+        oe_cert_chain_get_leaf_cert(pck_cert_chain, &pck_cert),
+        "Failed to get leaf certificate.",
+        NULL);
+    OE_CHECK_MSG(
+        oe_cert_chain_get_root_cert(pck_cert_chain, &root_cert),
+        "Failed to get root certificate.",
+        NULL);
+    OE_CHECK_MSG(
+        oe_cert_chain_get_cert(pck_cert_chain, 1, &intermediate_cert),
+        "Failed to get intermediate certificate.",
+        NULL);
+
+    // Process certs validity dates.
+    OE_CHECK_MSG(
+        oe_cert_get_validity_dates(&root_cert, latest_from, earliest_until),
+        "Failed to get validity info from cert. %s",
+        oe_result_str(result));
+    OE_CHECK_MSG(
+        oe_cert_get_validity_dates(&intermediate_cert, &from, &until),
+        "Failed to get validity info from cert. %s",
+        oe_result_str(result));
+    _update_validity(latest_from, earliest_until, &from, &until);
+
+    OE_CHECK_MSG(
+        oe_cert_get_validity_dates(&pck_cert, &from, &until),
+        "Failed to get validity info from cert. %s",
+        oe_result_str(result));
+    _update_validity(latest_from, earliest_until, &from, &until);
+
+    result = OE_OK;
+
+done:
+    oe_cert_free(&pck_cert);
+    oe_cert_free(&intermediate_cert);
+    oe_cert_free(&root_cert);
+
+    return result;
+}
+
+/**
+ * Read the PCK certificate chain, verify it against the Intel root key and
+ * get the public key of the PCK certificate. Fills in the cache entry of the
+ * chain.
+ */
+static oe_result_t _read_pck_cert_chain(
+    const uint8_t* pem_pck_certificate,
+    size_t pem_pck_certificate_size,
+    oe_ec_public_key_t* leaf_public_key,
+    oe_sgx_verify_cache_entry_t* entry)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_cert_chain_t pck_cert_chain = {0};
+    oe_cert_t leaf_cert = {0};
+    oe_cert_t root_cert = {0};
+    oe_ec_public_key_t root_public_key = {0};
+    oe_ec_public_key_t expected_root_public_key = {0};
+    bool key_equal = false;
+
+    // Read and validate the chain.
+    OE_CHECK_MSG(
+        oe_cert_chain_read_pem(
+            &pck_cert_chain, pem_pck_certificate, pem_pck_certificate_size),
+        "Failed to parse certificate chain.",
+        NULL);
+
+    // Fetch leaf and root certificates.
+    OE_CHECK_MSG(
+        oe_cert_chain_get_leaf_cert(&pck_cert_chain, &leaf_cert),
+        "Failed to get leaf certificate.",
+        NULL);
+    OE_CHECK_MSG(
+        oe_cert_chain_get_root_cert(&pck_cert_chain, &root_cert),
+        "Failed to get root certificate.",
+        NULL);
+
+    // Get public keys.
+    OE_CHECK_MSG(
+        oe_cert_get_ec_public_key(&leaf_cert, leaf_public_key),
+        "Failed to get leaf cert public key.",
+        NULL);
+    OE_CHECK_MSG(
+        oe_cert_get_ec_public_key(&root_cert, &root_public_key),
+        "Failed to get root cert public key.",
+        NULL);
+
+    // Ensure that the root certificate matches root of trust.
+    OE_CHECK_MSG(
+        oe_ec_public_key_read_pem(
+            &expected_root_public_key,
+            (const uint8_t*)g_expected_root_certificate_key,
+            oe_strlen(g_expected_root_certificate_key) + 1),
+        "Failed to read expected root cert key.",
+        NULL);
+    OE_CHECK_MSG(
+        oe_ec_public_key_equal(
+            &root_public_key, &expected_root_public_key, &key_equal),
+        "Failed to compare keys.",
+        NULL);
+    if (!key_equal)
+        OE_RAISE_MSG(
+            OE_QUOTE_VERIFICATION_ERROR,
+            "Failed to verify root public key.",
+            NULL);
+
+    // The chain stays valid until one of its certs expires.
+    OE_CHECK(_get_pck_cert_chain_validity(
+        &pck_cert_chain, &entry->from, &entry->until));
+    entry->expires = entry->until;
+    entry->data_size = sizeof(entry->data);
+    OE_CHECK(oe_ec_public_key_write_pem(
+        leaf_public_key, entry->data, &entry->data_size));
+
+    result = OE_OK;
+
+done:
+    oe_ec_public_key_free(&root_public_key);
+    oe_ec_public_key_free(&expected_root_public_key);
+    oe_cert_free(&leaf_cert);
+    oe_cert_free(&root_cert);
+    oe_cert_chain_free(&pck_cert_chain);
+    return result;
+}
+
+/**
+ * Verify the PCK certificate chain and get the public key of the PCK
+ * certificate. The result is cached, so a chain is only parsed and verified
+ * the first time a platform presents it.
+ */
+static oe_result_t _verify_pck_cert_chain(
+    const uint8_t* pem_pck_certificate,
+    size_t pem_pck_certificate_size,
+    oe_ec_public_key_t* leaf_public_key)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    const void* item = pem_pck_certificate;
+    OE_SHA256 key;
+    oe_sgx_verify_cache_entry_t entry = {{0}};
+
+    OE_CHECK(oe_sgx_verify_cache_key(
+        OE_SGX_VERIFY_CACHE_PCK_CHAIN,
+        &item,
+        &pem_pck_certificate_size,
+        1,
+        &key));
+
+    if (oe_sgx_verify_cache_get(&key, &entry))
+    {
+        OE_CHECK_MSG(
+            oe_ec_public_key_read_pem(
+                leaf_public_key, entry.data, entry.data_size),
+            "Failed to read cached leaf cert public key.",
+            NULL);
+    }
+    else
+    {
+        OE_CHECK(_read_pck_cert_chain(
+            pem_pck_certificate,
+            pem_pck_certificate_size,
+            leaf_public_key,
+            &entry));
+        oe_sgx_verify_cache_put(&key, &entry);
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 static oe_result_t oe_verify_quote_internal(
     const uint8_t* quote,
     size_t quote_size)
@@ -214,20 +415,10 @@ static oe_result_t oe_verify_quote_internal(
     sgx_quote_auth_data_t* quote_auth_data = NULL;
     sgx_qe_auth_data_t qe_auth_data = {0};
     sgx_qe_cert_data_t qe_cert_data = {0};
-    oe_cert_chain_t pck_cert_chain = {0};
     oe_sha256_context_t sha256_ctx = {0};
     OE_SHA256 sha256 = {0};
     oe_ec_public_key_t attestation_key = {0};
-    oe_cert_t leaf_cert = {0};
-    oe_cert_t root_cert = {0};
-    oe_cert_t intermediate_cert = {0};
     oe_ec_public_key_t leaf_public_key = {0};
-    oe_ec_public_key_t root_public_key = {0};
-    oe_ec_public_key_t expected_root_public_key = {0};
-    bool key_equal = false;
-
-    uint8_t* pem_pck_certificate = NULL;
-    size_t pem_pck_certificate_size = 0;
 
     OE_CHECK_MSG(
         _parse_quote(
@@ -240,61 +431,9 @@ static oe_result_t oe_verify_quote_internal(
         "Failed to parse quote. %s",
         oe_result_str(result));
 
-    pem_pck_certificate = qe_cert_data.data;
-    pem_pck_certificate_size = qe_cert_data.size;
-
     // PckCertificate Chain validations.
-    {
-        // Read and validate the chain.
-        OE_CHECK_MSG(
-            oe_cert_chain_read_pem(
-                &pck_cert_chain, pem_pck_certificate, pem_pck_certificate_size),
-            "Failed to parse certificate chain.",
-            NULL);
-
-        // Fetch leaf and root certificates.
-        OE_CHECK_MSG(
-            oe_cert_chain_get_leaf_cert(&pck_cert_chain, &leaf_cert),
-            "Failed to get leaf certificate.",
-            NULL);
-        OE_CHECK_MSG(
-            oe_cert_chain_get_root_cert(&pck_cert_chain, &root_cert),
-            "Failed to get root certificate.",
-            NULL);
-        OE_CHECK_MSG(
-            oe_cert_chain_get_cert(&pck_cert_chain, 1, &intermediate_cert),
-            "Failed to get intermediate certificate.",
-            NULL);
-
-        // Get public keys.
-        OE_CHECK_MSG(
-            oe_cert_get_ec_public_key(&leaf_cert, &leaf_public_key),
-            "Failed to get leaf cert public key.",
-            NULL);
-        OE_CHECK_MSG(
-            oe_cert_get_ec_public_key(&root_cert, &root_public_key),
-            "Failed to get root cert public key.",
-            NULL);
-
-        // Ensure that the root certificate matches root of trust.
-        OE_CHECK_MSG(
-            oe_ec_public_key_read_pem(
-                &expected_root_public_key,
-                (const uint8_t*)g_expected_root_certificate_key,
-                oe_strlen(g_expected_root_certificate_key) + 1),
-            "Failed to read expected root cert key.",
-            NULL);
-        OE_CHECK_MSG(
-            oe_ec_public_key_equal(
-                &root_public_key, &expected_root_public_key, &key_equal),
-            "Failed to compare keys.",
-            NULL);
-        if (!key_equal)
-            OE_RAISE_MSG(
-                OE_QUOTE_VERIFICATION_ERROR,
-                "Failed to verify root public key.",
-                NULL);
-    }
+    OE_CHECK(_verify_pck_cert_chain(
+        qe_cert_data.data, qe_cert_data.size, &leaf_public_key));
 
     // Quote validations.
     {
@@ -355,13 +494,7 @@ static oe_result_t oe_verify_quote_internal(
 
 done:
     oe_ec_public_key_free(&leaf_public_key);
-    oe_ec_public_key_free(&root_public_key);
-    oe_ec_public_key_free(&expected_root_public_key);
     oe_ec_public_key_free(&attestation_key);
-    oe_cert_free(&leaf_cert);
-    oe_cert_free(&root_cert);
-    oe_cert_free(&intermediate_cert);
-    oe_cert_chain_free(&pck_cert_chain);
     return result;
 }
 
@@ -408,23 +541,6 @@ done:
     return result;
 }
 
-static void _update_validity(
-    oe_datetime_t* latest_from,
-    oe_datetime_t* earliest_until,
-    oe_datetime_t* from,
-    oe_datetime_t* until)
-{
-    if (oe_datetime_compare(from, latest_from) > 0)
-    {
-        *latest_from = *from;
-    }
-
-    if (oe_datetime_compare(until, earliest_until) < 0)
-    {
-        *earliest_until = *until;
-    }
-}
-
 oe_result_t oe_verify_sgx_quote(
     const uint8_t* quote,
     size_t quote_size,
@@ -570,6 +686,35 @@ done:
     return result;
 }
 
+/**
+ * Compute the cache key of the revocation check of a PCK certificate chain.
+ * The check depends on the chain and on the endorsements from the version up
+ * to the CRL issuer chain.
+ */
+static oe_result_t _get_revocation_cache_key(
+    const uint8_t* pem_pck_certificate,
+    size_t pem_pck_certificate_size,
+    const oe_sgx_endorsements_t* sgx_endorsements,
+    OE_SHA256* key)
+{
+    const size_t count =
+        OE_SGX_ENDORSEMENT_FIELD_CRL_ISSUER_CHAIN_PCK_CERT + 2;
+    const void* items[OE_SGX_ENDORSEMENT_FIELD_CRL_ISSUER_CHAIN_PCK_CERT + 2];
+    size_t sizes[OE_SGX_ENDORSEMENT_FIELD_CRL_ISSUER_CHAIN_PCK_CERT + 2];
+
+    items[0] = pem_pck_certificate;
+    sizes[0] = pem_pck_certificate_size;
+
+    for (size_t i = 1; i < count; i++)
+    {
+        items[i] = sgx_endorsements->items[i - 1].data;
+        sizes[i] = sgx_endorsements->items[i - 1].size;
+    }
+
+    return oe_sgx_verify_cache_key(
+        OE_SGX_VERIFY_CACHE_REVOCATION, items, sizes, count, key);
+}
+
 oe_result_t oe_get_sgx_quote_validity(
     const uint8_t* quote,
     const size_t quote_size,
@@ -587,11 +732,15 @@ oe_result_t oe_get_sgx_quote_validity(
     const uint8_t* pem_pck_certificate = NULL;
     size_t pem_pck_certificate_size = 0;
     oe_cert_chain_t pck_cert_chain = {0};
-
-    oe_cert_t root_cert = {0};
-    oe_cert_t intermediate_cert = {0};
     oe_cert_t pck_cert = {0};
 
+    OE_SHA256 chain_key;
+    OE_SHA256 revocation_key;
+    oe_sgx_verify_cache_entry_t chain_entry = {{0}};
+    oe_sgx_verify_cache_entry_t revocation_entry = {{0}};
+    bool has_chain = false;
+    bool has_revocation = false;
+
     oe_datetime_t latest_from = {0};
     oe_datetime_t earliest_until = {0};
     oe_datetime_t from;
@@ -617,54 +766,83 @@ oe_result_t oe_get_sgx_quote_validity(
     pem_pck_certificate = qe_cert_data.data;
     pem_pck_certificate_size = qe_cert_data.size;
 
-    OE_CHECK_MSG(
-        oe_get_quote_cert_chain_internal(
-            quote,
-            quote_size,
-            &pem_pck_certificate,
+    // The PCK cert chain only needs to be parsed if its validity dates or its
+    // revocation check with these endorsements are not cached.
+    {
+        const void* item = pem_pck_certificate;
+
+        OE_CHECK(oe_sgx_verify_cache_key(
+            OE_SGX_VERIFY_CACHE_PCK_CHAIN,
+            &item,
             &pem_pck_certificate_size,
-            &pck_cert_chain),
-        "Failed to retreive PCK cert chain. %s",
-        oe_result_str(result));
+            1,
+            &chain_key));
+        OE_CHECK(_get_revocation_cache_key(
+            pem_pck_certificate,
+            pem_pck_certificate_size,
+            sgx_endorsements,
+            &revocation_key));
 
-    // Fetch certificates.
-    OE_CHECK_MSG(
-        oe_cert_chain_get_leaf_cert(&pck_cert_chain, &pck_cert),
-        "Failed to get leaf certificate.",
-        NULL);
-    OE_CHECK_MSG(
-        oe_cert_chain_get_root_cert(&pck_cert_chain, &root_cert),
-        "Failed to get root certificate.",
-        NULL);
-    OE_CHECK_MSG(
-        oe_cert_chain_get_cert(&pck_cert_chain, 1, &intermediate_cert),
-        "Failed to get intermediate certificate.",
-        NULL);
+        has_chain = oe_sgx_verify_cache_get(&chain_key, &chain_entry);
+        has_revocation =
+            oe_sgx_verify_cache_get(&revocation_key, &revocation_entry);
+    }
 
-    // Process certs validity dates.
-    OE_CHECK_MSG(
-        oe_cert_get_validity_dates(&root_cert, &latest_from, &earliest_until),
-        "Failed to get validity info from cert. %s",
-        oe_result_str(result));
-    OE_CHECK_MSG(
-        oe_cert_get_validity_dates(&intermediate_cert, &from, &until),
-        "Failed to get validity info from cert. %s",
-        oe_result_str(result));
-    _update_validity(&latest_from, &earliest_until, &from, &until);
+    if (!has_chain || !has_revocation)
+    {
+        OE_CHECK_MSG(
+            oe_get_quote_cert_chain_internal(
+                quote,
+                quote_size,
+                &pem_pck_certificate,
+                &pem_pck_certificate_size,
+                &pck_cert_chain),
+            "Failed to retreive PCK cert chain. %s",
+            oe_result_str(result));
+        OE_CHECK_MSG(
+            oe_cert_chain_get_leaf_cert(&pck_cert_chain, &pck_cert),
+            "Failed to get leaf certificate.",
+            NULL);
+    }
 
-    OE_CHECK_MSG(
-        oe_cert_get_validity_dates(&pck_cert, &from, &until),
-        "Failed to get validity info from cert. %s",
-        oe_result_str(result));
-    _update_validity(&latest_from, &earliest_until, &from, &until);
+    // Process certs validity dates.
+    if (has_chain)
+    {
+        latest_from = chain_entry.from;
+        earliest_until = chain_entry.until;
+    }
+    else
+    {
+        OE_CHECK(_get_pck_cert_chain_validity(
+            &pck_cert_chain, &latest_from, &earliest_until));
+    }
 
     // Fetch revocation info validity dates.
-    OE_CHECK_MSG(
-        oe_validate_revocation_list(&pck_cert, sgx_endorsements, &from, &until),
+    if (!has_revocation)
+    {
+        OE_CHECK_MSG(
+            oe_validate_revocation_list(
+                &pck_cert,
+                sgx_endorsements,
+                &revocation_entry.from,
+                &revocation_entry.until),
 
-        "Failed to validate revocation info. %s",
-        oe_result_str(result));
-    _update_validity(&latest_from, &earliest_until, &from, &until);
+            "Failed to validate revocation info. %s",
+            oe_result_str(result));
+
+        // The check verified the PCK cert chain and the CRLs against the
+        // current time, so it must be redone when one of them expires.
+        revocation_entry.expires = revocation_entry.until;
+        if (oe_datetime_compare(&earliest_until, &revocation_entry.expires) <
+            0)
+            revocation_entry.expires = earliest_until;
+        oe_sgx_verify_cache_put(&revocation_key, &revocation_entry);
+    }
+    _update_validity(
+        &latest_from,
+        &earliest_until,
+        &revocation_entry.from,
+        &revocation_entry.until);
 
     // QE identity info validity dates.
     OE_CHECK_MSG(
@@ -690,8 +868,6 @@ oe_result_t oe_get_sgx_quote_validity(
 
 done:
     oe_cert_free(&pck_cert);
-    oe_cert_free(&intermediate_cert);
-    oe_cert_free(&root_cert);
     oe_cert_chain_free(&pck_cert_chain);
 
     return result;
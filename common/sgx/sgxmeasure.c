@@ -2,11 +2,53 @@
 // Licensed under the MIT License.
 
 #include "sgxmeasure.h"
+#include <string.h>
 #include <openenclave/bits/sgx/sgxtypes.h>
 #include <openenclave/host.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/trace.h>
 
+#define EEXTEND_CHUNK_SIZE 256
+
+/* Number of EADD records of pages that are not extended that are hashed with
+ * a single update. */
+#define EADD_BATCH_SIZE 64
+
+/* The data that EADD and EEXTEND add to the measurement. */
+typedef struct _eadd_record
+{
+    char op[8];
+    uint64_t offset;
+    uint64_t flags;
+    uint8_t reserved[40];
+} eadd_record_t;
+
+OE_STATIC_ASSERT(sizeof(eadd_record_t) == 64);
+
+typedef struct _eextend_record
+{
+    char op[8];
+    uint64_t offset;
+    uint8_t reserved[48];
+    uint8_t data[EEXTEND_CHUNK_SIZE];
+} eextend_record_t;
+
+OE_STATIC_ASSERT(sizeof(eextend_record_t) == 64 + EEXTEND_CHUNK_SIZE);
+
+/* The records of adding and extending one page. */
+typedef struct _page_records
+{
+    eadd_record_t eadd;
+    eextend_record_t eextend[OE_PAGE_SIZE / EEXTEND_CHUNK_SIZE];
+} page_records_t;
+
+static void _init_eadd_record(eadd_record_t* record, uint64_t flags)
+{
+    memset(record, 0, sizeof(*record));
+    memcpy(record->op, "EADD\0\0\0", sizeof(record->op));
+    record->flags = flags;
+}
+
 static void _measure_zeros(oe_sha256_context_t* context, size_t size)
 {
     char zeros[128] = {0};
@@ -26,28 +68,6 @@ static void _measure_zeros(oe_sha256_context_t* context, size_t size)
     }
 }
 
-static void _measure_eextend(
-    oe_sha256_context_t* context,
-    uint64_t vaddr,
-    uint64_t flags,
-    const void* page)
-{
-    uint64_t pgoff = 0;
-    const uint64_t CHUNK_SIZE = 256;
-    OE_UNUSED(flags);
-
-    /* Write this page one chunk at a time */
-    for (pgoff = 0; pgoff < OE_PAGE_SIZE; pgoff += CHUNK_SIZE)
-    {
-        const uint64_t moffset = vaddr + pgoff;
-
-        oe_sha256_update(context, "EEXTEND", 8);
-        oe_sha256_update(context, &moffset, sizeof(moffset));
-        _measure_zeros(context, 48);
-        oe_sha256_update(context, (const uint8_t*)page + pgoff, CHUNK_SIZE);
-    }
-}
-
 oe_result_t oe_sgx_measure_create_enclave(
     oe_sha256_context_t* context,
     sgx_secs_t* secs)
@@ -79,6 +99,88 @@ oe_result_t oe_sgx_measure_load_enclave_data(
     uint64_t src,
     uint64_t flags,
     bool extend)
+{
+    return oe_sgx_measure_load_enclave_pages(
+        context, base, addr, src, 1, OE_PAGE_SIZE, flags, extend);
+}
+
+static void _measure_eadd_pages(
+    oe_sha256_context_t* context,
+    uint64_t vaddr,
+    size_t npages,
+    uint64_t flags)
+{
+    eadd_record_t records[EADD_BATCH_SIZE];
+
+    for (size_t i = 0; i < OE_COUNTOF(records); i++)
+        _init_eadd_record(&records[i], flags);
+
+    while (npages)
+    {
+        const size_t n =
+            npages < OE_COUNTOF(records) ? npages : OE_COUNTOF(records);
+
+        for (size_t i = 0; i < n; i++)
+        {
+            records[i].offset = vaddr;
+            vaddr += OE_PAGE_SIZE;
+        }
+
+        oe_sha256_update(context, records, n * sizeof(records[0]));
+        npages -= n;
+    }
+}
+
+static void _measure_eextend_pages(
+    oe_sha256_context_t* context,
+    uint64_t vaddr,
+    uint64_t src,
+    size_t npages,
+    size_t src_stride,
+    uint64_t flags)
+{
+    page_records_t records;
+    const uint8_t* cached_page = NULL;
+
+    _init_eadd_record(&records.eadd, flags);
+    memset(records.eextend, 0, sizeof(records.eextend));
+    for (size_t i = 0; i < OE_COUNTOF(records.eextend); i++)
+        memcpy(records.eextend[i].op, "EEXTEND", sizeof(records.eextend[i].op));
+
+    for (size_t i = 0; i < npages; i++)
+    {
+        const uint8_t* page = (const uint8_t*)(src + i * src_stride);
+
+        records.eadd.offset = vaddr;
+
+        /* Only copy the data again if the page differs from the last one,
+         * e.g., not for stack pages, which all have the same content. */
+        for (size_t j = 0; j < OE_COUNTOF(records.eextend); j++)
+        {
+            records.eextend[j].offset = vaddr + j * EEXTEND_CHUNK_SIZE;
+
+            if (page != cached_page)
+                memcpy(
+                    records.eextend[j].data,
+                    page + j * EEXTEND_CHUNK_SIZE,
+                    EEXTEND_CHUNK_SIZE);
+        }
+
+        cached_page = page;
+        oe_sha256_update(context, &records, sizeof(records));
+        vaddr += OE_PAGE_SIZE;
+    }
+}
+
+oe_result_t oe_sgx_measure_load_enclave_pages(
+    oe_sha256_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    uint64_t src,
+    size_t npages,
+    size_t src_stride,
+    uint64_t flags,
+    bool extend)
 {
     oe_result_t result = OE_UNEXPECTED;
     uint64_t vaddr = addr - base;
@@ -86,15 +188,11 @@ oe_result_t oe_sgx_measure_load_enclave_data(
     if (!context || !base || !addr || !src || !flags || addr < base)
         OE_RAISE(OE_INVALID_PARAMETER);
 
-    /* Measure EADD */
-    oe_sha256_update(context, "EADD\0\0\0", 8);
-    oe_sha256_update(context, &vaddr, sizeof(vaddr));
-    oe_sha256_update(context, &flags, sizeof(flags));
-    _measure_zeros(context, 40);
-
-    /* Measure EEXTEND if requested */
+    /* Measure EADD and, if requested, EEXTEND of each page */
     if (extend)
-        _measure_eextend(context, vaddr, flags, (void*)src);
+        _measure_eextend_pages(context, vaddr, src, npages, src_stride, flags);
+    else
+        _measure_eadd_pages(context, vaddr, npages, flags);
 
     result = OE_OK;
 
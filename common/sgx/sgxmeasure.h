@@ -21,6 +21,22 @@ oe_result_t oe_sgx_measure_load_enclave_data(
     uint64_t flags,
     bool extend);
 
+/*
+ * Measure adding npages pages at addr, like npages calls to
+ * oe_sgx_measure_load_enclave_data(). The source page of the i-th page is at
+ * src + i * src_stride, so a src_stride of 0 measures npages copies of the
+ * same page.
+ */
+oe_result_t oe_sgx_measure_load_enclave_pages(
+    oe_sha256_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    uint64_t src,
+    size_t npages,
+    size_t src_stride,
+    uint64_t flags,
+    bool extend);
+
 oe_result_t oe_sgx_measure_initialize_enclave(
     oe_sha256_context_t* context,
     OE_SHA256* mrenclave);
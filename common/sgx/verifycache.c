@@ -0,0 +1,225 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include "verifycache.h"
+#include <openenclave/internal/datetime.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/utils.h>
+#include "../common.h"
+
+#ifdef OE_BUILD_ENCLAVE
+#include <openenclave/internal/thread.h>
+#else
+#include "../../host/hostthread.h"
+typedef oe_mutex oe_mutex_t;
+#define OE_MUTEX_INITIALIZER OE_H_MUTEX_INITIALIZER
+#endif
+
+/*
+**==============================================================================
+**
+** Cache of verification results.
+**
+** The results of the expensive steps of quote verification (parsing and
+** verifying certificate chains, CRLs and signed collateral) only depend on
+** their inputs and on the current time. The cache maps a digest of the inputs
+** to the result and drops it when one of the checked certificates or CRLs
+** expires.
+**
+** The cache is set associative: the first byte of the key selects a set, and
+** the least recently used entry of the set is replaced.
+**
+**==============================================================================
+*/
+
+#define CACHE_SETS 32
+#define CACHE_WAYS 8
+
+typedef struct _cache_slot
+{
+    bool used;
+    uint64_t last_used;
+    OE_SHA256 key;
+    oe_sgx_verify_cache_entry_t entry;
+} cache_slot_t;
+
+static struct
+{
+    oe_mutex_t lock;
+    uint64_t clock;
+    cache_slot_t slots[CACHE_SETS][CACHE_WAYS];
+} _cache = {OE_MUTEX_INITIALIZER};
+
+static bool _is_expired(const cache_slot_t* slot, const oe_datetime_t* now)
+{
+    return oe_datetime_compare(now, &slot->entry.expires) > 0;
+}
+
+oe_result_t oe_sgx_verify_cache_key(
+    oe_sgx_verify_cache_kind_t kind,
+    const void* const* items,
+    const size_t* sizes,
+    size_t count,
+    OE_SHA256* key)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_sha256_context_t context;
+    const uint32_t kind_value = (uint32_t)kind;
+
+    if (!items || !sizes || !key)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(oe_sha256_init(&context));
+    OE_CHECK(oe_sha256_update(&context, &kind_value, sizeof(kind_value)));
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint64_t size = sizes[i];
+
+        if (size && !items[i])
+            OE_RAISE(OE_INVALID_PARAMETER);
+
+        OE_CHECK(oe_sha256_update(&context, &size, sizeof(size)));
+        if (size)
+            OE_CHECK(oe_sha256_update(&context, items[i], sizes[i]));
+    }
+
+    OE_CHECK(oe_sha256_final(&context, key));
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_sgx_verify_cache_get_chain_expiry(
+    const oe_cert_chain_t* chain,
+    oe_datetime_t* expires)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    size_t length = 0;
+    oe_cert_t cert = {0};
+    oe_datetime_t from;
+    oe_datetime_t until;
+
+    if (!chain || !expires)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(oe_cert_chain_get_length(chain, &length));
+    if (length == 0)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    for (size_t i = 0; i < length; i++)
+    {
+        OE_CHECK(oe_cert_chain_get_cert(chain, i, &cert));
+        OE_CHECK(oe_cert_get_validity_dates(&cert, &from, &until));
+        OE_CHECK(oe_cert_free(&cert));
+
+        if (i == 0 || oe_datetime_compare(&until, expires) < 0)
+            *expires = until;
+    }
+
+    result = OE_OK;
+
+done:
+    oe_cert_free(&cert);
+    return result;
+}
+
+bool oe_sgx_verify_cache_get(
+    const OE_SHA256* key,
+    oe_sgx_verify_cache_entry_t* entry)
+{
+    bool found = false;
+    oe_datetime_t now;
+    cache_slot_t* set;
+
+    if (!key || !entry || oe_datetime_now(&now) != OE_OK)
+        return false;
+
+    set = _cache.slots[key->buf[0] % CACHE_SETS];
+
+    if (oe_mutex_lock(&_cache.lock) != 0)
+        return false;
+
+    for (size_t i = 0; i < CACHE_WAYS; i++)
+    {
+        cache_slot_t* const slot = &set[i];
+
+        if (!slot->used || memcmp(&slot->key, key, sizeof(*key)) != 0)
+            continue;
+
+        if (_is_expired(slot, &now))
+        {
+            slot->used = false;
+            break;
+        }
+
+        slot->last_used = ++_cache.clock;
+        *entry = slot->entry;
+        found = true;
+        break;
+    }
+
+    oe_mutex_unlock(&_cache.lock);
+
+    return found;
+}
+
+void oe_sgx_verify_cache_put(
+    const OE_SHA256* key,
+    const oe_sgx_verify_cache_entry_t* entry)
+{
+    oe_datetime_t now;
+    cache_slot_t* set;
+    cache_slot_t* victim = NULL;
+    uint64_t victim_last_used = 0;
+
+    if (!key || !entry || oe_datetime_now(&now) != OE_OK)
+        return;
+
+    set = _cache.slots[key->buf[0] % CACHE_SETS];
+
+    if (oe_mutex_lock(&_cache.lock) != 0)
+        return;
+
+    for (size_t i = 0; i < CACHE_WAYS; i++)
+    {
+        cache_slot_t* const slot = &set[i];
+        uint64_t last_used;
+
+        /* Replace the entry of the same key if there is one */
+        if (slot->used && memcmp(&slot->key, key, sizeof(*key)) == 0)
+        {
+            victim = slot;
+            break;
+        }
+
+        /* Free and expired slots are replaced before any live entry */
+        last_used =
+            (!slot->used || _is_expired(slot, &now)) ? 0 : slot->last_used;
+
+        if (!victim || last_used < victim_last_used)
+        {
+            victim = slot;
+            victim_last_used = last_used;
+        }
+    }
+
+    victim->used = true;
+    victim->last_used = ++_cache.clock;
+    victim->key = *key;
+    victim->entry = *entry;
+
+    oe_mutex_unlock(&_cache.lock);
+}
+
+void oe_sgx_verify_cache_clear(void)
+{
+    if (oe_mutex_lock(&_cache.lock) != 0)
+        return;
+
+    memset(_cache.slots, 0, sizeof(_cache.slots));
+
+    oe_mutex_unlock(&_cache.lock);
+}
@@ -0,0 +1,109 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#ifndef _OE_COMMON_SGX_VERIFYCACHE_H
+#define _OE_COMMON_SGX_VERIFYCACHE_H
+
+#include <openenclave/bits/defs.h>
+#include <openenclave/bits/result.h>
+#include <openenclave/bits/types.h>
+#include <openenclave/internal/crypto/cert.h>
+#include <openenclave/internal/crypto/sha.h>
+
+OE_EXTERNC_BEGIN
+
+/**
+ * The kinds of verification results that are cached. The kind is part of the
+ * key, so equal inputs of different kinds do not collide.
+ */
+typedef enum _oe_sgx_verify_cache_kind
+{
+    /* A PCK certificate chain that chains up to the Intel root key. The entry
+     * data holds the public key of the PCK certificate in PEM format. */
+    OE_SGX_VERIFY_CACHE_PCK_CHAIN,
+
+    /* A PCK certificate chain that passed oe_validate_revocation_list() with
+     * the given CRLs and TCB info. */
+    OE_SGX_VERIFY_CACHE_REVOCATION,
+
+    /* TCB info whose signature was verified with the given issuer chain. */
+    OE_SGX_VERIFY_CACHE_TCB_INFO,
+
+    /* QE identity whose signature was verified with the given issuer chain. */
+    OE_SGX_VERIFY_CACHE_QE_IDENTITY,
+} oe_sgx_verify_cache_kind_t;
+
+/**
+ * A cached verification result. 'from' and 'until' are the validity period
+ * that the verification returned. The entry is dropped once the current time
+ * is later than 'expires', which is the earliest notAfter or nextUpdate of the
+ * certificates and CRLs that the verification checked against the current
+ * time.
+ */
+typedef struct _oe_sgx_verify_cache_entry
+{
+    oe_datetime_t from;
+    oe_datetime_t until;
+    oe_datetime_t expires;
+    uint8_t data[256];
+    size_t data_size;
+} oe_sgx_verify_cache_entry_t;
+
+/**
+ * Computes the key of a cache entry from the given items. Each item is hashed
+ * together with its size.
+ *
+ * @param[in] kind The kind of the entry.
+ * @param[in] items The data items that the verification result depends on.
+ * @param[in] sizes The sizes of the items.
+ * @param[in] count The number of items.
+ * @param[out] key The key.
+ */
+oe_result_t oe_sgx_verify_cache_key(
+    oe_sgx_verify_cache_kind_t kind,
+    const void* const* items,
+    const size_t* sizes,
+    size_t count,
+    OE_SHA256* key);
+
+/**
+ * Gets the earliest notAfter date of the certificates in a chain.
+ *
+ * @param[in] chain The certificate chain.
+ * @param[out] expires The date at which the chain expires.
+ */
+oe_result_t oe_sgx_verify_cache_get_chain_expiry(
+    const oe_cert_chain_t* chain,
+    oe_datetime_t* expires);
+
+/**
+ * Looks up a verification result.
+ *
+ * @param[in] key The key computed by oe_sgx_verify_cache_key().
+ * @param[out] entry The cached result.
+ *
+ * @return true if an unexpired result was found.
+ */
+bool oe_sgx_verify_cache_get(
+    const OE_SHA256* key,
+    oe_sgx_verify_cache_entry_t* entry);
+
+/**
+ * Adds a successful verification result. If the cache is full, an expired or
+ * else the least recently used entry is replaced.
+ *
+ * @param[in] key The key computed by oe_sgx_verify_cache_key().
+ * @param[in] entry The result.
+ */
+void oe_sgx_verify_cache_put(
+    const OE_SHA256* key,
+    const oe_sgx_verify_cache_entry_t* entry);
+
+/**
+ * Removes all entries, e.g., after a verification setting changed.
+ */
+void oe_sgx_verify_cache_clear(void);
+
+OE_EXTERNC_END
+
+#endif // _OE_COMMON_SGX_VERIFYCACHE_H
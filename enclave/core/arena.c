@@ -12,6 +12,11 @@
 // The per-thread shared memory arena
 static __thread shared_memory_arena_t _arena = {0};
 
+// The per-thread shared memory arena for asynchronous switchless calls.
+// Allocations from it outlive other ocalls of the thread, so it is only
+// reset once all of them have been freed.
+static __thread shared_memory_arena_t _async_arena = {0};
+
 // Default shared memory arena capacity is 1 mb
 static size_t _capacity = 1024 * 1024;
 
@@ -30,24 +35,24 @@ bool oe_configure_arena_capacity(size_t cap)
     return true;
 }
 
-void* oe_arena_malloc(size_t size)
+static void* _arena_malloc(shared_memory_arena_t* arena, size_t size)
 {
     oe_result_t result = OE_UNEXPECTED;
     size_t total_size = 0;
     const size_t align = OE_EDGER8R_BUFFER_ALIGNMENT;
 
     // Create the anera if it hasn't been created.
-    if (_arena.buffer == NULL)
+    if (arena->buffer == NULL)
     {
-        _arena.capacity = __atomic_load_n(&_capacity, __ATOMIC_SEQ_CST);
-        void* buffer = oe_allocate_arena(_arena.capacity);
+        arena->capacity = __atomic_load_n(&_capacity, __ATOMIC_SEQ_CST);
+        void* buffer = oe_allocate_arena(arena->capacity);
         if (buffer == NULL)
         {
-            _arena.capacity = 0;
+            arena->capacity = 0;
             return NULL;
         }
-        _arena.buffer = (uint8_t*)buffer;
-        _arena.used = 0;
+        arena->buffer = (uint8_t*)buffer;
+        arena->used = 0;
     }
 
     // Round up to the nearest alignment size.
@@ -59,13 +64,13 @@ void* oe_arena_malloc(size_t size)
 
     // check for capacity
     size_t used_after;
-    OE_CHECK(oe_safe_add_sizet(_arena.used, total_size, &used_after));
+    OE_CHECK(oe_safe_add_sizet(arena->used, total_size, &used_after));
 
     // Ok if the incoming malloc puts us below the capacity.
-    if (used_after <= _arena.capacity)
+    if (used_after <= arena->capacity)
     {
-        uint8_t* addr = _arena.buffer + _arena.used;
-        _arena.used = used_after;
+        uint8_t* addr = arena->buffer + arena->used;
+        arena->used = used_after;
         return addr;
     }
 
@@ -73,6 +78,11 @@ done:
     return NULL;
 }
 
+void* oe_arena_malloc(size_t size)
+{
+    return _arena_malloc(&_arena, size);
+}
+
 void* oe_arena_calloc(size_t num, size_t size)
 {
     size_t total = 0;
@@ -92,10 +102,38 @@ void oe_arena_free_all()
     _arena.used = 0;
 }
 
+void* oe_async_arena_malloc(size_t size)
+{
+    void* ptr = _arena_malloc(&_async_arena, size);
+    if (ptr != NULL)
+        _async_arena.outstanding++;
+    return ptr;
+}
+
+bool oe_async_arena_free(void* ptr)
+{
+    uint8_t* p = (uint8_t*)ptr;
+
+    if (_async_arena.buffer == NULL || p < _async_arena.buffer ||
+        p >= _async_arena.buffer + _async_arena.capacity)
+        return false;
+
+    if (_async_arena.outstanding > 0 && --_async_arena.outstanding == 0)
+        _async_arena.used = 0;
+
+    return true;
+}
+
 // Free the arena in the current thread.
 void oe_teardown_arena()
 {
     if (_arena.buffer != NULL)
         oe_deallocate_arena(_arena.buffer);
     memset(&_arena, 0, sizeof(_arena));
+
+    // Host workers may still write to the buffers of asynchronous calls that
+    // were never completed. Leak the arena rather than freeing it under them.
+    if (_async_arena.buffer != NULL && _async_arena.outstanding == 0)
+        oe_deallocate_arena(_async_arena.buffer);
+    memset(&_async_arena, 0, sizeof(_async_arena));
 }
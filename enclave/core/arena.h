@@ -12,6 +12,8 @@ typedef struct _shared_memory_arena_t
     uint8_t* buffer;
     size_t capacity;
     size_t used;
+    /* Number of allocations that have not been freed yet */
+    size_t outstanding;
 } shared_memory_arena_t;
 
 bool oe_configure_arena_capacity(size_t cap);
@@ -24,4 +26,8 @@ void oe_arena_free_all();
 
 void oe_teardown_arena();
 
+void* oe_async_arena_malloc(size_t size);
+
+bool oe_async_arena_free(void* ptr);
+
 #endif /* _OE_ARENA_H */
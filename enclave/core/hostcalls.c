@@ -170,6 +170,25 @@ void oe_free_switchless_ocall_buffer(void* buffer)
     oe_arena_free_all();
 }
 
+// Function used by oeedger8r for allocating asynchronous switchless ocall
+// buffers. Unlike the buffers above, these stay alive while the thread makes
+// further OCALLs, so they come from a separate pool that is only recycled
+// once all of its buffers have been freed. Fall back to the host heap when
+// the pool is exhausted.
+void* oe_allocate_switchless_async_ocall_buffer(size_t size)
+{
+    void* buffer = oe_async_arena_malloc(size);
+    return buffer ? buffer : oe_host_malloc(size);
+}
+
+// Function used by oeedger8r for freeing asynchronous switchless ocall
+// buffers.
+void oe_free_switchless_async_ocall_buffer(void* buffer)
+{
+    if (buffer && !oe_async_arena_free(buffer))
+        oe_host_free(buffer);
+}
+
 int oe_host_write(int device, const char* str, size_t len)
 {
     if (oe_write_ocall(device, str, len) != OE_OK)
@@ -0,0 +1,338 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/corelibc/stdlib.h>
+#include <openenclave/corelibc/string.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/hostpool.h>
+#include <openenclave/internal/thread.h>
+
+/*
+**==============================================================================
+**
+** Pool of untrusted memory for ocall buffers and shared memory arenas.
+**
+** The pool reserves large host regions with a single OE_OCALL_MALLOC and
+** carves them into power-of-two blocks, so that allocating and freeing an
+** ocall buffer usually does not leave the enclave. Each region serves one
+** size class. All bookkeeping is kept in enclave memory; the host only ever
+** sees the blocks themselves.
+**
+** Blocks are handed out through small per-thread caches that are refilled
+** from and flushed to the regions in batches. The caches are flushed when
+** the outermost ECALL of a thread returns, because TLS is cleared then.
+**
+** A block is in use while its bit in the used bitmap is set. The cached bitmap
+** marks the blocks of the used bitmap that sit in a thread cache. Every free
+** sets the cached bit, so that a double free is detected right away, even if
+** the block is still cached by another thread.
+**
+**==============================================================================
+*/
+
+#define MIN_SHIFT 6  /* 64 bytes */
+#define MAX_SHIFT 20 /* 1 MiB, the default switchless arena capacity */
+#define NUM_CLASSES (MAX_SHIFT - MIN_SHIFT + 1)
+#define REGION_SIZE ((size_t)4 << 20)
+#define MAX_REGIONS 128
+#define CACHE_SIZE 8
+#define CACHE_BATCH 4
+
+typedef struct _region
+{
+    /* Set before the region is published and never changed afterwards */
+    uint8_t* base;
+    size_t size_class;
+    size_t num_blocks;
+
+    /* Protected by _lock. The bits of used are also read without it. */
+    size_t num_free;
+    size_t hint;
+    uint64_t* used;
+
+    /* Changed atomically */
+    uint64_t* cached;
+} region_t;
+
+typedef struct _block_cache
+{
+    size_t count;
+    void* blocks[CACHE_SIZE];
+    region_t* regions[CACHE_SIZE];
+} block_cache_t;
+
+static region_t _regions[MAX_REGIONS];
+static size_t _num_regions;
+static oe_spinlock_t _lock = OE_SPINLOCK_INITIALIZER;
+
+static __thread block_cache_t _caches[NUM_CLASSES];
+
+static size_t _block_size(size_t size_class)
+{
+    return (size_t)1 << (size_class + MIN_SHIFT);
+}
+
+static size_t _size_to_class(size_t size)
+{
+    size_t size_class = 0;
+
+    while (_block_size(size_class) < size)
+        size_class++;
+
+    return size_class;
+}
+
+/* Find the region containing ptr without taking the lock. */
+static region_t* _find_region(const void* ptr)
+{
+    const uint8_t* p = (const uint8_t*)ptr;
+    const size_t n = __atomic_load_n(&_num_regions, __ATOMIC_ACQUIRE);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        region_t* region = &_regions[i];
+
+        if (p >= region->base && p < region->base + REGION_SIZE)
+            return region;
+    }
+
+    return NULL;
+}
+
+/* Get the bitmap word and mask of a block. Aborts if ptr is not a block. */
+static size_t _block_bit(
+    const region_t* region,
+    const void* ptr,
+    uint64_t* mask)
+{
+    const size_t block_size = _block_size(region->size_class);
+    const size_t offset = (size_t)((const uint8_t*)ptr - region->base);
+    const size_t index = offset / block_size;
+
+    if (offset % block_size)
+        oe_abort();
+
+    *mask = (uint64_t)1 << (index % 64);
+    return index / 64;
+}
+
+/* Push a block onto the cache and mark it as cached. Aborts if the block is
+ * not in use or already cached, which means that it is freed twice. */
+static void _push(block_cache_t* cache, region_t* region, void* ptr)
+{
+    uint64_t mask;
+    const size_t word = _block_bit(region, ptr, &mask);
+
+    if (!(__atomic_load_n(&region->used[word], __ATOMIC_RELAXED) & mask) ||
+        __atomic_fetch_or(&region->cached[word], mask, __ATOMIC_RELAXED) &
+            mask)
+        oe_abort();
+
+    cache->blocks[cache->count] = ptr;
+    cache->regions[cache->count++] = region;
+}
+
+static void* _pop(block_cache_t* cache)
+{
+    void* ptr = cache->blocks[--cache->count];
+    region_t* region = cache->regions[cache->count];
+    uint64_t mask;
+    const size_t word = _block_bit(region, ptr, &mask);
+
+    __atomic_fetch_and(&region->cached[word], ~mask, __ATOMIC_RELAXED);
+    return ptr;
+}
+
+/* Move up to count free blocks from the region to the cache. Called with
+ * _lock held. */
+static size_t _take_blocks(
+    region_t* region,
+    block_cache_t* cache,
+    size_t count)
+{
+    const size_t num_words = (region->num_blocks + 63) / 64;
+    const size_t block_size = _block_size(region->size_class);
+    size_t n = 0;
+
+    for (size_t i = 0; i < num_words && n < count && region->num_free; i++)
+    {
+        const size_t word = (region->hint + i) % num_words;
+        uint64_t free_bits = ~region->used[word];
+
+        /* Mask out the bits past the last block */
+        if (word == num_words - 1 && region->num_blocks % 64)
+            free_bits &= ((uint64_t)1 << (region->num_blocks % 64)) - 1;
+
+        while (free_bits && n < count)
+        {
+            const size_t bit = (size_t)__builtin_ctzll(free_bits);
+            free_bits &= free_bits - 1;
+
+            __atomic_store_n(
+                &region->used[word],
+                region->used[word] | (uint64_t)1 << bit,
+                __ATOMIC_RELAXED);
+            region->num_free--;
+            _push(cache, region, region->base + (word * 64 + bit) * block_size);
+            n++;
+        }
+
+        region->hint = word;
+    }
+
+    return n;
+}
+
+/* Return a cached block to its region. Called with _lock held. */
+static void _give_block(region_t* region, void* ptr)
+{
+    uint64_t mask;
+    const size_t word = _block_bit(region, ptr, &mask);
+
+    __atomic_fetch_and(&region->cached[word], ~mask, __ATOMIC_RELAXED);
+    __atomic_store_n(
+        &region->used[word], region->used[word] & ~mask, __ATOMIC_RELAXED);
+    region->num_free++;
+}
+
+static size_t _refill(size_t size_class, block_cache_t* cache, size_t count)
+{
+    region_t region = {0};
+    size_t n = 0;
+
+    oe_spin_lock(&_lock);
+    {
+        for (size_t i = 0; i < _num_regions && n < count; i++)
+            if (_regions[i].size_class == size_class)
+                n += _take_blocks(&_regions[i], cache, count - n);
+    }
+    oe_spin_unlock(&_lock);
+
+    if (n)
+        return n;
+
+    /* Reserve a new region outside of the lock since this needs an OCALL */
+    region.size_class = size_class;
+    region.num_blocks = REGION_SIZE / _block_size(size_class);
+    region.num_free = region.num_blocks;
+
+    /* The cached bitmap follows the used bitmap */
+    if (!(region.used = oe_calloc((region.num_blocks + 63) / 64, 16)))
+        return 0;
+
+    region.cached = region.used + (region.num_blocks + 63) / 64;
+
+    if (!(region.base = oe_host_malloc(REGION_SIZE)))
+    {
+        oe_free(region.used);
+        return 0;
+    }
+
+    oe_spin_lock(&_lock);
+    if (_num_regions < MAX_REGIONS)
+    {
+        region_t* p = &_regions[_num_regions];
+
+        *p = region;
+        n = _take_blocks(p, cache, count);
+        __atomic_store_n(&_num_regions, _num_regions + 1, __ATOMIC_RELEASE);
+        region.base = NULL;
+    }
+    oe_spin_unlock(&_lock);
+
+    /* The pool is exhausted */
+    if (region.base)
+    {
+        oe_host_free(region.base);
+        oe_free(region.used);
+    }
+
+    return n;
+}
+
+static void _flush(block_cache_t* cache, size_t count)
+{
+    oe_spin_lock(&_lock);
+    {
+        while (count--)
+        {
+            cache->count--;
+            _give_block(
+                cache->regions[cache->count], cache->blocks[cache->count]);
+        }
+    }
+    oe_spin_unlock(&_lock);
+}
+
+void* oe_host_pool_malloc(size_t size)
+{
+    block_cache_t* cache;
+
+    if (size > _block_size(NUM_CLASSES - 1))
+        return oe_host_malloc(size);
+
+    cache = &_caches[_size_to_class(size)];
+
+    if (cache->count == 0)
+        _refill((size_t)(cache - _caches), cache, CACHE_BATCH);
+
+    if (cache->count == 0)
+        return oe_host_malloc(size);
+
+    return _pop(cache);
+}
+
+void oe_host_pool_free(void* ptr)
+{
+    region_t* region;
+    block_cache_t* cache;
+
+    if (!ptr)
+        return;
+
+    if (!(region = _find_region(ptr)))
+    {
+        oe_host_free(ptr);
+        return;
+    }
+
+    cache = &_caches[region->size_class];
+
+    if (cache->count == CACHE_SIZE)
+        _flush(cache, CACHE_BATCH);
+
+    _push(cache, region, ptr);
+}
+
+void oe_teardown_host_pool_cache(void)
+{
+    for (size_t i = 0; i < NUM_CLASSES; i++)
+    {
+        if (_caches[i].count)
+            _flush(&_caches[i], _caches[i].count);
+    }
+}
+
+void oe_teardown_host_pool(void)
+{
+    oe_teardown_host_pool_cache();
+
+    oe_spin_lock(&_lock);
+    {
+        for (size_t i = 0; i < _num_regions; i++)
+        {
+            region_t* region = &_regions[i];
+
+            // Blocks of asynchronous switchless calls that never completed may
+            // still be in use by host workers. Leak such regions.
+            if (region->num_free == region->num_blocks)
+                oe_host_free(region->base);
+
+            oe_free(region->used);
+        }
+
+        memset(_regions, 0, sizeof(_regions));
+        __atomic_store_n(&_num_regions, 0, __ATOMIC_RELEASE);
+    }
+    oe_spin_unlock(&_lock);
+}
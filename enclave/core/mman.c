@@ -3,11 +3,29 @@
 
 /*
 This mmap implementation manages the whole enclave heap memory. The first pages
-are reserved for a bitmap that saves the state of all other pages: 1 if the page
-is in use, 0 otherwise.
+are reserved for the allocator metadata:
+- a bitmap that saves the state of all other pages: 1 if the page is in use, 0
+  otherwise,
+- a bitmap that marks in-use pages that are held by a thread cache, and
+- an extent tag for each page.
 malloc calls mmap to reserve enclave heap space.
+
+Free pages are kept in maximal extents. The first and the last page of a free
+extent are tagged with its page count, so that neighbors can be coalesced in
+constant time. Free extents are linked into bins by size: one bin per page count
+for small extents and one bin per power of two for larger ones.
+
+Each thread caches a few small ranges it has unmapped and reuses them for
+mappings of the same size without taking the lock. Cached pages stay in use in
+the bitmap. Whoever atomically clears the cached bit of a page owns it: the
+thread that reuses the range, or a MAP_FIXED mapping or a reclaim pass when the
+heap is exhausted.
+
+Heap pages are not measured when the enclave is loaded, so their initial
+content is not trusted and every mapping is cleared.
 */
 
+#include "mman.h"
 #include <openenclave/corelibc/assert.h>
 #include <openenclave/corelibc/errno.h>
 #include <openenclave/corelibc/mman.h>
@@ -17,20 +35,290 @@ malloc calls mmap to reserve enclave heap space.
 #include <openenclave/internal/thread.h>
 #include <openenclave/internal/utils.h>
 
+/* Marks the end of a bin list. */
+#define EXTENT_NONE OE_UINT32_MAX
+
+/* Extents of up to this many pages have a bin of their own. */
+#define EXACT_BINS 32
+
+/* The remaining bins each hold extents of a power-of-two size range. */
+#define BIN_COUNT 64
+
+/* Number of ranges a thread can cache. */
+#define CACHE_ENTRIES 4
+
+/* Largest range (in pages) that a thread caches. */
+#define CACHE_MAX_PAGES 256
+
+typedef struct _extent
+{
+    /* Page count, valid on the first and the last page of a free extent. */
+    uint32_t count;
+
+    /* Bin list links, valid on the first page of a free extent. */
+    uint32_t next;
+    uint32_t prev;
+} extent_t;
+
+typedef struct _cache_entry
+{
+    uint32_t pos;
+    uint32_t count;
+} cache_entry_t;
+
+typedef struct _page_cache
+{
+    size_t size;
+    cache_entry_t entries[CACHE_ENTRIES];
+} page_cache_t;
+
 static oe_spinlock_t _lock = OE_SPINLOCK_INITIALIZER;
-static void* _bitset;
+static uint64_t* _bitset;
+static uint64_t* _cached;
+static extent_t* _extents;
 static void* _base;
 static size_t _size;
+static size_t _num_pages;
+
+static uint32_t _bins[BIN_COUNT];
+static uint64_t _bin_mask;
+
+static __thread page_cache_t _cache;
+
+/*
+**==============================================================================
+**
+** Bitmaps
+**
+**==============================================================================
+*/
+
+static bool _test(const uint64_t* bitset, size_t pos)
+{
+    const uint64_t word = __atomic_load_n(&bitset[pos / 64], __ATOMIC_RELAXED);
+    return word & (1ull << (pos % 64));
+}
+
+/* Returns the position after the last set bit before pos, or 0. */
+static size_t _find_prev_set(const uint64_t* bitset, size_t pos)
+{
+    size_t i = pos / 64;
+    uint64_t word = bitset[i] & ((1ull << (pos % 64)) - 1);
+
+    while (!word)
+    {
+        if (i == 0)
+            return 0;
+        word = bitset[--i];
+    }
+
+    return i * 64 + 64 - (size_t)__builtin_clzll(word);
+}
+
+/*
+ * Atomically clears the cached bits in the given range. Stores the bits that
+ * have been cleared by this call in claimed (if not NULL) and returns whether
+ * all bits were set.
+ */
+static bool _claim_cached(size_t pos, size_t count, uint64_t* claimed)
+{
+    bool all = true;
+    const size_t end = pos + count;
+
+    for (size_t i = pos / 64; i * 64 < end; i++)
+    {
+        const size_t first = i * 64 < pos ? pos % 64 : 0;
+        const size_t last = (i + 1) * 64 > end ? end % 64 : 64;
+        const uint64_t mask =
+            (last == 64 ? ~0ull : (1ull << last) - 1) & ~((1ull << first) - 1);
+        const uint64_t old =
+            __atomic_fetch_and(&_cached[i], ~mask, __ATOMIC_ACQ_REL);
+
+        if ((old & mask) != mask)
+            all = false;
+        if (claimed)
+            claimed[i - pos / 64] = old & mask;
+    }
+
+    return all;
+}
+
+/*
+**==============================================================================
+**
+** Free extents
+**
+**==============================================================================
+*/
+
+static size_t _bin_index(size_t count)
+{
+    if (count <= EXACT_BINS)
+        return count - 1;
+
+    const size_t index =
+        EXACT_BINS + (63 - (size_t)__builtin_clzll(count)) - 5;
+    return index < BIN_COUNT ? index : BIN_COUNT - 1;
+}
+
+static void _insert_extent(size_t pos, size_t count)
+{
+    const size_t bin = _bin_index(count);
+    extent_t* const extent = &_extents[pos];
+
+    extent->count = (uint32_t)count;
+    _extents[pos + count - 1].count = (uint32_t)count;
+
+    extent->prev = EXTENT_NONE;
+    extent->next = _bins[bin];
+    if (extent->next != EXTENT_NONE)
+        _extents[extent->next].prev = (uint32_t)pos;
+    _bins[bin] = (uint32_t)pos;
+    _bin_mask |= 1ull << bin;
+}
+
+static void _remove_extent(size_t pos)
+{
+    const extent_t* const extent = &_extents[pos];
+    const size_t bin = _bin_index(extent->count);
+
+    if (extent->prev == EXTENT_NONE)
+        _bins[bin] = extent->next;
+    else
+        _extents[extent->prev].next = extent->next;
+
+    if (extent->next != EXTENT_NONE)
+        _extents[extent->next].prev = extent->prev;
+
+    if (_bins[bin] == EXTENT_NONE)
+        _bin_mask &= ~(1ull << bin);
+}
+
+/* Returns the first page of a free extent with at least count pages. */
+static size_t _find_extent(size_t count)
+{
+    const size_t bin = _bin_index(count);
+
+    // Extents in a power-of-two bin may be smaller than requested.
+    if (count > EXACT_BINS)
+        for (uint32_t pos = _bins[bin]; pos != EXTENT_NONE;
+             pos = _extents[pos].next)
+            if (_extents[pos].count >= count)
+                return pos;
+
+    const size_t first = count > EXACT_BINS ? bin + 1 : bin;
+    if (first >= BIN_COUNT)
+        return OE_SIZE_MAX;
+
+    const uint64_t mask = _bin_mask & (~0ull << first);
+    if (!mask)
+        return OE_SIZE_MAX;
+
+    return _bins[__builtin_ctzll(mask)];
+}
+
+/* Marks the given pages as in use. They must be part of a single extent. */
+static void _take(size_t extent_pos, size_t pos, size_t count)
+{
+    const size_t extent_end = extent_pos + _extents[extent_pos].count;
+
+    _remove_extent(extent_pos);
+
+    if (extent_pos < pos)
+        _insert_extent(extent_pos, pos - extent_pos);
+    if (pos + count < extent_end)
+        _insert_extent(pos + count, extent_end - pos - count);
+
+    oe_bitset_set_range(_bitset, pos, count);
+}
+
+/* Marks the given in-use pages as free and coalesces them with neighbors. */
+static void _release(size_t pos, size_t count)
+{
+    oe_bitset_reset_range(_bitset, pos, count);
+
+    if (pos > 0 && !_test(_bitset, pos - 1))
+    {
+        const size_t prev_count = _extents[pos - 1].count;
+        pos -= prev_count;
+        count += prev_count;
+        _remove_extent(pos);
+    }
+
+    const size_t end = pos + count;
+    if (end < _num_pages && !_test(_bitset, end))
+    {
+        count += _extents[end].count;
+        _remove_extent(end);
+    }
+
+    _insert_extent(pos, count);
+}
+
+/* Releases the pages whose cached bits have been claimed. */
+static void _release_claimed(size_t pos, size_t count, const uint64_t* claimed)
+{
+    size_t run = 0;
+
+    for (size_t i = pos; i < pos + count; i++)
+    {
+        const size_t bit = i - pos / 64 * 64;
+
+        if (claimed[bit / 64] & (1ull << (bit % 64)))
+            run++;
+        else if (run)
+        {
+            _release(i - run, run);
+            run = 0;
+        }
+    }
+
+    if (run)
+        _release(pos + count - run, run);
+}
+
+/* Returns all cached pages of all threads to the free extents. */
+static bool _reclaim_cached(void)
+{
+    bool reclaimed = false;
+
+    for (size_t i = 0; i * 64 < _num_pages; i++)
+    {
+        const uint64_t claimed =
+            __atomic_exchange_n(&_cached[i], 0, __ATOMIC_ACQ_REL);
+
+        if (claimed)
+        {
+            _release_claimed(i * 64, 64, &claimed);
+            reclaimed = true;
+        }
+    }
+
+    return reclaimed;
+}
 
 static void _init()
 {
     const size_t full_size = __oe_get_heap_size();
-    const size_t bitmap_size =
-        oe_round_up_to_page_size(full_size / (OE_CHAR_BIT * OE_PAGE_SIZE));
-    _bitset = (void*)__oe_get_heap_base();
-    _base = (uint8_t*)_bitset + bitmap_size;
-    _size = full_size - bitmap_size;
-    memset(_bitset, 0, bitmap_size);
+    const size_t full_pages = full_size / OE_PAGE_SIZE;
+    const size_t bitmap_size = oe_round_up_to_multiple(full_pages, 64) / 8;
+    const size_t meta_size = oe_round_up_to_page_size(
+        2 * bitmap_size + full_pages * sizeof(extent_t));
+
+    _bitset = (uint64_t*)__oe_get_heap_base();
+    _cached = (uint64_t*)((uint8_t*)_bitset + bitmap_size);
+    _extents = (extent_t*)((uint8_t*)_cached + bitmap_size);
+    memset(_bitset, 0, 2 * bitmap_size);
+
+    _size = full_size - meta_size;
+    _num_pages = _size / OE_PAGE_SIZE;
+
+    for (size_t i = 0; i < BIN_COUNT; i++)
+        _bins[i] = EXTENT_NONE;
+    _bin_mask = 0;
+    _insert_extent(0, _num_pages);
+
+    __atomic_store_n(&_base, (uint8_t*)_bitset + meta_size, __ATOMIC_RELEASE);
 }
 
 static bool _length_in_range(size_t length)
@@ -48,15 +336,116 @@ static size_t _to_pos(const void* addr)
     return (size_t)((uint8_t*)addr - (uint8_t*)_base) / OE_PAGE_SIZE;
 }
 
+static void* _to_addr(size_t pos)
+{
+    return (uint8_t*)_base + pos * OE_PAGE_SIZE;
+}
+
+/*
+**==============================================================================
+**
+** Thread cache
+**
+**==============================================================================
+*/
+
+/* Caches the given range if it is small and fully mapped. */
+static bool _cache_push(void* addr, size_t length)
+{
+    const size_t count = length / OE_PAGE_SIZE;
+
+    if (!__atomic_load_n(&_base, __ATOMIC_ACQUIRE) || count > CACHE_MAX_PAGES ||
+        _cache.size == CACHE_ENTRIES || (uintptr_t)addr % OE_PAGE_SIZE ||
+        !_addr_in_range(addr, length))
+        return false;
+
+    const size_t pos = _to_pos(addr);
+
+    for (size_t i = pos; i < pos + count; i++)
+        if (!_test(_bitset, i) || _test(_cached, i))
+            return false;
+
+    for (size_t i = pos; i < pos + count; i++)
+        __atomic_fetch_or(&_cached[i / 64], 1ull << (i % 64), __ATOMIC_RELEASE);
+
+    _cache.entries[_cache.size].pos = (uint32_t)pos;
+    _cache.entries[_cache.size].count = (uint32_t)count;
+    _cache.size++;
+
+    return true;
+}
+
+static void _cache_remove(size_t index)
+{
+    _cache.entries[index] = _cache.entries[--_cache.size];
+}
+
+/* Takes a cached range of the given size, or returns NULL. */
+static void* _cache_pop(size_t length)
+{
+    const size_t count = length / OE_PAGE_SIZE;
+    uint64_t claimed[CACHE_MAX_PAGES / 64 + 1];
+
+    for (size_t i = 0; i < _cache.size;)
+    {
+        const cache_entry_t entry = _cache.entries[i];
+
+        if (entry.count != count)
+        {
+            i++;
+            continue;
+        }
+
+        _cache_remove(i);
+
+        if (_claim_cached(entry.pos, entry.count, claimed))
+            return _to_addr(entry.pos);
+
+        // Some pages have been taken by another thread. Give the rest back.
+        oe_spin_lock(&_lock);
+        _release_claimed(entry.pos, entry.count, claimed);
+        oe_spin_unlock(&_lock);
+    }
+
+    return NULL;
+}
+
+void oe_teardown_mman_cache(void)
+{
+    uint64_t claimed[CACHE_MAX_PAGES / 64 + 1];
+
+    if (!_cache.size)
+        return;
+
+    oe_spin_lock(&_lock);
+
+    while (_cache.size)
+    {
+        const cache_entry_t entry = _cache.entries[--_cache.size];
+        _claim_cached(entry.pos, entry.count, claimed);
+        _release_claimed(entry.pos, entry.count, claimed);
+    }
+
+    oe_spin_unlock(&_lock);
+}
+
+/*
+**==============================================================================
+**
+** Mappings
+**
+**==============================================================================
+*/
+
 static void* _map(size_t length)
 {
     oe_assert(length && length % OE_PAGE_SIZE == 0);
 
-    // Naive approach: reserve the first unset range we can find.
-
     const size_t count = length / OE_PAGE_SIZE;
-    const size_t pos =
-        oe_bitset_find_unset_range(_bitset, _size / OE_PAGE_SIZE, count);
+    size_t pos = _find_extent(count);
+
+    if (pos == OE_SIZE_MAX && _reclaim_cached())
+        pos = _find_extent(count);
 
     if (pos == OE_SIZE_MAX)
     {
@@ -64,10 +453,8 @@ static void* _map(size_t length)
         return OE_MAP_FAILED;
     }
 
-    oe_bitset_set_range(_bitset, pos, count);
-    void* const result = (uint8_t*)_base + pos * OE_PAGE_SIZE;
-    memset(result, 0, length);
-    return result;
+    _take(pos, pos, count);
+    return _to_addr(pos);
 }
 
 static void* _map_fixed(void* addr, size_t length)
@@ -78,12 +465,55 @@ static void* _map_fixed(void* addr, size_t length)
         return OE_MAP_FAILED;
     }
 
-    // MAP_FIXED discards overlapped part of existing mappings
-    oe_bitset_set_range(_bitset, _to_pos(addr), length / OE_PAGE_SIZE);
-    memset(addr, 0, length);
+    // MAP_FIXED discards overlapped part of existing mappings, including
+    // ranges cached by threads.
+    const size_t first = _to_pos(addr);
+    const size_t end = first + length / OE_PAGE_SIZE;
+
+    _claim_cached(first, end - first, NULL);
+
+    for (size_t pos = first; pos < end;)
+    {
+        if (_test(_bitset, pos))
+        {
+            pos++;
+            continue;
+        }
+
+        const size_t extent_pos =
+            pos == first ? _find_prev_set(_bitset, pos) : pos;
+        const size_t extent_end = extent_pos + _extents[extent_pos].count;
+        const size_t take_end = extent_end < end ? extent_end : end;
+
+        _take(extent_pos, pos, take_end - pos);
+        pos = take_end;
+    }
+
     return addr;
 }
 
+static void _unmap(void* addr, size_t length)
+{
+    const size_t first = _to_pos(addr);
+    const size_t end = first + length / OE_PAGE_SIZE;
+    size_t run = 0;
+
+    // Pages that are free or cached are not mapped.
+    for (size_t pos = first; pos < end; pos++)
+    {
+        if (_test(_bitset, pos) && !_test(_cached, pos))
+            run++;
+        else if (run)
+        {
+            _release(pos - run, run);
+            run = 0;
+        }
+    }
+
+    if (run)
+        _release(end - run, run);
+}
+
 void* oe_mmap(
     void* addr,
     size_t length,
@@ -112,6 +542,15 @@ void* oe_mmap(
     length = oe_round_up_to_page_size(length);
     void* result = OE_MAP_FAILED;
 
+    if (!addr && flags == (OE_MAP_ANON | OE_MAP_PRIVATE) &&
+        (result = _cache_pop(length)))
+    {
+        memset(result, 0, length);
+        return result;
+    }
+
+    result = OE_MAP_FAILED;
+
     oe_spin_lock(&_lock);
 
     if (!_base)
@@ -133,6 +572,11 @@ void* oe_mmap(
 
     oe_spin_unlock(&_lock);
 
+    // The pages are owned by the caller now, so they can be cleared without
+    // holding the lock.
+    if (result != OE_MAP_FAILED)
+        memset(result, 0, length);
+
     return result;
 }
 
@@ -141,12 +585,15 @@ int oe_munmap(void* addr, size_t length)
     int result = -1;
     length = oe_round_up_to_page_size(length);
 
+    if (length && _cache_push(addr, length))
+        return 0;
+
     oe_spin_lock(&_lock);
 
     if (_length_in_range(length) && _addr_in_range(addr, length) &&
         (uintptr_t)addr % OE_PAGE_SIZE == 0)
     {
-        oe_bitset_reset_range(_bitset, _to_pos(addr), length / OE_PAGE_SIZE);
+        _unmap(addr, length);
         result = 0;
     }
     else
@@ -157,8 +604,106 @@ int oe_munmap(void* addr, size_t length)
     return result;
 }
 
+void* oe_mremap(
+    void* old_address,
+    size_t old_size,
+    size_t new_size,
+    int flags,
+    ...)
+{
+    void* result = OE_MAP_FAILED;
+    size_t pos;
+    size_t old_count;
+    size_t new_count;
+    size_t end;
+
+    // check for invalid args
+    if ((uintptr_t)old_address % OE_PAGE_SIZE || !old_size || !new_size ||
+        (flags & ~OE_MREMAP_MAYMOVE))
+    {
+        oe_errno = OE_EINVAL;
+        return result;
+    }
+
+    old_size = oe_round_up_to_page_size(old_size);
+    new_size = oe_round_up_to_page_size(new_size);
+
+    oe_spin_lock(&_lock);
+
+    if (!_base || !_length_in_range(old_size) ||
+        !_addr_in_range(old_address, old_size))
+    {
+        oe_errno = OE_EFAULT;
+        goto done;
+    }
+
+    if (!_length_in_range(new_size))
+    {
+        oe_errno = OE_ENOMEM;
+        goto done;
+    }
+
+    pos = _to_pos(old_address);
+    old_count = old_size / OE_PAGE_SIZE;
+    new_count = new_size / OE_PAGE_SIZE;
+
+    // The old range must be mapped.
+    for (size_t i = pos; i < pos + old_count; i++)
+    {
+        if (!_test(_bitset, i) || _test(_cached, i))
+        {
+            oe_errno = OE_EFAULT;
+            goto done;
+        }
+    }
+
+    if (new_count <= old_count)
+    {
+        if (new_count < old_count)
+            _release(pos + new_count, old_count - new_count);
+        result = old_address;
+        goto done;
+    }
+
+    // Grow in place if the following extent is large enough.
+    end = pos + old_count;
+    if (end < _num_pages && !_test(_bitset, end) &&
+        _extents[end].count >= new_count - old_count)
+    {
+        _take(end, end, new_count - old_count);
+        oe_spin_unlock(&_lock);
+        memset(_to_addr(end), 0, new_size - old_size);
+        return old_address;
+    }
+
+    if (!(flags & OE_MREMAP_MAYMOVE))
+    {
+        oe_errno = OE_ENOMEM;
+        goto done;
+    }
+
+    result = _map(new_size);
+    oe_spin_unlock(&_lock);
+
+    if (result == OE_MAP_FAILED)
+        return result;
+
+    memcpy(result, old_address, old_size);
+    memset((uint8_t*)result + old_size, 0, new_size - old_size);
+
+    oe_spin_lock(&_lock);
+    _release(pos, old_count);
+
+done:
+    oe_spin_unlock(&_lock);
+
+    return result;
+}
+
 OE_WEAK_ALIAS(oe_mmap, mmap);
 OE_WEAK_ALIAS(oe_mmap, __mmap);
 OE_WEAK_ALIAS(oe_mmap, mmap64);
 OE_WEAK_ALIAS(oe_munmap, munmap);
 OE_WEAK_ALIAS(oe_munmap, __munmap);
+OE_WEAK_ALIAS(oe_mremap, mremap);
+OE_WEAK_ALIAS(oe_mremap, __mremap);
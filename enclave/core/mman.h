@@ -0,0 +1,10 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#ifndef _OE_MMAN_H
+#define _OE_MMAN_H
+
+/* Returns the pages cached by the calling thread to the enclave heap. */
+void oe_teardown_mman_cache(void);
+
+#endif /* _OE_MMAN_H */
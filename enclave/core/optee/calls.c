@@ -56,6 +56,23 @@ done:
     return result;
 }
 
+void oe_prefer_switchless_ocall(bool prefer)
+{
+    // Switchless calls for op-tee: TODO
+    OE_UNUSED(prefer);
+}
+
+oe_result_t oe_end_switchless_ocall(oe_result_t result)
+{
+    return result;
+}
+
+bool oe_set_switchless_syscalls(bool enabled)
+{
+    OE_UNUSED(enabled);
+    return false;
+}
+
 oe_result_t oe_call_host_function(
     size_t function_id,
     const void* input_buffer,
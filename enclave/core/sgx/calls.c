@@ -14,6 +14,7 @@
 #include <openenclave/internal/eeid.h>
 #include <openenclave/internal/fault.h>
 #include <openenclave/internal/globals.h>
+#include <openenclave/internal/hostpool.h>
 #include <openenclave/internal/jump.h>
 #include <openenclave/internal/malloc.h>
 #include <openenclave/internal/print.h>
@@ -31,6 +32,7 @@
 #include "../arena.h"
 #include "../args.h"
 #include "../atexit.h"
+#include "../mman.h"
 #include "../tracee.h"
 #include "asmdefs.h"
 #include "core_t.h"
@@ -479,6 +481,10 @@ static void _handle_ecall(
             /* Call all finalization functions */
             oe_call_fini_functions();
 
+            /* Release the untrusted memory pool */
+            oe_teardown_arena();
+            oe_teardown_host_pool();
+
 #if defined(OE_USE_DEBUG_MALLOC)
 
             /* If memory still allocated, print a trace and return an error */
@@ -512,10 +518,12 @@ static void _handle_ecall(
 
 done:
 
-    /* Free shared memory arena before we clear TLS */
+    /* Free shared memory arena and cached pages before we clear TLS */
     if (td->depth == 1)
     {
         oe_teardown_arena();
+        oe_teardown_host_pool_cache();
+        oe_teardown_mman_cache();
     }
 
     /* Remove ECALL context from front of oe_sgx_td_t.ecalls list */
@@ -773,6 +781,11 @@ oe_result_t oe_call_host_function_by_table_id(
     if (!input_buffer || input_buffer_size == 0)
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    /* Make the call switchless if oe_prefer_switchless_ocall() requested it
+     * and its buffer has been allocated accordingly. */
+    if (!switchless && oe_is_switchless_ocall_buffer(input_buffer))
+        switchless = true;
+
     /*
      * oe_post_switchless_ocall (below) can make a regular ocall to wake up the
      * host worker thread, and will end up using the ecall context's args.
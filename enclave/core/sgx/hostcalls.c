@@ -3,8 +3,10 @@
 
 #include <openenclave/edger8r/enclave.h>
 #include <openenclave/enclave.h>
+#include <openenclave/internal/hostpool.h>
 #include <openenclave/internal/sgx/ecall_context.h>
 #include <openenclave/internal/sgx/td.h>
+#include "switchlesscalls.h"
 #include "td.h"
 
 /**
@@ -50,16 +52,37 @@ void* oe_ecall_context_get_ocall_buffer(uint64_t size)
 // Function used by oeedger8r for allocating ocall buffers.
 void* oe_allocate_ocall_buffer(size_t size)
 {
+    // Use the arena if the ocall has been marked to be made switchlessly.
+    void* buffer = oe_switchless_take_ocall_buffer(size);
+    if (buffer)
+    {
+        return buffer;
+    }
+
+    // Let the host know how large a buffer the ocalls need.
+    oe_ecall_context_t* ecall_context = _get_ecall_context();
+    if (ecall_context && size > ecall_context->ocall_buffer_peak)
+        ecall_context->ocall_buffer_peak = size;
+
     // Fetch the ecall context's ocall buffer if it is equal to or larger than
     // given size. Use it if available.
-    void* buffer = oe_ecall_context_get_ocall_buffer(size);
+    buffer = oe_ecall_context_get_ocall_buffer(size);
     if (buffer)
     {
         return buffer;
     }
 
-    // Perform host allocation by making an ocall.
-    return oe_host_malloc(size);
+    // Let the host know that its buffer was too small.
+    if (ecall_context)
+    {
+        ecall_context->ocall_buffer_fallback_count++;
+        if (size > ecall_context->ocall_buffer_high_water)
+            ecall_context->ocall_buffer_high_water = size;
+    }
+
+    // Take the buffer from the untrusted memory pool. This only makes an ocall
+    // if the pool needs to grow.
+    return oe_host_pool_malloc(size);
 }
 
 // Function used by oeedger8r for freeing ocall buffers.
@@ -67,6 +90,9 @@ void oe_free_ocall_buffer(void* buffer)
 {
     oe_ecall_context_t* ecall_context = _get_ecall_context();
 
+    if (oe_switchless_release_ocall_buffer(buffer))
+        return;
+
     // ecall context's buffer is managed by the host and does not have to be
     // freed.
     if (buffer == ecall_context->ocall_buffer)
@@ -80,15 +106,15 @@ void oe_free_ocall_buffer(void* buffer)
     // execution.
     oe_lfence();
 
-    oe_host_free(buffer);
+    oe_host_pool_free(buffer);
 }
 
 void* oe_allocate_arena(size_t capacity)
 {
-    return oe_host_malloc(capacity);
+    return oe_host_pool_malloc(capacity);
 }
 
 void oe_deallocate_arena(void* buffer)
 {
-    oe_host_free(buffer);
+    oe_host_pool_free(buffer);
 }
@@ -3,12 +3,18 @@
 
 #include <openenclave/corelibc/string.h>
 #include <openenclave/enclave.h>
+#include <openenclave/internal/cpuid.h>
+#include <openenclave/internal/entropy.h>
+#include <openenclave/internal/raise.h>
 #include <openenclave/internal/rdrand.h>
+#include <openenclave/internal/thread.h>
+#include <openenclave/internal/utils.h>
+#include "cpuid.h"
 
 // The RDRAND generates 8-byte random value.
 #define RDRAND_BYTES 8
 
-oe_result_t oe_random_internal(void* data, size_t size)
+static oe_result_t _rdrand_random(void* data, size_t size)
 {
     for (size_t i = 0; i < size; i += RDRAND_BYTES)
     {
@@ -23,3 +29,253 @@ oe_result_t oe_random_internal(void* data, size_t size)
 
     return OE_OK;
 }
+
+#if defined(OE_RANDOM_RDRAND_ONLY)
+
+oe_result_t oe_random_internal(void* data, size_t size)
+{
+    return _rdrand_random(data, size);
+}
+
+#else /* !defined(OE_RANDOM_RDRAND_ONLY) */
+
+/*
+**==============================================================================
+**
+** AES-128 in counter mode with AES-NI.
+**
+** The generator keeps a key and a counter. Each request derives its own key
+** and counter from the key stream and then replaces the generator key with
+** the next block of the stream, so that a later compromise of the state does
+** not reveal earlier output. Only this derivation is done under the lock;
+** large requests are generated without it, eight blocks at a time.
+**
+** The key is mixed with fresh entropy from RDSEED (or RDRAND if the CPU lacks
+** RDSEED) every OE_RANDOM_RESEED_INTERVAL bytes of output.
+**
+**==============================================================================
+*/
+
+#define OE_RANDOM_RESEED_INTERVAL (1024 * 1024)
+
+/* Requests up to this size are served from the generator key stream under
+ * the lock, which is cheaper than deriving a request key. */
+#define SMALL_REQUEST_SIZE 64
+
+#define AES128_ROUNDS 10
+#define BLOCK_SIZE 16
+#define PARALLEL_BLOCKS 8
+
+#define AESNI __attribute__((__target__("aes")))
+
+typedef long long block_t __attribute__((__vector_size__(BLOCK_SIZE)));
+typedef long long unaligned_block_t
+    __attribute__((__vector_size__(BLOCK_SIZE), __aligned__(1)));
+typedef int words_t __attribute__((__vector_size__(BLOCK_SIZE)));
+
+typedef struct _key_schedule
+{
+    block_t round_keys[AES128_ROUNDS + 1];
+} key_schedule_t;
+
+static struct
+{
+    oe_spinlock_t lock;
+    bool seeded;
+    uint64_t bytes_since_reseed;
+    block_t key;
+    block_t counter;
+} _generator = {OE_SPINLOCK_INITIALIZER};
+
+static bool _has_aesni;
+
+static bool _check_aesni(void)
+{
+    uint64_t rax = 1, rbx = 0, rcx = 0, rdx = 0;
+
+    /* Only remember a positive answer: the CPUID table may not have been
+     * initialized yet when the first random bytes are requested. */
+    if (!_has_aesni && oe_emulate_cpuid(&rax, &rbx, &rcx, &rdx) == 0 &&
+        (rcx & OE_CPUID_AESNI_FEATURE))
+        _has_aesni = true;
+
+    return _has_aesni;
+}
+
+static AESNI block_t _expand_step(block_t key, block_t assist)
+{
+    words_t k = (words_t)key;
+    const int w = ((words_t)assist)[3];
+
+    k[1] ^= k[0];
+    k[2] ^= k[1];
+    k[3] ^= k[2];
+
+    return (block_t)(k ^ (words_t){w, w, w, w});
+}
+
+/* aeskeygenassist takes the round constant as an immediate. */
+#define EXPAND(I, RCON)                                    \
+    ks->round_keys[I] = _expand_step(                      \
+        ks->round_keys[I - 1],                             \
+        __builtin_ia32_aeskeygenassist128(ks->round_keys[I - 1], RCON))
+
+static AESNI void _expand_key(key_schedule_t* ks, block_t key)
+{
+    ks->round_keys[0] = key;
+    EXPAND(1, 0x01);
+    EXPAND(2, 0x02);
+    EXPAND(3, 0x04);
+    EXPAND(4, 0x08);
+    EXPAND(5, 0x10);
+    EXPAND(6, 0x20);
+    EXPAND(7, 0x40);
+    EXPAND(8, 0x80);
+    EXPAND(9, 0x1b);
+    EXPAND(10, 0x36);
+}
+
+/* Write size bytes of the key stream to out and advance the counter. */
+static AESNI void _generate(
+    const key_schedule_t* ks,
+    block_t* counter,
+    uint8_t* out,
+    size_t size)
+{
+    const block_t one = {1, 0};
+    block_t rk[AES128_ROUNDS + 1];
+    block_t ctr = *counter;
+
+    /* Local copies, since the stores to out may alias them. */
+    for (size_t r = 0; r <= AES128_ROUNDS; r++)
+        rk[r] = ks->round_keys[r];
+
+    while (size >= PARALLEL_BLOCKS * BLOCK_SIZE)
+    {
+        block_t b[PARALLEL_BLOCKS];
+
+        /* Keep the blocks in registers to pipeline the AES instructions. */
+#pragma GCC unroll 8
+        for (size_t i = 0; i < PARALLEL_BLOCKS; i++)
+        {
+            b[i] = ctr ^ rk[0];
+            ctr += one;
+        }
+
+        for (size_t r = 1; r < AES128_ROUNDS; r++)
+        {
+#pragma GCC unroll 8
+            for (size_t i = 0; i < PARALLEL_BLOCKS; i++)
+                b[i] = __builtin_ia32_aesenc128(b[i], rk[r]);
+        }
+
+#pragma GCC unroll 8
+        for (size_t i = 0; i < PARALLEL_BLOCKS; i++)
+            ((unaligned_block_t*)out)[i] =
+                __builtin_ia32_aesenclast128(b[i], rk[AES128_ROUNDS]);
+
+        out += PARALLEL_BLOCKS * BLOCK_SIZE;
+        size -= PARALLEL_BLOCKS * BLOCK_SIZE;
+    }
+
+    while (size > 0)
+    {
+        const size_t n = size < BLOCK_SIZE ? size : BLOCK_SIZE;
+        block_t b = ctr ^ rk[0];
+
+        for (size_t r = 1; r < AES128_ROUNDS; r++)
+            b = __builtin_ia32_aesenc128(b, rk[r]);
+        b = __builtin_ia32_aesenclast128(b, rk[AES128_ROUNDS]);
+        ctr += one;
+
+        memcpy(out, &b, n);
+        out += n;
+        size -= n;
+    }
+
+    *counter = ctr;
+    oe_secure_zero_fill(rk, sizeof(rk));
+}
+
+/* Called with the generator lock held. */
+static oe_result_t _reseed(void)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    block_t seed[2];
+    oe_entropy_kind_t kind;
+
+    OE_CHECK(oe_get_entropy(seed, sizeof(seed), &kind));
+
+    _generator.key ^= seed[0];
+    if (!_generator.seeded)
+        _generator.counter = seed[1];
+
+    _generator.seeded = true;
+    _generator.bytes_since_reseed = 0;
+
+    result = OE_OK;
+
+done:
+    oe_secure_zero_fill(seed, sizeof(seed));
+    return result;
+}
+
+static AESNI oe_result_t _aes_ctr_random(void* data, size_t size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    key_schedule_t ks;
+    block_t request[2];
+    block_t next_key;
+    const bool small = size <= SMALL_REQUEST_SIZE;
+
+    oe_spin_lock(&_generator.lock);
+
+    if (!_generator.seeded ||
+        _generator.bytes_since_reseed >= OE_RANDOM_RESEED_INTERVAL)
+    {
+        result = _reseed();
+        if (result != OE_OK)
+        {
+            oe_spin_unlock(&_generator.lock);
+            OE_RAISE(result);
+        }
+    }
+
+    _expand_key(&ks, _generator.key);
+
+    if (small)
+        _generate(&ks, &_generator.counter, data, size);
+    else
+        _generate(
+            &ks, &_generator.counter, (uint8_t*)request, sizeof(request));
+
+    _generate(&ks, &_generator.counter, (uint8_t*)&next_key, BLOCK_SIZE);
+    _generator.key = next_key;
+    _generator.bytes_since_reseed += size;
+
+    oe_spin_unlock(&_generator.lock);
+
+    if (!small)
+    {
+        _expand_key(&ks, request[0]);
+        _generate(&ks, &request[1], data, size);
+    }
+
+    result = OE_OK;
+
+done:
+    oe_secure_zero_fill(&ks, sizeof(ks));
+    oe_secure_zero_fill(request, sizeof(request));
+    oe_secure_zero_fill(&next_key, sizeof(next_key));
+    return result;
+}
+
+oe_result_t oe_random_internal(void* data, size_t size)
+{
+    if (!_check_aesni())
+        return _rdrand_random(data, size);
+
+    return _aes_ctr_random(data, size);
+}
+
+#endif /* !defined(OE_RANDOM_RDRAND_ONLY) */
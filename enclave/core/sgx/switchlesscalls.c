@@ -8,6 +8,7 @@
 #include <openenclave/internal/defs.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/utils.h>
+#include "../arena.h"
 #include "handle_ecall.h"
 #include "platform_t.h"
 
@@ -17,6 +18,20 @@ static size_t _host_worker_count = 0;
 // The array of host worker contexts. Initialized by host through ECALL
 static oe_host_worker_context_t* _host_worker_contexts = NULL;
 
+// The ring of pending switchless ocalls. Initialized by host through ECALL.
+// The slots pointer and the capacity are stashed in enclave memory so that
+// the host cannot make the enclave access memory outside of the ring.
+static oe_switchless_ring_t* _ring = NULL;
+static oe_switchless_ring_slot_t* _ring_slots = NULL;
+static uint64_t _ring_mask = 0;
+
+/**
+ * Number of iterations an enclave thread waits for a host worker to pick up a
+ * queued switchless ocall before falling back to a regular ocall. Bounding the
+ * wait ensures progress when all workers are blocked in long-running ocalls.
+ */
+#define OE_SWITCHLESS_OCALL_PICKUP_SPIN_LIMIT (1U << 14)
+
 // Flag to denote if switchless calls have already been initialized.
 static bool _is_switchless_initialized = false;
 
@@ -30,6 +45,21 @@ static bool _is_switchless_initialized = false;
  * */
 static int64_t _switchless_init_in_progress = 0;
 
+// Whether oe_prefer_switchless_ocall() has any effect.
+#ifdef OE_SWITCHLESS_SYSCALLS
+static bool _switchless_syscalls = true;
+#else
+static bool _switchless_syscalls = false;
+#endif
+
+// Set by oe_prefer_switchless_ocall() and consumed by the buffer allocation
+// of the next ocall. oe_end_switchless_ocall() clears it if the ocall failed
+// before.
+static __thread bool _prefer_switchless_ocall;
+
+// The marshalling buffer of the ocall that is made switchlessly.
+static __thread void* _switchless_ocall_buffer;
+
 /*
 **==============================================================================
 **
@@ -61,10 +91,13 @@ bool oe_is_switchless_initialized()
 */
 oe_result_t oe_sgx_init_context_switchless_ecall(
     oe_host_worker_context_t* host_worker_contexts,
-    uint64_t num_host_workers)
+    uint64_t num_host_workers,
+    oe_switchless_ring_t* ring)
 {
     oe_result_t result = OE_UNEXPECTED;
     uint64_t contexts_size = 0;
+    oe_switchless_ring_slot_t* ring_slots = NULL;
+    uint64_t ring_capacity = 0;
 
     if (!oe_atomic_compare_and_swap(
             &_switchless_init_in_progress, (int64_t) false, (int64_t) true))
@@ -86,12 +119,33 @@ oe_result_t oe_sgx_init_context_switchless_ecall(
         OE_RAISE(OE_INVALID_PARAMETER);
     }
 
+    // Ensure the ring header lies outside the enclave.
+    if (!oe_is_outside_enclave(ring, sizeof(*ring)))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    // Copy the ring geometry into enclave memory before validating it.
+    ring_slots = ring->slots;
+    ring_capacity = ring->capacity;
+
+    // The capacity must be a power of two so that positions can be masked.
+    if (ring_capacity == 0 || (ring_capacity & (ring_capacity - 1)) != 0 ||
+        ring_capacity > OE_UINT64_MAX / sizeof(oe_switchless_ring_slot_t))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    // Ensure the slots are outside of enclave
+    if (!oe_is_outside_enclave(
+            ring_slots, ring_capacity * sizeof(oe_switchless_ring_slot_t)))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
     /* lfence after checks. */
     oe_lfence();
 
     // Stash host worker information in enclave memory.
     _host_worker_count = num_host_workers;
     _host_worker_contexts = host_worker_contexts;
+    _ring = ring;
+    _ring_slots = ring_slots;
+    _ring_mask = ring_capacity - 1;
 
     __atomic_store_n(&_is_switchless_initialized, true, __ATOMIC_SEQ_CST);
 
@@ -103,85 +157,254 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** _ring_enqueue()
+**
+**  Place args in a free slot of the ring. Returns the slot or NULL if the ring
+**  is full.
+**
+**==============================================================================
+*/
+static oe_switchless_ring_slot_t* _ring_enqueue(
+    oe_call_host_function_args_t* args)
+{
+    uint64_t pos = __atomic_load_n(&_ring->enqueue_pos, __ATOMIC_RELAXED);
+
+    // The host controls the positions and sequence numbers. Bound the number
+    // of attempts so that a misbehaving host cannot keep the caller looping.
+    for (uint64_t tries = 0; tries <= _ring_mask; tries++)
+    {
+        oe_switchless_ring_slot_t* slot = &_ring_slots[pos & _ring_mask];
+        uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t)(sequence - pos);
+
+        if (diff == 0)
+        {
+            // The slot is free. Try to claim the position.
+            if (__atomic_compare_exchange_n(
+                    &_ring->enqueue_pos,
+                    &pos,
+                    pos + 1,
+                    true,
+                    __ATOMIC_SEQ_CST,
+                    __ATOMIC_RELAXED))
+            {
+                __atomic_store_n(&slot->call_arg, args, __ATOMIC_RELAXED);
+
+                // Publish the slot to the workers.
+                __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_SEQ_CST);
+
+                // Update the statistics.
+                uint64_t occupancy =
+                    pos + 1 -
+                    __atomic_load_n(&_ring->dequeue_pos, __ATOMIC_RELAXED);
+                uint64_t peak =
+                    __atomic_load_n(&_ring->peak_occupancy, __ATOMIC_RELAXED);
+                while (occupancy > peak && occupancy <= _ring_mask + 1 &&
+                       !__atomic_compare_exchange_n(
+                           &_ring->peak_occupancy,
+                           &peak,
+                           occupancy,
+                           true,
+                           __ATOMIC_RELAXED,
+                           __ATOMIC_RELAXED))
+                    ;
+                __atomic_fetch_add(&_ring->total_enqueued, 1, __ATOMIC_RELAXED);
+
+                return slot;
+            }
+            // pos has been updated by the failed compare-exchange.
+        }
+        else if (diff < 0)
+        {
+            // The slot still holds a call from the previous lap. Full.
+            return NULL;
+        }
+        else
+        {
+            // Another producer claimed the position. Catch up.
+            pos = __atomic_load_n(&_ring->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    return NULL;
+}
+
+/*
+**==============================================================================
+**
+** _wake_idle_worker()
+**
+**  Make sure that at least one idle host worker will look at the ring.
+**
+**==============================================================================
+*/
+static void _wake_idle_worker(void)
+{
+    // An idle worker that is awake drains the ring before it goes to sleep.
+    // Workers announce that they go to sleep before they look at the ring
+    // a last time, so a worker that is not sleeping will see the call.
+    for (size_t i = 0; i < _host_worker_count; i++)
+    {
+        oe_host_worker_context_t* context = &_host_worker_contexts[i];
+
+        if (__atomic_load_n(&context->call_arg, __ATOMIC_SEQ_CST) == NULL &&
+            !__atomic_load_n(&context->is_sleeping, __ATOMIC_SEQ_CST))
+            return;
+    }
+
+    for (size_t i = 0; i < _host_worker_count; i++)
+    {
+        oe_host_worker_context_t* context = &_host_worker_contexts[i];
+
+        // Skip workers that are busy handling another call.
+        if (__atomic_load_n(&context->call_arg, __ATOMIC_SEQ_CST) != NULL)
+            continue;
+
+        // If event is 0, the worker has gone to sleep. Wake it by
+        // making an ocall (oe_sgx_wake_switchless_worker_ocall).
+        // Note: it is important to use an atomic cas operation to set
+        // the value to 1 before making the ocall. Setting the value to
+        // 1 prevents the host worker from simulataneously going to
+        // sleep. If instead, just a compare operation is used to
+        // determine if the host thread is sleeping or not, the host
+        // thread could go to sleep after the enclave has determined
+        // that the host is not sleeping, causing a deadlock.
+        //
+        // If event is 1, that indicates a pending wake notification.
+        int32_t oldval = 0;
+        int32_t newval = 1;
+        // Weak operation could sporadically fail.
+        // We need a strong operation.
+        bool weak = false;
+        if (__atomic_compare_exchange_n(
+                &context->event,
+                &oldval,
+                newval,
+                weak,
+                __ATOMIC_ACQ_REL,
+                __ATOMIC_ACQUIRE))
+        {
+            // The pevious value of the event was 0 which means that the
+            // worker was previously sleeping.
+            // Wake it via an ocall.
+            oe_sgx_wake_switchless_worker_ocall(context);
+        }
+        return;
+    }
+}
+
 /*
 **==============================================================================
 **
 ** oe_post_switchless_ocall()
 **
-**  Post the function call (wrapped in args) to a free host worker thread
-**  by writing to its context.
+**  Post the function call (wrapped in args) to the ring of pending switchless
+**  ocalls and wait until a host worker picks it up. If the ring is full or no
+**  worker becomes available in time, the call is withdrawn and the caller has
+**  to fall back to a regular ocall.
 **
 **==============================================================================
 */
 oe_result_t oe_post_switchless_ocall(oe_call_host_function_args_t* args)
 {
-    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_ring_slot_t* slot = NULL;
 
     OE_ATOMIC_MEMORY_BARRIER_RELEASE();
     args->result = __OE_RESULT_MAX; // Means the call hasn't been processed.
 
-    // Cycle through the worker contexts until we find a free worker.
-    size_t tries = _host_worker_count;
-    while (tries--)
+    if ((slot = _ring_enqueue(args)) == NULL)
+        goto missed;
+
+    _wake_idle_worker();
+
+    // A worker picks up the call by clearing the slot's call_arg.
+    for (uint32_t i = 0; i < OE_SWITCHLESS_OCALL_PICKUP_SPIN_LIMIT; i++)
     {
-        // Check if the worker's slot is free.
-        if (_host_worker_contexts[tries].call_arg == NULL)
-        {
-            // Try to atomically grab the slot by placing args in the slot.
-            // If the atomic operation was successful, then the worker thread
-            // will execute this switchless ocall. If the atomic operation
-            // failed, this means that the slot was grabbed by another
-            // switchless ocall and therefore, we must scan for another worker
-            // thread with a free slot.
-            if (oe_atomic_compare_and_swap_ptr(
-                    (void* volatile*)&_host_worker_contexts[tries].call_arg,
-                    NULL,
-                    args))
-            {
-                // The worker thread has been marked to execute this switchless
-                // call. Determine if it needs to be woken up or not.
-                //
-                // If event is 0, it means that it has gone to sleep. Wake it by
-                // making an ocall (oe_sgx_wake_switchless_worker_ocall).
-                // Note: it is important to use an atomic cas operation to set
-                // the value to 1 before making the ocall. Setting the value to
-                // 1 prevents the host worker from simulataneously going to
-                // sleep. If instead, just a compare operation is used to
-                // determine if the host thread is sleeping or not, the host
-                // thread could go to sleep after the enclave has determined
-                // that the host is not sleeping, causing a deadlock.
-                //
-                // If event is 1, that indicates a pending wake notification.
-                int32_t oldval = 0;
-                int32_t newval = 1;
-                // Weak operation could sporadically fail.
-                // We need a strong operation.
-                bool weak = false;
-                if (__atomic_compare_exchange_n(
-                        &_host_worker_contexts[tries].event,
-                        &oldval,
-                        newval,
-                        weak,
-                        __ATOMIC_ACQ_REL,
-                        __ATOMIC_ACQUIRE))
-                {
-                    // The pevious value of the event was 0 which means that the
-                    // worker was previously sleeping.
-                    // Wake it via an ocall.
-                    oe_sgx_wake_switchless_worker_ocall(
-                        &_host_worker_contexts[tries]);
-                }
-
-                return OE_OK;
-            }
-        }
+        if (__atomic_load_n(&slot->call_arg, __ATOMIC_ACQUIRE) != args)
+            return OE_OK;
+
+        asm volatile("pause");
+    }
+
+    // Withdraw the call. If this fails, a worker has picked it up meanwhile.
+    {
+        void* expected = args;
+        if (!__atomic_compare_exchange_n(
+                &slot->call_arg,
+                &expected,
+                NULL,
+                false,
+                __ATOMIC_ACQ_REL,
+                __ATOMIC_ACQUIRE))
+            return OE_OK;
     }
 
-    result = OE_CONTEXT_SWITCHLESS_OCALL_MISSED;
+missed:
+    __atomic_fetch_add(&_ring->total_missed, 1, __ATOMIC_RELAXED);
+    return OE_CONTEXT_SWITCHLESS_OCALL_MISSED;
+}
 
+/*
+**==============================================================================
+**
+** oe_prefer_switchless_ocall()
+**
+**  Ocalls whose stubs were not generated as switchless use the ecall context's
+**  ocall buffer, which the regular ocall that wakes a host worker would
+**  overwrite. The buffer of the preferred ocall is therefore taken from the
+**  thread's arena instead, and oe_call_host_function_by_table_id() makes the
+**  call switchless when it is passed this buffer.
+**
+**==============================================================================
+*/
+
+void oe_prefer_switchless_ocall(bool prefer)
+{
+    _prefer_switchless_ocall =
+        prefer && __atomic_load_n(&_switchless_syscalls, __ATOMIC_RELAXED) &&
+        oe_is_switchless_initialized();
+}
+
+oe_result_t oe_end_switchless_ocall(oe_result_t result)
+{
+    _prefer_switchless_ocall = false;
     return result;
 }
 
+bool oe_set_switchless_syscalls(bool enabled)
+{
+    return __atomic_exchange_n(
+        &_switchless_syscalls, enabled, __ATOMIC_SEQ_CST);
+}
+
+void* oe_switchless_take_ocall_buffer(size_t size)
+{
+    if (!_prefer_switchless_ocall)
+        return NULL;
+
+    _prefer_switchless_ocall = false;
+    _switchless_ocall_buffer = oe_arena_malloc(size);
+    return _switchless_ocall_buffer;
+}
+
+bool oe_switchless_release_ocall_buffer(void* buffer)
+{
+    if (buffer == NULL || buffer != _switchless_ocall_buffer)
+        return false;
+
+    _switchless_ocall_buffer = NULL;
+    oe_arena_free_all();
+    return true;
+}
+
+bool oe_is_switchless_ocall_buffer(const void* buffer)
+{
+    return buffer != NULL && buffer == _switchless_ocall_buffer;
+}
+
 /*
 **==============================================================================
 **
@@ -209,6 +432,186 @@ oe_result_t oe_switchless_call_host_function(
         true /* switchless */);
 }
 
+/*
+**==============================================================================
+**
+** oe_switchless_call_host_function_async()
+**
+**  Post a switchless ocall without waiting for its result. The args of the
+**  call are kept in host memory that outlives further ocalls of the thread
+**  until the call is completed by oe_switchless_call_wait().
+**
+**==============================================================================
+*/
+
+oe_result_t oe_switchless_call_host_function_async(
+    size_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    oe_switchless_call_t* call)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_host_function_args_t* args = NULL;
+
+    if (call)
+    {
+        call->args = NULL;
+        call->buffer = NULL;
+        call->buffer_size = 0;
+    }
+
+    /* Reject invalid parameters */
+    if (!input_buffer || input_buffer_size == 0 || !call)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    args = (oe_call_host_function_args_t*)
+        oe_allocate_switchless_async_ocall_buffer(sizeof(*args));
+    if (args == NULL)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    args->table_id = OE_UINT64_MAX;
+    args->function_id = function_id;
+    args->input_buffer = input_buffer;
+    args->input_buffer_size = input_buffer_size;
+    args->output_buffer = output_buffer;
+    args->output_buffer_size = output_buffer_size;
+    args->output_bytes_written = 0;
+    args->result = OE_UNEXPECTED;
+
+    /* The call is complete when it returns from a regular ocall. */
+    if (!oe_is_switchless_initialized() ||
+        oe_post_switchless_ocall(args) == OE_CONTEXT_SWITCHLESS_OCALL_MISSED)
+    {
+        result = oe_ocall(OE_OCALL_CALL_HOST_FUNCTION, (uint64_t)args, NULL);
+        if (result != OE_OK)
+        {
+            oe_free_switchless_async_ocall_buffer(args);
+            OE_RAISE(result);
+        }
+    }
+
+    call->args = args;
+    call->buffer = (void*)input_buffer;
+    call->buffer_size = input_buffer_size + output_buffer_size;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** oe_switchless_call_poll()
+**
+**==============================================================================
+*/
+
+oe_result_t oe_switchless_call_poll(oe_switchless_call_t* call)
+{
+    oe_call_host_function_args_t* args;
+
+    if (!call || !call->args)
+        return OE_INVALID_PARAMETER;
+
+    args = (oe_call_host_function_args_t*)call->args;
+    if (__atomic_load_n(&args->result, __ATOMIC_ACQUIRE) == __OE_RESULT_MAX)
+        return OE_BUSY;
+
+    return OE_OK;
+}
+
+/*
+**==============================================================================
+**
+** oe_switchless_call_get_buffer()
+**
+**  The buffer is taken from the handle in enclave memory, so that the host
+**  cannot redirect the unmarshalling of the call.
+**
+**==============================================================================
+*/
+
+void* oe_switchless_call_get_buffer(
+    const oe_switchless_call_t* call,
+    size_t size)
+{
+    if (!call || !call->args || call->buffer_size != size)
+        return NULL;
+
+    return call->buffer;
+}
+
+/*
+**==============================================================================
+**
+** oe_switchless_call_wait()
+**
+**==============================================================================
+*/
+
+oe_result_t oe_switchless_call_wait(
+    oe_switchless_call_t* call,
+    size_t* output_bytes_written)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_host_function_args_t* args;
+
+    if (!call || !call->args)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    args = (oe_call_host_function_args_t*)call->args;
+
+    // Wait until args.result is set by the host worker.
+    while (oe_switchless_call_poll(call) == OE_BUSY)
+        asm volatile("pause");
+
+    result = args->result;
+    if (result == OE_OK && output_bytes_written)
+        *output_bytes_written = args->output_bytes_written;
+
+    oe_free_switchless_async_ocall_buffer(args);
+    call->args = NULL;
+    call->buffer = NULL;
+    call->buffer_size = 0;
+
+done:
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** oe_switchless_call_wait_all()
+**
+**==============================================================================
+*/
+
+oe_result_t oe_switchless_call_wait_all(
+    oe_switchless_call_t* calls,
+    size_t count,
+    size_t* output_bytes_written)
+{
+    oe_result_t result = OE_OK;
+
+    if (!calls && count)
+        return OE_INVALID_PARAMETER;
+
+    // Complete every call even if an earlier one failed so that none of them
+    // is left behind.
+    for (size_t i = 0; i < count; i++)
+    {
+        oe_result_t r = oe_switchless_call_wait(
+            &calls[i], output_bytes_written ? &output_bytes_written[i] : NULL);
+        if (result == OE_OK)
+            result = r;
+    }
+
+    return result;
+}
+
 void oe_sgx_switchless_enclave_worker_thread_ecall(
     oe_enclave_worker_context_t* context)
 {
@@ -219,12 +622,20 @@ void oe_sgx_switchless_enclave_worker_thread_ecall(
     // Prevent speculative execution.
     oe_lfence();
 
-    const uint64_t spin_count_threshold = context->spin_count_threshold;
+    const bool is_adaptive = context->is_adaptive;
     while (!context->is_stopping)
     {
         volatile oe_call_enclave_function_args_t* local_call_arg = NULL;
         if ((local_call_arg = context->call_arg) != NULL)
         {
+            // Tune the spin budget to the gap since the previous call,
+            // including the time this worker spent sleeping in the host.
+            if (is_adaptive)
+                oe_switchless_adapt_spin_count_threshold(
+                    &context->average_spin_count,
+                    &context->spin_count_threshold,
+                    context->spin_count + context->sleep_spin_count);
+
             // Handle the switchless call, but do not clear the slot yet. Since
             // the slot is not empty, any new incoming switchless call request
             // will be scheduled in another available work thread and get
@@ -235,19 +646,23 @@ void oe_sgx_switchless_enclave_worker_thread_ecall(
             // as free by clearing the slot.
             OE_ATOMIC_MEMORY_BARRIER_RELEASE();
             context->call_arg = NULL;
+            context->total_call_count++;
 
             // Reset spin count for next message.
             context->total_spin_count += context->spin_count;
             context->spin_count = 0;
+            context->sleep_spin_count = 0;
         }
         else
         {
             // If there is no message, increment spin count until threshold is
-            // reached.
-            if (++context->spin_count >= spin_count_threshold)
+            // reached. The threshold is reloaded since it changes under the
+            // adaptive policy.
+            if (++context->spin_count >= context->spin_count_threshold)
             {
                 // Reset spin count and return to host to sleep.
                 context->total_spin_count += context->spin_count;
+                context->sleep_spin_count += context->spin_count;
                 context->spin_count = 0;
 
                 // Make an ocall to sleep until messages arrive.
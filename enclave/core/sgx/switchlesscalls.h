@@ -10,4 +10,10 @@ bool oe_is_switchless_initialized();
 
 oe_result_t oe_post_switchless_ocall(oe_call_host_function_args_t* args);
 
+void* oe_switchless_take_ocall_buffer(size_t size);
+
+bool oe_switchless_release_ocall_buffer(void* buffer);
+
+bool oe_is_switchless_ocall_buffer(const void* buffer);
+
 #endif // _OE_SWITCHLESSCALLS_H
@@ -80,6 +80,118 @@ static int _thread_timedwait(
     return ret;
 }
 
+/*
+**==============================================================================
+**
+** Adaptive waiting:
+**
+**     A waiting thread first spins in the enclave for a bounded number of
+**     iterations and only asks the host to block it when it has not been
+**     woken by then. A waker that finds the waiter still spinning hands off
+**     by clearing its wait state and saves the wake ocall.
+**
+**     td->wait_state is set to OE_THREAD_WAIT_SPINNING by _thread_prepare_wait
+**     while the waiter still holds the spinlock of the primitive, so that a
+**     wakeup issued right after the spinlock is released is not missed.
+**     Wakeups that find the waiter idle or sleeping go to the host, which
+**     remembers them until the waiter blocks, as before.
+**
+**==============================================================================
+*/
+
+#define OE_THREAD_WAIT_IDLE 0
+#define OE_THREAD_WAIT_SPINNING 1
+#define OE_THREAD_WAIT_SLEEPING 2
+
+/* Number of iterations a thread spins before it blocks in the host. */
+#define OE_THREAD_SPIN_COUNT 2048
+
+static void _thread_prepare_wait(oe_sgx_td_t* self)
+{
+    __atomic_store_n(
+        &self->wait_state, OE_THREAD_WAIT_SPINNING, __ATOMIC_SEQ_CST);
+}
+
+/* Spin until woken. Return false if the thread must block in the host. */
+static bool _thread_spin(oe_sgx_td_t* self)
+{
+    uint32_t expected = OE_THREAD_WAIT_SPINNING;
+
+    for (uint32_t i = 0; i < OE_THREAD_SPIN_COUNT; i++)
+    {
+        if (__atomic_load_n(&self->wait_state, __ATOMIC_ACQUIRE) !=
+            OE_THREAD_WAIT_SPINNING)
+            return true;
+
+        asm volatile("pause" ::: "memory");
+    }
+
+    /* Fails if a waker has cleared the state meanwhile. */
+    return !__atomic_compare_exchange_n(
+        &self->wait_state,
+        &expected,
+        OE_THREAD_WAIT_SLEEPING,
+        false,
+        __ATOMIC_ACQ_REL,
+        __ATOMIC_ACQUIRE);
+}
+
+static int _thread_park(oe_sgx_td_t* self)
+{
+    if (_thread_spin(self))
+        return 0;
+
+    return _thread_wait(self);
+}
+
+static int _thread_timedpark(
+    oe_sgx_td_t* self,
+    const struct oe_timespec* abstime,
+    bool clock_monotonic)
+{
+    if (_thread_spin(self))
+        return 0;
+
+    return _thread_timedwait(self, abstime, clock_monotonic);
+}
+
+/* Return true if the waiter was still spinning and has been handed off. */
+static bool _thread_handoff(oe_sgx_td_t* waiter)
+{
+    return __atomic_exchange_n(
+               &waiter->wait_state, OE_THREAD_WAIT_IDLE, __ATOMIC_SEQ_CST) ==
+           OE_THREAD_WAIT_SPINNING;
+}
+
+static int _thread_unpark(oe_sgx_td_t* waiter)
+{
+    if (_thread_handoff(waiter))
+        return 0;
+
+    return _thread_wake(waiter);
+}
+
+/* Wake the waiter and block self, using a single ocall if both need one. */
+static int _thread_unpark_park(oe_sgx_td_t* waiter, oe_sgx_td_t* self)
+{
+    uint32_t expected = OE_THREAD_WAIT_SPINNING;
+
+    if (_thread_handoff(waiter))
+        return _thread_park(self);
+
+    /* The waiter is woken by the host, so do not delay it by spinning. */
+    if (!__atomic_compare_exchange_n(
+            &self->wait_state,
+            &expected,
+            OE_THREAD_WAIT_SLEEPING,
+            false,
+            __ATOMIC_ACQ_REL,
+            __ATOMIC_ACQUIRE))
+        return _thread_wake(waiter);
+
+    return _thread_wake_wait(waiter, self);
+}
+
 /*
 **==============================================================================
 **
@@ -381,6 +493,18 @@ oe_result_t oe_mutex_lock(oe_mutex_t* mutex)
     if (!m)
         return OE_INVALID_PARAMETER;
 
+    /* Spin while another thread holds the mutex and none is queued for it */
+    for (uint32_t i = 0; i < OE_THREAD_SPIN_COUNT; i++)
+    {
+        oe_sgx_td_t* owner = __atomic_load_n(&m->owner, __ATOMIC_RELAXED);
+
+        if (owner == NULL || owner == self ||
+            __atomic_load_n(&m->queue.front, __ATOMIC_RELAXED) != NULL)
+            break;
+
+        asm volatile("pause" ::: "memory");
+    }
+
     /* Loop until SELF obtains mutex */
     for (;;)
     {
@@ -399,11 +523,13 @@ oe_result_t oe_mutex_lock(oe_mutex_t* mutex)
                 /* Insert thread at back of waiters queue */
                 _queue_push_back(&m->queue, self);
             }
+
+            _thread_prepare_wait(self);
         }
         oe_spin_unlock(&m->lock);
 
-        /* Ask host to wait for an event on this thread */
-        _thread_wait(self);
+        /* Spin, then ask host to wait for an event on this thread */
+        _thread_park(self);
     }
 
     /* Unreachable! */
@@ -472,8 +598,8 @@ oe_result_t oe_mutex_unlock(oe_mutex_t* m)
 
     if (waiter)
     {
-        /* Ask host to wake up this thread */
-        _thread_wake(waiter);
+        /* Hand off to this thread, or ask host to wake it up */
+        _thread_unpark(waiter);
     }
 
     return OE_OK;
@@ -515,6 +641,8 @@ typedef struct _oe_cond_impl
     /* Spinlock for synchronizing access to thread queue and mutex parameter */
     oe_spinlock_t lock;
 
+    bool clock_monotonic;
+
     /* Queue of threads waiting on this condition variable */
     struct
     {
@@ -522,7 +650,8 @@ typedef struct _oe_cond_impl
         oe_sgx_td_t* back;
     } queue;
 
-    bool clock_monotonic;
+    /* The mutex used by all queued threads, or NULL if they use several */
+    oe_mutex_t* mutex;
 } oe_cond_impl_t;
 
 OE_STATIC_ASSERT(sizeof(oe_cond_impl_t) <= sizeof(oe_cond_t));
@@ -568,6 +697,21 @@ oe_result_t oe_cond_destroy(oe_cond_t* condition)
     return OE_OK;
 }
 
+/* Caller holds the spinlock of the condition variable */
+static void _cond_enqueue(
+    oe_cond_impl_t* cond,
+    oe_mutex_t* mutex,
+    oe_sgx_td_t* self)
+{
+    if (_queue_empty((Queue*)&cond->queue))
+        cond->mutex = mutex;
+    else if (cond->mutex != mutex)
+        cond->mutex = NULL;
+
+    /* Add the self thread to the end of the wait queue */
+    _queue_push_back((Queue*)&cond->queue, self);
+}
+
 oe_result_t oe_cond_wait(oe_cond_t* condition, oe_mutex_t* mutex)
 {
     oe_cond_impl_t* cond = (oe_cond_impl_t*)condition;
@@ -580,28 +724,29 @@ oe_result_t oe_cond_wait(oe_cond_t* condition, oe_mutex_t* mutex)
     {
         oe_sgx_td_t* waiter = NULL;
 
-        /* Add the self thread to the end of the wait queue */
-        _queue_push_back((Queue*)&cond->queue, self);
+        _cond_enqueue(cond, mutex, self);
 
         /* Unlock this mutex and get the waiter at the front of the queue */
         if (_mutex_unlock(mutex, &waiter) != 0)
         {
+            _queue_remove((Queue*)&cond->queue, self);
             oe_spin_unlock(&cond->lock);
             return OE_BUSY;
         }
 
         for (;;)
         {
+            _thread_prepare_wait(self);
             oe_spin_unlock(&cond->lock);
             {
                 if (waiter)
                 {
-                    _thread_wake_wait(waiter, self);
+                    _thread_unpark_park(waiter, self);
                     waiter = NULL;
                 }
                 else
                 {
-                    _thread_wait(self);
+                    _thread_park(self);
                 }
             }
             oe_spin_lock(&cond->lock);
@@ -634,12 +779,12 @@ oe_result_t oe_cond_timedwait(
     {
         oe_sgx_td_t* waiter = NULL;
 
-        /* Add the self thread to the end of the wait queue */
-        _queue_push_back((Queue*)&cond->queue, self);
+        _cond_enqueue(cond, mutex, self);
 
         /* Unlock this mutex and get the waiter at the front of the queue */
         if (_mutex_unlock(mutex, &waiter) != 0)
         {
+            _queue_remove((Queue*)&cond->queue, self);
             oe_spin_unlock(&cond->lock);
             return OE_BUSY;
         }
@@ -648,15 +793,16 @@ oe_result_t oe_cond_timedwait(
         {
             int res = 0;
 
+            _thread_prepare_wait(self);
             oe_spin_unlock(&cond->lock);
             {
                 if (waiter)
                 {
-                    _thread_wake(waiter);
+                    _thread_unpark(waiter);
                     waiter = NULL;
                 }
 
-                res = _thread_timedwait(self, abstime, cond->clock_monotonic);
+                res = _thread_timedpark(self, abstime, cond->clock_monotonic);
             }
             oe_spin_lock(&cond->lock);
 
@@ -693,7 +839,7 @@ oe_result_t oe_cond_signal(oe_cond_t* condition)
     if (!waiter)
         return OE_OK;
 
-    _thread_wake(waiter);
+    _thread_unpark(waiter);
     return OE_OK;
 }
 
@@ -709,6 +855,32 @@ oe_result_t oe_cond_broadcast(oe_cond_t* condition)
     {
         oe_sgx_td_t* p;
 
+        /* If all waiters use the same mutex, requeue them on the mutex instead
+         * of waking them all up only to contend for it. The mutex wakes them
+         * one by one as it is unlocked, so only its new front is woken here if
+         * nobody owns it. */
+        if (cond->mutex && !_queue_empty((Queue*)&cond->queue))
+        {
+            oe_mutex_impl_t* m = (oe_mutex_impl_t*)cond->mutex;
+            oe_sgx_td_t* waiter = NULL;
+
+            oe_spin_lock(&m->lock);
+            {
+                if (_queue_empty(&m->queue) && m->owner == NULL)
+                    waiter = cond->queue.front;
+
+                while ((p = _queue_pop_front((Queue*)&cond->queue)))
+                    _queue_push_back(&m->queue, p);
+            }
+            oe_spin_unlock(&m->lock);
+            oe_spin_unlock(&cond->lock);
+
+            if (waiter)
+                _thread_unpark(waiter);
+
+            return OE_OK;
+        }
+
         while ((p = _queue_pop_front((Queue*)&cond->queue)))
             _queue_push_back(&waiters, p);
     }
@@ -721,7 +893,7 @@ oe_result_t oe_cond_broadcast(oe_cond_t* condition)
         // primitive that could modify the next field.
         // Therefore fetch the next thread before waking up p.
         p_next = p->next;
-        _thread_wake(p);
+        _thread_unpark(p);
     }
 
     return OE_OK;
@@ -804,8 +976,9 @@ oe_result_t oe_rwlock_rdlock(oe_rwlock_t* read_write_lock)
         if (!_queue_contains(&rw_lock->queue, self))
             _queue_push_back(&rw_lock->queue, self);
 
+        _thread_prepare_wait(self);
         oe_spin_unlock(&rw_lock->lock);
-        _thread_wait(self);
+        _thread_park(self);
 
         // Upon waking, re-acquire the lock.
         // Just like a condition variable.
@@ -862,7 +1035,7 @@ static oe_result_t _wake_waiters(oe_rwlock_impl_t* rw_lock)
     // Wake the waiters in FIFO order. However actual acquisition of the lock
     // will be dependent on OS scheduling of the threads.
     while ((p = _queue_pop_front(&waiters)))
-        _thread_wake(p);
+        _thread_unpark(p);
 
     return OE_OK;
 }
@@ -918,9 +1091,10 @@ oe_result_t oe_rwlock_wrlock(oe_rwlock_t* read_write_lock)
         if (!_queue_contains(&rw_lock->queue, self))
             _queue_push_back(&rw_lock->queue, self);
 
+        _thread_prepare_wait(self);
         oe_spin_unlock(&rw_lock->lock);
 
-        _thread_wait(self);
+        _thread_park(self);
 
         // Upon waking, re-acquire the lock.
         // Just like a condition variable.
@@ -1213,9 +1387,10 @@ oe_result_t oe_sem_wait(
 
     for (;;)
     {
+        _thread_prepare_wait(self);
         oe_spin_unlock(&s->lock);
-        const int res = abstime ? _thread_timedwait(self, abstime, false)
-                                : _thread_wait(self);
+        const int res = abstime ? _thread_timedpark(self, abstime, false)
+                                : _thread_park(self);
         oe_spin_lock(&s->lock);
 
         if (res == OE_ETIMEDOUT)
@@ -1247,5 +1422,177 @@ void oe_sem_wake(oe_sem_t* sem)
     oe_spin_unlock(&s->lock);
 
     if (waiter)
-        _thread_wake(waiter);
+        _thread_unpark(waiter);
+}
+
+/*
+**==============================================================================
+**
+** futex
+**
+**     Waiters are kept in a fixed number of buckets hashed by the futex
+**     address. Each waiter links a record on its own stack into the bucket,
+**     so that it can carry the address and the bitset it waits for.
+**
+**==============================================================================
+*/
+
+#define OE_FUTEX_BUCKETS 64
+#define OE_FUTEX_WAKE_BATCH 16
+
+typedef struct _futex_waiter
+{
+    struct _futex_waiter* next;
+    oe_sgx_td_t* thread;
+    const volatile int* uaddr;
+    uint32_t bitset;
+    bool woken;
+} futex_waiter_t;
+
+typedef struct _futex_bucket
+{
+    oe_spinlock_t lock;
+    futex_waiter_t* front;
+    futex_waiter_t* back;
+} futex_bucket_t;
+
+static futex_bucket_t _futex_buckets[OE_FUTEX_BUCKETS];
+
+static futex_bucket_t* _futex_bucket(const volatile int* uaddr)
+{
+    uint64_t h = (uint64_t)uaddr >> 2;
+    h ^= h >> 17;
+    h *= 0x9e3779b97f4a7c15ULL;
+    return &_futex_buckets[(h >> 32) % OE_FUTEX_BUCKETS];
+}
+
+static void _futex_remove(futex_bucket_t* b, futex_waiter_t* waiter)
+{
+    futex_waiter_t* prev = NULL;
+
+    for (futex_waiter_t* p = b->front; p; prev = p, p = p->next)
+    {
+        if (p == waiter)
+        {
+            if (prev)
+                prev->next = p->next;
+            else
+                b->front = p->next;
+            if (b->back == p)
+                b->back = prev;
+            return;
+        }
+    }
+}
+
+oe_result_t oe_futex_wait(
+    const volatile int* uaddr,
+    int val,
+    uint32_t bitset,
+    const struct oe_timespec* abstime,
+    bool clock_monotonic)
+{
+    futex_bucket_t* const b = _futex_bucket(uaddr);
+    oe_sgx_td_t* const self = oe_sgx_get_td();
+    futex_waiter_t waiter = {NULL, self, uaddr, bitset, false};
+    oe_result_t result = OE_OK;
+
+    if (!uaddr || !bitset)
+        return OE_INVALID_PARAMETER;
+
+    oe_spin_lock(&b->lock);
+
+    // Wakers change the value before they take the bucket lock, so a wakeup
+    // cannot be missed once the value has been checked under the lock.
+    if (__atomic_load_n(uaddr, __ATOMIC_SEQ_CST) != val)
+    {
+        result = OE_BUSY;
+        goto done;
+    }
+
+    if (b->back)
+        b->back->next = &waiter;
+    else
+        b->front = &waiter;
+    b->back = &waiter;
+
+    for (;;)
+    {
+        _thread_prepare_wait(self);
+        oe_spin_unlock(&b->lock);
+        const int res = abstime
+                            ? _thread_timedpark(self, abstime, clock_monotonic)
+                            : _thread_park(self);
+        oe_spin_lock(&b->lock);
+
+        if (waiter.woken)
+            break;
+
+        if (res == OE_ETIMEDOUT)
+        {
+            result = OE_TIMEDOUT;
+            _futex_remove(b, &waiter);
+            break;
+        }
+    }
+
+done:
+    oe_spin_unlock(&b->lock);
+
+    return result;
+}
+
+int oe_futex_wake(const volatile int* uaddr, int count, uint32_t bitset)
+{
+    futex_bucket_t* const b = _futex_bucket(uaddr);
+    oe_sgx_td_t* threads[OE_FUTEX_WAKE_BATCH];
+    int woken = 0;
+    size_t n;
+
+    if (!uaddr || !bitset)
+        return 0;
+
+    // Wake in batches. A woken waiter may return as soon as the bucket lock is
+    // released and reuse its td->next, so the threads to wake are collected
+    // in a local array instead of a queue.
+    do
+    {
+        n = 0;
+
+        oe_spin_lock(&b->lock);
+        {
+            futex_waiter_t* prev = NULL;
+            futex_waiter_t* next;
+
+            for (futex_waiter_t* w = b->front;
+                 w && woken < count && n < OE_FUTEX_WAKE_BATCH;
+                 w = next)
+            {
+                next = w->next;
+
+                if (w->uaddr != uaddr || !(w->bitset & bitset))
+                {
+                    prev = w;
+                    continue;
+                }
+
+                if (prev)
+                    prev->next = next;
+                else
+                    b->front = next;
+                if (b->back == w)
+                    b->back = prev;
+
+                threads[n++] = w->thread;
+                w->woken = true;
+                woken++;
+            }
+        }
+        oe_spin_unlock(&b->lock);
+
+        for (size_t i = 0; i < n; i++)
+            _thread_unpark(threads[i]);
+    } while (n == OE_FUTEX_WAKE_BATCH && woken < count);
+
+    return woken;
 }
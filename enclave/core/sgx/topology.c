@@ -0,0 +1,119 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/corelibc/string.h>
+#include <openenclave/internal/globals.h>
+#include <openenclave/internal/sched.h>
+#include <openenclave/internal/thread.h>
+#include <openenclave/internal/trace.h>
+#include "core_t.h"
+
+static oe_once_t _init_topology_once = OE_ONCE_INIT;
+static uint8_t _mask[OE_MAX_CPUS / 8];
+static uint32_t _numa_nodes[OE_MAX_CPUS];
+static size_t _num_cpus;
+
+static bool _is_set(const uint8_t* mask, size_t cpu)
+{
+    return mask[cpu / 8] & (1u << (cpu % 8));
+}
+
+static void _set(uint8_t* mask, size_t cpu)
+{
+    mask[cpu / 8] |= (uint8_t)(1u << (cpu % 8));
+}
+
+static void _init_topology(void)
+{
+    uint8_t host_mask[OE_MAX_CPUS / 8];
+    uint16_t node_sizes[OE_MAX_CPUS];
+    const uint64_t num_tcs = oe_get_num_tcs();
+    int ret = -1;
+
+    if (oe_get_cpu_topology_ocall(
+            &ret, host_mask, sizeof(host_mask), _numa_nodes, OE_MAX_CPUS) !=
+            OE_OK ||
+        ret != 0)
+    {
+        OE_TRACE_ERROR("oe_get_cpu_topology_ocall() failed");
+        memset(host_mask, 0, sizeof(host_mask));
+        memset(_numa_nodes, 0, sizeof(_numa_nodes));
+    }
+
+    // The host cannot have more nodes than CPUs.
+    memset(node_sizes, 0, sizeof(node_sizes));
+    for (size_t cpu = 0; cpu < OE_MAX_CPUS; cpu++)
+    {
+        if (_numa_nodes[cpu] >= OE_MAX_CPUS)
+            _numa_nodes[cpu] = 0;
+        if (_is_set(host_mask, cpu))
+            node_sizes[_numa_nodes[cpu]]++;
+    }
+
+    // The enclave cannot run more threads than it has TCSs. Select CPUs node by
+    // node, largest node first, so that the selected CPUs share as few NUMA
+    // nodes as possible.
+    while (_num_cpus < num_tcs)
+    {
+        uint32_t node = 0;
+
+        for (uint32_t i = 1; i < OE_MAX_CPUS; i++)
+            if (node_sizes[i] > node_sizes[node])
+                node = i;
+
+        if (!node_sizes[node])
+            break;
+
+        node_sizes[node] = 0;
+
+        for (size_t cpu = 0; cpu < OE_MAX_CPUS && _num_cpus < num_tcs; cpu++)
+        {
+            if (_is_set(host_mask, cpu) && !_is_set(_mask, cpu) &&
+                _numa_nodes[cpu] == node)
+            {
+                _set(_mask, cpu);
+                _num_cpus++;
+            }
+        }
+    }
+
+    // Report at least 2 CPUs so that Go does not assume a single-threaded
+    // process.
+    if (_num_cpus < 2)
+    {
+        memset(_mask, 0, sizeof(_mask));
+        _set(_mask, 0);
+        _set(_mask, 1);
+        _num_cpus = 2;
+    }
+}
+
+size_t oe_get_cpu_affinity(void* mask, size_t mask_size)
+{
+    oe_once(&_init_topology_once, _init_topology);
+
+    if (mask)
+    {
+        const size_t size =
+            mask_size < sizeof(_mask) ? mask_size : sizeof(_mask);
+        memset(mask, 0, mask_size);
+        memcpy(mask, _mask, size);
+    }
+
+    return _num_cpus;
+}
+
+OE_WEAK oe_result_t oe_get_cpu_topology_ocall(
+    int* retval,
+    void* mask,
+    size_t mask_size,
+    uint32_t* numa_nodes,
+    size_t num_cpus)
+{
+    OE_UNUSED(retval);
+    OE_UNUSED(mask);
+    OE_UNUSED(mask_size);
+    OE_UNUSED(numa_nodes);
+    OE_UNUSED(num_cpus);
+    return OE_UNSUPPORTED;
+}
@@ -3,7 +3,10 @@
 
 #include "ctr_drbg.h"
 #include <mbedtls/entropy.h>
+#include <mbedtls/threading.h>
+#include <openenclave/corelibc/stdlib.h>
 #include <openenclave/enclave.h>
+#include <openenclave/internal/crypto/ctr_drbg.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/thread.h>
 
@@ -15,36 +18,191 @@
 **==============================================================================
 */
 
-static mbedtls_ctr_drbg_context _drbg;
-static mbedtls_entropy_context _entropy;
+/* Maximum number of threads that get their own DRBG instance. Any further
+ * threads share the global instance. */
+#define MAX_THREAD_INSTANCES 1024
 
-static oe_result_t _seed_entropy_source()
+typedef struct _drbg_instance
+{
+    mbedtls_ctr_drbg_context drbg;
+    mbedtls_entropy_context entropy;
+
+    /* The reseed interval that has been applied to drbg. */
+    int reseed_interval;
+} drbg_instance_t;
+
+typedef struct _drbg_slot
+{
+    /* The thread that has claimed the slot, or 0 if the slot is free. Slots
+     * are never released because the thread identifier is the TCS, which
+     * lives as long as the enclave. */
+    oe_thread_t owner;
+
+    /* Only accessed by the owner. */
+    drbg_instance_t* instance;
+} drbg_slot_t;
+
+static drbg_slot_t _slots[MAX_THREAD_INSTANCES];
+static int _reseed_interval = OE_CTR_DRBG_DEFAULT_RESEED_INTERVAL;
+
+/* The instance shared by threads that do not find a free slot. */
+static drbg_instance_t _shared;
+
+static oe_result_t _seed_instance(
+    drbg_instance_t* instance,
+    const void* custom,
+    size_t custom_size)
 {
     oe_result_t result = OE_UNEXPECTED;
 
-    mbedtls_ctr_drbg_init(&_drbg);
-    mbedtls_entropy_init(&_entropy);
+    mbedtls_ctr_drbg_init(&instance->drbg);
+    mbedtls_entropy_init(&instance->entropy);
+
+    /* The entropy context polls the CPU entropy source (RDSEED, with a
+     * fallback to conditioned RDRAND output). */
+    if (mbedtls_ctr_drbg_seed(
+            &instance->drbg,
+            mbedtls_entropy_func,
+            &instance->entropy,
+            custom,
+            custom_size) != 0)
+        OE_RAISE(OE_CRYPTO_ERROR);
 
-    OE_CHECK((oe_result_t)mbedtls_ctr_drbg_seed(
-        &_drbg, mbedtls_entropy_func, &_entropy, NULL, 0));
+    instance->reseed_interval =
+        __atomic_load_n(&_reseed_interval, __ATOMIC_RELAXED);
+    mbedtls_ctr_drbg_set_reseed_interval(
+        &instance->drbg, instance->reseed_interval);
 
     result = OE_OK;
 
 done:
+    if (result != OE_OK)
+    {
+        mbedtls_ctr_drbg_free(&instance->drbg);
+        mbedtls_entropy_free(&instance->entropy);
+    }
+
     return result;
 }
 
+static void _update_reseed_interval(drbg_instance_t* instance)
+{
+    const int interval = __atomic_load_n(&_reseed_interval, __ATOMIC_RELAXED);
+
+    if (instance->reseed_interval != interval)
+    {
+        mbedtls_ctr_drbg_set_reseed_interval(&instance->drbg, interval);
+        instance->reseed_interval = interval;
+    }
+}
+
+static drbg_instance_t* _new_thread_instance(oe_thread_t self, size_t index)
+{
+    drbg_instance_t* instance = NULL;
+
+    /* Personalize each instance so that their outputs differ even if they
+     * were seeded with the same entropy. */
+    const struct
+    {
+        oe_thread_t self;
+        size_t index;
+    } custom = {self, index};
+
+    if (!(instance = malloc(sizeof(*instance))))
+        return NULL;
+
+    if (_seed_instance(instance, &custom, sizeof(custom)) != OE_OK)
+    {
+        free(instance);
+        return NULL;
+    }
+
+    return instance;
+}
+
+/* Find the slot of the calling thread or claim a free one. */
+static drbg_instance_t* _get_thread_instance(void)
+{
+    const oe_thread_t self = oe_thread_self();
+    size_t index = (self / OE_PAGE_SIZE) % MAX_THREAD_INSTANCES;
+
+    for (size_t i = 0; i < MAX_THREAD_INSTANCES; i++)
+    {
+        drbg_slot_t* const slot = &_slots[index];
+        oe_thread_t owner = __atomic_load_n(&slot->owner, __ATOMIC_ACQUIRE);
+
+        /* A thread's slot always precedes the first free slot in its probe
+         * sequence because slots are never released. */
+        if (owner == 0 && __atomic_compare_exchange_n(
+                              &slot->owner,
+                              &owner,
+                              self,
+                              false,
+                              __ATOMIC_ACQ_REL,
+                              __ATOMIC_ACQUIRE))
+            owner = self;
+
+        if (owner == self)
+        {
+            /* Retry on later calls if creating the instance failed. */
+            if (!slot->instance)
+                slot->instance = _new_thread_instance(self, index);
+
+            return slot->instance;
+        }
+
+        index = (index + 1) % MAX_THREAD_INSTANCES;
+    }
+
+    return NULL;
+}
+
 static oe_result_t _seed_result = OE_UNEXPECTED;
 static oe_once_t _seed_once = OE_ONCE_INIT;
 
 /* Wrapper to set file-scope _seed_result */
 static void _seed_entropy_source_once()
 {
-    _seed_result = _seed_entropy_source();
+    _seed_result = _seed_instance(&_shared, NULL, 0);
 }
 
-mbedtls_ctr_drbg_context* oe_mbedtls_get_drbg()
+static mbedtls_ctr_drbg_context* _get_shared_drbg(void)
 {
     oe_once(&_seed_once, _seed_entropy_source_once);
-    return (_seed_result == OE_OK) ? &_drbg : NULL;
+
+    if (_seed_result != OE_OK)
+        return NULL;
+
+    /* Other threads may be generating random data with the shared instance. */
+    mbedtls_mutex_lock(&_shared.drbg.mutex);
+    _update_reseed_interval(&_shared);
+    mbedtls_mutex_unlock(&_shared.drbg.mutex);
+
+    return &_shared.drbg;
+}
+
+mbedtls_ctr_drbg_context* oe_mbedtls_get_drbg()
+{
+    drbg_instance_t* const instance = _get_thread_instance();
+
+    if (!instance)
+        return _get_shared_drbg();
+
+    _update_reseed_interval(instance);
+    return &instance->drbg;
+}
+
+oe_result_t oe_ctr_drbg_set_reseed_interval(int interval)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (interval <= 0)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    __atomic_store_n(&_reseed_interval, interval, __ATOMIC_RELAXED);
+
+    result = OE_OK;
+
+done:
+    return result;
 }
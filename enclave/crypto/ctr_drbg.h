@@ -6,6 +6,8 @@
 
 #include <mbedtls/ctr_drbg.h>
 
+/* Returns the DRBG instance of the calling thread. The instance must not be
+ * passed to other threads. */
 mbedtls_ctr_drbg_context* oe_mbedtls_get_drbg();
 
 #endif /* _CRYPTO_ENCLAVE_CTR_DRBG_H */
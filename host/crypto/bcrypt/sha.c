@@ -81,3 +81,26 @@ oe_result_t oe_sha256_final(oe_sha256_context_t* context, OE_SHA256* sha256)
 done:
     return result;
 }
+
+/* BCrypt hash objects are opaque, so their state cannot be saved. */
+oe_result_t oe_sha256_save(
+    const oe_sha256_context_t* context,
+    uint32_t* internal_hash,
+    uint32_t* num_hashed)
+{
+    OE_UNUSED(context);
+    OE_UNUSED(internal_hash);
+    OE_UNUSED(num_hashed);
+    return OE_UNSUPPORTED;
+}
+
+oe_result_t oe_sha256_restore(
+    oe_sha256_context_t* context,
+    const uint32_t* internal_hash,
+    const uint32_t* num_hashed)
+{
+    OE_UNUSED(context);
+    OE_UNUSED(internal_hash);
+    OE_UNUSED(num_hashed);
+    return OE_UNSUPPORTED;
+}
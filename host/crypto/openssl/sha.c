@@ -71,7 +71,6 @@ done:
     return result;
 }
 
-#ifdef OE_WITH_EXPERIMENTAL_EEID
 oe_result_t oe_sha256_save(
     const oe_sha256_context_t* context,
     uint32_t* internal_hash,
@@ -120,4 +119,3 @@ oe_result_t oe_sha256_restore(
 done:
     return result;
 }
-#endif
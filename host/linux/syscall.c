@@ -7,6 +7,7 @@
 #include <limits.h>
 #include <netdb.h>
 #include <openenclave/corelibc/limits.h>
+#include <openenclave/internal/syscall/batch.h>
 #include <openenclave/internal/syscall/sys/uio.h>
 #include <openenclave/internal/syscall/types.h>
 #include <pthread.h>
@@ -24,6 +25,7 @@
 #include <unistd.h>
 #include "../../common/oe_host_socket.h"
 #include "../host/strings.h"
+#include "../uring.h"
 #include "syscall_u.h"
 
 /*
@@ -58,6 +60,19 @@ ssize_t oe_syscall_write_ocall(oe_host_fd_t fd, const void* buf, size_t count)
     return write((int)fd, buf, count);
 }
 
+ssize_t oe_syscall_read_staged_ocall(oe_host_fd_t fd, void* buf, size_t count)
+{
+    return oe_syscall_read_ocall(fd, buf, count);
+}
+
+ssize_t oe_syscall_write_staged_ocall(
+    oe_host_fd_t fd,
+    const void* buf,
+    size_t count)
+{
+    return oe_syscall_write_ocall(fd, buf, count);
+}
+
 static void _relocate_iov_bases(
     struct oe_iovec* iov,
     int iovcnt,
@@ -562,6 +577,24 @@ ssize_t oe_syscall_send_ocall(
     return send((int)sockfd, buf, len, flags);
 }
 
+ssize_t oe_syscall_recv_staged_ocall(
+    oe_host_fd_t sockfd,
+    void* buf,
+    size_t len,
+    int flags)
+{
+    return oe_syscall_recv_ocall(sockfd, buf, len, flags);
+}
+
+ssize_t oe_syscall_send_staged_ocall(
+    oe_host_fd_t sockfd,
+    const void* buf,
+    size_t len,
+    int flags)
+{
+    return oe_syscall_send_ocall(sockfd, buf, len, flags);
+}
+
 ssize_t oe_syscall_sendto_ocall(
     oe_host_fd_t sockfd,
     const void* buf,
@@ -1448,3 +1481,66 @@ oe_host_fd_t oe_syscall_eventfd_ocall(unsigned int initval, int flags)
 {
     return eventfd(initval, flags);
 }
+
+static int64_t _execute_sqe(oe_syscall_sqe_t* sqe)
+{
+    const int fd = (int)sqe->fd;
+    struct iovec iov = {sqe->buf, sqe->len};
+    struct msghdr msg = {0};
+    ssize_t ret = -1;
+
+    msg.msg_name = sqe->name;
+    msg.msg_namelen = sqe->namelen;
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = sqe->control;
+    msg.msg_controllen = sqe->controllen;
+
+    switch (sqe->opcode)
+    {
+        case OE_BATCH_OP_READ:
+            ret = read(fd, sqe->buf, sqe->len);
+            break;
+        case OE_BATCH_OP_WRITE:
+            ret = write(fd, sqe->buf, sqe->len);
+            break;
+        case OE_BATCH_OP_PREAD:
+            ret = pread(fd, sqe->buf, sqe->len, sqe->offset);
+            break;
+        case OE_BATCH_OP_PWRITE:
+            ret = pwrite(fd, sqe->buf, sqe->len, sqe->offset);
+            break;
+        case OE_BATCH_OP_SENDMSG:
+            ret = sendmsg(fd, &msg, sqe->flags);
+            break;
+        case OE_BATCH_OP_RECVMSG:
+            if ((ret = recvmsg(fd, &msg, sqe->flags)) != -1)
+            {
+                sqe->namelen = msg.msg_namelen;
+                sqe->controllen = msg.msg_controllen;
+                sqe->msg_flags = msg.msg_flags;
+            }
+            break;
+        case OE_BATCH_OP_FSYNC:
+            ret = fsync(fd);
+            break;
+        default:
+            errno = ENOSYS;
+            break;
+    }
+
+    return ret == -1 ? -errno : ret;
+}
+
+int oe_syscall_submit_ocall(void* sqes, size_t count)
+{
+    oe_syscall_sqe_t* sqe = (oe_syscall_sqe_t*)sqes;
+
+    if (oe_uring_execute(sqe, count))
+        return 0;
+
+    for (size_t i = 0; i < count; i++)
+        sqe[i].result = _execute_sqe(&sqe[i]);
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "core_u.h"
+
+/* Returns the NUMA node of the given CPU, or 0 if it is unknown. */
+static uint32_t _get_numa_node(size_t cpu)
+{
+    char path[64];
+    DIR* dir;
+    struct dirent* entry;
+    uint32_t node = 0;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%zu", cpu);
+
+    if (!(dir = opendir(path)))
+        return 0;
+
+    // The CPU directory contains a link named nodeN to its NUMA node.
+    while ((entry = readdir(dir)))
+    {
+        if (sscanf(entry->d_name, "node%u", &node) == 1)
+            break;
+        node = 0;
+    }
+
+    closedir(dir);
+    return node;
+}
+
+int oe_get_cpu_topology_ocall(
+    void* mask,
+    size_t mask_size,
+    uint32_t* numa_nodes,
+    size_t num_cpus)
+{
+    cpu_set_t set;
+    uint8_t* const bytes = mask;
+
+    if (!mask || !numa_nodes)
+        return -1;
+
+    if (sched_getaffinity(0, sizeof(set), &set) != 0)
+        return -1;
+
+    memset(mask, 0, mask_size);
+    memset(numa_nodes, 0, num_cpus * sizeof(*numa_nodes));
+
+    for (size_t cpu = 0; cpu < mask_size * 8 && cpu < CPU_SETSIZE; cpu++)
+    {
+        if (!CPU_ISSET(cpu, &set))
+            continue;
+
+        bytes[cpu / 8] |= (uint8_t)(1u << (cpu % 8));
+
+        if (cpu < num_cpus)
+            numa_nodes[cpu] = _get_numa_node(cpu);
+    }
+
+    return 0;
+}
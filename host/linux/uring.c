@@ -0,0 +1,444 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#define _GNU_SOURCE
+
+#include "../uring.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "../dupenv.h"
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+
+/*
+**==============================================================================
+**
+** io_uring backend for batched syscalls.
+**
+** Each host thread that executes a batch creates its own ring on first use, so
+** that neither rings nor completions are shared between threads. A batch is
+** split into waves of entries that do not depend on each other. All entries of
+** a wave are submitted with one io_uring_enter and run concurrently; the next
+** wave starts when all completions of the previous one have been reaped.
+**
+** Different host descriptors may refer to the same file or socket, for
+** example after dup(). Therefore, only preads and pwrites of disjoint ranges
+** are independent of each other, whatever their descriptors. Every other
+** entry runs in a wave of its own. Thus, a batch of preads on a file keeps as
+** many requests in flight as the ring has entries.
+**
+**==============================================================================
+*/
+
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+
+/* The maximum count of a single read or write, as in Linux */
+#define MAX_RW_COUNT 0x7ffff000u
+
+/* The maximum number of ring entries that OE_IO_URING may request */
+#define MAX_ENTRIES 4096u
+
+typedef struct _ring
+{
+    int fd;
+    unsigned int entries;
+
+    unsigned int* sq_head;
+    unsigned int* sq_tail;
+    unsigned int* sq_mask;
+    unsigned int* sq_array;
+    struct io_uring_sqe* sqes;
+
+    unsigned int* cq_head;
+    unsigned int* cq_tail;
+    unsigned int* cq_mask;
+    struct io_uring_cqe* cqes;
+
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+
+    /* Per slot of a wave: the index of the entry and its message header */
+    size_t* slots;
+    struct msghdr* msgs;
+    struct iovec* iovs;
+} ring_t;
+
+static pthread_once_t _once = PTHREAD_ONCE_INIT;
+static pthread_key_t _key;
+static unsigned int _entries;
+
+static __thread ring_t* _ring;
+static __thread bool _unsupported;
+
+static void _destroy(void* arg)
+{
+    ring_t* ring = (ring_t*)arg;
+
+    if (ring->sqes && ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqes_size);
+
+    if (ring->cq_ring && ring->cq_ring != MAP_FAILED &&
+        ring->cq_ring != ring->sq_ring)
+        munmap(ring->cq_ring, ring->cq_ring_size);
+
+    if (ring->sq_ring && ring->sq_ring != MAP_FAILED)
+        munmap(ring->sq_ring, ring->sq_ring_size);
+
+    if (ring->fd >= 0)
+        close(ring->fd);
+
+    free(ring->slots);
+    free(ring->msgs);
+    free(ring->iovs);
+    free(ring);
+}
+
+static void _init(void)
+{
+    char* env = oe_dupenv("OE_IO_URING");
+
+    if (env)
+    {
+        const unsigned long entries = strtoul(env, NULL, 10);
+        _entries = entries < MAX_ENTRIES ? (unsigned int)entries : MAX_ENTRIES;
+        free(env);
+    }
+
+    if (_entries && pthread_key_create(&_key, _destroy) != 0)
+        _entries = 0;
+}
+
+static void* _map(int fd, size_t size, off_t offset)
+{
+    return mmap(
+        NULL,
+        size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        fd,
+        offset);
+}
+
+static ring_t* _create(void)
+{
+    /* Reading at the file position needs Linux 5.6. */
+    const uint32_t features = IORING_FEAT_NODROP | IORING_FEAT_RW_CUR_POS;
+    struct io_uring_params params;
+    ring_t* ring;
+    uint8_t* sq;
+    uint8_t* cq;
+
+    memset(&params, 0, sizeof(params));
+
+    if (!(ring = calloc(1, sizeof(*ring))))
+        return NULL;
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, _entries, &params);
+
+    if (ring->fd < 0 || (params.features & features) != features)
+        goto fail;
+
+    ring->entries = params.sq_entries;
+    ring->sq_ring_size =
+        params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->cq_ring_size =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        if (ring->cq_ring_size > ring->sq_ring_size)
+            ring->sq_ring_size = ring->cq_ring_size;
+
+        ring->sq_ring = _map(ring->fd, ring->sq_ring_size, IORING_OFF_SQ_RING);
+        ring->cq_ring = ring->sq_ring;
+    }
+    else
+    {
+        ring->sq_ring = _map(ring->fd, ring->sq_ring_size, IORING_OFF_SQ_RING);
+        ring->cq_ring = _map(ring->fd, ring->cq_ring_size, IORING_OFF_CQ_RING);
+    }
+
+    ring->sqes =
+        (struct io_uring_sqe*)_map(ring->fd, ring->sqes_size, IORING_OFF_SQES);
+
+    if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED ||
+        ring->sqes == MAP_FAILED)
+        goto fail;
+
+    sq = (uint8_t*)ring->sq_ring;
+    ring->sq_head = (unsigned int*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned int*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned int*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int*)(sq + params.sq_off.array);
+
+    cq = (uint8_t*)ring->cq_ring;
+    ring->cq_head = (unsigned int*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned int*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned int*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    ring->slots = calloc(ring->entries, sizeof(*ring->slots));
+    ring->msgs = calloc(ring->entries, sizeof(*ring->msgs));
+    ring->iovs = calloc(ring->entries, sizeof(*ring->iovs));
+
+    if (!ring->slots || !ring->msgs || !ring->iovs)
+        goto fail;
+
+    return ring;
+
+fail:
+    _destroy(ring);
+    return NULL;
+}
+
+static ring_t* _get_ring(void)
+{
+    pthread_once(&_once, _init);
+
+    if (!_entries || _unsupported)
+        return NULL;
+
+    if (!_ring)
+    {
+        /* The kernel may not support io_uring or may forbid it. */
+        if (!(_ring = _create()))
+        {
+            _unsupported = true;
+            return NULL;
+        }
+
+        pthread_setspecific(_key, _ring);
+    }
+
+    return _ring;
+}
+
+static bool _is_positional(const oe_syscall_sqe_t* sqe)
+{
+    return sqe->opcode == OE_BATCH_OP_PREAD ||
+           sqe->opcode == OE_BATCH_OP_PWRITE;
+}
+
+/* Returns true if b must not start before a has completed. */
+static bool _depends(const oe_syscall_sqe_t* a, const oe_syscall_sqe_t* b)
+{
+    if (!_is_positional(a) || !_is_positional(b))
+        return true;
+
+    if (a->opcode == OE_BATCH_OP_PREAD && b->opcode == OE_BATCH_OP_PREAD)
+        return false;
+
+    /* Ranges that cannot be compared */
+    if (a->offset < 0 || b->offset < 0 ||
+        a->len > (uint64_t)(INT64_MAX - a->offset) ||
+        b->len > (uint64_t)(INT64_MAX - b->offset))
+        return true;
+
+    return a->offset < b->offset + (int64_t)b->len &&
+           b->offset < a->offset + (int64_t)a->len;
+}
+
+/* Queue the entry in the given slot. Returns false if the entry has been
+ * completed without being submitted. */
+static bool _push(ring_t* ring, oe_syscall_sqe_t* sqe, unsigned int slot)
+{
+    const unsigned int tail = *ring->sq_tail;
+    const unsigned int index = tail & *ring->sq_mask;
+    struct io_uring_sqe* s = &ring->sqes[index];
+    struct msghdr* msg = &ring->msgs[slot];
+    struct iovec* iov = &ring->iovs[slot];
+    const uint32_t len =
+        sqe->len < MAX_RW_COUNT ? (uint32_t)sqe->len : MAX_RW_COUNT;
+
+    memset(s, 0, sizeof(*s));
+    s->fd = (int)sqe->fd;
+    s->user_data = slot;
+
+    switch (sqe->opcode)
+    {
+        case OE_BATCH_OP_READ:
+        case OE_BATCH_OP_WRITE:
+        case OE_BATCH_OP_PREAD:
+        case OE_BATCH_OP_PWRITE:
+            if (_is_positional(sqe) && sqe->offset < 0)
+            {
+                sqe->result = -EINVAL;
+                return false;
+            }
+
+            s->opcode = sqe->opcode == OE_BATCH_OP_READ ||
+                                sqe->opcode == OE_BATCH_OP_PREAD
+                            ? IORING_OP_READ
+                            : IORING_OP_WRITE;
+            s->addr = (uintptr_t)sqe->buf;
+            s->len = len;
+            /* An offset of -1 reads or writes at the file position. */
+            s->off = _is_positional(sqe) ? (uint64_t)sqe->offset : UINT64_MAX;
+            break;
+        case OE_BATCH_OP_SENDMSG:
+        case OE_BATCH_OP_RECVMSG:
+            iov->iov_base = sqe->buf;
+            iov->iov_len = sqe->len;
+            memset(msg, 0, sizeof(*msg));
+            msg->msg_name = sqe->name;
+            msg->msg_namelen = sqe->namelen;
+            msg->msg_iov = iov;
+            msg->msg_iovlen = 1;
+            msg->msg_control = sqe->control;
+            msg->msg_controllen = sqe->controllen;
+
+            s->opcode = sqe->opcode == OE_BATCH_OP_SENDMSG
+                            ? IORING_OP_SENDMSG
+                            : IORING_OP_RECVMSG;
+            s->addr = (uintptr_t)msg;
+            s->len = 1;
+            s->msg_flags = (uint32_t)sqe->flags;
+            break;
+        case OE_BATCH_OP_FSYNC:
+            s->opcode = IORING_OP_FSYNC;
+            break;
+        default:
+            sqe->result = -ENOSYS;
+            return false;
+    }
+
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+static unsigned int _reap(ring_t* ring, oe_syscall_sqe_t* sqes)
+{
+    unsigned int head = *ring->cq_head;
+    const unsigned int tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    unsigned int count = 0;
+
+    for (; head != tail; head++, count++)
+    {
+        const struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+        const size_t slot = (size_t)cqe->user_data;
+        oe_syscall_sqe_t* sqe = &sqes[ring->slots[slot]];
+
+        sqe->result = cqe->res;
+
+        if (sqe->opcode == OE_BATCH_OP_RECVMSG && cqe->res >= 0)
+        {
+            sqe->namelen = ring->msgs[slot].msg_namelen;
+            sqe->controllen = ring->msgs[slot].msg_controllen;
+            sqe->msg_flags = ring->msgs[slot].msg_flags;
+        }
+    }
+
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+    return count;
+}
+
+/* Submit the count entries that have been queued and wait for all of them. */
+static void _run(ring_t* ring, oe_syscall_sqe_t* sqes, unsigned int count)
+{
+    unsigned int to_submit = count;
+    unsigned int completed = 0;
+
+    while (completed < count)
+    {
+        const int ret = (int)syscall(
+            __NR_io_uring_enter,
+            ring->fd,
+            to_submit,
+            1,
+            IORING_ENTER_GETEVENTS,
+            NULL,
+            0);
+
+        if (ret >= 0)
+            to_submit -= (unsigned int)ret;
+        else if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            const int err = errno;
+            const unsigned int tail = *ring->sq_tail;
+
+            /* Requests in flight still write to their buffers, so poll their
+             * completions without waiting in the kernel. */
+            if (!to_submit)
+                sched_yield();
+
+            /* Withdraw the entries that the kernel has not consumed. */
+            for (unsigned int i = tail - to_submit; i != tail; i++)
+            {
+                const unsigned int index = i & *ring->sq_mask;
+                sqes[ring->slots[ring->sqes[index].user_data]].result = -err;
+            }
+
+            __atomic_store_n(ring->sq_tail, tail - to_submit, __ATOMIC_RELEASE);
+            completed += to_submit;
+            to_submit = 0;
+        }
+
+        completed += _reap(ring, sqes);
+    }
+}
+
+bool oe_uring_execute(oe_syscall_sqe_t* sqes, size_t count)
+{
+    ring_t* ring = _get_ring();
+    size_t first = 0;
+
+    if (!ring)
+        return false;
+
+    while (first < count)
+    {
+        size_t end = first;
+        unsigned int slot = 0;
+
+        /* Collect a wave of entries that do not depend on each other. */
+        for (; end < count && slot < ring->entries; end++)
+        {
+            bool dependent = false;
+
+            for (size_t i = first; i < end && !dependent; i++)
+                dependent = _depends(&sqes[i], &sqes[end]);
+
+            if (dependent)
+                break;
+
+            ring->slots[slot] = end;
+
+            if (_push(ring, &sqes[end], slot))
+                slot++;
+        }
+
+        _run(ring, sqes, slot);
+        first = end;
+    }
+
+    return true;
+}
+
+#else /* defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup) */
+
+bool oe_uring_execute(oe_syscall_sqe_t* sqes, size_t count)
+{
+    OE_UNUSED(sqes);
+    OE_UNUSED(count);
+    return false;
+}
+
+#endif
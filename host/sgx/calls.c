@@ -595,6 +595,53 @@ static void _release_tcs(oe_enclave_t* enclave, void* tcs)
     oe_mutex_unlock(&enclave->lock);
 }
 
+/*
+**==============================================================================
+**
+** oe_get_ocall_buffer_statistics()
+**
+**     Collect the ocall buffer counters of the thread bindings. The counters
+**     of busy bindings are updated by their threads without the lock, so the
+**     result is a snapshot.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_get_ocall_buffer_statistics(
+    oe_enclave_t* enclave,
+    oe_ocall_buffer_statistics_t* statistics,
+    size_t* count)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    size_t num_bindings;
+
+    if (!enclave || !count || (*count && !statistics))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    num_bindings = enclave->num_bindings;
+    if (*count < num_bindings)
+    {
+        *count = num_bindings;
+        OE_RAISE_NO_TRACE(OE_BUFFER_TOO_SMALL);
+    }
+
+    for (size_t i = 0; i < num_bindings; i++)
+    {
+        volatile oe_thread_binding_t* binding = &enclave->bindings[i];
+
+        statistics[i].buffer_size = binding->ocall_buffer_size;
+        statistics[i].fallback_count = binding->ocall_buffer_fallback_count;
+        statistics[i].high_water = binding->ocall_buffer_high_water;
+        statistics[i].grow_count = binding->ocall_buffer_grow_count;
+    }
+
+    *count = num_bindings;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 /*
 **==============================================================================
 **
@@ -90,6 +90,9 @@ static void _initialize_enclave_host()
 }
 #endif // OEHOSTMR
 
+/* Maximum number of filled pages that are added with one request. */
+#define MAX_FILLED_PAGES_PER_ADD 1024
+
 static oe_result_t _add_filled_pages(
     oe_sgx_load_context_t* context,
     uint64_t enclave_addr,
@@ -99,46 +102,55 @@ static oe_result_t _add_filled_pages(
     bool extend)
 {
     oe_result_t result = OE_UNEXPECTED;
-    oe_page_t* page = NULL;
-    size_t i;
-
-    page = oe_memalign(OE_PAGE_SIZE, sizeof(oe_page_t));
-    if (!page)
-        OE_RAISE(OE_OUT_OF_MEMORY);
+    oe_page_t* pages = NULL;
+    const size_t chunk_pages =
+        npages < MAX_FILLED_PAGES_PER_ADD ? npages : MAX_FILLED_PAGES_PER_ADD;
 
     /* Reject invalid parameters */
     if (!context || !enclave_addr || !vaddr)
         OE_RAISE(OE_INVALID_PARAMETER);
 
-    /* Fill or clear the page */
+    if (!npages)
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    pages = oe_memalign(OE_PAGE_SIZE, chunk_pages * sizeof(oe_page_t));
+    if (!pages)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    /* Fill or clear the pages */
     if (filler)
     {
-        size_t n = OE_PAGE_SIZE / sizeof(uint32_t);
-        uint32_t* p = (uint32_t*)page;
+        size_t n = chunk_pages * OE_PAGE_SIZE / sizeof(uint32_t);
+        uint32_t* p = (uint32_t*)pages;
 
         while (n--)
             *p++ = filler;
     }
     else
-        memset(page, 0, sizeof(*page));
+        memset(pages, 0, chunk_pages * sizeof(oe_page_t));
 
-    /* Add the pages */
-    for (i = 0; i < npages; i++)
+    /* Add the pages, up to chunk_pages at a time */
+    while (npages)
     {
+        const size_t n = npages < chunk_pages ? npages : chunk_pages;
         uint64_t addr = enclave_addr + *vaddr;
-        uint64_t src = (uint64_t)page;
+        uint64_t src = (uint64_t)pages;
         uint64_t flags = SGX_SECINFO_REG | SGX_SECINFO_R | SGX_SECINFO_W;
 
-        OE_CHECK(oe_sgx_load_enclave_data(
-            context, enclave_addr, addr, src, flags, extend));
-        (*vaddr) += OE_PAGE_SIZE;
+        OE_CHECK(oe_sgx_load_enclave_pages(
+            context, enclave_addr, addr, src, n, flags, extend));
+        (*vaddr) += n * OE_PAGE_SIZE;
+        npages -= n;
     }
 
     result = OE_OK;
 
 done:
-    if (page)
-        oe_memalign_free(page);
+    if (pages)
+        oe_memalign_free(pages);
 
     return result;
 }
@@ -474,9 +486,11 @@ static oe_result_t _configure_enclave(
                 size_t max_enclave_workers =
                     settings[i]
                         .u.context_switchless_setting->max_enclave_workers;
+                uint32_t policy =
+                    settings[i].u.context_switchless_setting->policy;
 
                 OE_CHECK(oe_start_switchless_manager(
-                    enclave, max_host_workers, max_enclave_workers));
+                    enclave, max_host_workers, max_enclave_workers, policy));
                 break;
             }
 #ifdef OE_WITH_EXPERIMENTAL_EEID
@@ -713,6 +727,60 @@ done:
 }
 #endif
 
+#if !defined(OEHOSTMR)
+/* Use the measurement manifest that oesign wrote next to the enclave image if
+ * it belongs to the signature of the image. */
+static void _load_measurement_manifest(
+    oe_sgx_load_context_t* context,
+    const char* path,
+    const oe_sgx_enclave_properties_t* props)
+{
+    const sgx_sigstruct_t* sigstruct = (const sgx_sigstruct_t*)props->sigstruct;
+    const size_t size = strlen(path) + sizeof(OE_SGX_MANIFEST_EXTENSION);
+    oe_sgx_measurement_manifest_t* manifest = NULL;
+    char* manifest_path = NULL;
+
+    if (context->type != OE_SGX_LOAD_TYPE_CREATE)
+        return;
+
+#ifdef OE_WITH_EXPERIMENTAL_EEID
+    /* The EEID pages are not part of the signed measurement */
+    if (context->eeid)
+        return;
+#endif
+
+    /* Unsigned enclaves have no manifest */
+    if (memcmp(
+            sigstruct->header,
+            SGX_SIGSTRUCT_HEADER,
+            sizeof(SGX_SIGSTRUCT_HEADER)) != 0)
+        return;
+
+    if (!(manifest_path = malloc(size)))
+        return;
+
+    snprintf(manifest_path, size, "%s%s", path, OE_SGX_MANIFEST_EXTENSION);
+
+    if (oe_sgx_read_measurement_manifest(manifest_path, &manifest) == OE_OK &&
+        memcmp(
+            manifest->mrenclave.buf,
+            sigstruct->enclavehash,
+            sizeof(sigstruct->enclavehash)) == 0)
+    {
+        context->manifest = manifest;
+        context->manifest_index = 0;
+
+        /* On hardware, EINIT verifies the measurement against the signature,
+         * so the pages need not be hashed. */
+        context->manifest_verify = oe_sgx_is_simulation_load_context(context);
+        manifest = NULL;
+    }
+
+    free(manifest_path);
+    oe_sgx_free_measurement_manifest(manifest);
+}
+#endif // OEHOSTMR
+
 oe_result_t oe_sgx_build_enclave(
     oe_sgx_load_context_t* context,
     const char* path,
@@ -805,6 +873,10 @@ oe_result_t oe_sgx_build_enclave(
     OE_CHECK(_calculate_enclave_size(
         image_size, &props, &enclave_end, &enclave_size));
 
+#if !defined(OEHOSTMR)
+    _load_measurement_manifest(context, path, &props);
+#endif
+
     /* Perform the ECREATE operation */
     OE_CHECK(oe_sgx_create_enclave(context, enclave_size, &enclave_addr));
 
@@ -840,6 +912,16 @@ oe_result_t oe_sgx_build_enclave(
     OE_CHECK(oe_sgx_initialize_enclave(
         context, enclave_addr, &props, &enclave->hash));
 
+    /* Size the ocall buffers of the thread bindings */
+    enclave->ocall_buffer_size =
+        props.config.ocall_buffer_pages
+            ? (uint64_t)props.config.ocall_buffer_pages * OE_PAGE_SIZE
+            : OE_DEFAULT_OCALL_BUFFER_SIZE;
+    enclave->max_ocall_buffer_size =
+        (uint64_t)props.config.max_ocall_buffer_pages * OE_PAGE_SIZE;
+    if (enclave->max_ocall_buffer_size < enclave->ocall_buffer_size)
+        enclave->max_ocall_buffer_size = enclave->ocall_buffer_size;
+
     /* Save full path of this enclave. When a debugger attaches to the host
      * process, it needs the fullpath so that it can load the image binary and
      * extract the debugging symbols. */
@@ -857,6 +939,13 @@ done:
     if (ecall_data)
         free(ecall_data);
 
+    /* A manifest for measurement mode belongs to the caller */
+    if (context && context->type == OE_SGX_LOAD_TYPE_CREATE)
+    {
+        oe_sgx_free_measurement_manifest(context->manifest);
+        context->manifest = NULL;
+    }
+
     oe_unload_enclave_image(&oeimage);
 
     return result;
@@ -1079,11 +1168,14 @@ oe_result_t oe_terminate_enclave(oe_enclave_t* enclave)
         {
             oe_thread_binding_t* binding = &enclave->bindings[i];
             CloseHandle(binding->event.handle);
-            free(binding->ocall_buffer);
         }
 
 #endif
 
+        /* Release the ocall buffers of the thread bindings */
+        for (size_t i = 0; i < enclave->num_bindings; i++)
+            free(enclave->bindings[i].ocall_buffer);
+
         /* Free the path name of the enclave image file */
         free(enclave->path);
     }
@@ -75,8 +75,34 @@ typedef struct _thread_binding
     /* Buffer used for ocall parameters */
     void* ocall_buffer;
     uint64_t ocall_buffer_size;
+
+    /* Ocalls whose parameters did not fit into the ocall buffer */
+    uint64_t ocall_buffer_fallback_count;
+    uint64_t ocall_buffer_high_water;
+    uint64_t ocall_buffer_grow_count;
+
+    /* The largest ocall parameters in the current window of outermost ecalls,
+     * and the number of these ecalls so far */
+    uint64_t ocall_buffer_window_peak;
+    uint64_t ocall_buffer_window_ecalls;
 } oe_thread_binding_t;
 
+/**
+ * Default size of the ocall buffers passed in ecall_contexts. Large enough
+ * for most ocalls. If an ocall requires more than this size, then the enclave
+ * allocates the buffer from its pool of host memory instead of using the
+ * ecall_context's buffer. The size can be changed with the enclave properties.
+ * Note: Currently, quotes are about 10KB.
+ */
+#define OE_DEFAULT_OCALL_BUFFER_SIZE (16 * 1024)
+
+/**
+ * The number of outermost ecalls after which the ocall buffer of a thread
+ * binding is resized to fit the largest ocall parameters of these ecalls, so
+ * that a buffer that was grown for a burst of large ocalls shrinks again.
+ */
+#define OE_OCALL_BUFFER_WINDOW 1024
+
 /* Whether this binding is busy */
 #define _OE_THREAD_BUSY 0X1UL
 
@@ -130,6 +156,10 @@ typedef struct _oe_enclave
 
     /* Manager for switchless calls */
     oe_switchless_call_manager_t* switchless_manager;
+
+    /* Initial and maximum size of the ocall buffer of each thread binding */
+    uint64_t ocall_buffer_size;
+    uint64_t max_ocall_buffer_size;
 } oe_enclave_t;
 
 /* Get the event for the given TCS */
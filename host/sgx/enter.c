@@ -5,6 +5,7 @@
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/registers.h>
 #include <openenclave/internal/sgx/ecall_context.h>
+#include <openenclave/internal/utils.h>
 #include "asmdefs.h"
 #include "enclave.h"
 
@@ -97,30 +98,89 @@ int __oe_host_stack_bridge(
 }
 
 /**
- * Size of ocall buffers passed in ecall_contexts. Large enough for most ocalls.
- * If an ocall requires more than this size, then the enclave will make an
- * ocall to allocate the buffer instead of using the ecall_context's buffer.
- * Note: Currently, quotes are about 10KB.
+ * Get the size of an ocall buffer that fits the given ocall parameters,
+ * within the sizes set in the enclave properties.
  */
-#define OE_DEFAULT_OCALL_BUFFER_SIZE (16 * 1024)
+static uint64_t _get_ocall_buffer_size(
+    const oe_enclave_t* enclave,
+    uint64_t params_size)
+{
+    uint64_t size = oe_round_up_to_page_size(params_size);
+
+    if (size < enclave->ocall_buffer_size)
+        size = enclave->ocall_buffer_size;
+    if (size > enclave->max_ocall_buffer_size)
+        size = enclave->max_ocall_buffer_size;
+
+    return size;
+}
 
 /**
  * Setup the ecall_context.
  */
-OE_INLINE void _setup_ecall_context(oe_ecall_context_t* ecall_context)
+OE_INLINE void _setup_ecall_context(
+    oe_enclave_t* enclave,
+    oe_ecall_context_t* ecall_context)
 {
     oe_thread_binding_t* binding = oe_get_thread_binding();
-    if (binding->ocall_buffer == NULL)
+
+    // The buffer is bound to the tcs and may only be replaced by the
+    // outermost ecall. Grow it as soon as an ocall did not fit. At the end of
+    // each window, fit it to the largest ocall of the window, so that it also
+    // shrinks again.
+    if (binding->count == 1)
     {
-        // Lazily allocate buffer for making ocalls. Bound to the tcs.
-        // Will be cleaned up by enclave during termination.
-        binding->ocall_buffer = malloc(OE_DEFAULT_OCALL_BUFFER_SIZE);
-        binding->ocall_buffer_size = OE_DEFAULT_OCALL_BUFFER_SIZE;
+        const uint64_t peak = binding->ocall_buffer_window_peak;
+        uint64_t size = binding->ocall_buffer_size;
+
+        if (size == 0)
+            size = enclave->ocall_buffer_size;
+
+        if (++binding->ocall_buffer_window_ecalls >= OE_OCALL_BUFFER_WINDOW)
+        {
+            size = _get_ocall_buffer_size(enclave, peak);
+            binding->ocall_buffer_window_peak = 0;
+            binding->ocall_buffer_window_ecalls = 0;
+        }
+        else if (peak > size)
+            size = _get_ocall_buffer_size(enclave, peak);
+
+        if (size != binding->ocall_buffer_size)
+        {
+            // Released by oe_terminate_enclave().
+            void* buffer = malloc(size);
+            if (buffer)
+            {
+                if (binding->ocall_buffer && size > binding->ocall_buffer_size)
+                    binding->ocall_buffer_grow_count++;
+                free(binding->ocall_buffer);
+                binding->ocall_buffer = buffer;
+                binding->ocall_buffer_size = size;
+            }
+        }
     }
+
     ecall_context->ocall_buffer = binding->ocall_buffer;
     ecall_context->ocall_buffer_size = binding->ocall_buffer_size;
 }
 
+/**
+ * Collect the counters that the enclave recorded in the ecall_context.
+ */
+OE_INLINE void _teardown_ecall_context(oe_ecall_context_t* ecall_context)
+{
+    oe_thread_binding_t* binding = oe_get_thread_binding();
+
+    binding->ocall_buffer_fallback_count +=
+        ecall_context->ocall_buffer_fallback_count;
+    if (ecall_context->ocall_buffer_high_water >
+        binding->ocall_buffer_high_water)
+        binding->ocall_buffer_high_water =
+            ecall_context->ocall_buffer_high_water;
+    if (ecall_context->ocall_buffer_peak > binding->ocall_buffer_window_peak)
+        binding->ocall_buffer_window_peak = ecall_context->ocall_buffer_peak;
+}
+
 /**
  * oe_enter Executes the ENCLU instruction and transfers control to the enclave.
  *
@@ -162,7 +222,7 @@ void oe_enter(
     OE_ALIGNED(16)
     uint64_t fx_state[64];
     oe_ecall_context_t ecall_context = {{0}};
-    _setup_ecall_context(&ecall_context);
+    _setup_ecall_context(enclave, &ecall_context);
 
     while (1)
     {
@@ -202,6 +262,8 @@ void oe_enter(
             break;
     }
 
+    _teardown_ecall_context(&ecall_context);
+
     *arg3 = arg1;
     *arg4 = arg2;
 }
@@ -235,7 +297,7 @@ void oe_enter_sim(
     void* host_gs = oe_get_gs_register_base();
     sgx_tcs_t* sgx_tcs = (sgx_tcs_t*)tcs;
     oe_ecall_context_t ecall_context = {{0}};
-    _setup_ecall_context(&ecall_context);
+    _setup_ecall_context(enclave, &ecall_context);
 
     while (1)
     {
@@ -293,6 +355,8 @@ void oe_enter_sim(
             break;
     }
 
+    _teardown_ecall_context(&ecall_context);
+
     *arg3 = arg1;
     *arg4 = arg2;
 }
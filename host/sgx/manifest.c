@@ -0,0 +1,174 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/sgxcreate.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+**==============================================================================
+**
+** File format of the measurement manifest:
+**
+**     manifest_header_t
+**     oe_sgx_measurement_checkpoint_t[num_checkpoints]
+**
+** All fields are little endian. The last checkpoint holds the state after the
+** last page.
+**
+**==============================================================================
+*/
+
+#define MANIFEST_MAGIC "OEMRMANI"
+#define MANIFEST_VERSION 1
+
+/* Limits the allocation for a corrupt file. This allows for 2^24 runs of
+ * pages, which is much more than an enclave of the maximum size can have. */
+#define MANIFEST_MAX_CHECKPOINTS (1 << 24)
+
+typedef struct _manifest_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t checkpoint_size;
+    uint64_t num_checkpoints;
+    OE_SHA256 mrenclave;
+} manifest_header_t;
+
+static FILE* _open(const char* path, const char* mode)
+{
+    FILE* file = NULL;
+
+#ifdef _WIN32
+    if (fopen_s(&file, path, mode) != 0)
+        return NULL;
+#else
+    file = fopen(path, mode);
+#endif
+
+    return file;
+}
+
+oe_result_t oe_sgx_read_measurement_manifest(
+    const char* path,
+    oe_sgx_measurement_manifest_t** manifest_out)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    FILE* file = NULL;
+    manifest_header_t header;
+    oe_sgx_measurement_manifest_t* manifest = NULL;
+
+    if (manifest_out)
+        *manifest_out = NULL;
+
+    if (!path || !manifest_out)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* The manifest is optional, so its absence is not an error */
+    if (!(file = _open(path, "rb")))
+        OE_RAISE_NO_TRACE(OE_NOT_FOUND);
+
+    if (fread(&header, sizeof(header), 1, file) != 1)
+        OE_RAISE_MSG(OE_FAILURE, "Truncated manifest: %s", path);
+
+    if (memcmp(header.magic, MANIFEST_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != MANIFEST_VERSION ||
+        header.checkpoint_size != sizeof(oe_sgx_measurement_checkpoint_t) ||
+        header.num_checkpoints == 0 ||
+        header.num_checkpoints > MANIFEST_MAX_CHECKPOINTS)
+        OE_RAISE_MSG(OE_FAILURE, "Invalid manifest: %s", path);
+
+    if (!(manifest = calloc(1, sizeof(*manifest))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    manifest->mrenclave = header.mrenclave;
+    manifest->num_checkpoints = (size_t)header.num_checkpoints;
+    manifest->capacity = manifest->num_checkpoints;
+
+    if (!(manifest->checkpoints = calloc(
+              manifest->capacity, sizeof(oe_sgx_measurement_checkpoint_t))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    if (fread(
+            manifest->checkpoints,
+            sizeof(oe_sgx_measurement_checkpoint_t),
+            manifest->num_checkpoints,
+            file) != manifest->num_checkpoints)
+        OE_RAISE_MSG(OE_FAILURE, "Truncated manifest: %s", path);
+
+    /* Only the last checkpoint may be the final state */
+    for (size_t i = 0; i < manifest->num_checkpoints; i++)
+    {
+        const bool last = i == manifest->num_checkpoints - 1;
+        if ((manifest->checkpoints[i].npages == 0) != last)
+            OE_RAISE_MSG(OE_FAILURE, "Invalid manifest: %s", path);
+    }
+
+    *manifest_out = manifest;
+    manifest = NULL;
+    result = OE_OK;
+
+done:
+    if (file)
+        fclose(file);
+
+    oe_sgx_free_measurement_manifest(manifest);
+
+    return result;
+}
+
+oe_result_t oe_sgx_write_measurement_manifest(
+    const char* path,
+    const oe_sgx_measurement_manifest_t* manifest)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    FILE* file = NULL;
+    manifest_header_t header;
+
+    if (!path || !manifest || manifest->num_checkpoints == 0)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MANIFEST_MAGIC, sizeof(header.magic));
+    header.version = MANIFEST_VERSION;
+    header.checkpoint_size = sizeof(oe_sgx_measurement_checkpoint_t);
+    header.num_checkpoints = manifest->num_checkpoints;
+    header.mrenclave = manifest->mrenclave;
+
+    if (!(file = _open(path, "wb")))
+        OE_RAISE_MSG(OE_FAILURE, "Failed to open: %s", path);
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fwrite(
+            manifest->checkpoints,
+            sizeof(oe_sgx_measurement_checkpoint_t),
+            manifest->num_checkpoints,
+            file) != manifest->num_checkpoints)
+        OE_RAISE_MSG(OE_FAILURE, "Failed to write: %s", path);
+
+    if (fclose(file) != 0)
+    {
+        file = NULL;
+        OE_RAISE_MSG(OE_FAILURE, "Failed to write: %s", path);
+    }
+
+    file = NULL;
+    result = OE_OK;
+
+done:
+    if (file)
+        fclose(file);
+
+    return result;
+}
+
+void oe_sgx_free_measurement_manifest(oe_sgx_measurement_manifest_t* manifest)
+{
+    if (manifest)
+    {
+        free(manifest->checkpoints);
+        free(manifest);
+    }
+}
@@ -23,6 +23,7 @@
 #include <openenclave/internal/trace.h>
 #include <openenclave/internal/utils.h>
 #include "../common/sgx/sgxmeasure.h"
+#include "../hostthread.h"
 #include "../memalign.h"
 #include "../signkey.h"
 #include "enclave.h"
@@ -602,56 +603,186 @@ static void _dump_load_enclave_data(
 
 #endif /* defined(OE_TRACE_MEASURE) */
 
-oe_result_t oe_sgx_load_enclave_data(
+/*
+**==============================================================================
+**
+** Measurement manifest
+**
+** In measurement mode, the loader records the state of the measurement before
+** each run of pages. When creating the enclave, a run that matches its
+** checkpoints is either not measured at all (on SGX hardware, where EINIT
+** verifies the measurement against the SIGSTRUCT) or measured on several
+** threads, each starting from a checkpoint and comparing its result with the
+** next checkpoint.
+**
+**==============================================================================
+*/
+
+/* Runs of pages are split into checkpoints of at most this many pages, so
+ * that long runs can be measured on several threads. */
+#define MANIFEST_CHECKPOINT_PAGES 1024
+
+static bool _is_checkpoint_state(
+    const oe_sha256_context_t* context,
+    const oe_sgx_measurement_checkpoint_t* checkpoint)
+{
+    uint32_t hash_state[8];
+    uint32_t num_hashed[2];
+
+    return oe_sha256_save(context, hash_state, num_hashed) == OE_OK &&
+           memcmp(hash_state, checkpoint->hash_state, sizeof(hash_state)) ==
+               0 &&
+           memcmp(num_hashed, checkpoint->num_hashed, sizeof(num_hashed)) == 0;
+}
+
+static oe_result_t _add_checkpoint(
+    oe_sgx_measurement_manifest_t* manifest,
+    const oe_sha256_context_t* context,
+    uint64_t offset,
+    size_t npages,
+    uint64_t flags,
+    bool extend)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_sgx_measurement_checkpoint_t* checkpoint;
+
+    if (manifest->num_checkpoints == manifest->capacity)
+    {
+        const size_t capacity =
+            manifest->capacity ? manifest->capacity * 2 : 64;
+        void* checkpoints = realloc(
+            manifest->checkpoints,
+            capacity * sizeof(oe_sgx_measurement_checkpoint_t));
+
+        if (!checkpoints)
+            OE_RAISE(OE_OUT_OF_MEMORY);
+
+        manifest->checkpoints = checkpoints;
+        manifest->capacity = capacity;
+    }
+
+    checkpoint = &manifest->checkpoints[manifest->num_checkpoints];
+    memset(checkpoint, 0, sizeof(*checkpoint));
+    checkpoint->offset = offset;
+    checkpoint->npages = npages;
+    checkpoint->flags = flags;
+    checkpoint->extend = extend;
+    OE_CHECK(oe_sha256_save(
+        context, checkpoint->hash_state, checkpoint->num_hashed));
+
+    manifest->num_checkpoints++;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/* Measure the pages and record a checkpoint before every
+ * MANIFEST_CHECKPOINT_PAGES pages. */
+static oe_result_t _record_pages(
     oe_sgx_load_context_t* context,
     uint64_t base,
     uint64_t addr,
     uint64_t src,
+    size_t npages,
     uint64_t flags,
     bool extend)
 {
     oe_result_t result = OE_UNEXPECTED;
 
-    if (!context || !base || !addr || !src || !flags)
-        OE_RAISE(OE_INVALID_PARAMETER);
+    while (npages > 0)
+    {
+        const size_t n = npages < MANIFEST_CHECKPOINT_PAGES
+                             ? npages
+                             : MANIFEST_CHECKPOINT_PAGES;
+
+        OE_CHECK(_add_checkpoint(
+            context->manifest,
+            &context->hash_context,
+            addr - base,
+            n,
+            flags,
+            extend));
+        OE_CHECK(oe_sgx_measure_load_enclave_pages(
+            &context->hash_context,
+            base,
+            addr,
+            src,
+            n,
+            OE_PAGE_SIZE,
+            flags,
+            extend));
+
+        addr += n * OE_PAGE_SIZE;
+        src += n * OE_PAGE_SIZE;
+        npages -= n;
+    }
 
-    if (context->state != OE_SGX_LOAD_STATE_ENCLAVE_CREATED)
-        OE_RAISE(OE_INVALID_PARAMETER);
+    result = OE_OK;
 
-    /* addr and src must both be page aligned */
-    if (addr % OE_PAGE_SIZE || src % OE_PAGE_SIZE)
-        OE_RAISE(OE_INVALID_PARAMETER);
+done:
+    return result;
+}
 
-#if defined(OE_TRACE_MEASURE)
+#if !defined(OEHOSTMR)
 
-    _dump_load_enclave_data(addr - base, flags, src, extend);
+/* Extended ranges of at least this many pages are measured on a separate
+ * thread while the pages are added. Measuring pages that are not extended
+ * costs less than starting the thread. */
+#define PARALLEL_MEASURE_MIN_PAGES 64
 
-#endif /* defined(OE_TRACE_MEASURE) */
+typedef struct _measure_args
+{
+    oe_sha256_context_t* context;
+    uint64_t base;
+    uint64_t addr;
+    uint64_t src;
+    size_t npages;
+    uint64_t flags;
+    bool extend;
+    oe_result_t result;
+} measure_args_t;
+
+static void* _measure_thread(void* arg)
+{
+    measure_args_t* args = (measure_args_t*)arg;
+
+    args->result = oe_sgx_measure_load_enclave_pages(
+        args->context,
+        args->base,
+        args->addr,
+        args->src,
+        args->npages,
+        OE_PAGE_SIZE,
+        args->flags,
+        args->extend);
+
+    return NULL;
+}
 
-    /* Measure this operation */
-    OE_CHECK(oe_sgx_measure_load_enclave_data(
-        &context->hash_context, base, addr, src, flags, extend));
+static oe_result_t _add_pages(
+    oe_sgx_load_context_t* context,
+    uint64_t addr,
+    uint64_t src,
+    size_t size,
+    uint64_t flags,
+    bool extend)
+{
+    oe_result_t result = OE_UNEXPECTED;
 
-    if (context->type == OE_SGX_LOAD_TYPE_MEASURE)
-    {
-        /* EADD has no further action in measurement mode */
-        result = OE_OK;
-        goto done;
-    }
-#if !defined(OEHOSTMR)
-    else if (oe_sgx_is_simulation_load_context(context))
+    if (oe_sgx_is_simulation_load_context(context))
     {
         /* Simulate enclave add page */
-        /* Verify that page is within enclave boundaries */
+        /* Verify that the pages are within enclave boundaries */
         if ((void*)addr < context->sim.addr ||
+            size > context->sim.size ||
             (uint8_t*)addr >
-                (uint8_t*)context->sim.addr + context->sim.size - OE_PAGE_SIZE)
+                (uint8_t*)context->sim.addr + context->sim.size - size)
             OE_RAISE_MSG(
                 OE_FAILURE, "Page is NOT within enclave boundaries", NULL);
 
         /* Copy page contents onto memory-mapped region */
-        OE_CHECK(oe_memcpy_s(
-            (uint8_t*)addr, OE_PAGE_SIZE, (uint8_t*)src, OE_PAGE_SIZE));
+        OE_CHECK(oe_memcpy_s((uint8_t*)addr, size, (uint8_t*)src, size));
 
         /* Set page access permissions */
         {
@@ -662,7 +793,7 @@ oe_result_t oe_sgx_load_enclave_data(
                     OE_FAILURE, "Unexpected page protections: %#x", prot);
 
 #if defined(__linux__)
-            if (mprotect((void*)addr, OE_PAGE_SIZE, prot) != 0)
+            if (mprotect((void*)addr, size, prot) != 0)
                 OE_RAISE_MSG(
                     OE_FAILURE,
                     "mprotect failed (addr=%#x, prot=%#x)",
@@ -670,7 +801,7 @@ oe_result_t oe_sgx_load_enclave_data(
                     prot);
 #elif defined(_WIN32)
             DWORD old;
-            if (!VirtualProtect((LPVOID)addr, OE_PAGE_SIZE, prot, &old))
+            if (!VirtualProtect((LPVOID)addr, size, prot, &old))
                 OE_RAISE_MSG(
                     OE_FAILURE,
                     "VirtualProtect failed (addr=%#x, prot=%#x)",
@@ -685,13 +816,15 @@ oe_result_t oe_sgx_load_enclave_data(
         if (!extend)
             protect |= ENCLAVE_PAGE_UNVALIDATED;
 
+        /* The whole range is passed to the driver at once. Drivers that
+         * support it add the pages with a single request. */
         uint32_t enclave_error;
         if (enclave_load_data(
                 (void*)addr,
-                OE_PAGE_SIZE,
+                size,
                 (const void*)src,
                 (uint32_t)protect,
-                &enclave_error) != OE_PAGE_SIZE)
+                &enclave_error) != size)
             OE_RAISE_MSG(
                 OE_PLATFORM_ERROR,
                 "enclave_load_data failed (addr=%#x, prot=%#x, err=%#x)",
@@ -699,14 +832,311 @@ oe_result_t oe_sgx_load_enclave_data(
                 protect,
                 enclave_error);
     }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/* Maximum number of threads that verify a run of pages */
+#define MANIFEST_VERIFY_THREADS 8
+
+typedef struct _verify_args
+{
+    const oe_sgx_measurement_checkpoint_t* checkpoints;
+    size_t count;
+    uint64_t base;
+    uint64_t addr;
+    uint64_t src;
+    oe_result_t result;
+} verify_args_t;
+
+/* Measure the pages of each checkpoint from its state and compare the result
+ * with the state of the next checkpoint. */
+static void* _verify_thread(void* arg)
+{
+    verify_args_t* args = (verify_args_t*)arg;
+    oe_result_t result = OE_UNEXPECTED;
+    oe_sha256_context_t context;
+
+    for (size_t i = 0; i < args->count; i++)
+    {
+        const oe_sgx_measurement_checkpoint_t* checkpoint =
+            &args->checkpoints[i];
+        const uint64_t addr = args->base + checkpoint->offset;
+
+        OE_CHECK(oe_sha256_restore(
+            &context, checkpoint->hash_state, checkpoint->num_hashed));
+        OE_CHECK(oe_sgx_measure_load_enclave_pages(
+            &context,
+            args->base,
+            addr,
+            args->src + (addr - args->addr),
+            checkpoint->npages,
+            OE_PAGE_SIZE,
+            checkpoint->flags,
+            checkpoint->extend != 0));
+
+        if (!_is_checkpoint_state(&context, checkpoint + 1))
+            OE_RAISE_MSG(
+                OE_FAILURE,
+                "Pages do not match the measurement manifest (offset=%#x)",
+                checkpoint->offset);
+    }
+
+    result = OE_OK;
+
+done:
+    args->result = result;
+    return NULL;
+}
+
+/* Return the number of checkpoints that make up the run of pages, or 0 if the
+ * run does not continue the manifest. */
+static size_t _match_checkpoints(
+    const oe_sgx_load_context_t* context,
+    uint64_t offset,
+    size_t npages,
+    uint64_t flags,
+    bool extend)
+{
+    const oe_sgx_measurement_manifest_t* manifest = context->manifest;
+    size_t i = context->manifest_index;
+
+    /* The run must start from the current state. This also checks the state
+     * after ECREATE, which depends on the enclave size. */
+    if (i >= manifest->num_checkpoints ||
+        !_is_checkpoint_state(
+            &context->hash_context, &manifest->checkpoints[i]))
+        return 0;
+
+    /* The final checkpoint has no pages, so the loop stops before it */
+    for (; npages > 0; i++)
+    {
+        const oe_sgx_measurement_checkpoint_t* checkpoint =
+            &manifest->checkpoints[i];
+
+        if (checkpoint->offset != offset || checkpoint->npages == 0 ||
+            checkpoint->npages > npages || checkpoint->flags != flags ||
+            checkpoint->extend != extend)
+            return 0;
+
+        offset += checkpoint->npages * OE_PAGE_SIZE;
+        npages -= checkpoint->npages;
+    }
+
+    return i - context->manifest_index;
+}
+
+/* Add the pages of count checkpoints and continue the measurement from the
+ * state after them. */
+static oe_result_t _replay_pages(
+    oe_sgx_load_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    uint64_t src,
+    size_t npages,
+    uint64_t flags,
+    bool extend,
+    size_t count)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    const oe_sgx_measurement_checkpoint_t* checkpoints =
+        &context->manifest->checkpoints[context->manifest_index];
+    verify_args_t args[MANIFEST_VERIFY_THREADS];
+    oe_thread_t threads[MANIFEST_VERIFY_THREADS];
+    bool started[MANIFEST_VERIFY_THREADS];
+    size_t nargs = 0;
+
+    if (context->manifest_verify)
+    {
+        const bool parallel = npages >= PARALLEL_MEASURE_MIN_PAGES;
+        size_t first = 0;
+
+        nargs = count < MANIFEST_VERIFY_THREADS ? count
+                                                : MANIFEST_VERIFY_THREADS;
+
+        /* Split the checkpoints evenly among the threads */
+        for (size_t i = 0; i < nargs; i++)
+        {
+            const size_t n = (count - first) / (nargs - i);
+
+            args[i].checkpoints = checkpoints + first;
+            args[i].count = n;
+            args[i].base = base;
+            args[i].addr = addr;
+            args[i].src = src;
+            args[i].result = OE_UNEXPECTED;
+            started[i] = parallel && oe_thread_create(
+                                         &threads[i],
+                                         _verify_thread,
+                                         &args[i]) == 0;
+            first += n;
+        }
+    }
+
+    result =
+        _add_pages(context, addr, src, npages * OE_PAGE_SIZE, flags, extend);
+
+    for (size_t i = 0; i < nargs; i++)
+    {
+        if (started[i])
+            oe_thread_join(threads[i]);
+        else
+            _verify_thread(&args[i]);
+    }
+
+    OE_CHECK(result);
+
+    for (size_t i = 0; i < nargs; i++)
+        OE_CHECK(args[i].result);
+
+    OE_CHECK(oe_sha256_restore(
+        &context->hash_context,
+        checkpoints[count].hash_state,
+        checkpoints[count].num_hashed));
+    context->manifest_index += count;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+#endif // OEHOSTMR
+
+oe_result_t oe_sgx_load_enclave_pages(
+    oe_sgx_load_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    uint64_t src,
+    size_t npages,
+    uint64_t flags,
+    bool extend)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    size_t size;
+
+    if (!context || !base || !addr || !src || !flags)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (context->state != OE_SGX_LOAD_STATE_ENCLAVE_CREATED)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* addr and src must both be page aligned */
+    if (addr % OE_PAGE_SIZE || src % OE_PAGE_SIZE)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(oe_safe_mul_sizet(npages, OE_PAGE_SIZE, &size));
+
+    if (!size)
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+#if defined(OE_TRACE_MEASURE)
+
+    for (size_t i = 0; i < npages; i++)
+        _dump_load_enclave_data(
+            addr - base + i * OE_PAGE_SIZE,
+            flags,
+            src + i * OE_PAGE_SIZE,
+            extend);
+
+#endif /* defined(OE_TRACE_MEASURE) */
+
+#if !defined(OEHOSTMR)
+    if (context->type != OE_SGX_LOAD_TYPE_MEASURE)
+    {
+        if (context->manifest)
+        {
+            const size_t count =
+                _match_checkpoints(context, addr - base, npages, flags, extend);
+
+            if (count)
+            {
+                OE_CHECK(_replay_pages(
+                    context, base, addr, src, npages, flags, extend, count));
+                result = OE_OK;
+                goto done;
+            }
+
+            /* The layout differs from the one that was signed, e.g., because
+             * of EEID. Measure all remaining pages. */
+            oe_sgx_free_measurement_manifest(context->manifest);
+            context->manifest = NULL;
+        }
+
+        /* Measure this operation, concurrently for larger ranges */
+        measure_args_t args = {
+            &context->hash_context,
+            base,
+            addr,
+            src,
+            npages,
+            flags,
+            extend,
+            OE_UNEXPECTED};
+        oe_thread_t thread = 0;
+        const bool parallel =
+            extend && npages >= PARALLEL_MEASURE_MIN_PAGES &&
+            oe_thread_create(&thread, _measure_thread, &args) == 0;
+
+        if (!parallel)
+            _measure_thread(&args);
+
+        result = _add_pages(context, addr, src, size, flags, extend);
+
+        if (parallel)
+            oe_thread_join(thread);
+
+        OE_CHECK(result);
+        OE_CHECK(args.result);
+
+        result = OE_OK;
+        goto done;
+    }
 #endif // OEHOSTMR
 
+    /* Measure this operation. EADD has no further action in measurement mode */
+    if (context->manifest)
+    {
+        OE_CHECK(
+            _record_pages(context, base, addr, src, npages, flags, extend));
+        result = OE_OK;
+        goto done;
+    }
+
+    OE_CHECK(oe_sgx_measure_load_enclave_pages(
+        &context->hash_context,
+        base,
+        addr,
+        src,
+        npages,
+        OE_PAGE_SIZE,
+        flags,
+        extend));
+
     result = OE_OK;
 
 done:
     return result;
 }
 
+oe_result_t oe_sgx_load_enclave_data(
+    oe_sgx_load_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    uint64_t src,
+    uint64_t flags,
+    bool extend)
+{
+    return oe_sgx_load_enclave_pages(
+        context, base, addr, src, 1, flags, extend);
+}
+
 oe_result_t oe_sgx_initialize_enclave(
     oe_sgx_load_context_t* context,
     uint64_t addr,
@@ -724,10 +1154,31 @@ oe_result_t oe_sgx_initialize_enclave(
     if (context->state != OE_SGX_LOAD_STATE_ENCLAVE_CREATED)
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    /* Record the state after the last page */
+    if (context->type == OE_SGX_LOAD_TYPE_MEASURE && context->manifest)
+        OE_CHECK(_add_checkpoint(
+            context->manifest, &context->hash_context, 0, 0, 0, false));
+
     /* Measure this operation */
     OE_CHECK(
         oe_sgx_measure_initialize_enclave(&context->hash_context, mrenclave));
+
+    if (context->type == OE_SGX_LOAD_TYPE_MEASURE && context->manifest)
+        context->manifest->mrenclave = *mrenclave;
 #if !defined(OEHOSTMR)
+    /* Pages that were replayed from the manifest without measuring them must
+     * lead to the signed MRENCLAVE. EINIT checks the actual measurement. */
+    if (context->type == OE_SGX_LOAD_TYPE_CREATE &&
+        context->manifest_index > 0 && !context->manifest_verify &&
+        memcmp(
+            mrenclave->buf,
+            ((const sgx_sigstruct_t*)properties->sigstruct)->enclavehash,
+            sizeof(mrenclave->buf)) != 0)
+        OE_RAISE_MSG(
+            OE_FAILURE,
+            "Enclave measurement does not match the manifest",
+            NULL);
+
     /* EINIT has no further action in measurement/simulation mode */
     if (context->type == OE_SGX_LOAD_TYPE_CREATE &&
         !oe_sgx_is_simulation_load_context(context))
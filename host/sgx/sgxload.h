@@ -37,6 +37,19 @@ oe_result_t oe_sgx_load_enclave_data(
     uint64_t flags,
     bool extend);
 
+/*
+ * Add npages pages from the contiguous buffer at src to the enclave at addr,
+ * like npages calls to oe_sgx_load_enclave_data().
+ */
+oe_result_t oe_sgx_load_enclave_pages(
+    oe_sgx_load_context_t* context,
+    uint64_t base,
+    uint64_t addr,
+    uint64_t src,
+    size_t npages,
+    uint64_t flags,
+    bool extend);
+
 oe_result_t oe_sgx_initialize_enclave(
     oe_sgx_load_context_t* context,
     uint64_t addr,
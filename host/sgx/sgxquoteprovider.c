@@ -1,6 +1,8 @@
 // Copyright (c) Open Enclave SDK contributors.
 // Licensed under the MIT License.
 
+#include <openenclave/internal/crypto/crl.h>
+#include <openenclave/internal/datetime.h>
 #include <openenclave/internal/hexdump.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/safecrt.h>
@@ -8,6 +10,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "../hostthread.h"
 #include "sgxquoteprovider.h"
@@ -53,7 +56,7 @@ done:
     return result;
 }
 
-oe_result_t oe_get_sgx_quote_verification_collateral(
+static oe_result_t _fetch_collateral(
     oe_get_sgx_quote_verification_collateral_args_t* args)
 {
     oe_result_t result = OE_FAILURE;
@@ -279,6 +282,249 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** Collateral cache.
+**
+** Fetching the collateral usually means a request to a caching service or to
+** Intel's provisioning service, which takes much longer than the verification
+** of a quote. The collateral of an FMSPC only changes when Intel publishes new
+** CRLs, TCB info or QE identity, so it is reused until the earliest nextUpdate
+** of its CRLs. Entries are refetched after COLLATERAL_CACHE_MAX_AGE seconds at
+** the latest, so that a CRL that is published early is picked up.
+**
+**==============================================================================
+*/
+
+#define COLLATERAL_CACHE_SIZE 16
+#define COLLATERAL_CACHE_MAX_AGE (60 * 60)
+
+typedef struct _collateral_cache_entry
+{
+    bool used;
+    uint64_t last_used;
+    time_t fetched;
+    oe_datetime_t next_update;
+    oe_get_sgx_quote_verification_collateral_args_t args;
+} collateral_cache_entry_t;
+
+static struct
+{
+    oe_mutex lock;
+    uint64_t clock;
+    collateral_cache_entry_t entries[COLLATERAL_CACHE_SIZE];
+} _collateral_cache = {OE_H_MUTEX_INITIALIZER};
+
+static size_t _get_collateral_size(
+    const oe_get_sgx_quote_verification_collateral_args_t* args)
+{
+    return args->pck_crl_issuer_chain_size + args->root_ca_crl_size +
+           args->pck_crl_size + args->tcb_info_issuer_chain_size +
+           args->tcb_info_size + args->qe_identity_issuer_chain_size +
+           args->qe_identity_size;
+}
+
+/* Copies the collateral into a new host_out_buffer. */
+static oe_result_t _copy_collateral(
+    oe_get_sgx_quote_verification_collateral_args_t* dest,
+    const oe_get_sgx_quote_verification_collateral_args_t* src)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    const size_t size = _get_collateral_size(src);
+    uint8_t* buffer = NULL;
+
+    if (!(buffer = (uint8_t*)malloc(size)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    memcpy(buffer, src->host_out_buffer, size);
+
+#define REBASE(FIELD)                                           \
+    dest->FIELD = buffer + (src->FIELD - src->host_out_buffer); \
+    dest->FIELD##_size = src->FIELD##_size
+
+    REBASE(pck_crl_issuer_chain);
+    REBASE(root_ca_crl);
+    REBASE(pck_crl);
+    REBASE(tcb_info_issuer_chain);
+    REBASE(tcb_info);
+    REBASE(qe_identity_issuer_chain);
+    REBASE(qe_identity);
+
+#undef REBASE
+
+    dest->host_out_buffer = buffer;
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+static oe_result_t _get_crl_next_update(
+    const uint8_t* data,
+    size_t size,
+    oe_datetime_t* next_update)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_crl_t crl = {{0}};
+    bool read = false;
+
+    /* The quote provider may return the CRLs in either format */
+    if (oe_crl_read_pem(&crl, data, size) != OE_OK)
+        OE_CHECK(oe_crl_read_der(&crl, data, size));
+    read = true;
+
+    OE_CHECK(oe_crl_get_update_dates(&crl, NULL, next_update));
+
+    result = OE_OK;
+
+done:
+    if (read)
+        oe_crl_free(&crl);
+
+    return result;
+}
+
+static oe_result_t _get_collateral_next_update(
+    const oe_get_sgx_quote_verification_collateral_args_t* args,
+    oe_datetime_t* next_update)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_datetime_t root_ca_next_update;
+
+    OE_CHECK(
+        _get_crl_next_update(args->pck_crl, args->pck_crl_size, next_update));
+    OE_CHECK(_get_crl_next_update(
+        args->root_ca_crl, args->root_ca_crl_size, &root_ca_next_update));
+
+    if (oe_datetime_compare(&root_ca_next_update, next_update) < 0)
+        *next_update = root_ca_next_update;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+static bool _is_fresh(
+    const collateral_cache_entry_t* entry,
+    time_t now,
+    const oe_datetime_t* datetime_now)
+{
+    return now - entry->fetched < COLLATERAL_CACHE_MAX_AGE &&
+           oe_datetime_compare(datetime_now, &entry->next_update) < 0;
+}
+
+/* Copies the cached collateral for args->fmspc into args if there is any. */
+static bool _get_cached_collateral(
+    oe_get_sgx_quote_verification_collateral_args_t* args)
+{
+    bool found = false;
+    const time_t now = time(NULL);
+    oe_datetime_t datetime_now;
+
+    if (oe_datetime_now(&datetime_now) != OE_OK)
+        return false;
+
+    if (oe_mutex_lock(&_collateral_cache.lock) != 0)
+        return false;
+
+    for (size_t i = 0; i < COLLATERAL_CACHE_SIZE; i++)
+    {
+        collateral_cache_entry_t* const entry = &_collateral_cache.entries[i];
+
+        if (!entry->used ||
+            memcmp(entry->args.fmspc, args->fmspc, sizeof(args->fmspc)) != 0)
+            continue;
+
+        if (_is_fresh(entry, now, &datetime_now) &&
+            _copy_collateral(args, &entry->args) == OE_OK)
+        {
+            entry->last_used = ++_collateral_cache.clock;
+            found = true;
+        }
+
+        break;
+    }
+
+    oe_mutex_unlock(&_collateral_cache.lock);
+
+    return found;
+}
+
+/* Adds a copy of the fetched collateral to the cache. */
+static void _cache_collateral(
+    const oe_get_sgx_quote_verification_collateral_args_t* args)
+{
+    collateral_cache_entry_t* victim = NULL;
+    oe_get_sgx_quote_verification_collateral_args_t copy = {0};
+    oe_datetime_t next_update;
+
+    /* Collateral whose expiry is unknown is not cached */
+    if (_get_collateral_next_update(args, &next_update) != OE_OK ||
+        _copy_collateral(&copy, args) != OE_OK)
+        return;
+
+    memcpy(copy.fmspc, args->fmspc, sizeof(copy.fmspc));
+
+    if (oe_mutex_lock(&_collateral_cache.lock) != 0)
+    {
+        free(copy.host_out_buffer);
+        return;
+    }
+
+    /* Replace the entry of the same FMSPC, a free or the least recently used
+     * entry */
+    for (size_t i = 0; i < COLLATERAL_CACHE_SIZE; i++)
+    {
+        collateral_cache_entry_t* const entry = &_collateral_cache.entries[i];
+
+        if (entry->used &&
+            memcmp(entry->args.fmspc, args->fmspc, sizeof(args->fmspc)) == 0)
+        {
+            victim = entry;
+            break;
+        }
+
+        if (!victim || (victim->used && (!entry->used ||
+                                         entry->last_used < victim->last_used)))
+            victim = entry;
+    }
+
+    free(victim->args.host_out_buffer);
+
+    victim->used = true;
+    victim->last_used = ++_collateral_cache.clock;
+    victim->fetched = time(NULL);
+    victim->next_update = next_update;
+    victim->args = copy;
+
+    oe_mutex_unlock(&_collateral_cache.lock);
+}
+
+oe_result_t oe_get_sgx_quote_verification_collateral(
+    oe_get_sgx_quote_verification_collateral_args_t* args)
+{
+    oe_result_t result = OE_FAILURE;
+
+    if (!args)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (_get_cached_collateral(args))
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    OE_CHECK(_fetch_collateral(args));
+    _cache_collateral(args);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 void oe_free_sgx_quote_verification_collateral_args(
     oe_get_sgx_quote_verification_collateral_args_t* args)
 {
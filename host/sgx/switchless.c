@@ -8,6 +8,7 @@
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/switchless.h>
 #include <openenclave/internal/utils.h>
+#include <string.h>
 #include "../calls.h"
 #include "../hostthread.h"
 #include "../ocalls.h"
@@ -17,12 +18,147 @@
 /**
  * Number of iterations an ocall worker thread would spin before going to sleep
  */
-#define OE_HOST_WORKER_SPIN_COUNT_THRESHOLD (4096U)
+#define OE_HOST_WORKER_SPIN_COUNT_THRESHOLD \
+    OE_SWITCHLESS_DEFAULT_SPIN_COUNT_THRESHOLD
 
 /**
  * Number of iterations an ecall worker thread would spin before going to sleep
  */
-#define OE_ENCLAVE_WORKER_SPIN_COUNT_THRESHOLD (4096U)
+#define OE_ENCLAVE_WORKER_SPIN_COUNT_THRESHOLD \
+    OE_SWITCHLESS_DEFAULT_SPIN_COUNT_THRESHOLD
+
+/**
+ * Number of iterations used to measure the duration of one spin iteration
+ */
+#define OE_SWITCHLESS_CALIBRATION_SPIN_COUNT (4096U)
+
+/*
+** Take the next pending call out of the ring and mark the worker busy with it.
+** Returns NULL if the ring is empty.
+*/
+static oe_call_host_function_args_t* _ring_dequeue(
+    oe_host_worker_context_t* context)
+{
+    oe_switchless_ring_t* const ring = context->ring;
+    const uint64_t mask = ring->capacity - 1;
+    uint64_t pos = oe_atomic_load(&ring->dequeue_pos);
+
+    while (true)
+    {
+        oe_switchless_ring_slot_t* slot = &ring->slots[pos & mask];
+        uint64_t sequence = oe_atomic_load(&slot->sequence);
+        int64_t diff = (int64_t)(sequence - (pos + 1));
+
+        if (diff == 0)
+        {
+            // The slot holds a posted call. Try to claim the position.
+            if (oe_atomic_compare_and_swap(
+                    (int64_t volatile*)&ring->dequeue_pos,
+                    (int64_t)pos,
+                    (int64_t)(pos + 1)))
+            {
+                // Take the call out of the slot. The enclave thread that
+                // posted the call may have withdrawn it in the meantime by
+                // clearing call_arg. The worker is marked busy before the
+                // slot is cleared, so the enclave never sees it idle while
+                // it holds a call and wakes another worker for new calls.
+                void* call_arg = slot->call_arg;
+                if (call_arg != NULL)
+                {
+                    context->call_arg = call_arg;
+                    if (!oe_atomic_compare_and_swap_ptr(
+                            (void* volatile*)&slot->call_arg, call_arg, NULL))
+                    {
+                        context->call_arg = NULL;
+                        call_arg = NULL;
+                    }
+                }
+
+                // Hand the slot back to the producers for the next lap.
+                OE_ATOMIC_MEMORY_BARRIER_RELEASE();
+                slot->sequence = pos + mask + 1;
+
+                if (call_arg != NULL)
+                    return (oe_call_host_function_args_t*)call_arg;
+            }
+            pos = oe_atomic_load(&ring->dequeue_pos);
+        }
+        else if (diff < 0)
+        {
+            // The slot has not been published yet. The ring is empty.
+            return NULL;
+        }
+        else
+        {
+            // Another worker claimed the position. Catch up.
+            pos = oe_atomic_load(&ring->dequeue_pos);
+        }
+    }
+}
+
+/*
+** Return whether the ring has no posted calls.
+*/
+static bool _ring_is_empty(oe_switchless_ring_t* ring)
+{
+    uint64_t pos = oe_atomic_load(&ring->dequeue_pos);
+    oe_switchless_ring_slot_t* slot = &ring->slots[pos & (ring->capacity - 1)];
+    return oe_atomic_load(&slot->sequence) != pos + 1;
+}
+
+/*
+** Convert the time that passed since start into the number of spin iterations
+** a worker could have done in the meantime.
+*/
+static uint64_t _elapsed_spin_count(
+    oe_switchless_call_manager_t* manager,
+    uint64_t start)
+{
+    uint64_t elapsed = oe_switchless_get_time() - start;
+    return elapsed * 1000 / manager->spin_duration;
+}
+
+/*
+** Measure the duration of one spin iteration in picoseconds.
+*/
+static uint64_t _calibrate_spin_duration(void)
+{
+    uint64_t start = oe_switchless_get_time();
+    for (uint32_t i = 0; i < OE_SWITCHLESS_CALIBRATION_SPIN_COUNT; i++)
+        oe_yield_cpu();
+    uint64_t duration = (oe_switchless_get_time() - start) * 1000 /
+                        OE_SWITCHLESS_CALIBRATION_SPIN_COUNT;
+    return duration ? duration : 1;
+}
+
+/*
+** Put a host worker to sleep until the enclave posts a call.
+*/
+static void _host_worker_sleep(
+    oe_switchless_call_manager_t* manager,
+    oe_host_worker_context_t* context)
+{
+    uint64_t start = 0;
+
+    // Announce the sleep before looking at the ring a last time. The enclave
+    // looks at is_sleeping after it has posted a call, so either the enclave
+    // wakes up this worker or this worker sees the call.
+    context->is_sleeping = true;
+    OE_ATOMIC_MEMORY_BARRIER_FULL();
+
+    if (!_ring_is_empty(context->ring) || context->is_stopping)
+    {
+        context->is_sleeping = false;
+        return;
+    }
+
+    context->total_sleep_count++;
+    start = oe_switchless_get_time();
+    oe_host_worker_wait(context);
+    context->sleep_spin_count += _elapsed_spin_count(manager, start);
+
+    context->is_sleeping = false;
+}
 
 /*
 ** The thread function that handles switchless ocalls
@@ -31,50 +167,124 @@
 static void* _switchless_ocall_worker(void* arg)
 {
     oe_host_worker_context_t* context = (oe_host_worker_context_t*)arg;
+    oe_switchless_call_manager_t* manager = context->enc->switchless_manager;
+    const bool is_adaptive =
+        (manager->policy & OE_SWITCHLESS_POLICY_ADAPTIVE_SPIN) != 0;
+    bool is_spinning = false;
 
     while (!context->is_stopping)
     {
-        volatile oe_call_host_function_args_t* local_call_arg = NULL;
-        if ((local_call_arg = context->call_arg) != NULL)
+        oe_call_host_function_args_t* local_call_arg = NULL;
+        // _ring_dequeue() marks this worker as busy, so that the enclave
+        // wakes up another worker for calls that are posted meanwhile.
+        if ((local_call_arg = _ring_dequeue(context)) != NULL)
         {
-            // Handle the switchless call, but do not clear the slot yet. Since
-            // the slot is not empty, any new incoming switchless call request
-            // will be scheduled in another available work thread and get
-            // handled immediately.
+            if (is_spinning)
+            {
+                oe_atomic_decrement(&manager->num_spinning_host_workers);
+                is_spinning = false;
+            }
+
+            // More calls are waiting. Let one more worker spin.
+            if (!_ring_is_empty(context->ring))
+            {
+                uint64_t max =
+                    oe_atomic_load(&manager->max_spinning_host_workers);
+                if (max < manager->num_host_workers)
+                    oe_atomic_compare_and_swap(
+                        (int64_t volatile*)&manager->max_spinning_host_workers,
+                        (int64_t)max,
+                        (int64_t)(max + 1));
+            }
+
+            if (is_adaptive)
+                oe_switchless_adapt_spin_count_threshold(
+                    &context->average_spin_count,
+                    &context->spin_count_threshold,
+                    context->spin_count + context->sleep_spin_count);
+
             oe_handle_call_host_function(
                 (uint64_t)local_call_arg, context->enc);
 
             // After handling the switchless call, mark this worker thread
-            // as free by clearing the slot.
+            // as free and keep draining the ring.
             context->call_arg = NULL;
+            context->total_call_count++;
 
             // Reset spin count for next message.
             context->total_spin_count += context->spin_count;
             context->spin_count = 0;
+            context->sleep_spin_count = 0;
+        }
+        else if (!is_spinning)
+        {
+            // Start spinning unless enough other workers are already
+            // spinning. In that case, park this worker right away.
+            if (oe_atomic_increment(&manager->num_spinning_host_workers) <=
+                oe_atomic_load(&manager->max_spinning_host_workers))
+            {
+                is_spinning = true;
+            }
+            else
+            {
+                oe_atomic_decrement(&manager->num_spinning_host_workers);
+                _host_worker_sleep(manager, context);
+            }
         }
         else
         {
             // If there is no message, increment spin count until threshold is
             // reached.
-            if (++context->spin_count >= OE_HOST_WORKER_SPIN_COUNT_THRESHOLD)
+            if (++context->spin_count >= context->spin_count_threshold)
             {
                 // Reset spin count and go to sleep until event is fired.
                 context->total_spin_count += context->spin_count;
+                context->sleep_spin_count += context->spin_count;
                 context->spin_count = 0;
-                oe_host_worker_wait(context);
+
+                // No call arrived while spinning. Let one worker less spin.
+                oe_atomic_decrement(&manager->num_spinning_host_workers);
+                is_spinning = false;
+                if (manager->policy & OE_SWITCHLESS_POLICY_AUTO_SCALE)
+                {
+                    uint64_t max =
+                        oe_atomic_load(&manager->max_spinning_host_workers);
+                    if (max > 1)
+                        oe_atomic_compare_and_swap(
+                            (int64_t volatile*)&manager
+                                ->max_spinning_host_workers,
+                            (int64_t)max,
+                            (int64_t)(max - 1));
+                }
+
+                _host_worker_sleep(manager, context);
             }
 
             /* Yield CPU */
             oe_yield_cpu();
         }
     }
+
+    if (is_spinning)
+        oe_atomic_decrement(&manager->num_spinning_host_workers);
+
     return NULL;
 }
 
 void oe_sgx_sleep_switchless_worker_ocall(oe_enclave_worker_context_t* context)
 {
+    oe_switchless_call_manager_t* manager = context->enc->switchless_manager;
+    uint64_t start = oe_switchless_get_time();
+
     // Wait for messages.
+    context->is_sleeping = true;
+    context->total_sleep_count++;
     oe_enclave_worker_wait(context);
+    context->is_sleeping = false;
+
+    // Let the enclave account for the time slept when it adapts the spin
+    // count threshold.
+    context->sleep_spin_count += _elapsed_spin_count(manager, start);
 }
 
 /*
@@ -104,9 +314,22 @@ static oe_result_t oe_stop_worker_threads(oe_switchless_call_manager_t* manager)
         oe_host_worker_wake(&manager->host_worker_contexts[i]);
 
         OE_TRACE_INFO(
-            "Switchless host worker thread %d spun for %lu times",
+            "Switchless host worker thread %d spun for %lu times, slept %lu "
+            "times and handled %lu calls",
             (int)i,
-            manager->host_worker_contexts[i].total_spin_count);
+            manager->host_worker_contexts[i].total_spin_count,
+            manager->host_worker_contexts[i].total_sleep_count,
+            manager->host_worker_contexts[i].total_call_count);
+    }
+    if (manager->ring != NULL)
+    {
+        OE_TRACE_INFO(
+            "Switchless ocall ring: %lu calls enqueued, %lu missed, "
+            "peak occupancy %lu of %lu",
+            manager->ring->total_enqueued,
+            manager->ring->total_missed,
+            manager->ring->peak_occupancy,
+            manager->ring->capacity);
     }
     for (size_t i = 0; i < manager->num_enclave_workers; i++)
     {
@@ -136,7 +359,8 @@ done:
 oe_result_t oe_start_switchless_manager(
     oe_enclave_t* enclave,
     size_t num_host_workers,
-    size_t num_enclave_workers)
+    size_t num_enclave_workers,
+    uint32_t policy)
 {
     oe_result_t result = OE_UNEXPECTED;
     oe_result_t result_out = 0;
@@ -145,6 +369,8 @@ oe_result_t oe_start_switchless_manager(
     oe_thread_t* host_threads = NULL;
     oe_enclave_worker_context_t* enclave_contexts = NULL;
     oe_thread_t* enclave_threads = NULL;
+    oe_switchless_ring_t* ring = NULL;
+    uint64_t ring_capacity = OE_SWITCHLESS_RING_MIN_CAPACITY;
 
     if (enclave == NULL)
         OE_RAISE(OE_INVALID_PARAMETER);
@@ -193,12 +419,48 @@ oe_result_t oe_start_switchless_manager(
     manager->num_enclave_workers = num_enclave_workers;
     manager->enclave_worker_contexts = enclave_contexts;
     manager->enclave_worker_threads = enclave_threads;
+    manager->policy = policy;
+    manager->spin_duration = _calibrate_spin_duration();
+    manager->max_spinning_host_workers = num_host_workers;
+    if (policy & OE_SWITCHLESS_POLICY_AUTO_SCALE)
+        manager->max_spinning_host_workers = 1;
+
+    // Each enclave has at most one switchless manager. It is published before
+    // the workers are started because they look it up through the enclave.
+    enclave->switchless_manager = manager;
+
+    // Allocate the ring of pending switchless ocalls. Size it so that every
+    // enclave thread can have a call queued at the same time.
+    if (num_host_workers > 0)
+    {
+        while (ring_capacity < enclave->num_bindings)
+            ring_capacity <<= 1;
+
+        ring = calloc(1, sizeof(oe_switchless_ring_t));
+        if (ring == NULL)
+            OE_RAISE(OE_OUT_OF_MEMORY);
+        manager->ring = ring;
+
+        ring->slots = calloc(ring_capacity, sizeof(oe_switchless_ring_slot_t));
+        if (ring->slots == NULL)
+            OE_RAISE(OE_OUT_OF_MEMORY);
+        ring->capacity = ring_capacity;
+
+        // Each slot starts out free for the first lap.
+        for (uint64_t i = 0; i < ring_capacity; i++)
+            ring->slots[i].sequence = i;
+    }
 
     // Start the host worker threads, and assign each one a private context.
     for (size_t i = 0; i < num_host_workers; i++)
     {
         OE_TRACE_INFO("Creating switchless host worker thread %d\n", (int)i);
         manager->host_worker_contexts[i].enc = enclave;
+        manager->host_worker_contexts[i].ring = ring;
+        manager->host_worker_contexts[i].spin_count_threshold =
+            OE_HOST_WORKER_SPIN_COUNT_THRESHOLD;
+        manager->host_worker_contexts[i].average_spin_count =
+            OE_HOST_WORKER_SPIN_COUNT_THRESHOLD / 2;
         if (oe_thread_create(
                 &manager->host_worker_threads[i],
                 _switchless_ocall_worker,
@@ -215,7 +477,8 @@ oe_result_t oe_start_switchless_manager(
             enclave,
             &result_out,
             manager->host_worker_contexts,
-            manager->num_host_workers));
+            manager->num_host_workers,
+            manager->ring));
         OE_CHECK(result_out);
     }
 
@@ -228,6 +491,10 @@ oe_result_t oe_start_switchless_manager(
         manager->enclave_worker_contexts[i].enc = enclave;
         manager->enclave_worker_contexts[i].spin_count_threshold =
             OE_ENCLAVE_WORKER_SPIN_COUNT_THRESHOLD;
+        manager->enclave_worker_contexts[i].average_spin_count =
+            OE_ENCLAVE_WORKER_SPIN_COUNT_THRESHOLD / 2;
+        manager->enclave_worker_contexts[i].is_adaptive =
+            (policy & OE_SWITCHLESS_POLICY_ADAPTIVE_SPIN) != 0;
         if (oe_thread_create(
                 &manager->enclave_worker_threads[i],
                 _switchless_ecall_worker,
@@ -247,9 +514,6 @@ oe_result_t oe_start_switchless_manager(
         }
     }
 
-    // Each enclave has at most one switchless manager.
-    enclave->switchless_manager = manager;
-
     result = OE_OK;
 
 done:
@@ -281,6 +545,11 @@ oe_result_t oe_stop_switchless_manager(oe_enclave_t* enclave)
             free(manager->enclave_worker_contexts);
         if (manager->enclave_worker_threads != NULL)
             free(manager->enclave_worker_threads);
+        if (manager->ring != NULL)
+        {
+            free(manager->ring->slots);
+            free(manager->ring);
+        }
         free(manager);
     }
     result = OE_OK;
@@ -290,9 +559,94 @@ done:
 
 void oe_sgx_wake_switchless_worker_ocall(oe_host_worker_context_t* context)
 {
+    oe_atomic_increment(&context->total_wakeup_count);
     oe_host_worker_wake(context);
 }
 
+oe_result_t oe_get_switchless_statistics(
+    oe_enclave_t* enclave,
+    oe_switchless_statistics_t* statistics)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_call_manager_t* manager = NULL;
+    oe_switchless_worker_statistics_t* host = NULL;
+    oe_switchless_worker_statistics_t* enc = NULL;
+
+    if (enclave == NULL || statistics == NULL)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if ((manager = enclave->switchless_manager) == NULL)
+        OE_RAISE(OE_NOT_FOUND);
+
+    memset(statistics, 0, sizeof(*statistics));
+    host = &statistics->host_workers;
+    enc = &statistics->enclave_workers;
+
+    host->num_workers = manager->num_host_workers;
+    for (size_t i = 0; i < manager->num_host_workers; i++)
+    {
+        volatile oe_host_worker_context_t* context =
+            &manager->host_worker_contexts[i];
+        if (context->is_sleeping)
+            host->num_sleeping_workers++;
+        host->total_spin_count += context->total_spin_count;
+        host->total_sleep_count += context->total_sleep_count;
+        host->total_wakeup_count += context->total_wakeup_count;
+        host->total_call_count += context->total_call_count;
+    }
+
+    enc->num_workers = manager->num_enclave_workers;
+    for (size_t i = 0; i < manager->num_enclave_workers; i++)
+    {
+        volatile oe_enclave_worker_context_t* context =
+            &manager->enclave_worker_contexts[i];
+        if (context->is_sleeping)
+            enc->num_sleeping_workers++;
+        enc->total_spin_count += context->total_spin_count;
+        enc->total_sleep_count += context->total_sleep_count;
+        enc->total_wakeup_count += context->total_wakeup_count;
+        enc->total_call_count += context->total_call_count;
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_get_switchless_ring_statistics(
+    oe_enclave_t* enclave,
+    oe_switchless_ring_statistics_t* statistics)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_ring_t* ring = NULL;
+
+    if (enclave == NULL || statistics == NULL)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (enclave->switchless_manager == NULL ||
+        enclave->switchless_manager->ring == NULL)
+        OE_RAISE(OE_NOT_FOUND);
+
+    ring = enclave->switchless_manager->ring;
+
+    // The counters are updated concurrently, so this is only a snapshot.
+    uint64_t dequeue_pos = oe_atomic_load(&ring->dequeue_pos);
+    uint64_t enqueue_pos = oe_atomic_load(&ring->enqueue_pos);
+
+    statistics->capacity = ring->capacity;
+    statistics->occupancy =
+        enqueue_pos > dequeue_pos ? enqueue_pos - dequeue_pos : 0;
+    statistics->peak_occupancy = oe_atomic_load(&ring->peak_occupancy);
+    statistics->total_enqueued = oe_atomic_load(&ring->total_enqueued);
+    statistics->total_missed = oe_atomic_load(&ring->total_missed);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 static oe_result_t oe_switchless_call_enclave_function_by_table_id(
     oe_enclave_t* enclave,
     uint64_t table_id,
@@ -370,6 +724,7 @@ static oe_result_t oe_switchless_call_enclave_function_by_table_id(
                     // The pevious value of the event was 0 which means that the
                     // worker was previously sleeping.
                     // Wake it.
+                    oe_atomic_increment(&contexts[tries].total_wakeup_count);
                     oe_enclave_worker_wake(&contexts[tries]);
                 }
 
@@ -447,12 +802,14 @@ OE_UNUSED_FUNC static oe_result_t _oe_sgx_init_context_switchless_ecall(
     oe_enclave_t* enclave,
     oe_result_t* _retval,
     oe_host_worker_context_t* host_worker_contexts,
-    uint64_t num_host_workers)
+    uint64_t num_host_workers,
+    oe_switchless_ring_t* ring)
 {
     OE_UNUSED(enclave);
     OE_UNUSED(_retval);
     OE_UNUSED(host_worker_contexts);
     OE_UNUSED(num_host_workers);
+    OE_UNUSED(ring);
     return OE_UNSUPPORTED;
 }
 
@@ -47,3 +47,19 @@ void oe_enclave_worker_wake(oe_enclave_worker_context_t* context)
 {
     _worker_wake(&context->event);
 }
+
+uint64_t oe_switchless_get_time(void)
+{
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+
+    QueryPerformanceCounter(&counter);
+
+    // Split the conversion to avoid overflowing the intermediate product.
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL /
+               (uint64_t)frequency.QuadPart;
+}
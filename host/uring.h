@@ -0,0 +1,25 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#ifndef _OE_HOST_URING_H
+#define _OE_HOST_URING_H
+
+#include <openenclave/bits/defs.h>
+#include <openenclave/bits/types.h>
+#include <openenclave/internal/syscall/batch.h>
+
+OE_EXTERNC_BEGIN
+
+/*
+ * Execute a batch of syscall submission queue entries with io_uring. The
+ * backend is enabled by setting the OE_IO_URING environment variable to the
+ * number of entries of the ring that each host thread creates.
+ *
+ * Returns false without executing any entry if the backend is disabled or
+ * not supported by the kernel.
+ */
+bool oe_uring_execute(oe_syscall_sqe_t* sqes, size_t count);
+
+OE_EXTERNC_END
+
+#endif /* _OE_HOST_URING_H */
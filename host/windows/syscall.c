@@ -1243,6 +1243,19 @@ done:
     return ret;
 }
 
+ssize_t oe_syscall_read_staged_ocall(oe_host_fd_t fd, void* buf, size_t count)
+{
+    return oe_syscall_read_ocall(fd, buf, count);
+}
+
+ssize_t oe_syscall_write_staged_ocall(
+    oe_host_fd_t fd,
+    const void* buf,
+    size_t count)
+{
+    return oe_syscall_write_ocall(fd, buf, count);
+}
+
 // oe_syscall_readv_ocall does not yet support socket.
 ssize_t oe_syscall_readv_ocall(
     oe_host_fd_t fd,
@@ -2328,6 +2341,24 @@ ssize_t oe_syscall_send_ocall(
     return ret;
 }
 
+ssize_t oe_syscall_recv_staged_ocall(
+    oe_host_fd_t sockfd,
+    void* buf,
+    size_t len,
+    int flags)
+{
+    return oe_syscall_recv_ocall(sockfd, buf, len, flags);
+}
+
+ssize_t oe_syscall_send_staged_ocall(
+    oe_host_fd_t sockfd,
+    const void* buf,
+    size_t len,
+    int flags)
+{
+    return oe_syscall_send_ocall(sockfd, buf, len, flags);
+}
+
 ssize_t oe_syscall_sendto_ocall(
     oe_host_fd_t sockfd,
     const void* buf,
@@ -3024,3 +3055,12 @@ int oe_syscall_nanosleep_ocall(struct oe_timespec* req, struct oe_timespec* rem)
     _set_errno(0);
     return 0;
 }
+
+int oe_syscall_submit_ocall(void* sqes, size_t count)
+{
+    OE_UNUSED(sqes);
+    OE_UNUSED(count);
+
+    // Batches are not supported. The enclave executes the calls one by one.
+    return -1;
+}
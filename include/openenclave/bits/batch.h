@@ -0,0 +1,24 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+/**
+ * @file batch.h
+ *
+ * This file defines the operations that can be submitted in a batch of system
+ * calls. See syscall_batch.h.
+ *
+ */
+#ifndef _OE_BITS_BATCH_H
+#define _OE_BITS_BATCH_H
+
+#define OE_BATCH_OP_READ 1
+#define OE_BATCH_OP_WRITE 2
+#define OE_BATCH_OP_SENDMSG 3
+#define OE_BATCH_OP_RECVMSG 4
+#define OE_BATCH_OP_ACCEPT 5
+#define OE_BATCH_OP_CLOSE 6
+#define OE_BATCH_OP_FSYNC 7
+#define OE_BATCH_OP_PREAD 8
+#define OE_BATCH_OP_PWRITE 9
+
+#endif /* _OE_BITS_BATCH_H */
@@ -75,6 +75,32 @@ oe_result_t oe_load_module_host_resolver(void);
  */
 oe_result_t oe_load_module_host_epoll(void);
 
+/**
+ * The version of oe_customfs_t defined by this header.
+ */
+#define OE_CUSTOMFS_VERSION 2
+
+/**
+ * A buffer of a vectored custom file system request. It has the layout of
+ * struct iovec.
+ */
+typedef struct _oe_customfs_iovec
+{
+    void* base;
+    uint64_t len;
+} oe_customfs_iovec_t;
+
+/**
+ * The operations of a custom file system.
+ *
+ * Version 1 consists of the members up to write. A file system that sets
+ * version to 2 may implement the members that follow it, which are all
+ * optional.
+ *
+ * With version 2, the size of an open file is only queried with get_size when
+ * it is opened and is then kept in the enclave, so it must only change through
+ * the operations of the file system.
+ */
 typedef struct _oe_customfs
 {
     uint8_t reserved[4232];
@@ -88,13 +114,50 @@ typedef struct _oe_customfs
         const void* buf,
         uint64_t count,
         uint64_t offset);
+
+    /* Version 2 */
+
+    /* 0 or 1 if only the members above are implemented. */
+    uint32_t version;
+
+    /* Reads the whole range that starts at offset into the buffers. The range
+     * is within the size of the file. Each read(), readv() and pread() is
+     * passed as a single request, which may span many blocks of the file. If
+     * NULL, read is called per buffer. */
+    void (*readv)(
+        uintptr_t handle,
+        const oe_customfs_iovec_t* iov,
+        int iovcnt,
+        uint64_t offset);
+
+    /* Writes the buffers to the range that starts at offset. Each write(),
+     * writev() and pwrite() is passed as a single request. If NULL, write is
+     * called per buffer. */
+    bool (*writev)(
+        uintptr_t handle,
+        const oe_customfs_iovec_t* iov,
+        int iovcnt,
+        uint64_t offset);
+
+    /* Sets the size of the file. Enables truncate(), ftruncate() and opening
+     * files with O_TRUNC without unlinking them. */
+    bool (*truncate)(uintptr_t handle, uint64_t size);
+
+    /* Writes buffered data of the file. Called when a file descriptor is
+     * closed, before close. If it fails, close() fails with EIO. */
+    bool (*flush)(uintptr_t handle);
+
+    /* Writes the data of the file to storage. Called by fsync() and
+     * fdatasync(), which fail with EINVAL if NULL and with EIO on failure. */
+    bool (*fsync)(uintptr_t handle);
 } oe_customfs_t;
 
 /**
  * Load a custom file system.
  *
  * The enclave application must implement the functions defined in
- * oe_customfs_t. Folders are not supported for now.
+ * oe_customfs_t. Folders are not supported for now. Set the version member to
+ * OE_CUSTOMFS_VERSION to use the functions of version 2.
  *
  * @param devname An arbitrary but unique device name. The same name must be
  * passed to mount().
@@ -61,6 +61,15 @@ typedef struct _oe_enclave_properties_header
     HEAP_PAGE_COUNT,        \
     STACK_PAGE_COUNT,       \
     TCS_COUNT)
+#define OE_SET_ENCLAVE_SGX_EX(  \
+    PRODUCT_ID,                 \
+    SECURITY_VERSION,           \
+    ALLOW_DEBUG,                \
+    HEAP_PAGE_COUNT,            \
+    STACK_PAGE_COUNT,           \
+    TCS_COUNT,                  \
+    OCALL_BUFFER_PAGE_COUNT,    \
+    MAX_OCALL_BUFFER_PAGE_COUNT)
 #endif
 
 #if __aarch64__
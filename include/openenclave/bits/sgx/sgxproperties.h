@@ -38,8 +38,13 @@ typedef struct oe_sgx_enclave_config_t
     uint16_t product_id;
     uint16_t security_version;
 
-    /* Padding to make packed and unpacked size the same */
-    uint32_t padding;
+    /* Size of the buffer for ocall parameters that the host passes to each
+     * enclave thread, in pages. 0 selects the default of 4 pages. */
+    uint16_t ocall_buffer_pages;
+
+    /* If larger than ocall_buffer_pages, the host grows the buffer of a
+     * thread up to this size to fit the largest ocall that did not fit. */
+    uint16_t max_ocall_buffer_pages;
 
     /* (OE_SGX_FLAGS_DEBUG | OE_SGX_FLAGS_MODE64BIT) */
     uint64_t attributes;
@@ -95,16 +100,55 @@ typedef struct _oe_sgx_enclave_properties
  * the enclave
  * @param TCS_COUNT Number of concurrent threads in an enclave to support
  */
+#define OE_SET_ENCLAVE_SGX(  \
+    PRODUCT_ID,              \
+    SECURITY_VERSION,        \
+    ALLOW_DEBUG,             \
+    HEAP_PAGE_COUNT,         \
+    STACK_PAGE_COUNT,        \
+    TCS_COUNT)               \
+    OE_SET_ENCLAVE_SGX_EX(   \
+        PRODUCT_ID,          \
+        SECURITY_VERSION,    \
+        ALLOW_DEBUG,         \
+        HEAP_PAGE_COUNT,     \
+        STACK_PAGE_COUNT,    \
+        TCS_COUNT,           \
+        0,                   \
+        0)
+
+/**
+ * Defines the SGX properties for an enclave, including the size of the
+ * buffers for ocall parameters.
+ *
+ * Ocalls whose parameters do not fit into the buffer of the calling thread
+ * take a slower path that allocates host memory for them.
+ *
+ * @param PRODUCT_ID See OE_SET_ENCLAVE_SGX
+ * @param SECURITY_VERSION See OE_SET_ENCLAVE_SGX
+ * @param ALLOW_DEBUG See OE_SET_ENCLAVE_SGX
+ * @param HEAP_PAGE_COUNT See OE_SET_ENCLAVE_SGX
+ * @param STACK_PAGE_COUNT See OE_SET_ENCLAVE_SGX
+ * @param TCS_COUNT See OE_SET_ENCLAVE_SGX
+ * @param OCALL_BUFFER_PAGE_COUNT Number of pages of the buffer that the host
+ * passes to each enclave thread for ocall parameters. 0 selects the default
+ * of 4 pages.
+ * @param MAX_OCALL_BUFFER_PAGE_COUNT If larger than OCALL_BUFFER_PAGE_COUNT,
+ * the host grows the buffer of a thread up to this number of pages to fit
+ * the largest ocall that did not fit.
+ */
 // Note: disable clang-format since it badly misformats this macro
 // clang-format off
 
-#define OE_SET_ENCLAVE_SGX(                                               \
+#define OE_SET_ENCLAVE_SGX_EX(                                            \
     PRODUCT_ID,                                                           \
     SECURITY_VERSION,                                                     \
     ALLOW_DEBUG,                                                          \
     HEAP_PAGE_COUNT,                                                      \
     STACK_PAGE_COUNT,                                                     \
-    TCS_COUNT)                                                            \
+    TCS_COUNT,                                                            \
+    OCALL_BUFFER_PAGE_COUNT,                                              \
+    MAX_OCALL_BUFFER_PAGE_COUNT)                                          \
     OE_INFO_SECTION_BEGIN                                                 \
     volatile const oe_sgx_enclave_properties_t oe_enclave_properties_sgx = \
     {                                                                     \
@@ -123,7 +167,8 @@ typedef struct _oe_sgx_enclave_properties
         {                                                                 \
             .product_id = PRODUCT_ID,                                     \
             .security_version = SECURITY_VERSION,                         \
-            .padding = 0,                                                 \
+            .ocall_buffer_pages = OCALL_BUFFER_PAGE_COUNT,                \
+            .max_ocall_buffer_pages = MAX_OCALL_BUFFER_PAGE_COUNT,        \
             .attributes = OE_MAKE_ATTRIBUTES(ALLOW_DEBUG)                 \
         },                                                                \
         .image_info =                                                     \
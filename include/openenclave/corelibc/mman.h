@@ -11,6 +11,8 @@
 #define OE_MAP_FIXED 0x10
 #define OE_MAP_ANON 0x20
 
+#define OE_MREMAP_MAYMOVE 1
+
 #define OE_PROT_READ 1
 #define OE_PROT_WRITE 2
 #define OE_PROT_EXEC 4
@@ -27,12 +29,20 @@ void* oe_mmap(
 
 int oe_munmap(void* addr, size_t length);
 
+void* oe_mremap(
+    void* old_address,
+    size_t old_size,
+    size_t new_size,
+    int flags,
+    ...);
+
 #ifdef OE_NEED_STDC_NAMES
 
 #define MAP_FAILED OE_MAP_FAILED
 #define MAP_PRIVATE OE_MAP_PRIVATE
 #define MAP_FIXED OE_MAP_FIXED
 #define MAP_ANON OE_MAP_ANON
+#define MREMAP_MAYMOVE OE_MREMAP_MAYMOVE
 
 #define PROT_READ OE_PROT_READ
 #define PROT_WRITE OE_PROT_WRITE
@@ -48,6 +58,13 @@ void* mmap(
 
 int munmap(void* addr, size_t length);
 
+void* mremap(
+    void* old_address,
+    size_t old_size,
+    size_t new_size,
+    int flags,
+    ...);
+
 #endif // OE_NEED_STDC_NAMES
 
 OE_EXTERNC_END
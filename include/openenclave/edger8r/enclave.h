@@ -117,6 +117,119 @@ oe_result_t oe_switchless_call_host_function(
     size_t output_buffer_size,
     size_t* output_bytes_written);
 
+/**
+ * Handle of an asynchronous switchless host function call.
+ *
+ * The handle is owned by the caller and must stay valid until the call has
+ * been completed with oe_switchless_call_wait() or
+ * oe_switchless_call_wait_all().
+ *
+ * For every OCALL declared with transition_using_threads, oeedger8r also
+ * generates <name>_async() and <name>_async_complete() in the trusted files.
+ * Both take a handle followed by the parameters of <name>(). The first posts
+ * the call, and the second waits for it and unmarshals the return value and
+ * the out parameters. The same parameters must be passed to both.
+ */
+typedef struct _oe_switchless_call
+{
+    /* Internal: the arguments of the call in host memory. */
+    void* args;
+
+    /* Internal: the input buffer of the call and the total size of the
+     * input and output buffers. */
+    void* buffer;
+    size_t buffer_size;
+} oe_switchless_call_t;
+
+/**
+ * Post a high-level host function call (OCALL) switchlessly without waiting
+ * for it to complete.
+ *
+ * The call is handed to a host worker thread and the function returns as
+ * soon as a worker has picked it up. If no worker is available, the call is
+ * performed as a regular OCALL and is already complete when the function
+ * returns.
+ *
+ * The input and output buffers must be allocated with
+ * oe_allocate_switchless_async_ocall_buffer() and must not be accessed or
+ * freed until the call has completed. All calls must be completed before the
+ * ECALL that posted them returns.
+ *
+ * @param function_id The id of the host function that will be called.
+ * @param input_buffer Buffer containing inputs data.
+ * @param input_buffer_size Size of the input data buffer.
+ * @param output_buffer Buffer where the outputs of the host function are
+ * written to.
+ * @param output_buffer_size Size of the output buffer.
+ * @param call The handle of the call.
+ *
+ * @return OE_OK the call was posted.
+ * @return OE_INVALID_PARAMETER a parameter is invalid.
+ * @return OE_OUT_OF_MEMORY the call could not be allocated.
+ */
+oe_result_t oe_switchless_call_host_function_async(
+    size_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    oe_switchless_call_t* call);
+
+/**
+ * Check whether an asynchronous switchless call has completed.
+ *
+ * @param call The handle of the call.
+ *
+ * @return OE_OK the call has completed.
+ * @return OE_BUSY the call is still being handled by the host.
+ * @return OE_INVALID_PARAMETER the handle is not valid.
+ */
+oe_result_t oe_switchless_call_poll(oe_switchless_call_t* call);
+
+/**
+ * Get the input buffer of an asynchronous switchless call that has not been
+ * completed yet. Used by the generated <name>_async_complete() functions.
+ *
+ * @param call The handle of the call.
+ * @param size The total size of the input and output buffers of the call.
+ *
+ * @returns the input buffer of the call.
+ * @return NULL if the handle is not valid or the size does not match.
+ */
+void* oe_switchless_call_get_buffer(
+    const oe_switchless_call_t* call,
+    size_t size);
+
+/**
+ * Wait until an asynchronous switchless call has completed and release it.
+ *
+ * @param call The handle of the call.
+ * @param output_bytes_written Number of bytes written in the output buffer.
+ *
+ * @return The result of the call, as oe_switchless_call_host_function()
+ * would have returned it.
+ */
+oe_result_t oe_switchless_call_wait(
+    oe_switchless_call_t* call,
+    size_t* output_bytes_written);
+
+/**
+ * Wait until all given asynchronous switchless calls have completed and
+ * release them.
+ *
+ * @param calls Array of handles of the calls.
+ * @param count Number of handles in **calls**.
+ * @param output_bytes_written Array of **count** elements that receives the
+ * number of bytes written in the output buffer of each call.
+ *
+ * @return OE_OK if all calls were successful, otherwise the result of the
+ * first call that failed.
+ */
+oe_result_t oe_switchless_call_wait_all(
+    oe_switchless_call_t* calls,
+    size_t count,
+    size_t* output_bytes_written);
+
 /**
  * Allocate a buffer of given size for doing an ocall.
  *
@@ -155,6 +268,27 @@ void* oe_allocate_switchless_ocall_buffer(size_t size);
  */
 void oe_free_switchless_ocall_buffer(void* buffer);
 
+/**
+ * Allocate a buffer of given size for doing an asynchronous switchless ocall.
+ *
+ * The buffer is allocated in host memory and stays valid until it is freed,
+ * independently of other ocalls made by the thread.
+ * The buffer should be treated as untrusted.
+ *
+ * @param size The size in bytes of the buffer.
+ * @returns pointer to the allocated buffer.
+ * @return NULL if allocation failed.
+ */
+void* oe_allocate_switchless_async_ocall_buffer(size_t size);
+
+/**
+ * Free the buffer allocated for asynchronous switchless ocalls.
+ *
+ * @param buffer The buffer allocated via
+ * oe_allocate_switchless_async_ocall_buffer.
+ */
+void oe_free_switchless_async_ocall_buffer(void* buffer);
+
 /**
  * For hand-written enclaves, that use the older calling mechanism, define empty
  * ecall tables.
@@ -96,6 +96,18 @@ typedef enum _oe_enclave_setting_type
 #endif
 } oe_enclave_setting_type_t;
 
+/**
+ * Adapt the number of iterations each switchless worker spins before it goes
+ * to sleep to the observed interval between calls.
+ */
+#define OE_SWITCHLESS_POLICY_ADAPTIVE_SPIN 0x00000001
+
+/**
+ * Let only as many switchless ocall workers spin as the current load needs
+ * and park the others until they are woken up by a call.
+ */
+#define OE_SWITCHLESS_POLICY_AUTO_SCALE 0x00000002
+
 /**
  * The setting for context-switchless calls.
  */
@@ -112,8 +124,75 @@ typedef struct _oe_enclave_setting_context_switchless
      * workers should be 0.
      */
     size_t max_enclave_workers;
+    /**
+     * Bitwise OR of zero or more OE_SWITCHLESS_POLICY_* flags. If 0, workers
+     * spin for a fixed number of iterations before they go to sleep.
+     */
+    uint32_t policy;
 } oe_enclave_setting_context_switchless_t;
 
+/**
+ * Counters of a pool of switchless call workers.
+ */
+typedef struct _oe_switchless_worker_statistics
+{
+    /** The number of workers in the pool. */
+    size_t num_workers;
+    /** The number of workers that are currently sleeping. */
+    size_t num_sleeping_workers;
+    /** The number of iterations the workers spun without seeing a call. */
+    uint64_t total_spin_count;
+    /** The number of times the workers went to sleep. */
+    uint64_t total_sleep_count;
+    /** The number of times the workers were woken up by a caller. */
+    uint64_t total_wakeup_count;
+    /** The number of calls the workers handled. */
+    uint64_t total_call_count;
+} oe_switchless_worker_statistics_t;
+
+/**
+ * Counters of the switchless call workers of an enclave.
+ */
+typedef struct _oe_switchless_statistics
+{
+    /** The workers that handle switchless ocalls. */
+    oe_switchless_worker_statistics_t host_workers;
+    /** The workers that handle switchless ecalls. */
+    oe_switchless_worker_statistics_t enclave_workers;
+} oe_switchless_statistics_t;
+
+/**
+ * Counters of the ring in which switchless ocalls wait for a host worker.
+ */
+typedef struct _oe_switchless_ring_statistics
+{
+    /** The number of slots in the ring. */
+    uint64_t capacity;
+    /** The number of calls that are queued and not yet picked up. */
+    uint64_t occupancy;
+    /** The highest number of calls that were queued at the same time. */
+    uint64_t peak_occupancy;
+    /** The number of calls that were posted to the ring. */
+    uint64_t total_enqueued;
+    /** The number of calls that fell back to a regular ocall. */
+    uint64_t total_missed;
+} oe_switchless_ring_statistics_t;
+
+/**
+ * Counters of the buffer for ocall parameters of an enclave thread.
+ */
+typedef struct _oe_ocall_buffer_statistics
+{
+    /** The current size of the buffer, or 0 if it was not used yet. */
+    uint64_t buffer_size;
+    /** The number of ocalls whose parameters did not fit into the buffer. */
+    uint64_t fallback_count;
+    /** The size of the largest parameters that did not fit. */
+    uint64_t high_water;
+    /** The number of times the buffer was grown. */
+    uint64_t grow_count;
+} oe_ocall_buffer_statistics_t;
+
 /**
  * The uniform structure type containing a specific type of enclave
  * setting.
@@ -182,6 +261,60 @@ oe_result_t oe_create_enclave(
     uint32_t ocall_count,
     oe_enclave_t** enclave);
 
+/**
+ * Get the counters of the switchless call workers of an enclave.
+ *
+ * The counters are read while the workers are running, so they are a
+ * snapshot that may be slightly out of date.
+ *
+ * @param enclave The enclave that was created with context-switchless calls.
+ * @param[out] statistics The counters of the switchless call workers.
+ *
+ * @returns Returns OE_OK on success, or OE_NOT_FOUND if switchless calls are
+ * not enabled for the enclave.
+ *
+ */
+oe_result_t oe_get_switchless_statistics(
+    oe_enclave_t* enclave,
+    oe_switchless_statistics_t* statistics);
+
+/**
+ * Get the counters of the switchless ocall ring of an enclave.
+ *
+ * A high peak occupancy or many missed calls suggest that more host workers
+ * are needed. Like oe_get_switchless_statistics(), this is a snapshot.
+ *
+ * @param enclave The enclave that was created with context-switchless calls.
+ * @param[out] statistics The counters of the ring.
+ *
+ * @returns Returns OE_OK on success, or OE_NOT_FOUND if switchless calls are
+ * not enabled for the enclave.
+ *
+ */
+oe_result_t oe_get_switchless_ring_statistics(
+    oe_enclave_t* enclave,
+    oe_switchless_ring_statistics_t* statistics);
+
+/**
+ * Get the counters of the buffers for ocall parameters of an enclave.
+ *
+ * Each TCS of the enclave has its own buffer. Ocalls whose parameters do not
+ * fit into it are slower. The buffer size is set with the enclave properties.
+ *
+ * @param enclave The enclave.
+ * @param[out] statistics Array that receives the counters of each TCS.
+ * @param[in,out] count The number of elements of **statistics**. Receives
+ * the number of TCSs of the enclave.
+ *
+ * @returns Returns OE_OK on success, or OE_BUFFER_TOO_SMALL if **count** is
+ * smaller than the number of TCSs.
+ *
+ */
+oe_result_t oe_get_ocall_buffer_statistics(
+    oe_enclave_t* enclave,
+    oe_ocall_buffer_statistics_t* statistics,
+    size_t* count);
+
 /**
  * Join all threads that have been created from inside the enclave.
  *
@@ -254,6 +254,52 @@ oe_result_t oe_call_host_function_by_table_id(
     size_t* output_bytes_written,
     bool switchless);
 
+/*
+**==============================================================================
+**
+** oe_prefer_switchless_ocall()
+**
+**     Make the next ocall of the calling thread switchless if prefer is true,
+**     switchless syscalls are enabled and host worker threads are available.
+**     Only ocalls that cannot block indefinitely may be made switchless, since
+**     a blocked call occupies a host worker. The syscall devices prefer the
+**     non-blocking ocalls on their hot paths with OE_SWITCHLESS_OCALL().
+**
+**==============================================================================
+*/
+
+void oe_prefer_switchless_ocall(bool prefer);
+
+/*
+**==============================================================================
+**
+** oe_end_switchless_ocall()
+**
+**     Clear the preference of the calling thread and return the given result.
+**     This must follow every preferred ocall, because the preference is only
+**     consumed if the ocall stub gets as far as allocating its buffer.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_end_switchless_ocall(oe_result_t result);
+
+#define OE_SWITCHLESS_OCALL(PREFER, OCALL) \
+    (oe_prefer_switchless_ocall(PREFER), oe_end_switchless_ocall(OCALL))
+
+/*
+**==============================================================================
+**
+** oe_set_switchless_syscalls()
+**
+**     Enable or disable oe_prefer_switchless_ocall() and return the previous
+**     setting. The default is set by the SWITCHLESS_SYSCALLS build option.
+**
+**==============================================================================
+*/
+
+bool oe_set_switchless_syscalls(bool enabled);
+
 /*
 **==============================================================================
 **
@@ -0,0 +1,33 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#ifndef _OE_CTR_DRBG_H
+#define _OE_CTR_DRBG_H
+
+#include <openenclave/bits/defs.h>
+#include <openenclave/bits/result.h>
+
+OE_EXTERNC_BEGIN
+
+/* Number of random requests after which a CTR-DRBG instance reseeds. */
+#define OE_CTR_DRBG_DEFAULT_RESEED_INTERVAL 10000
+
+/**
+ * Sets the reseed interval of the CTR-DRBG instances that the enclave crypto
+ * library uses for key generation, signing and certificate generation.
+ *
+ * Each enclave thread (TCS) has its own instance, which is seeded from the CPU
+ * entropy source on first use. The new interval takes effect for every
+ * instance from its next use on.
+ *
+ * @param interval the number of requests between two reseeds. Must be
+ *        positive.
+ *
+ * @return OE_OK on success
+ * @return OE_INVALID_PARAMETER if **interval** is not positive
+ */
+oe_result_t oe_ctr_drbg_set_reseed_interval(int interval);
+
+OE_EXTERNC_END
+
+#endif /* _OE_CTR_DRBG_H */
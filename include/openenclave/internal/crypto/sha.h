@@ -80,7 +80,6 @@ oe_result_t oe_sha256_final(oe_sha256_context_t* context, OE_SHA256* sha256);
  */
 oe_result_t oe_sha256(const void* data, size_t size, OE_SHA256* sha256);
 
-#ifdef OE_WITH_EXPERIMENTAL_EEID
 /**
  * Saves the internal state of a SHA-256 context
  *
@@ -92,6 +91,7 @@ oe_result_t oe_sha256(const void* data, size_t size, OE_SHA256* sha256);
  * @param num_hashed buffer to write the number of hashed bytes to
  *
  * @return OE_OK upon success
+ * @return OE_UNSUPPORTED if the crypto library does not expose the state
  */
 oe_result_t oe_sha256_save(
     const oe_sha256_context_t* context,
@@ -109,12 +109,12 @@ oe_result_t oe_sha256_save(
  * @param num_hashed buffer to read the number of hashed bytes from
  *
  * @return OE_OK upon success
+ * @return OE_UNSUPPORTED if the crypto library does not expose the state
  */
 oe_result_t oe_sha256_restore(
     oe_sha256_context_t* context,
     const uint32_t* internal_hash,
     const uint32_t* num_hashed);
-#endif
 
 OE_EXTERNC_END
 
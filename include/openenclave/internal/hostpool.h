@@ -0,0 +1,26 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#ifndef _OE_INTERNAL_HOSTPOOL_H
+#define _OE_INTERNAL_HOSTPOOL_H
+
+#include <openenclave/bits/defs.h>
+#include <openenclave/bits/types.h>
+
+OE_EXTERNC_BEGIN
+
+/* Allocate host memory from the pool. Falls back to oe_host_malloc(). */
+void* oe_host_pool_malloc(size_t size);
+
+/* Free memory returned by oe_host_pool_malloc(). */
+void oe_host_pool_free(void* ptr);
+
+/* Return the blocks cached by the current thread to the pool. */
+void oe_teardown_host_pool_cache(void);
+
+/* Release the pool. Only called when the enclave is destroyed. */
+void oe_teardown_host_pool(void);
+
+OE_EXTERNC_END
+
+#endif /* _OE_INTERNAL_HOSTPOOL_H */
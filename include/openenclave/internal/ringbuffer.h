@@ -24,5 +24,12 @@ size_t oe_ringbuffer_write(
     const void* buffer,
     size_t size);
 bool oe_ringbuffer_empty(const oe_ringbuffer_t* rb);
+size_t oe_ringbuffer_size(const oe_ringbuffer_t* rb);
+size_t oe_ringbuffer_capacity(const oe_ringbuffer_t* rb);
+
+// Moves the contents to a new buffer of the given capacity, which must be at
+// least the current size. Returns the new buffer and frees the old one, or
+// returns null and keeps the old one if the allocation fails.
+oe_ringbuffer_t* oe_ringbuffer_resize(oe_ringbuffer_t* rb, size_t size);
 
 OE_EXTERNC_END
@@ -0,0 +1,31 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#ifndef _OE_INTERNAL_SCHED_H
+#define _OE_INTERNAL_SCHED_H
+
+#include <openenclave/bits/defs.h>
+#include <openenclave/bits/types.h>
+
+OE_EXTERNC_BEGIN
+
+/* The maximum number of CPUs the enclave knows about. */
+#define OE_MAX_CPUS 1024
+
+/**
+ * Gets the CPUs that enclave threads can run on.
+ *
+ * These are the CPUs in the affinity mask of the host process, capped by the
+ * number of TCSs. If the cap applies, CPUs are taken from as few NUMA nodes as
+ * possible. The host topology is queried on the first call.
+ *
+ * @param mask Receives the CPU mask. Bits beyond mask_size are dropped.
+ * @param mask_size Size of mask in bytes.
+ *
+ * @return The number of CPUs in the full mask.
+ */
+size_t oe_get_cpu_affinity(void* mask, size_t mask_size);
+
+OE_EXTERNC_END
+
+#endif /* _OE_INTERNAL_SCHED_H */
@@ -21,6 +21,13 @@ typedef struct _oe_ecall_context
     uint64_t debug_eexit_rip;
     uint64_t debug_eexit_rbp;
     uint64_t debug_eexit_rsp;
+
+    // Ocalls whose parameters did not fit into ocall_buffer, the size of the
+    // largest of them, and the size of the largest parameters of any ocall.
+    // Written by the enclave, read by the host.
+    uint64_t ocall_buffer_fallback_count;
+    uint64_t ocall_buffer_high_water;
+    uint64_t ocall_buffer_peak;
 } oe_ecall_context_t;
 
 /**
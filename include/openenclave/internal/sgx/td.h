@@ -112,7 +112,9 @@ typedef struct _td
     /* Return arguments from OCALL */
     uint16_t oret_func;
     uint16_t oret_result;
-    uint16_t padding[2];
+
+    /* Whether the thread is spinning or sleeping in a wait (see thread.c) */
+    uint32_t wait_state;
     uint64_t oret_arg;
 
     /* List of Callsite structures (most recent call is first) */
@@ -35,6 +35,45 @@ typedef enum _oe_sgx_load_state
 
 OE_STATIC_ASSERT(sizeof(oe_sgx_load_state_t) == sizeof(unsigned int));
 
+/* The state of the MRENCLAVE computation before a run of pages that the
+ * loader adds with oe_sgx_load_enclave_pages(). */
+typedef struct _oe_sgx_measurement_checkpoint
+{
+    /* Offset of the first page from the enclave base */
+    uint64_t offset;
+
+    /* Number of pages in the run, or 0 for the state after the last page */
+    uint64_t npages;
+
+    /* SECINFO flags of the pages and whether they are extended */
+    uint64_t flags;
+    uint64_t extend;
+
+    /* SHA-256 state as returned by oe_sha256_save() */
+    uint32_t hash_state[8];
+    uint32_t num_hashed[2];
+} oe_sgx_measurement_checkpoint_t;
+
+OE_STATIC_ASSERT(sizeof(oe_sgx_measurement_checkpoint_t) == 72);
+
+/* Suffix that is appended to the path of a signed enclave to get the path of
+ * its measurement manifest */
+#define OE_SGX_MANIFEST_EXTENSION ".manifest"
+
+/* Measurement manifest that oesign writes next to the signed enclave. It
+ * lets the loader skip the software measurement on SGX hardware, where EINIT
+ * checks the measurement against the SIGSTRUCT anyway, and measure the runs
+ * of pages in parallel elsewhere. */
+typedef struct _oe_sgx_measurement_manifest
+{
+    /* MRENCLAVE that results from the checkpoints */
+    OE_SHA256 mrenclave;
+
+    size_t num_checkpoints;
+    size_t capacity;
+    oe_sgx_measurement_checkpoint_t* checkpoints;
+} oe_sgx_measurement_manifest_t;
+
 typedef struct _oe_sgx_load_context oe_sgx_load_context_t;
 
 struct _oe_sgx_load_context
@@ -64,6 +103,13 @@ struct _oe_sgx_load_context
     /* Hash context used to measure enclave as it is loaded */
     oe_sha256_context_t hash_context;
 
+    /* Manifest that is recorded in measurement mode, or replayed instead of
+     * measuring the pages when creating the enclave. Replay starts at
+     * manifest_index and hashes the pages only if manifest_verify is set. */
+    oe_sgx_measurement_manifest_t* manifest;
+    size_t manifest_index;
+    bool manifest_verify;
+
 #ifdef OE_WITH_EXPERIMENTAL_EEID
     /* EEID data needed during enclave creation */
     oe_eeid_t* eeid;
@@ -83,6 +129,27 @@ oe_result_t oe_sgx_build_enclave(
     const oe_sgx_enclave_properties_t* properties,
     oe_enclave_t* enclave);
 
+/**
+ * Read a measurement manifest written by oe_sgx_write_measurement_manifest().
+ *
+ * @param path path of the manifest file
+ * @param manifest[output] the manifest, to be released with
+ *        oe_sgx_free_measurement_manifest()
+ *
+ * @returns OE_OK
+ * @returns OE_NOT_FOUND the file does not exist
+ * @returns OE_FAILURE the file is not a valid manifest
+ */
+oe_result_t oe_sgx_read_measurement_manifest(
+    const char* path,
+    oe_sgx_measurement_manifest_t** manifest);
+
+oe_result_t oe_sgx_write_measurement_manifest(
+    const char* path,
+    const oe_sgx_measurement_manifest_t* manifest);
+
+void oe_sgx_free_measurement_manifest(oe_sgx_measurement_manifest_t* manifest);
+
 /**
  * Validate certain fields of an SGX enclave properties structure.
  *
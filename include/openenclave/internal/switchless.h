@@ -14,19 +14,53 @@
  * oe_host_worker_context_t is used both by the host (windows/linux) and the
  * enclave (ELF). Lock down the layout.
  */
-OE_STATIC_ASSERT(sizeof(oe_host_worker_context_t) == 40);
+OE_STATIC_ASSERT(sizeof(oe_host_worker_context_t) == 104);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, call_arg) == 0);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, enc) == 8);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, is_stopping) == 16);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, event) == 20);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, spin_count) == 24);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, total_spin_count) == 32);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, ring) == 40);
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_host_worker_context_t, spin_count_threshold) == 48);
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_host_worker_context_t, average_spin_count) == 56);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, sleep_spin_count) == 64);
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_host_worker_context_t, total_sleep_count) == 72);
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_host_worker_context_t, total_wakeup_count) == 80);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, total_call_count) == 88);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, is_sleeping) == 96);
+
+/**
+ * oe_switchless_ring_t is used both by the host (windows/linux) and the
+ * enclave (ELF). Lock down the layout.
+ */
+OE_STATIC_ASSERT(sizeof(oe_switchless_ring_slot_t) == 16);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_slot_t, sequence) == 0);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_slot_t, call_arg) == 8);
+OE_STATIC_ASSERT(sizeof(oe_switchless_ring_t) == 216);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_t, slots) == 0);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_t, capacity) == 8);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_t, enqueue_pos) == 64);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_t, dequeue_pos) == 128);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_t, total_enqueued) == 192);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_t, total_missed) == 200);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_t, peak_occupancy) == 208);
+
+/**
+ * Minimum number of slots in the switchless ocall ring. The ring is sized to
+ * the next power of two that can hold one outstanding call per enclave thread.
+ */
+#define OE_SWITCHLESS_RING_MIN_CAPACITY (64U)
 
 /**
  * oe_enclave_worker_context_t is used both by the host (windows/linux) and the
  * enclave (ELF). Lock down the layout.
  */
-OE_STATIC_ASSERT(sizeof(oe_enclave_worker_context_t) == 48);
+OE_STATIC_ASSERT(sizeof(oe_enclave_worker_context_t) == 96);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, call_arg) == 0);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, enc) == 8);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, is_stopping) == 16);
@@ -36,12 +70,79 @@ OE_STATIC_ASSERT(
     OE_OFFSETOF(oe_enclave_worker_context_t, spin_count_threshold) == 32);
 OE_STATIC_ASSERT(
     OE_OFFSETOF(oe_enclave_worker_context_t, total_spin_count) == 40);
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_enclave_worker_context_t, average_spin_count) == 48);
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_enclave_worker_context_t, sleep_spin_count) == 56);
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_enclave_worker_context_t, total_sleep_count) == 64);
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_enclave_worker_context_t, total_wakeup_count) == 72);
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_enclave_worker_context_t, total_call_count) == 80);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, is_adaptive) == 88);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, is_sleeping) == 89);
+
+/**
+ * Default number of iterations a worker thread spins before going to sleep.
+ */
+#define OE_SWITCHLESS_DEFAULT_SPIN_COUNT_THRESHOLD (4096U)
+
+/**
+ * Bounds of the spin count threshold under the adaptive policy.
+ */
+#define OE_SWITCHLESS_MIN_SPIN_COUNT_THRESHOLD (64U)
+#define OE_SWITCHLESS_MAX_SPIN_COUNT_THRESHOLD (65536U)
+
+/**
+ * Adapt the spin count threshold of a worker to the number of spins that
+ * passed between the last two calls. The threshold follows twice the moving
+ * average of that gap, so that a worker spins through the usual gap but not
+ * much longer. If calls arrive further apart than the maximum threshold, it is
+ * cheaper to sleep right away and be woken up, so the threshold drops to the
+ * minimum.
+ */
+OE_INLINE void oe_switchless_adapt_spin_count_threshold(
+    volatile uint64_t* average_spin_count,
+    volatile uint64_t* spin_count_threshold,
+    uint64_t spin_count)
+{
+    uint64_t average = *average_spin_count;
+    uint64_t threshold = 0;
+
+    // Bound the sample so that one long pause does not dominate the average.
+    if (spin_count > 2 * OE_SWITCHLESS_MAX_SPIN_COUNT_THRESHOLD)
+        spin_count = 2 * OE_SWITCHLESS_MAX_SPIN_COUNT_THRESHOLD;
+
+    // Exponential moving average with a weight of 1/8 for the new sample.
+    average = average - (average >> 3) + (spin_count >> 3);
+    threshold = 2 * average;
+
+    if (threshold > OE_SWITCHLESS_MAX_SPIN_COUNT_THRESHOLD ||
+        threshold < OE_SWITCHLESS_MIN_SPIN_COUNT_THRESHOLD)
+        threshold = OE_SWITCHLESS_MIN_SPIN_COUNT_THRESHOLD;
+
+    *average_spin_count = average;
+    *spin_count_threshold = threshold;
+}
 
 typedef struct _oe_switchless_call_manager
 {
     oe_host_worker_context_t* host_worker_contexts;
     oe_thread_t* host_worker_threads;
     size_t num_host_workers;
+    oe_switchless_ring_t* ring;
+
+    /* Bitwise OR of OE_SWITCHLESS_POLICY_* flags. */
+    uint32_t policy;
+
+    /* Duration of one spin iteration in picoseconds. */
+    uint64_t spin_duration;
+
+    /* Number of host workers that are spinning and the number of host
+     * workers that may spin at the same time (auto-scaling only). */
+    uint64_t num_spinning_host_workers;
+    uint64_t max_spinning_host_workers;
 
     oe_enclave_worker_context_t* enclave_worker_contexts;
     oe_thread_t* enclave_worker_threads;
@@ -51,7 +152,8 @@ typedef struct _oe_switchless_call_manager
 oe_result_t oe_start_switchless_manager(
     oe_enclave_t* enclave,
     size_t num_host_workers,
-    size_t num_enclave_workers);
+    size_t num_enclave_workers,
+    uint32_t policy);
 
 oe_result_t oe_stop_switchless_manager(oe_enclave_t* enclave);
 
@@ -63,4 +165,7 @@ void oe_enclave_worker_wait(oe_enclave_worker_context_t* context);
 
 void oe_enclave_worker_wake(oe_enclave_worker_context_t* context);
 
+/* Return a monotonic time in nanoseconds. */
+uint64_t oe_switchless_get_time(void);
+
 #endif /* _OE_SWITCHLESS_H */
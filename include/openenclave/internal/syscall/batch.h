@@ -0,0 +1,86 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#ifndef _OE_SYSCALL_BATCH_H
+#define _OE_SYSCALL_BATCH_H
+
+#include <openenclave/bits/batch.h>
+#include <openenclave/bits/defs.h>
+#include <openenclave/bits/types.h>
+#include <openenclave/internal/syscall/sys/socket.h>
+#include <openenclave/internal/syscall/types.h>
+
+OE_EXTERNC_BEGIN
+
+/* The enclave-internal form of oe_syscall_op_t (openenclave/syscall_batch.h),
+ * which is passed to oe_batch_syscalls(). */
+typedef struct _oe_batch_op
+{
+    /* One of the OE_BATCH_OP_* values. */
+    int opcode;
+
+    int fd;
+
+    /* The flags of sendmsg and recvmsg. */
+    int flags;
+
+    /* The buffer of read, write, pread and pwrite. */
+    void* buf;
+    size_t len;
+
+    /* The file offset of pread and pwrite. */
+    oe_off_t offset;
+
+    /* The message of sendmsg and recvmsg. */
+    struct oe_msghdr* msg;
+
+    /* The optional peer address of accept. */
+    struct oe_sockaddr* addr;
+    oe_socklen_t* addrlen;
+
+    /* The return value of the operation, or -errno on failure. */
+    ssize_t result;
+} oe_batch_op_t;
+
+/*
+ * Execute the operations in order and store the outcome of each in its
+ * **result** field. Consecutive operations on descriptors that map directly
+ * to host descriptors are submitted to the host together, with a single OCALL.
+ * All other operations are executed individually, in order.
+ *
+ * If the host executes the submissions with io_uring, consecutive preads, and
+ * pwrites of disjoint ranges, may run concurrently, also if they use different
+ * descriptors. All other operations complete in order.
+ *
+ * Returns 0 if the operations were executed or -1 and sets oe_errno if the
+ * parameters are invalid. A failing operation does not stop the batch.
+ */
+int oe_syscall_batch(oe_batch_op_t* ops, size_t count);
+
+/*
+ * A submission queue entry as seen by the host. The host executes the entries
+ * of a batch as if in order and stores the return value, or -errno, in
+ * **result**.
+ */
+typedef struct _oe_syscall_sqe
+{
+    /* Set by the enclave. */
+    uint32_t opcode;
+    int32_t flags;
+    oe_host_fd_t fd;
+    void* buf;
+    uint64_t len;
+    int64_t offset;
+    void* name;
+    void* control;
+    uint64_t controllen;
+    uint32_t namelen;
+
+    /* Set by the host. namelen and controllen are updated by recvmsg. */
+    int32_t msg_flags;
+    int64_t result;
+} oe_syscall_sqe_t;
+
+OE_EXTERNC_END
+
+#endif // _OE_SYSCALL_BATCH_H
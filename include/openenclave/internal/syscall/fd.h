@@ -24,6 +24,18 @@ typedef enum _oe_fd_type
 
 typedef struct _oe_fd oe_fd_t;
 
+/* A watch on a descriptor that implements get_events. */
+typedef struct _oe_fd_watch
+{
+    /* Called by the descriptor with its lock held when some events may have
+     * become ready. When the descriptor is closed, it calls notify with closed
+     * set and without holding locks instead, and forgets the watch. */
+    void (*notify)(struct _oe_fd_watch* watch, bool closed);
+
+    /* Links the watches of a descriptor. */
+    struct _oe_fd_watch* next;
+} oe_fd_watch_t;
+
 /* Common operations on file-descriptor objects. */
 typedef struct _oe_fd_ops
 {
@@ -44,6 +56,19 @@ typedef struct _oe_fd_ops
     int (*close)(oe_fd_t* desc);
 
     oe_host_fd_t (*get_host_fd)(oe_fd_t* desc);
+
+    /* Optional. Returns the host descriptor if read, write, sendmsg, recvmsg
+     * and fsync on this descriptor may be executed directly on the host, or
+     * -1 otherwise. Used to batch these calls. */
+    oe_host_fd_t (*get_direct_host_fd)(oe_fd_t* desc);
+
+    /* Optional. Implemented by descriptors whose readiness is kept in enclave
+     * memory, which lets epoll wait for them without the host. Returns the
+     * OE_EPOLL* events that are ready. */
+    uint32_t (*get_events)(oe_fd_t* desc);
+
+    /* Required with get_events. Adds (add is true) or removes a watch. */
+    void (*watch)(oe_fd_t* desc, oe_fd_watch_t* watch, bool add);
 } oe_fd_ops_t;
 
 /* File operations. */
@@ -60,6 +85,14 @@ typedef struct _oe_file_ops
         *pwrite)(oe_fd_t* desc, const void* buf, size_t count, oe_off_t offset);
 
     int (*getdents64)(oe_fd_t* file, struct oe_dirent* dirp, uint32_t count);
+
+    /* Optional. Writes the data of the file to storage. fsync() and
+     * fdatasync() fail with OE_EINVAL if the file does not implement it. */
+    int (*fsync)(oe_fd_t* file);
+
+    /* Optional. ftruncate() fails with OE_EINVAL if the file does not
+     * implement it. */
+    int (*ftruncate)(oe_fd_t* file, oe_off_t length);
 } oe_file_ops_t;
 
 /* Socket operations .*/
@@ -160,6 +193,11 @@ typedef struct _oe_epoll_ops
 struct _oe_fd
 {
     oe_fd_type_t type;
+
+    /* References held by the fdtable and by callers of oe_fdtable_get(). The
+     * descriptor is closed when the last one is dropped. */
+    uint32_t refcount;
+
     union {
         oe_fd_ops_t fd;
         oe_file_ops_t file;
@@ -168,6 +206,28 @@ struct _oe_fd
     } ops;
 };
 
+/* The status flags of an open file description on the host. A descriptor
+ * shares them with its dups, like it shares the description on the host, so
+ * that setting O_NONBLOCK through one descriptor applies to all of them. */
+typedef struct _oe_fd_status
+{
+    uint32_t refcount;
+    int flags;
+} oe_fd_status_t;
+
+/* Returns NULL if out of memory. */
+oe_fd_status_t* oe_fd_status_new(int flags);
+
+/* Takes another reference for a dup of the descriptor. */
+oe_fd_status_t* oe_fd_status_ref(oe_fd_status_t* status);
+
+/* Drops a reference. Accepts NULL. */
+void oe_fd_status_put(oe_fd_status_t* status);
+
+int oe_fd_status_get(const oe_fd_status_t* status);
+
+void oe_fd_status_set(oe_fd_status_t* status, int flags);
+
 OE_EXTERNC_END
 
 // clang-format on
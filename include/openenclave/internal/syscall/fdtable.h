@@ -10,18 +10,51 @@
 
 OE_EXTERNC_BEGIN
 
+/**
+ * Looks up a descriptor and takes a reference to it, which the caller must
+ * drop with oe_fdtable_put(). The lookup does not take a lock.
+ */
 oe_fd_t* oe_fdtable_get(int fd, oe_fd_type_t type);
 
+/**
+ * Takes another reference to a descriptor that the caller knows has not been
+ * freed yet, which the caller must drop with oe_fdtable_put().
+ *
+ * @return false if the last reference has been dropped and the descriptor is
+ * being closed.
+ */
+bool oe_fdtable_ref(oe_fd_t* desc);
+
+/**
+ * Drops a reference taken by oe_fdtable_get() or passed to the caller by
+ * oe_fdtable_reassign(). Dropping the last reference closes the descriptor.
+ *
+ * @return The result of closing the descriptor, or 0 if other references are
+ * left.
+ */
+int oe_fdtable_put(oe_fd_t* desc);
+
+/**
+ * Adds a descriptor to the table, which takes over the reference of the
+ * caller.
+ */
 int oe_fdtable_assign(oe_fd_t* desc);
 
+/**
+ * Replaces the descriptor of an fd. The reference of the table to the old
+ * descriptor passes to the caller.
+ */
 int oe_fdtable_reassign(int fd, oe_fd_t* new_desc, oe_fd_t** old_desc);
 
+/**
+ * Removes an fd from the table and drops the reference of the table.
+ */
 int oe_fdtable_release(int fd);
 
 /**
  * Invokes **callback** for each fd of type **type** in the fdtable.
  *
- * The callback must not use any of the other fdtable functions.
+ * The callback holds a reference to the descriptor and runs without locks.
  *
  * @param type The fd type of interest. Can be OE_FD_TYPE_ANY.
  * @param arg An argument passed to the callback.
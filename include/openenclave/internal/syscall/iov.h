@@ -23,6 +23,33 @@ int oe_iov_sync(
     const void* buf_,
     size_t buf_size);
 
+/*
+ * Allocate a staging buffer in host memory that is large enough for all the
+ * data of the IO vector, and gather the data into it if **copy_data** is set.
+ * The host reads from or writes to the staging buffer directly, so the data
+ * is copied only once between the enclave and the host.
+ */
+int oe_iov_stage(
+    const struct oe_iovec* iov,
+    int iovcnt,
+    bool copy_data,
+    void** buf_out,
+    size_t* buf_size_out);
+
+/*
+ * Scatter the first **count** bytes of the staging buffer into the IO vector.
+ * Fails if **count** exceeds the size of the staging buffer.
+ */
+int oe_iov_unstage(
+    const struct oe_iovec* iov,
+    int iovcnt,
+    const void* buf,
+    size_t buf_size,
+    size_t count);
+
+/* Free a staging buffer returned by oe_iov_stage(). */
+void oe_iov_free_stage(void* buf);
+
 OE_EXTERNC_END
 
 #endif // _OE_SYSCALL_IOV_H
@@ -11,6 +11,7 @@
 OE_EXTERNC_BEGIN
 
 #define OE_TIOCGWINSZ 0x5413
+#define OE_FIONBIO 0x5421
 
 int __oe_ioctl(int fd, unsigned long request, uint64_t arg);
 
@@ -139,6 +139,7 @@ OE_EXTERNC_BEGIN
 #define OE_SHUT_RDWR 2
 
 #define OE_MSG_PEEK 0x0002
+#define OE_MSG_DONTWAIT 0x0040
 
 #define __OE_SOCKADDR_STORAGE oe_sockaddr_storage
 #include <openenclave/internal/syscall/sys/bits/sockaddr_storage.h>
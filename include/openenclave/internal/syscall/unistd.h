@@ -53,6 +53,12 @@ int oe_truncate(const char* path, oe_off_t length);
 
 int oe_truncate_d(uint64_t devid, const char* path, oe_off_t length);
 
+int oe_ftruncate(int fd, oe_off_t length);
+
+int oe_fsync(int fd);
+
+int oe_fdatasync(int fd);
+
 #endif /* !defined(WIN32) */
 
 int oe_link(const char* oldpath, const char* newpath);
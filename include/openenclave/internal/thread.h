@@ -713,6 +713,16 @@ oe_result_t oe_sem_wait(
     const struct oe_timespec* abstime);
 void oe_sem_wake(oe_sem_t* sem);
 
+// helpers for futex emulation in libc/syscalls.c
+#define OE_FUTEX_BITSET_MATCH_ANY 0xffffffffU
+oe_result_t oe_futex_wait(
+    const volatile int* uaddr,
+    int val,
+    uint32_t bitset,
+    const struct oe_timespec* abstime,
+    bool clock_monotonic);
+int oe_futex_wake(const volatile int* uaddr, int count, uint32_t bitset);
+
 OE_EXTERNC_END
 
 #endif // OE_BUILD_ENCLAVE
@@ -128,15 +128,21 @@ OE_INLINE uint64_t StrCode(const char* s, uint64_t n)
  * http://en.cppreference.com/w/cpp/atomic/memory_order. For a deeper
  * understanding see "C++ and the Perils of Double-Checked Locking"
  * http://www.aristeia.com/Papers/DDJ_Jul_Aug_2004_revised.pdf.
+ *
+ * A full barrier additionally prevents the reordering of a write with a read
+ * which follows it in program order. Unlike the other barriers, it generates a
+ * fence instruction on x86.
  */
 #if defined(__linux__)
 #define OE_ATOMIC_MEMORY_BARRIER_ACQUIRE() \
     __atomic_thread_fence(__ATOMIC_ACQUIRE)
 #define OE_ATOMIC_MEMORY_BARRIER_RELEASE() \
     __atomic_thread_fence(__ATOMIC_RELEASE)
+#define OE_ATOMIC_MEMORY_BARRIER_FULL() __atomic_thread_fence(__ATOMIC_SEQ_CST)
 #elif defined(_MSC_VER)
 #define OE_ATOMIC_MEMORY_BARRIER_ACQUIRE() _ReadBarrier()
 #define OE_ATOMIC_MEMORY_BARRIER_RELEASE() _WriteBarrier()
+#define OE_ATOMIC_MEMORY_BARRIER_FULL() __faststorefence()
 #else
 #error "Unsupported platform"
 #endif
@@ -0,0 +1,77 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+/**
+ * @file syscall_batch.h
+ *
+ * This file defines the programming interface for executing several system
+ * calls with a single transition to the host. Unlike enclave.h, it uses the
+ * types of the enclave libc.
+ *
+ */
+#ifndef _OE_SYSCALL_BATCH_PUBLIC_H
+#define _OE_SYSCALL_BATCH_PUBLIC_H
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include "bits/batch.h"
+#include "bits/defs.h"
+
+OE_EXTERNC_BEGIN
+
+/**
+ * A system call in a batch.
+ */
+typedef struct _oe_syscall_op
+{
+    /** One of the OE_BATCH_OP_* values. */
+    int opcode;
+
+    /** The file descriptor. */
+    int fd;
+
+    /** The flags of sendmsg and recvmsg. */
+    int flags;
+
+    /** The buffer of read, write, pread and pwrite. */
+    void* buf;
+    size_t len;
+
+    /** The file offset of pread and pwrite. */
+    off_t offset;
+
+    /** The message of sendmsg and recvmsg. */
+    struct msghdr* msg;
+
+    /** The optional peer address of accept. */
+    struct sockaddr* addr;
+    socklen_t* addrlen;
+
+    /** The return value of the system call, or -errno on failure. */
+    ssize_t result;
+} oe_syscall_op_t;
+
+/**
+ * Execute a batch of system calls.
+ *
+ * The calls are executed in order. Consecutive calls on host files and host
+ * sockets are executed by the host with a single transition, so that issuing
+ * many small writes, for example, costs fewer transitions. Other calls are
+ * executed one by one. A failing call does not stop the batch.
+ *
+ * If the host executes batches with io_uring (see the OE_IO_URING environment
+ * variable), consecutive preads, and pwrites of disjoint ranges, may run
+ * concurrently.
+ *
+ * @param[in,out] ops The system calls. The result of each is stored in its
+ * **result** field.
+ * @param[in] count The number of system calls.
+ *
+ * @returns 0 if the system calls were executed, or -1 with errno set if the
+ * parameters are invalid or memory could not be allocated.
+ */
+int oe_batch_syscalls(oe_syscall_op_t* ops, size_t count);
+
+OE_EXTERNC_END
+
+#endif /* _OE_SYSCALL_BATCH_PUBLIC_H */
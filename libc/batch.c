@@ -0,0 +1,97 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <errno.h>
+#include <openenclave/internal/syscall/batch.h>
+#include <openenclave/syscall_batch.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+OE_STATIC_ASSERT(sizeof(oe_syscall_op_t) == sizeof(oe_batch_op_t));
+OE_CHECK_FIELD(oe_syscall_op_t, oe_batch_op_t, opcode);
+OE_CHECK_FIELD(oe_syscall_op_t, oe_batch_op_t, fd);
+OE_CHECK_FIELD(oe_syscall_op_t, oe_batch_op_t, flags);
+OE_CHECK_FIELD(oe_syscall_op_t, oe_batch_op_t, buf);
+OE_CHECK_FIELD(oe_syscall_op_t, oe_batch_op_t, len);
+OE_CHECK_FIELD(oe_syscall_op_t, oe_batch_op_t, offset);
+OE_CHECK_FIELD(oe_syscall_op_t, oe_batch_op_t, msg);
+OE_CHECK_FIELD(oe_syscall_op_t, oe_batch_op_t, addr);
+OE_CHECK_FIELD(oe_syscall_op_t, oe_batch_op_t, addrlen);
+OE_CHECK_FIELD(oe_syscall_op_t, oe_batch_op_t, result);
+
+static bool _has_msg(const oe_syscall_op_t* op)
+{
+    return op->msg && (op->opcode == OE_BATCH_OP_SENDMSG ||
+                       op->opcode == OE_BATCH_OP_RECVMSG);
+}
+
+/* The msghdr of musl has padding next to msg_iovlen and msg_controllen, so it
+ * must be converted rather than cast. */
+static void _msg_to_oe(struct oe_msghdr* dst, const struct msghdr* src)
+{
+    dst->msg_name = src->msg_name;
+    dst->msg_namelen = src->msg_namelen;
+    dst->msg_iov = (struct oe_iovec*)src->msg_iov;
+    dst->msg_iovlen = (size_t)src->msg_iovlen;
+    dst->msg_control = src->msg_control;
+    dst->msg_controllen = src->msg_controllen;
+    dst->msg_flags = src->msg_flags;
+}
+
+static void _msg_from_oe(struct msghdr* dst, const struct oe_msghdr* src)
+{
+    dst->msg_namelen = src->msg_namelen;
+    dst->msg_controllen = (socklen_t)src->msg_controllen;
+    dst->msg_flags = src->msg_flags;
+}
+
+int oe_batch_syscalls(oe_syscall_op_t* ops, size_t count)
+{
+    int ret = -1;
+    oe_batch_op_t* batch = NULL;
+    struct oe_msghdr* msgs = NULL;
+
+    if (!ops && count)
+    {
+        errno = EINVAL;
+        goto done;
+    }
+
+    if (count > SIZE_MAX / sizeof(*batch) ||
+        !(batch = malloc(count * sizeof(*batch))) ||
+        !(msgs = calloc(count, sizeof(*msgs))))
+    {
+        errno = ENOMEM;
+        goto done;
+    }
+
+    memcpy(batch, ops, count * sizeof(*batch));
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (_has_msg(&ops[i]))
+        {
+            _msg_to_oe(&msgs[i], ops[i].msg);
+            batch[i].msg = &msgs[i];
+        }
+    }
+
+    if (oe_syscall_batch(batch, count) != 0)
+        goto done;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (_has_msg(&ops[i]))
+            _msg_from_oe(ops[i].msg, &msgs[i]);
+
+        ops[i].result = batch[i].result;
+    }
+
+    ret = 0;
+
+done:
+    free(msgs);
+    free(batch);
+    return ret;
+}
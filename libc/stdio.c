@@ -6,16 +6,17 @@
 #include "../3rdparty/musl/musl/src/internal/pthread_impl.h"
 #include "../3rdparty/musl/musl/src/internal/stdio_impl.h"
 
-// We must adapt the musl getc/putc family of functions because they originally
-// depend on futex.
+// These are the musl getc/putc family of functions. They used to be adapted
+// because they depend on futex, which is now emulated in libc/syscalls.c.
 
-// adapted from musl/stdio/getc.h
+// copied from musl/stdio/getc.h
 static int locking_getc(FILE* f)
 {
     if (a_cas(&f->lock, 0, MAYBE_WAITERS - 1))
         __lockfile(f);
     int c = getc_unlocked(f);
-    a_swap(&f->lock, 0);
+    if (a_swap(&f->lock, 0) & MAYBE_WAITERS)
+        __wake(&f->lock, 1, 1);
     return c;
 }
 
@@ -47,13 +48,14 @@ int fgetc(FILE* f)
     return do_getc(f);
 }
 
-// adapted from musl/stdio/putc.h
+// copied from musl/stdio/putc.h
 static int locking_putc(int c, FILE* f)
 {
     if (a_cas(&f->lock, 0, MAYBE_WAITERS - 1))
         __lockfile(f);
     c = putc_unlocked(c, f);
-    a_swap(&f->lock, 0);
+    if (a_swap(&f->lock, 0) & MAYBE_WAITERS)
+        __wake(&f->lock, 1, 1);
     return c;
 }
 
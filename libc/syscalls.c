@@ -9,6 +9,7 @@
 #include <openenclave/enclave.h>
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/random.h>
+#include <openenclave/internal/sched.h>
 #include <openenclave/internal/syscall.h>
 #include <openenclave/internal/syscall/sys/stat.h>
 #include <openenclave/internal/syscall/sys/syscall.h>
@@ -25,12 +26,21 @@
 #include <sys/time.h>
 #include <time.h>
 
+// Read on every syscall, so it is accessed with atomics instead of a lock.
 static oe_syscall_hook_t _hook;
-static oe_spinlock_t _lock;
 
 static const uint64_t _SEC_TO_MSEC = 1000UL;
 static const uint64_t _MSEC_TO_USEC = 1000UL;
 
+// From <linux/futex.h>, which is not available in the enclave.
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+#define FUTEX_WAIT_BITSET 9
+#define FUTEX_WAKE_BITSET 10
+#define FUTEX_PRIVATE_FLAG 128
+#define FUTEX_CLOCK_REALTIME 256
+#define FUTEX_CMD_MASK ~(FUTEX_PRIVATE_FLAG | FUTEX_CLOCK_REALTIME)
+
 static long _syscall_mmap(long n, ...)
 {
     /* Always fail */
@@ -101,14 +111,88 @@ static int _syscall_sched_getaffinity(pid_t pid, size_t size, cpu_set_t* set)
         return -1;
     }
 
-    CPU_ZERO_S(size, set);
+    oe_get_cpu_affinity(set, size);
+
+    // The kernel returns the size of the mask it copied.
+    return size < OE_MAX_CPUS / 8 ? (int)size : OE_MAX_CPUS / 8;
+}
 
-    // Return at least 2 CPUs so that Go does not assume a single-threaded
-    // process.
-    CPU_SET_S(0, size, set);
-    CPU_SET_S(1, size, set);
+static long _syscall_futex(
+    volatile int* uaddr,
+    int futex_op,
+    int val,
+    const struct timespec* timeout,
+    uint32_t val3)
+{
+    const int cmd = futex_op & FUTEX_CMD_MASK;
+    const bool clock_realtime = futex_op & FUTEX_CLOCK_REALTIME;
+    struct oe_timespec abstime;
+    const struct oe_timespec* pabstime = NULL;
+    uint32_t bitset = OE_FUTEX_BITSET_MATCH_ANY;
+    oe_result_t result;
+
+    switch (cmd)
+    {
+        case FUTEX_WAKE_BITSET:
+            bitset = val3;
+            /* fallthrough */
+        case FUTEX_WAKE:
+            if (!bitset)
+                break;
+            return oe_futex_wake(uaddr, val, bitset);
+
+        case FUTEX_WAIT_BITSET:
+            bitset = val3;
+            // The timeout is absolute.
+            if (timeout)
+            {
+                abstime.tv_sec = timeout->tv_sec;
+                abstime.tv_nsec = timeout->tv_nsec;
+                pabstime = &abstime;
+            }
+            /* fallthrough */
+        case FUTEX_WAIT:
+            if (!bitset)
+                break;
+
+            // The timeout is relative to CLOCK_MONOTONIC.
+            if (timeout && !pabstime)
+            {
+                if (timeout->tv_sec < 0 || timeout->tv_nsec < 0 ||
+                    timeout->tv_nsec >= 1000000000)
+                    break;
+                if (oe_clock_gettime(CLOCK_MONOTONIC, &abstime) != 0)
+                    return -1;
+                abstime.tv_sec += timeout->tv_sec;
+                abstime.tv_nsec += timeout->tv_nsec;
+                if (abstime.tv_nsec >= 1000000000)
+                {
+                    abstime.tv_sec++;
+                    abstime.tv_nsec -= 1000000000;
+                }
+                pabstime = &abstime;
+            }
+
+            result = oe_futex_wait(
+                uaddr,
+                val,
+                bitset,
+                pabstime,
+                cmd == FUTEX_WAIT || !clock_realtime);
+            if (result == OE_OK)
+                return 0;
+            errno = result == OE_BUSY       ? EAGAIN
+                    : result == OE_TIMEDOUT ? ETIMEDOUT
+                                            : EINVAL;
+            return -1;
 
-    return 1;
+        default:
+            errno = ENOSYS;
+            return -1;
+    }
+
+    errno = EINVAL;
+    return -1;
 }
 
 static void _stat_to_oe_stat(struct stat* stat, struct oe_stat_t* oe_stat)
@@ -200,12 +284,90 @@ static long _dispatch_oe_syscall(
     return ret;
 }
 
+/*
+**==============================================================================
+**
+** Syscalls that are handled in the enclave. They are looked up by number so
+** that they skip the dispatch to liboesyscall.
+**
+**==============================================================================
+*/
+
+// The handlers take the arguments of the syscall as an array of 6 longs.
+typedef long (*_syscall_handler_t)(const long* args);
+
+#define _SYSCALL_HANDLER(name) static long _handle_##name(const long* args)
+
+_SYSCALL_HANDLER(gettimeofday)
+{
+    return _syscall_gettimeofday(SYS_gettimeofday, args[0], args[1]);
+}
+
+_SYSCALL_HANDLER(clock_gettime)
+{
+    return _syscall_clock_gettime(SYS_clock_gettime, args[0], args[1]);
+}
+
+_SYSCALL_HANDLER(mmap)
+{
+    OE_UNUSED(args);
+    return _syscall_mmap(SYS_mmap);
+}
+
+_SYSCALL_HANDLER(getrandom)
+{
+    return _syscall_getrandom(
+        (void*)args[0], (size_t)args[1], (unsigned int)args[2]);
+}
+
+_SYSCALL_HANDLER(sched_getaffinity)
+{
+    return _syscall_sched_getaffinity(
+        (pid_t)args[0], (size_t)args[1], (cpu_set_t*)args[2]);
+}
+
+_SYSCALL_HANDLER(sched_yield)
+{
+    OE_UNUSED(args);
+    __builtin_ia32_pause();
+    return 0;
+}
+
+_SYSCALL_HANDLER(futex)
+{
+    return _syscall_futex(
+        (volatile int*)args[0],
+        (int)args[1],
+        (int)args[2],
+        (void*)args[3],
+        (uint32_t)args[5]);
+}
+
+// Silently ignored syscalls: madvise is a noop, and signals are not
+// supported.
+_SYSCALL_HANDLER(success)
+{
+    OE_UNUSED(args);
+    return 0;
+}
+
+static const _syscall_handler_t _syscall_handlers[] = {
+    [SYS_gettimeofday] = _handle_gettimeofday,
+    [SYS_clock_gettime] = _handle_clock_gettime,
+    [SYS_mmap] = _handle_mmap,
+    [SYS_getrandom] = _handle_getrandom,
+    [SYS_madvise] = _handle_success,
+    [SYS_sched_getaffinity] = _handle_sched_getaffinity,
+    [SYS_sched_yield] = _handle_sched_yield,
+    [SYS_futex] = _handle_futex,
+    [SYS_rt_sigprocmask] = _handle_success,
+    [SYS_sigaltstack] = _handle_success,
+};
+
 /* Intercept __syscalls() from MUSL */
 long __syscall(long n, long x1, long x2, long x3, long x4, long x5, long x6)
 {
-    oe_spin_lock(&_lock);
-    oe_syscall_hook_t hook = _hook;
-    oe_spin_unlock(&_lock);
+    const oe_syscall_hook_t hook = __atomic_load_n(&_hook, __ATOMIC_ACQUIRE);
 
     /* Invoke the syscall hook if any */
     if (hook)
@@ -222,30 +384,14 @@ long __syscall(long n, long x1, long x2, long x3, long x4, long x5, long x6)
     }
 
     /* Handle syscall internally if possible. */
-    switch (n)
+    if (n >= 0 && (size_t)n < OE_COUNTOF(_syscall_handlers))
     {
-        case SYS_gettimeofday:
-            return _syscall_gettimeofday(n, x1, x2);
-        case SYS_clock_gettime:
-            return _syscall_clock_gettime(n, x1, x2);
-        case SYS_mmap:
-            return _syscall_mmap(n, x1, x2, x3, x4, x5, x6);
-        case SYS_getrandom:
-            return _syscall_getrandom((void*)x1, x2, x3);
-        case SYS_madvise:
-            return 0; // noop, return success
-        case SYS_sched_getaffinity:
-            return _syscall_sched_getaffinity(x1, x2, (void*)x3);
-        case SYS_sched_yield:
-            __builtin_ia32_pause();
-            return 0;
-        case SYS_rt_sigprocmask:
-        case SYS_sigaltstack:
-            // Signals are not supported. Silently ignore and return success.
-            return 0;
-        default:
-            /* Drop through and let the code below handle the syscall. */
-            break;
+        const _syscall_handler_t handler = _syscall_handlers[n];
+        if (handler)
+        {
+            const long args[] = {x1, x2, x3, x4, x5, x6};
+            return handler(args);
+        }
     }
 
     /* Let liboesyscall handle select system calls. */
@@ -301,7 +447,5 @@ long __syscall_ret(unsigned long r)
 
 void oe_register_syscall_hook(oe_syscall_hook_t hook)
 {
-    oe_spin_lock(&_lock);
-    _hook = hook;
-    oe_spin_unlock(&_lock);
+    __atomic_store_n(&_hook, hook, __ATOMIC_RELEASE);
 }
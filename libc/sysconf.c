@@ -4,6 +4,7 @@
 #include <errno.h>
 #include <openenclave/enclave.h>
 #include <openenclave/internal/defs.h>
+#include <openenclave/internal/sched.h>
 #include <unistd.h>
 
 long sysconf(int name)
@@ -12,6 +13,10 @@ long sysconf(int name)
     {
         case _SC_PAGESIZE:
             return OE_PAGE_SIZE;
+        case _SC_NPROCESSORS_CONF:
+        case _SC_NPROCESSORS_ONLN:
+            // get_nprocs() and get_nprocs_conf() also end up here.
+            return (long)oe_get_cpu_affinity(NULL, 0);
         default:
             errno = EINVAL;
             return -1;
@@ -27,12 +27,13 @@ void musl_init_threaded(void)
     libc.threaded = 1;
 }
 
-// Locks used internally in musl. These are adapted to spin instead of using
-// futex (which is not supported in OE). We cannot use oe_spinlock because musl
+// Locks used internally in musl. These block on the futex emulation of
+// __syscall() (see libc/syscalls.c), which spins in the enclave before it asks
+// the host to block the thread. We cannot use oe_spinlock because musl
 // depends on implementation details. E.g., some functions "wake" a lock by
 // directly modifying the value.
 
-// adapted from musl/thread/__lock.c
+// copied from musl/thread/__lock.c
 void __lock(volatile int* l)
 {
     if (!libc.threads_minus_1)
@@ -41,8 +42,8 @@ void __lock(volatile int* l)
     int current = a_cas(l, 0, INT_MIN + 1);
     if (!current)
         return;
-    /* spin loop */
-    for (;;)
+    /* A first spin loop, for medium congestion. */
+    for (unsigned i = 0; i < 10; ++i)
     {
         if (current < 0)
             current -= INT_MIN + 1;
@@ -51,11 +52,30 @@ void __lock(volatile int* l)
         if (val == current)
             return;
         current = val;
-        __builtin_ia32_pause();
+    }
+    // Spinning failed, so mark ourselves as being inside the CS.
+    current = a_fetch_add(l, 1) + 1;
+    /* The main lock acquisition loop for heavy congestion. The only
+     * change to the value performed inside that loop is a successful
+     * lock via the CAS that acquires the lock. */
+    for (;;)
+    {
+        /* We can only go into wait, if we know that somebody holds the
+         * lock and will eventually wake us up, again. */
+        if (current < 0)
+        {
+            __futexwait(l, current, 1);
+            current -= INT_MIN + 1;
+        }
+        /* assertion: current > 0, the count includes us already. */
+        int val = a_cas(l, current, INT_MIN + current);
+        if (val == current)
+            return;
+        current = val;
     }
 }
 
-// adapted from musl/thread/__lock.c
+// copied from musl/thread/__lock.c
 void __unlock(volatile int* l)
 {
     /* Check l[0] to see if we are multi-threaded. */
@@ -63,26 +83,32 @@ void __unlock(volatile int* l)
     {
         if (a_fetch_add(l, -(INT_MIN + 1)) != (INT_MIN + 1))
         {
-            //__wake(l, 1, 1);
+            __wake(l, 1, 1);
         }
     }
 }
 
-// adapted from musl/stdio/__lockfile.c
+// copied from musl/stdio/__lockfile.c
 int __lockfile(FILE* f)
 {
     int owner = f->lock, tid = __pthread_self()->tid;
-    if (owner == tid)
+    if ((owner & ~MAYBE_WAITERS) == tid)
         return 0;
-    while ((owner = a_cas(&f->lock, 0, tid)))
+    owner = a_cas(&f->lock, 0, tid);
+    if (!owner)
+        return 1;
+    while ((owner = a_cas(&f->lock, 0, tid | MAYBE_WAITERS)))
     {
-        __builtin_ia32_pause();
+        if ((owner & MAYBE_WAITERS) ||
+            a_cas(&f->lock, owner, owner | MAYBE_WAITERS) == owner)
+            __futexwait(&f->lock, owner | MAYBE_WAITERS, 1);
     }
     return 1;
 }
 
-// adapted from musl/stdio/__lockfile.c
+// copied from musl/stdio/__lockfile.c
 void __unlockfile(FILE* f)
 {
-    a_swap(&f->lock, 0);
+    if (a_swap(&f->lock, 0) & MAYBE_WAITERS)
+        __wake(&f->lock, 1, 1);
 }
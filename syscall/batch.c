@@ -0,0 +1,394 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/corelibc/stdlib.h>
+#include <openenclave/corelibc/string.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/hostpool.h>
+#include <openenclave/internal/safemath.h>
+#include <openenclave/internal/syscall/batch.h>
+#include <openenclave/internal/syscall/fdtable.h>
+#include <openenclave/internal/syscall/iov.h>
+#include <openenclave/internal/syscall/raise.h>
+#include <openenclave/internal/syscall/sys/socket.h>
+#include <openenclave/internal/syscall/unistd.h>
+#include "syscall_t.h"
+
+/*
+**==============================================================================
+**
+** Batched system calls.
+**
+** Operations on descriptors that map directly to host descriptors are
+** collected in a submission queue. The queue is copied to host memory together
+** with the data to be written and is executed by the host with a single OCALL,
+** which is handed to a switchless worker if none of the entries can block. The
+** enclave keeps its own copy of every entry and only reads the results back
+** from the host.
+**
+**==============================================================================
+*/
+
+/* Bounds of a single submission */
+#define QUEUE_SIZE 64
+#define MAX_PAYLOAD_SIZE ((size_t)1 << 20)
+
+/* Results in [-MAX_ERRNO, -1] are negated error numbers. */
+#define MAX_ERRNO 4095
+
+typedef struct _queue
+{
+    oe_batch_op_t* ops[QUEUE_SIZE];
+    oe_syscall_sqe_t sqes[QUEUE_SIZE];
+
+    /* Keep the host fds of the entries open until the host is done. */
+    oe_fd_t* descs[QUEUE_SIZE];
+    size_t count;
+    size_t payload_size;
+} queue_t;
+
+static size_t _align(size_t size)
+{
+    return (size + 15) & ~(size_t)15;
+}
+
+static bool _msg_len(const struct oe_msghdr* msg, uint64_t* len)
+{
+    *len = 0;
+
+    for (size_t i = 0; i < msg->msg_iovlen; i++)
+        if (oe_safe_add_u64(*len, msg->msg_iov[i].iov_len, len) != OE_OK)
+            return false;
+
+    return true;
+}
+
+static size_t _payload_size(const oe_syscall_sqe_t* sqe)
+{
+    return _align(sqe->len) + _align(sqe->namelen) + _align(sqe->controllen);
+}
+
+static ssize_t _execute_inline(oe_batch_op_t* op)
+{
+    ssize_t ret = -1;
+
+    oe_errno = 0;
+
+    switch (op->opcode)
+    {
+        case OE_BATCH_OP_READ:
+            ret = oe_read(op->fd, op->buf, op->len);
+            break;
+        case OE_BATCH_OP_WRITE:
+            ret = oe_write(op->fd, op->buf, op->len);
+            break;
+        case OE_BATCH_OP_PREAD:
+            ret = oe_pread(op->fd, op->buf, op->len, op->offset);
+            break;
+        case OE_BATCH_OP_PWRITE:
+            ret = oe_pwrite(op->fd, op->buf, op->len, op->offset);
+            break;
+        case OE_BATCH_OP_SENDMSG:
+            ret = oe_sendmsg(op->fd, op->msg, op->flags);
+            break;
+        case OE_BATCH_OP_RECVMSG:
+            ret = oe_recvmsg(op->fd, op->msg, op->flags);
+            break;
+        case OE_BATCH_OP_ACCEPT:
+            ret = oe_accept(op->fd, op->addr, op->addrlen);
+            break;
+        case OE_BATCH_OP_CLOSE:
+            ret = oe_close(op->fd);
+            break;
+        case OE_BATCH_OP_FSYNC:
+            ret = oe_fsync(op->fd);
+            break;
+        default:
+            oe_errno = OE_EINVAL;
+            break;
+    }
+
+    return ret == -1 ? -oe_errno : ret;
+}
+
+/* Fill in the enclave copy of the submission queue entry if the operation can
+ * be executed directly on the host. On success, the caller must put *desc_out
+ * after the host has executed the entry. */
+static bool _prepare(
+    const oe_batch_op_t* op,
+    oe_syscall_sqe_t* sqe,
+    oe_fd_t** desc_out)
+{
+    const oe_fd_type_t type =
+        op->opcode == OE_BATCH_OP_SENDMSG || op->opcode == OE_BATCH_OP_RECVMSG
+            ? OE_FD_TYPE_SOCKET
+            : OE_FD_TYPE_ANY;
+    const struct oe_msghdr* msg = op->msg;
+    oe_fd_t* desc;
+
+    memset(sqe, 0, sizeof(*sqe));
+
+    switch (op->opcode)
+    {
+        case OE_BATCH_OP_READ:
+        case OE_BATCH_OP_WRITE:
+        case OE_BATCH_OP_PREAD:
+        case OE_BATCH_OP_PWRITE:
+            if ((op->len && !op->buf) || op->len > OE_SSIZE_MAX)
+                return false;
+            sqe->len = op->len;
+            sqe->offset = op->offset;
+            break;
+        case OE_BATCH_OP_SENDMSG:
+        case OE_BATCH_OP_RECVMSG:
+            /* Let the regular path report invalid messages. */
+            if (!msg || (msg->msg_iovlen && !msg->msg_iov) ||
+                msg->msg_iovlen > OE_IOV_MAX ||
+                (msg->msg_namelen && !msg->msg_name) ||
+                (msg->msg_controllen && !msg->msg_control) ||
+                !_msg_len(msg, &sqe->len) || sqe->len > OE_SSIZE_MAX)
+                return false;
+            sqe->namelen = msg->msg_namelen;
+            sqe->controllen = msg->msg_controllen;
+            sqe->flags = op->flags;
+            break;
+        case OE_BATCH_OP_FSYNC:
+            break;
+        default:
+            return false;
+    }
+
+    oe_errno = 0;
+
+    if (!(desc = oe_fdtable_get(op->fd, type)))
+        return false;
+
+    sqe->opcode = (uint32_t)op->opcode;
+    sqe->fd = desc->ops.fd.get_direct_host_fd
+                  ? desc->ops.fd.get_direct_host_fd(desc)
+                  : -1;
+
+    if (sqe->fd == -1)
+    {
+        oe_fdtable_put(desc);
+        return false;
+    }
+
+    *desc_out = desc;
+    return true;
+}
+
+/* Copy the data to be written into host memory and point the entry at it. */
+static void _stage(const oe_batch_op_t* op, oe_syscall_sqe_t* sqe, uint8_t* p)
+{
+    const struct oe_msghdr* msg = op->msg;
+    const bool send = op->opcode == OE_BATCH_OP_WRITE ||
+                      op->opcode == OE_BATCH_OP_PWRITE ||
+                      op->opcode == OE_BATCH_OP_SENDMSG;
+
+    sqe->buf = p;
+    p += _align(sqe->len);
+
+    if (op->opcode == OE_BATCH_OP_WRITE || op->opcode == OE_BATCH_OP_PWRITE)
+        memcpy(sqe->buf, op->buf, op->len);
+    else if (op->opcode == OE_BATCH_OP_SENDMSG)
+    {
+        uint8_t* buf = sqe->buf;
+
+        for (size_t i = 0; i < msg->msg_iovlen; i++)
+        {
+            memcpy(buf, msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
+            buf += msg->msg_iov[i].iov_len;
+        }
+    }
+
+    if (sqe->namelen)
+    {
+        sqe->name = p;
+        p += _align(sqe->namelen);
+
+        if (send)
+            memcpy(sqe->name, msg->msg_name, sqe->namelen);
+    }
+
+    if (sqe->controllen)
+    {
+        sqe->control = p;
+
+        if (send)
+            memcpy(sqe->control, msg->msg_control, sqe->controllen);
+    }
+}
+
+/* Validate the result of an entry that the host has executed and copy the
+ * data read back into the enclave. */
+static ssize_t _complete(
+    oe_batch_op_t* op,
+    const oe_syscall_sqe_t* sqe,
+    const oe_syscall_sqe_t* host_sqe)
+{
+    struct oe_msghdr* msg = op->msg;
+    const int64_t result = host_sqe->result;
+
+    if (result < 0)
+        return result >= -MAX_ERRNO ? (ssize_t)result : -OE_EINVAL;
+
+    if ((uint64_t)result > sqe->len ||
+        (op->opcode == OE_BATCH_OP_FSYNC && result))
+        return -OE_EINVAL;
+
+    if (op->opcode == OE_BATCH_OP_READ || op->opcode == OE_BATCH_OP_PREAD)
+        memcpy(op->buf, sqe->buf, (size_t)result);
+    else if (op->opcode == OE_BATCH_OP_RECVMSG)
+    {
+        const uint32_t namelen = host_sqe->namelen;
+        const uint64_t controllen = host_sqe->controllen;
+
+        if (oe_iov_unstage(
+                msg->msg_iov,
+                (int)msg->msg_iovlen,
+                sqe->buf,
+                sqe->len,
+                (size_t)result) != 0)
+            return -OE_EINVAL;
+
+        msg->msg_namelen = namelen < sqe->namelen ? namelen : sqe->namelen;
+        msg->msg_controllen =
+            controllen < sqe->controllen ? controllen : sqe->controllen;
+        msg->msg_flags = host_sqe->msg_flags;
+
+        if (msg->msg_namelen)
+            memcpy(msg->msg_name, sqe->name, msg->msg_namelen);
+        if (msg->msg_controllen)
+            memcpy(msg->msg_control, sqe->control, msg->msg_controllen);
+    }
+
+    return (ssize_t)result;
+}
+
+/* Whether the host may block indefinitely on an entry of the queue. */
+static bool _may_block(const queue_t* queue)
+{
+    for (size_t i = 0; i < queue->count; i++)
+    {
+        const oe_batch_op_t* op = queue->ops[i];
+
+        switch (op->opcode)
+        {
+            case OE_BATCH_OP_PREAD:
+            case OE_BATCH_OP_PWRITE:
+            case OE_BATCH_OP_FSYNC:
+                break;
+            case OE_BATCH_OP_SENDMSG:
+            case OE_BATCH_OP_RECVMSG:
+                if (!(op->flags & OE_MSG_DONTWAIT))
+                    return true;
+                break;
+            default:
+                return true;
+        }
+    }
+
+    return false;
+}
+
+static void _submit(queue_t* queue)
+{
+    const size_t sqes_size = queue->count * sizeof(oe_syscall_sqe_t);
+    oe_syscall_sqe_t* host_sqes = NULL;
+    uint8_t* p;
+    int retval = -1;
+
+    if (!queue->count)
+        return;
+
+    if ((host_sqes = oe_host_pool_malloc(sqes_size + queue->payload_size)))
+    {
+        p = (uint8_t*)host_sqes + _align(sqes_size);
+
+        for (size_t i = 0; i < queue->count; i++)
+        {
+            _stage(queue->ops[i], &queue->sqes[i], p);
+            p += _payload_size(&queue->sqes[i]);
+        }
+
+        memcpy(host_sqes, queue->sqes, sqes_size);
+
+        if (OE_SWITCHLESS_OCALL(
+                !_may_block(queue),
+                oe_syscall_submit_ocall(
+                    &retval, host_sqes, queue->count)) != OE_OK)
+            retval = -1;
+    }
+
+    for (size_t i = 0; i < queue->count; i++)
+    {
+        oe_batch_op_t* op = queue->ops[i];
+
+        /* Nothing has been executed if the host does not support batches. */
+        if (retval == 0)
+            op->result = _complete(op, &queue->sqes[i], &host_sqes[i]);
+        else
+            op->result = _execute_inline(op);
+
+        oe_fdtable_put(queue->descs[i]);
+    }
+
+    oe_host_pool_free(host_sqes);
+    queue->count = 0;
+    queue->payload_size = 0;
+}
+
+int oe_syscall_batch(oe_batch_op_t* ops, size_t count)
+{
+    int ret = -1;
+    queue_t* queue = NULL;
+
+    if (!ops && count)
+        OE_RAISE_ERRNO(OE_EINVAL);
+
+    if (!(queue = oe_calloc(1, sizeof(*queue))))
+        OE_RAISE_ERRNO(OE_ENOMEM);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        oe_batch_op_t* op = &ops[i];
+        oe_syscall_sqe_t* sqe = &queue->sqes[queue->count];
+        oe_fd_t* desc;
+        size_t payload_size;
+
+        if (!_prepare(op, sqe, &desc))
+        {
+            /* Preserve the order of the operations. */
+            _submit(queue);
+            op->result = _execute_inline(op);
+            continue;
+        }
+
+        payload_size = _payload_size(sqe);
+
+        if (queue->payload_size + payload_size > MAX_PAYLOAD_SIZE &&
+            queue->count)
+        {
+            const oe_syscall_sqe_t tmp = *sqe;
+
+            _submit(queue);
+            sqe = &queue->sqes[0];
+            *sqe = tmp;
+        }
+
+        queue->ops[queue->count] = op;
+        queue->descs[queue->count++] = desc;
+        queue->payload_size += payload_size;
+
+        if (queue->count == QUEUE_SIZE)
+            _submit(queue);
+    }
+
+    _submit(queue);
+    ret = 0;
+
+done:
+    oe_free(queue);
+    return ret;
+}
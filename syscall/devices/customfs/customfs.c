@@ -48,6 +48,24 @@ typedef struct _device
     } mount;
 } device_t;
 
+/* The state shared by the open files of a path. Only used if the custom fs
+ * implements version 2. */
+typedef struct _inode
+{
+    /* Identifies the custom fs, which may be mounted more than once. */
+    uintptr_t (*fs_open)(const char* path, bool must_exist);
+
+    /* NULL after the path has been unlinked. */
+    char* path;
+
+    size_t refcount;
+
+    /* The cached size of the file. */
+    uint64_t size;
+
+    struct _inode* next;
+} inode_t;
+
 /* Create by open(). */
 typedef struct _file
 {
@@ -63,10 +81,25 @@ typedef struct _file
     oe_spinlock_t lock;
     uint64_t offset;
     bool readonly;
+
+    /* NULL if the custom fs only implements version 1. */
+    inode_t* inode;
 } file_t;
 
+/* Protects _inodes and makes unlink() and open() atomic. */
 static oe_spinlock_t _lock;
 
+/* The inodes of the paths that are open. */
+static inode_t* _inodes;
+
+OE_STATIC_ASSERT(sizeof(oe_customfs_iovec_t) == sizeof(struct oe_iovec));
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_customfs_iovec_t, base) ==
+    OE_OFFSETOF(struct oe_iovec, iov_base));
+OE_STATIC_ASSERT(
+    OE_OFFSETOF(oe_customfs_iovec_t, len) ==
+    OE_OFFSETOF(struct oe_iovec, iov_len));
+
 static oe_file_ops_t _get_file_ops(void);
 
 /* Return true if the file system was mounted as read-only. */
@@ -103,30 +136,253 @@ done:
     return ret;
 }
 
+static bool _is_version2(const oe_customfs_t* customfs)
+{
+    return customfs->version >= 2;
+}
+
+/* Finds the inode of a path. Requires _lock. */
+static inode_t* _inode_find(const oe_customfs_t* customfs, const char* path)
+{
+    for (inode_t* inode = _inodes; inode; inode = inode->next)
+    {
+        if (inode->fs_open == customfs->open &&
+            oe_strcmp(inode->path, path) == 0)
+            return inode;
+    }
+
+    return NULL;
+}
+
+/* Gets the inode of a path that has been opened with the given handle.
+ * Requires _lock. */
+static inode_t* _inode_get(
+    const oe_customfs_t* customfs,
+    const char* path,
+    uintptr_t handle)
+{
+    inode_t* inode = _inode_find(customfs, path);
+
+    if (inode)
+    {
+        inode->refcount++;
+        return inode;
+    }
+
+    if (!(inode = oe_calloc(1, sizeof(*inode))))
+        return NULL;
+
+    if (!(inode->path = oe_strdup(path)))
+    {
+        oe_free(inode);
+        return NULL;
+    }
+
+    inode->fs_open = customfs->open;
+    inode->refcount = 1;
+    inode->size = customfs->get_size(handle);
+    inode->next = _inodes;
+    _inodes = inode;
+
+    return inode;
+}
+
+/* Removes an inode from the list, so that the next open() of its path gets a
+ * new one. Requires _lock. */
+static void _inode_unlink(inode_t* inode)
+{
+    for (inode_t** p = &_inodes; *p; p = &(*p)->next)
+    {
+        if (*p == inode)
+        {
+            *p = inode->next;
+            break;
+        }
+    }
+
+    oe_free(inode->path);
+    inode->path = NULL;
+    inode->next = NULL;
+}
+
+/* Requires _lock. */
+static void _inode_put(inode_t* inode)
+{
+    if (--inode->refcount)
+        return;
+
+    if (inode->path)
+        _inode_unlink(inode);
+
+    oe_free(inode);
+}
+
+/* Unlinks a path from the custom fs. Requires _lock. */
+static void _unlink(const oe_customfs_t* customfs, const char* path)
+{
+    if (_is_version2(customfs))
+    {
+        inode_t* const inode = _inode_find(customfs, path);
+        if (inode)
+            _inode_unlink(inode);
+    }
+
+    customfs->unlink(path);
+}
+
+static uint64_t _get_size(const file_t* file)
+{
+    if (file->inode)
+        return __atomic_load_n(&file->inode->size, __ATOMIC_ACQUIRE);
+
+    return file->device->get_size(file->handle);
+}
+
+static void _set_size(const file_t* file, uint64_t size)
+{
+    __atomic_store_n(&file->inode->size, size, __ATOMIC_RELEASE);
+}
+
+/* Updates the cached size after a write that ended at the given offset. */
+static void _grow_size(const file_t* file, uint64_t end)
+{
+    uint64_t size;
+
+    if (!file->inode)
+        return;
+
+    size = __atomic_load_n(&file->inode->size, __ATOMIC_RELAXED);
+
+    while (size < end && !__atomic_compare_exchange_n(
+                             &file->inode->size,
+                             &size,
+                             end,
+                             true,
+                             __ATOMIC_RELEASE,
+                             __ATOMIC_RELAXED))
+        ;
+}
+
+/* Reads the buffers in one request if the custom fs supports it. */
+static void _device_readv(
+    const file_t* file,
+    const oe_customfs_iovec_t* iov,
+    int iovcnt,
+    uint64_t offset)
+{
+    if (file->inode && file->device->readv)
+    {
+        if (iovcnt)
+            file->device->readv(file->handle, iov, iovcnt, offset);
+        return;
+    }
+
+    for (int i = 0; i < iovcnt; i++)
+    {
+        file->device->read(file->handle, iov[i].base, iov[i].len, offset);
+        offset += iov[i].len;
+    }
+}
+
 // caller must hold the file lock
-static ssize_t _read(
+static ssize_t _readv(
     const file_t* file,
-    void* buf,
-    uint64_t count,
+    const struct oe_iovec* iov,
+    int iovcnt,
     uint64_t offset)
 {
     oe_assert(file);
-    oe_assert(buf);
+    oe_assert(iov || !iovcnt);
 
-    const uint64_t size = file->device->get_size(file->handle);
+    const uint64_t size = _get_size(file);
     if (offset >= size)
         return 0;
 
-    const uint64_t max_count = size - offset;
-    if (count > max_count)
+    uint64_t max_count = size - offset;
+    if (max_count > OE_SSIZE_MAX)
+        max_count = OE_SSIZE_MAX;
+
+    /* Read the buffers that fit before the end of the file at once. */
+    uint64_t count = 0;
+    int n = 0;
+    while (n < iovcnt && iov[n].iov_len <= max_count - count)
+        count += iov[n++].iov_len;
+
+    _device_readv(file, (const oe_customfs_iovec_t*)iov, n, offset);
+
+    /* Fill the buffer that reaches beyond the end of the file partially. */
+    if (n < iovcnt && count < max_count)
+    {
+        const oe_customfs_iovec_t last = {iov[n].iov_base, max_count - count};
+        _device_readv(file, &last, 1, offset + count);
         count = max_count;
-    if (count > OE_SSIZE_MAX)
-        count = OE_SSIZE_MAX;
+    }
 
-    file->device->read(file->handle, buf, count, offset);
     return (ssize_t)count;
 }
 
+// caller must hold the file lock
+static ssize_t _writev(
+    const file_t* file,
+    const struct oe_iovec* iov,
+    int iovcnt,
+    uint64_t offset)
+{
+    ssize_t ret = -1;
+    uint64_t count = 0;
+
+    oe_assert(file);
+    oe_assert(iov || !iovcnt);
+
+    if (file->inode && file->device->writev)
+    {
+        for (int i = 0; i < iovcnt; ++i)
+        {
+            if (iov[i].iov_len > OE_SSIZE_MAX - count)
+                OE_RAISE_ERRNO(OE_EINVAL);
+            count += iov[i].iov_len;
+        }
+
+        if (!file->device->writev(
+                file->handle,
+                (const oe_customfs_iovec_t*)iov,
+                iovcnt,
+                offset))
+            OE_RAISE_ERRNO(OE_ENOSPC);
+    }
+    else
+    {
+        for (int i = 0; i < iovcnt; ++i)
+        {
+            const size_t len = iov[i].iov_len;
+            if (len > OE_SSIZE_MAX - count)
+            {
+                if (count)
+                    break;
+                OE_RAISE_ERRNO(OE_EFBIG);
+            }
+
+            if (!file->device->write(
+                    file->handle, iov[i].iov_base, len, offset + count))
+            {
+                if (count)
+                    break;
+                OE_RAISE_ERRNO(OE_ENOSPC);
+            }
+
+            count += len;
+        }
+    }
+
+    if (count)
+        _grow_size(file, offset + count);
+
+    ret = (ssize_t)count;
+
+done:
+    return ret;
+}
+
 /* Called by oe_mount(). */
 static int _fs_mount(
     oe_device_t* device,
@@ -250,6 +506,7 @@ static oe_fd_t* _fs_open_file(
     oe_fd_t* ret = NULL;
     device_t* fs = _cast_device(device);
     file_t* file = NULL;
+    bool locked = false;
 
     /* Fail if any required parameters are null. */
     if (!fs || !pathname)
@@ -272,23 +529,52 @@ static oe_fd_t* _fs_open_file(
         file->readonly = readonly;
     }
 
+    const oe_customfs_t* const customfs = file->device;
+    const bool version2 = _is_version2(customfs);
+    const bool truncate =
+        (flags & OE_O_TRUNC) && version2 && customfs->truncate;
+
+    locked = true;
     oe_spin_lock(&_lock);
-    if (flags & OE_O_TRUNC)
-        file->device->unlink(pathname);
+
+    /* Without the truncate function, truncating means recreating the file. */
+    if ((flags & OE_O_TRUNC) && !truncate)
+        _unlink(customfs, pathname);
 
     /* Ask the host to open the file. */
-    file->handle = file->device->open(pathname, !(flags & OE_O_CREAT));
-    oe_spin_unlock(&_lock);
+    file->handle = customfs->open(pathname, !(flags & OE_O_CREAT));
     if (!file->handle)
         OE_RAISE_ERRNO(OE_EINVAL);
 
+    if (version2)
+    {
+        if (!(file->inode = _inode_get(customfs, pathname, file->handle)))
+            OE_RAISE_ERRNO(OE_ENOMEM);
+
+        if (truncate)
+        {
+            if (!customfs->truncate(file->handle, 0))
+                OE_RAISE_ERRNO(OE_EIO);
+            _set_size(file, 0);
+        }
+    }
+
     ret = &file->base;
     file = NULL;
 
 done:
 
     if (file)
+    {
+        if (file->inode)
+            _inode_put(file->inode);
+        if (file->handle)
+            file->device->close(file->handle);
         oe_free(file);
+    }
+
+    if (locked)
+        oe_spin_unlock(&_lock);
 
     return ret;
 }
@@ -318,13 +604,14 @@ static ssize_t _fs_read(oe_fd_t* desc, void* buf, size_t count)
 {
     ssize_t ret = -1;
     file_t* file = _cast_file(desc);
+    const struct oe_iovec iov = {buf, count};
 
-    if (!file)
+    if (!file || (count && !buf))
         OE_RAISE_ERRNO(OE_EINVAL);
 
     oe_spin_lock(&file->lock);
 
-    ret = _read(file, buf, count, file->offset);
+    ret = _readv(file, &iov, 1, file->offset);
     oe_assert(ret >= 0);
     file->offset += (uint64_t)ret;
 
@@ -359,6 +646,7 @@ static ssize_t _fs_write(oe_fd_t* desc, const void* buf, size_t count)
     ssize_t ret = -1;
     bool locked = false;
     file_t* file = _cast_file(desc);
+    const struct oe_iovec iov = {(void*)buf, count};
 
     /* Check parameters. */
     if (!file || (count && !buf))
@@ -372,10 +660,9 @@ static ssize_t _fs_write(oe_fd_t* desc, const void* buf, size_t count)
     locked = true;
     oe_spin_lock(&file->lock);
 
-    if (!file->device->write(file->handle, buf, count, file->offset))
-        OE_RAISE_ERRNO(OE_ENOSPC);
-    file->offset += count;
-    ret = (ssize_t)count;
+    if ((ret = _writev(file, &iov, 1, file->offset)) == -1)
+        OE_RAISE_ERRNO(oe_errno);
+    file->offset += (uint64_t)ret;
 
 done:
     if (locked)
@@ -391,42 +678,14 @@ static ssize_t _fs_readv(oe_fd_t* desc, const struct oe_iovec* iov, int iovcnt)
     if (!file || (!iov && iovcnt) || iovcnt < 0 || iovcnt > OE_IOV_MAX)
         OE_RAISE_ERRNO(OE_EINVAL);
 
-    uint64_t bytes_read = 0;
-
     oe_spin_lock(&file->lock);
 
-    const uint64_t size = file->device->get_size(file->handle);
-    if (file->offset >= size)
-    {
-        oe_spin_unlock(&file->lock);
-        return 0;
-    }
-
-    uint64_t max_count = size - file->offset;
-    if (max_count > OE_SSIZE_MAX)
-        max_count = OE_SSIZE_MAX;
-
-    for (int i = 0; i < iovcnt; ++i)
-    {
-        size_t len = iov[i].iov_len;
-        if (bytes_read + len > max_count)
-        {
-            len = max_count - bytes_read;
-            if (!len)
-                break;
-        }
-
-        file->device->read(
-            file->handle, iov[i].iov_base, len, file->offset + bytes_read);
-        bytes_read += len;
-    }
-
-    file->offset += bytes_read;
+    ret = _readv(file, iov, iovcnt, file->offset);
+    oe_assert(ret >= 0);
+    file->offset += (uint64_t)ret;
 
     oe_spin_unlock(&file->lock);
 
-    ret = (ssize_t)bytes_read;
-
 done:
     return ret;
 }
@@ -443,37 +702,12 @@ static ssize_t _fs_writev(oe_fd_t* desc, const struct oe_iovec* iov, int iovcnt)
     if (file->readonly)
         OE_RAISE_ERRNO(OE_EBADF);
 
-    uint64_t bytes_written = 0;
-
     locked = true;
     oe_spin_lock(&file->lock);
 
-    for (int i = 0; i < iovcnt; ++i)
-    {
-        const size_t len = iov[i].iov_len;
-        if (len > OE_SSIZE_MAX)
-        {
-            if (bytes_written)
-                break;
-            OE_RAISE_ERRNO(OE_EFBIG);
-        }
-
-        if (!file->device->write(
-                file->handle,
-                iov[i].iov_base,
-                len,
-                file->offset + bytes_written))
-        {
-            if (bytes_written)
-                break;
-            OE_RAISE_ERRNO(OE_ENOSPC);
-        }
-
-        bytes_written += len;
-    }
-
-    file->offset += bytes_written;
-    ret = (ssize_t)bytes_written;
+    if ((ret = _writev(file, iov, iovcnt, file->offset)) == -1)
+        OE_RAISE_ERRNO(oe_errno);
+    file->offset += (uint64_t)ret;
 
 done:
     if (locked)
@@ -501,7 +735,7 @@ static oe_off_t _fs_lseek_file(oe_fd_t* desc, oe_off_t offset, int whence)
             offset += (oe_off_t)file->offset;
             break;
         case OE_SEEK_END:
-            offset += (oe_off_t)file->device->get_size(file->handle);
+            offset += (oe_off_t)_get_size(file);
             break;
         default:
             OE_RAISE_ERRNO(OE_EINVAL);
@@ -526,12 +760,13 @@ static ssize_t _fs_pread(
 {
     ssize_t ret = -1;
     file_t* file = _cast_file(desc);
+    const struct oe_iovec iov = {buf, count};
 
-    if (!file || offset < 0)
+    if (!file || offset < 0 || (count && !buf))
         OE_RAISE_ERRNO(OE_EINVAL);
 
     oe_spin_lock(&file->lock);
-    ret = _read(file, buf, count, (uint64_t)offset);
+    ret = _readv(file, &iov, 1, (uint64_t)offset);
     oe_spin_unlock(&file->lock);
 
 done:
@@ -547,8 +782,9 @@ static ssize_t _fs_pwrite(
     ssize_t ret = -1;
     bool locked = false;
     file_t* file = _cast_file(desc);
+    const struct oe_iovec iov = {(void*)buf, count};
 
-    if (!file || offset < 0)
+    if (!file || offset < 0 || (count && !buf))
         OE_RAISE_ERRNO(OE_EINVAL);
 
     if (file->readonly)
@@ -559,9 +795,7 @@ static ssize_t _fs_pwrite(
     locked = true;
     oe_spin_lock(&file->lock);
 
-    if (!file->device->write(file->handle, buf, count, (uint64_t)offset))
-        OE_RAISE_ERRNO(OE_ENOSPC);
-    ret = (ssize_t)count;
+    ret = _writev(file, &iov, 1, (uint64_t)offset);
 
 done:
     if (locked)
@@ -577,15 +811,79 @@ static int _fs_close_file(oe_fd_t* desc)
     if (!file)
         OE_RAISE_ERRNO(OE_EINVAL);
 
+    /* Close the file even if flushing fails. */
+    if (file->inode && file->device->flush &&
+        !file->device->flush(file->handle))
+        oe_errno = OE_EIO;
+    else
+        ret = 0;
+
     file->device->close(file->handle);
+
+    if (file->inode)
+    {
+        oe_spin_lock(&_lock);
+        _inode_put(file->inode);
+        oe_spin_unlock(&_lock);
+    }
+
     oe_free(file);
 
+done:
+    return ret;
+}
+
+static int _fs_fsync(oe_fd_t* desc)
+{
+    int ret = -1;
+    file_t* file = _cast_file(desc);
+
+    if (!file)
+        OE_RAISE_ERRNO(OE_EINVAL);
+
+    if (!file->inode || !file->device->fsync)
+        OE_RAISE_ERRNO(OE_EINVAL);
+
+    if (!file->device->fsync(file->handle))
+        OE_RAISE_ERRNO(OE_EIO);
+
     ret = 0;
 
 done:
     return ret;
 }
 
+static int _fs_ftruncate(oe_fd_t* desc, oe_off_t length)
+{
+    int ret = -1;
+    bool locked = false;
+    file_t* file = _cast_file(desc);
+
+    if (!file || length < 0)
+        OE_RAISE_ERRNO(OE_EINVAL);
+
+    /* Fail if the file is not open for writing. */
+    if (file->readonly)
+        OE_RAISE_ERRNO(OE_EINVAL);
+
+    if (!file->inode || !file->device->truncate)
+        OE_RAISE_ERRNO(OE_EINVAL);
+
+    locked = true;
+    oe_spin_lock(&file->lock);
+
+    if (!file->device->truncate(file->handle, (uint64_t)length))
+        OE_RAISE_ERRNO(OE_EIO);
+    _set_size(file, (uint64_t)length);
+
+    ret = 0;
+
+done:
+    if (locked)
+        oe_spin_unlock(&file->lock);
+    return ret;
+}
+
 static int _fs_ioctl(oe_fd_t* desc, unsigned long request, uint64_t arg)
 {
     (void)request;
@@ -653,10 +951,16 @@ static int _fs_stat(oe_device_t* device, const char* pathname, oe_stat_t* buf)
 
     const oe_customfs_t* const customfs = (oe_customfs_t*)device;
 
+    oe_spin_lock(&_lock);
+
     const uintptr_t handle = customfs->open(pathname, true);
     if (handle)
     {
-        const uint64_t size = customfs->get_size(handle);
+        /* The cached size is the current one if the file is open. */
+        const inode_t* const inode =
+            _is_version2(customfs) ? _inode_find(customfs, pathname) : NULL;
+        const uint64_t size =
+            inode ? inode->size : customfs->get_size(handle);
         customfs->close(handle);
 
         buf->st_size = size < OE_SSIZE_MAX ? (oe_off_t)size : OE_SSIZE_MAX;
@@ -666,6 +970,8 @@ static int _fs_stat(oe_device_t* device, const char* pathname, oe_stat_t* buf)
     else
         oe_errno = OE_ENOENT;
 
+    oe_spin_unlock(&_lock);
+
     ret = retval;
 
 done:
@@ -724,7 +1030,7 @@ static int _fs_unlink(oe_device_t* device, const char* pathname)
         OE_RAISE_ERRNO(OE_EPERM);
 
     oe_spin_lock(&_lock);
-    ((oe_customfs_t*)device)->unlink(pathname);
+    _unlink((oe_customfs_t*)device, pathname);
     oe_spin_unlock(&_lock);
 
     ret = 0;
@@ -756,22 +1062,45 @@ done:
 
 static int _fs_truncate(oe_device_t* device, const char* path, oe_off_t length)
 {
-    (void)path;
-    (void)length;
-
     int ret = -1;
     device_t* fs = _cast_device(device);
+    const oe_customfs_t* const customfs = (oe_customfs_t*)device;
+    uintptr_t handle = 0;
+    bool locked = false;
 
-    if (!fs)
+    if (!fs || !path || length < 0)
         OE_RAISE_ERRNO(OE_EINVAL);
 
     if (_is_read_only(fs))
         OE_RAISE_ERRNO(OE_EPERM);
 
-    OE_RAISE_ERRNO(OE_ENOSYS);
+    if (!_is_version2(customfs) || !customfs->truncate)
+        OE_RAISE_ERRNO(OE_ENOSYS);
+
+    locked = true;
+    oe_spin_lock(&_lock);
+
+    if (!(handle = customfs->open(path, true)))
+        OE_RAISE_ERRNO(OE_ENOENT);
+
+    if (!customfs->truncate(handle, (uint64_t)length))
+        OE_RAISE_ERRNO(OE_EIO);
+
+    /* Update the cached size of the open files of the path. */
+    inode_t* const inode = _inode_find(customfs, path);
+    if (inode)
+        __atomic_store_n(&inode->size, (uint64_t)length, __ATOMIC_RELEASE);
+
+    ret = 0;
 
 done:
 
+    if (handle)
+        customfs->close(handle);
+
+    if (locked)
+        oe_spin_unlock(&_lock);
+
     return ret;
 }
 
@@ -840,6 +1169,8 @@ static oe_file_ops_t _file_ops = {
     .pread = _fs_pread,
     .pwrite = _fs_pwrite,
     .getdents64 = _fs_getdents64,
+    .fsync = _fs_fsync,
+    .ftruncate = _fs_ftruncate,
 };
 
 static oe_file_ops_t _get_file_ops(void)
@@ -12,32 +12,94 @@
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/safecrt.h>
 #include <openenclave/internal/syscall/device.h>
+#include <openenclave/internal/syscall/eventfd.h>
 #include <openenclave/internal/syscall/fcntl.h>
 #include <openenclave/internal/syscall/fdtable.h>
 #include <openenclave/internal/syscall/iov.h>
 #include <openenclave/internal/syscall/raise.h>
 #include <openenclave/internal/syscall/sys/ioctl.h>
+#include <openenclave/internal/syscall/unistd.h>
 #include <openenclave/internal/thread.h>
+#include <openenclave/internal/time.h>
 #include <openenclave/internal/trace.h>
 #include <openenclave/internal/utils.h>
 #include "syscall_t.h"
 
-/* The map allocation grows in multiples of the chunk size. */
+/* The map capacity grows in multiples of the chunk size. */
 #define MAP_CHUNK_SIZE 1024
 
 #define DEVICE_MAGIC 0x4504f4c
 #define EPOLL_MAGIC 0x708f5a51
 
-/* epoll_ctl() adds/modifies/deletes this mapping. */
+/* epoll_wait() takes at most this many watches from the ready list at once. */
+#define COLLECT_MAX 64
+
+/* epoll_wait() polls the host epoll whenever the ready watches do not fill
+ * the events. On every HOST_POLL_INTERVAL-th call, it leaves room for a host
+ * event so that host fds are not starved by watches that are always ready. */
+#define HOST_POLL_INTERVAL 16
+
+/* The data of the wake eventfd in the host epoll. It is not a valid fd, so
+ * epoll_wait() drops its events. */
+#define WAKE_FD_DATA -1
+
+typedef struct _epoll epoll_t;
+
+/*
+ * Descriptors whose readiness is kept in enclave memory (see get_events in
+ * fd.h) are not added to the host epoll. Each of them gets a watch instead,
+ * which the descriptor queues on the ready list of the epoll when some events
+ * may have become ready.
+ */
+typedef struct _watch
+{
+    oe_fd_watch_t base;
+    epoll_t* epoll;
+
+    /* The fields below are protected by epoll->ready_lock. */
+
+    /* Null once the descriptor has been closed. */
+    oe_fd_t* desc;
+
+    /* The event parameter from epoll_ctl(). */
+    struct oe_epoll_event event;
+
+    /* Set by an EPOLLONESHOT event until the next EPOLL_CTL_MOD. */
+    bool disabled;
+
+    /* Whether the watch is on the ready list. */
+    bool queued;
+    struct _watch* next_ready;
+} watch_t;
+
+/* epoll_ctl() adds/modifies/deletes this mapping. The map is indexed by fd. */
 typedef struct _mapping
 {
-    /* The fd parameter from epoll_ctl(). */
-    int fd;
+    /* Odd while epoll_ctl() is updating this mapping. */
+    uint32_t seq;
+
+    /* Whether the fd has been added by epoll_ctl(). */
+    uint32_t in_use;
 
     /* The event parameter from epoll_ctl(). */
     struct oe_epoll_event event;
+
+    /* The watch if the fd is not in the host epoll, otherwise null. */
+    watch_t* watch;
 } mapping_t;
 
+/*
+ * The fd-indexed mapping table. epoll_wait() reads it without holding the
+ * epoll lock, so a table that has been replaced by a larger one is kept on
+ * the retired list until the epoll object is closed.
+ */
+typedef struct _map
+{
+    struct _map* retired;
+    size_t capacity;
+    mapping_t mappings[];
+} map_t;
+
 /* The epoll device. */
 typedef struct _device
 {
@@ -47,7 +109,7 @@ typedef struct _device
     uint32_t magic;
 } device_t;
 
-typedef struct _epoll
+struct _epoll
 {
     oe_fd_t base;
 
@@ -58,13 +120,43 @@ typedef struct _epoll
     oe_host_fd_t host_fd;
 
     /* Mappings added by epoll_ctl(OE_EPOLL_CTL_ADD) */
-    mapping_t* map;
-    size_t map_size;
-    size_t map_capacity;
+    map_t* map;
 
-    /* Synchronizes access to this structure. */
+    /* Serializes epoll_ctl() calls. epoll_wait() does not take this lock. */
     oe_mutex_t lock;
-} epoll_t;
+
+    /* The number of fds in the host epoll. */
+    size_t num_host_fds;
+
+    /* Host eventfd in the host epoll that wakes the threads waiting in the
+     * host epoll when a watch is queued. Created with the first watch. */
+    oe_host_fd_t wake_fd;
+
+    /* Counts the calls of epoll_wait() while host fds are added. */
+    uint32_t streak;
+
+    /* Protects the watches, the ready list and the counters below. Taken
+     * after epoll->lock and after the locks of the watched descriptors. */
+    oe_mutex_t ready_lock;
+
+    /* Signaled when a watch is queued, when a host fd is added and when the
+     * last thread stops collecting. */
+    oe_cond_t ready_cond;
+
+    /* The watches that may be ready, in the order of their notifications. */
+    watch_t* ready_head;
+    watch_t* ready_tail;
+
+    /* The number of threads that are checking watches taken from the ready
+     * list. Watches are not freed while it is nonzero. */
+    size_t collecting;
+
+    /* The number of threads waiting in the host epoll. */
+    size_t host_waiters;
+
+    /* Whether wake_fd has been written since a host waiter returned. */
+    bool wake_pending;
+};
 
 static oe_epoll_ops_t _get_epoll_ops(void);
 
@@ -88,56 +180,424 @@ static epoll_t* _cast_epoll(const oe_fd_t* epoll_)
     return epoll;
 }
 
-/* Reserve space in the mapping array (does not change map_size). */
-static int _map_reserve(epoll_t* epoll, size_t new_capacity)
+static void _map_free(map_t* map)
+{
+    while (map)
+    {
+        map_t* const retired = map->retired;
+        oe_free(map);
+        map = retired;
+    }
+}
+
+/* Make the map large enough to hold the given fd. Requires epoll->lock. */
+static int _map_reserve(epoll_t* epoll, int fd)
 {
     int ret = -1;
+    map_t* const map = epoll->map;
+    const size_t old_capacity = map ? map->capacity : 0;
+    size_t new_capacity;
+    map_t* new_map;
+
+    if (fd < 0)
+        goto done;
 
+    if ((size_t)fd < old_capacity)
+    {
+        ret = 0;
+        goto done;
+    }
+
+    new_capacity = old_capacity * 2;
+    if (new_capacity <= (size_t)fd)
+        new_capacity = (size_t)fd + 1;
     new_capacity = oe_round_up_to_multiple(new_capacity, MAP_CHUNK_SIZE);
 
-    if (new_capacity > epoll->map_capacity)
+    if (!(new_map = oe_calloc(
+              1, sizeof(map_t) + new_capacity * sizeof(mapping_t))))
+        goto done;
+
+    new_map->capacity = new_capacity;
+
+    if (map)
     {
-        mapping_t* p;
-        const size_t n = new_capacity;
+        /* Writers are excluded by the lock, so the mappings are stable. */
+        memcpy(
+            new_map->mappings,
+            map->mappings,
+            old_capacity * sizeof(mapping_t));
+        new_map->retired = map;
+    }
 
-        /* Reallocate the table. */
-        if (!(p = oe_realloc(epoll->map, n * sizeof(mapping_t))))
-            goto done;
+    __atomic_store_n(&epoll->map, new_map, __ATOMIC_RELEASE);
 
-        /* Zero-fill the unused portion. */
-        {
-            const size_t num_bytes = (n - epoll->map_size) * sizeof(mapping_t);
-            void* ptr = p + epoll->map_size;
+    ret = 0;
+
+done:
+    return ret;
+}
+
+/* Find the mapping for the given fd. Requires epoll->lock. */
+static mapping_t* _map_find(epoll_t* epoll, int fd)
+{
+    map_t* const map = epoll->map;
+
+    if (!map || fd < 0 || (size_t)fd >= map->capacity ||
+        !map->mappings[fd].in_use)
+        return NULL;
+
+    return &map->mappings[fd];
+}
+
+/* Update the mapping for the given fd. Requires epoll->lock. */
+static void _map_update(
+    mapping_t* mapping,
+    bool in_use,
+    const struct oe_epoll_event* event)
+{
+    __atomic_store_n(&mapping->seq, mapping->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    mapping->in_use = in_use;
+    if (event)
+        mapping->event = *event;
+
+    __atomic_store_n(&mapping->seq, mapping->seq + 1, __ATOMIC_RELEASE);
+}
+
+/* Look up the data of the given fd without taking epoll->lock. */
+static bool _map_lookup(epoll_t* epoll, int fd, uint64_t* data)
+{
+    const map_t* const map = __atomic_load_n(&epoll->map, __ATOMIC_ACQUIRE);
+    const mapping_t* mapping;
+    uint32_t seq;
+    bool in_use;
+
+    if (!map || fd < 0 || (size_t)fd >= map->capacity)
+        return false;
+
+    mapping = &map->mappings[fd];
+
+    do
+    {
+        while ((seq = __atomic_load_n(&mapping->seq, __ATOMIC_ACQUIRE)) & 1)
+            __builtin_ia32_pause();
+
+        in_use = ((const volatile mapping_t*)mapping)->in_use;
+        *data = ((const volatile mapping_t*)mapping)->event.data.u64;
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&mapping->seq, __ATOMIC_RELAXED) != seq);
+
+    return in_use;
+}
+
+/* Requires epoll->ready_lock. */
+static void _ready_push(epoll_t* epoll, watch_t* watch)
+{
+    watch->queued = true;
+    watch->next_ready = NULL;
+
+    if (epoll->ready_tail)
+        epoll->ready_tail->next_ready = watch;
+    else
+        epoll->ready_head = watch;
+
+    epoll->ready_tail = watch;
+}
+
+/* Requires epoll->ready_lock. */
+static watch_t* _ready_pop(epoll_t* epoll)
+{
+    watch_t* const watch = epoll->ready_head;
+
+    if (watch)
+    {
+        if (!(epoll->ready_head = watch->next_ready))
+            epoll->ready_tail = NULL;
+
+        watch->queued = false;
+    }
+
+    return watch;
+}
+
+/* Requires epoll->ready_lock. */
+static void _ready_remove(epoll_t* epoll, watch_t* watch)
+{
+    watch_t* prev = NULL;
+
+    if (!watch->queued)
+        return;
+
+    for (watch_t* p = epoll->ready_head; p; prev = p, p = p->next_ready)
+    {
+        if (p != watch)
+            continue;
 
-            if (oe_memset_s(ptr, num_bytes, 0, num_bytes) != OE_OK)
-                goto done;
+        if (prev)
+            prev->next_ready = p->next_ready;
+        else
+            epoll->ready_head = p->next_ready;
+
+        if (epoll->ready_tail == p)
+            epoll->ready_tail = prev;
+
+        break;
+    }
+
+    watch->queued = false;
+}
+
+/* Queues the watch and wakes a thread that waits in epoll_wait(). */
+static void _watch_queue(watch_t* watch)
+{
+    epoll_t* const epoll = watch->epoll;
+    bool wake = false;
+
+    oe_mutex_lock(&epoll->ready_lock);
+
+    if (watch->desc && !watch->disabled && !watch->queued)
+    {
+        _ready_push(epoll, watch);
+        oe_cond_broadcast(&epoll->ready_cond);
+
+        if (epoll->host_waiters && !epoll->wake_pending)
+        {
+            epoll->wake_pending = true;
+            wake = true;
         }
+    }
+
+    oe_mutex_unlock(&epoll->ready_lock);
+
+    /* The eventfd is in the host epoll with EPOLLET, so it is never reset. */
+    if (wake)
+        oe_host_eventfd_write(epoll->wake_fd, 1);
+}
+
+/* Takes the watch off the ready list and waits until no thread is checking
+ * watches. Requires epoll->ready_lock. */
+static void _watch_quiesce(epoll_t* epoll, watch_t* watch)
+{
+    _ready_remove(epoll, watch);
 
-        epoll->map = p;
-        epoll->map_capacity = n;
+    while (epoll->collecting)
+        oe_cond_wait(&epoll->ready_cond, &epoll->ready_lock);
+}
+
+/* Called by the watched descriptor. */
+static void _watch_notify(oe_fd_watch_t* watch_, bool closed)
+{
+    watch_t* const watch = (watch_t*)watch_;
+    epoll_t* const epoll = watch->epoll;
+
+    if (!closed)
+    {
+        _watch_queue(watch);
+        return;
     }
 
+    /* The descriptor is being closed. on_close() frees the watch. */
+    oe_mutex_lock(&epoll->ready_lock);
+    watch->desc = NULL;
+    oe_cond_broadcast(&epoll->ready_cond);
+    _watch_quiesce(epoll, watch);
+    oe_mutex_unlock(&epoll->ready_lock);
+}
+
+/* Creates the wake eventfd if it does not exist yet. Requires epoll->lock. */
+static int _wake_fd_init(epoll_t* epoll)
+{
+    int ret = -1;
+    oe_host_fd_t wake_fd = -1;
+    struct oe_epoll_event event;
+    int retval;
+
+    if (epoll->wake_fd != -1)
+        return 0;
+
+    if ((wake_fd = oe_host_eventfd(0, 0)) == -1)
+        OE_RAISE_ERRNO(oe_errno);
+
+    memset(&event, 0, sizeof(event));
+    event.events = OE_EPOLLIN | OE_EPOLLET;
+    event.data.fd = WAKE_FD_DATA;
+
+    if (oe_syscall_epoll_ctl_ocall(
+            &retval, epoll->host_fd, OE_EPOLL_CTL_ADD, wake_fd, &event) !=
+        OE_OK)
+    {
+        OE_RAISE_ERRNO(OE_EINVAL);
+    }
+
+    if (retval != 0)
+        OE_RAISE_ERRNO(oe_errno);
+
+    epoll->wake_fd = wake_fd;
+    wake_fd = -1;
     ret = 0;
 
 done:
+
+    if (wake_fd != -1)
+        oe_close_hostfd(wake_fd);
+
     return ret;
 }
 
-/* Find the mapping for the given file descriptor. */
-static mapping_t* _map_find(epoll_t* epoll, int fd)
+/* Watches a descriptor that implements get_events. Requires epoll->lock. */
+static watch_t* _watch_new(
+    epoll_t* epoll,
+    oe_fd_t* desc,
+    const struct oe_epoll_event* event)
+{
+    watch_t* watch = NULL;
+
+    if (_wake_fd_init(epoll) != 0)
+        OE_RAISE_ERRNO(oe_errno);
+
+    if (!(watch = oe_calloc(1, sizeof(watch_t))))
+        OE_RAISE_ERRNO(OE_ENOMEM);
+
+    watch->base.notify = _watch_notify;
+    watch->epoll = epoll;
+    watch->desc = desc;
+    watch->event = *event;
+
+    desc->ops.fd.watch(desc, &watch->base, true);
+
+    /* Check the current readiness like the host epoll does. */
+    _watch_queue(watch);
+
+done:
+    return watch;
+}
+
+/* Stops watching and frees the watch. Requires epoll->lock. */
+static void _watch_free(watch_t* watch)
+{
+    epoll_t* const epoll = watch->epoll;
+    oe_fd_t* desc;
+
+    /* The reference keeps a concurrent close from freeing the descriptor
+     * while it is detached. If the close has already started, wait until the
+     * descriptor has forgotten the watch instead. */
+    oe_mutex_lock(&epoll->ready_lock);
+    while ((desc = watch->desc) && !oe_fdtable_ref(desc))
+        oe_cond_wait(&epoll->ready_cond, &epoll->ready_lock);
+    oe_mutex_unlock(&epoll->ready_lock);
+
+    /* After this, the descriptor does not queue the watch anymore. */
+    if (desc)
+    {
+        desc->ops.fd.watch(desc, &watch->base, false);
+        oe_fdtable_put(desc);
+    }
+
+    oe_mutex_lock(&epoll->ready_lock);
+    _watch_quiesce(epoll, watch);
+    oe_mutex_unlock(&epoll->ready_lock);
+
+    oe_free(watch);
+}
+
+/* Frees the watches and the enclave state of the epoll object. */
+static void _epoll_free(epoll_t* epoll)
 {
-    size_t i;
+    map_t* const map = epoll->map;
 
-    for (i = 0; i < epoll->map_size; i++)
+    for (size_t i = 0; map && i < map->capacity; i++)
     {
-        mapping_t* mapping = &epoll->map[i];
+        mapping_t* const mapping = &map->mappings[i];
 
-        if (mapping->fd == fd)
-            return mapping;
+        if (mapping->in_use && mapping->watch)
+            _watch_free(mapping->watch);
     }
 
-    /* Not found */
-    return NULL;
+    if (epoll->wake_fd != -1)
+        oe_close_hostfd(epoll->wake_fd);
+
+    _map_free(map);
+    oe_free(epoll);
+}
+
+/*
+ * Reports the ready events of the queued watches. Level-triggered watches
+ * that are still ready are queued again, so that the next call reports them
+ * again. Does not wait.
+ */
+static int _collect(
+    epoll_t* epoll,
+    struct oe_epoll_event* events,
+    int maxevents)
+{
+    watch_t* watches[COLLECT_MAX];
+    oe_fd_t* descs[COLLECT_MAX];
+    struct oe_epoll_event registered[COLLECT_MAX];
+    bool reported[COLLECT_MAX];
+    size_t count = 0;
+    int n = 0;
+
+    oe_mutex_lock(&epoll->ready_lock);
+
+    while (count < COLLECT_MAX && count < (size_t)maxevents)
+    {
+        watch_t* const watch = _ready_pop(epoll);
+        if (!watch)
+            break;
+
+        watches[count] = watch;
+        descs[count] = watch->desc;
+        registered[count] = watch->event;
+        count++;
+    }
+
+    if (count)
+        epoll->collecting++;
+
+    oe_mutex_unlock(&epoll->ready_lock);
+
+    if (!count)
+        return 0;
+
+    /* The descriptors are not closed while collecting is nonzero. */
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint32_t mask =
+            registered[i].events | OE_EPOLLERR | OE_EPOLLHUP;
+        const uint32_t ready = descs[i]->ops.fd.get_events(descs[i]) & mask;
+
+        if ((reported[i] = ready != 0))
+        {
+            events[n].events = ready;
+            events[n].data = registered[i].data;
+            n++;
+        }
+    }
+
+    oe_mutex_lock(&epoll->ready_lock);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        watch_t* const watch = watches[i];
+        const uint32_t flags = registered[i].events;
+
+        if (!reported[i])
+            continue;
+
+        if (flags & OE_EPOLLONESHOT)
+            watch->disabled = true;
+        else if (!(flags & OE_EPOLLET) && watch->desc && !watch->queued)
+            _ready_push(epoll, watch);
+    }
+
+    if (--epoll->collecting == 0)
+        oe_cond_broadcast(&epoll->ready_cond);
+
+    oe_mutex_unlock(&epoll->ready_lock);
+
+    return n;
 }
 
 /* Called by oe_epoll_create1(). */
@@ -166,6 +626,7 @@ static oe_fd_t* _epoll_create1(oe_device_t* device_, int32_t flags)
     epoll->base.ops.epoll = _get_epoll_ops();
     epoll->magic = EPOLL_MAGIC;
     epoll->host_fd = retval;
+    epoll->wake_fd = -1;
 
     ret = &epoll->base;
     epoll = NULL;
@@ -188,10 +649,21 @@ static oe_fd_t* _epoll_create(oe_device_t* device_, int size)
     return _epoll_create1(device_, 0);
 }
 
+/* Wakes the threads that wait for watches, so that they wait in the host epoll
+ * from now on. Called after a host fd has been added. */
+static void _host_fd_added(epoll_t* epoll)
+{
+    __atomic_add_fetch(&epoll->num_host_fds, 1, __ATOMIC_RELEASE);
+
+    oe_mutex_lock(&epoll->ready_lock);
+    oe_cond_broadcast(&epoll->ready_cond);
+    oe_mutex_unlock(&epoll->ready_lock);
+}
+
 static int _epoll_ctl_add(epoll_t* epoll, int fd, struct oe_epoll_event* event)
 {
     int ret = -1;
-    oe_fd_t* desc;
+    oe_fd_t* desc = NULL;
     oe_host_fd_t host_epfd;
     oe_host_fd_t host_fd;
     struct oe_epoll_event host_event;
@@ -207,6 +679,30 @@ static int _epoll_ctl_add(epoll_t* epoll, int fd, struct oe_epoll_event* event)
     if (!(desc = oe_fdtable_get(fd, OE_FD_TYPE_ANY)))
         OE_RAISE_ERRNO(oe_errno);
 
+    /* Watch descriptors with enclave-resident state in the enclave. */
+    if (desc->ops.fd.get_events)
+    {
+        watch_t* watch;
+
+        locked = true;
+        oe_mutex_lock(&epoll->lock);
+
+        if (_map_find(epoll, fd))
+            OE_RAISE_ERRNO(OE_EEXIST);
+
+        if (_map_reserve(epoll, fd) != 0)
+            OE_RAISE_ERRNO(OE_ENOMEM);
+
+        if (!(watch = _watch_new(epoll, desc, event)))
+            OE_RAISE_ERRNO(oe_errno);
+
+        epoll->map->mappings[fd].watch = watch;
+        _map_update(&epoll->map->mappings[fd], true, event);
+
+        ret = 0;
+        goto done;
+    }
+
     /* Get the host fd for the epoll object. */
     host_epfd = epoll->host_fd;
 
@@ -238,12 +734,12 @@ static int _epoll_ctl_add(epoll_t* epoll, int fd, struct oe_epoll_event* event)
 
     if (retval == 0)
     {
-        if (_map_reserve(epoll, epoll->map_size + 1) != 0)
+        if (_map_reserve(epoll, fd) != 0)
             OE_RAISE_ERRNO(OE_ENOMEM);
 
-        epoll->map[epoll->map_size].fd = fd;
-        epoll->map[epoll->map_size].event = *event;
-        epoll->map_size++;
+        epoll->map->mappings[fd].watch = NULL;
+        _map_update(&epoll->map->mappings[fd], true, event);
+        _host_fd_added(epoll);
     }
 
     ret = retval;
@@ -253,16 +749,22 @@ done:
     if (locked)
         oe_mutex_unlock(&epoll->lock);
 
+    /* Closes the descriptor if the fd was closed concurrently, so do not
+     * hold the lock here. */
+    if (desc)
+        oe_fdtable_put(desc);
+
     return ret;
 }
 
 static int _epoll_ctl_mod(epoll_t* epoll, int fd, struct oe_epoll_event* event)
 {
     int ret = -1;
-    oe_fd_t* desc;
+    oe_fd_t* desc = NULL;
     oe_host_fd_t host_epfd;
     oe_host_fd_t host_fd;
     struct oe_epoll_event host_event;
+    mapping_t* mapping;
     int retval;
     bool locked = false;
 
@@ -278,6 +780,31 @@ static int _epoll_ctl_mod(epoll_t* epoll, int fd, struct oe_epoll_event* event)
     /* Get the host fd for the epoll device. */
     host_epfd = epoll->host_fd;
 
+    // The host call and the map update must be done in an atomic operation.
+    locked = true;
+    oe_mutex_lock(&epoll->lock);
+
+    if (!(mapping = _map_find(epoll, fd)))
+        OE_RAISE_ERRNO(OE_ENOENT);
+
+    if (mapping->watch)
+    {
+        watch_t* const watch = mapping->watch;
+
+        oe_mutex_lock(&epoll->ready_lock);
+        watch->event = *event;
+        watch->disabled = false;
+        oe_mutex_unlock(&epoll->ready_lock);
+
+        _map_update(mapping, true, event);
+
+        /* Check the readiness for the new events. */
+        _watch_queue(watch);
+
+        ret = 0;
+        goto done;
+    }
+
     /* Get the host fd for the device. */
     if ((host_fd = desc->ops.fd.get_host_fd(desc)) == -1)
         OE_RAISE_ERRNO(oe_errno);
@@ -293,10 +820,6 @@ static int _epoll_ctl_mod(epoll_t* epoll, int fd, struct oe_epoll_event* event)
         host_event.data.fd = fd;
     }
 
-    // The host call and the map update must be done in an atomic operation.
-    locked = true;
-    oe_mutex_lock(&epoll->lock);
-
     if (oe_syscall_epoll_ctl_ocall(
             &retval, host_epfd, OE_EPOLL_CTL_MOD, host_fd, &host_event) !=
         OE_OK)
@@ -306,29 +829,27 @@ static int _epoll_ctl_mod(epoll_t* epoll, int fd, struct oe_epoll_event* event)
 
     /* Modify the mapping. */
     if (retval == 0)
-    {
-        mapping_t* const mapping = _map_find(epoll, fd);
-        if (!mapping)
-            OE_RAISE_ERRNO(OE_ENOENT);
-
-        mapping->event = *event;
-    }
+        _map_update(mapping, true, event);
 
-    ret = 0;
+    ret = retval;
 
 done:
     if (locked)
         oe_mutex_unlock(&epoll->lock);
 
+    if (desc)
+        oe_fdtable_put(desc);
+
     return ret;
 }
 
 static int _epoll_ctl_del(epoll_t* epoll, int fd)
 {
     int ret = -1;
-    oe_fd_t* desc;
+    oe_fd_t* desc = NULL;
     oe_host_fd_t host_epfd;
     oe_host_fd_t host_fd;
+    mapping_t* mapping;
     int retval;
     bool locked = false;
 
@@ -344,14 +865,27 @@ static int _epoll_ctl_del(epoll_t* epoll, int fd)
     /* Get the host fd for the epoll device. */
     host_epfd = epoll->host_fd;
 
-    /* Get the host fd for the device. */
-    if ((host_fd = desc->ops.fd.get_host_fd(desc)) == -1)
-        OE_RAISE_ERRNO(oe_errno);
-
     // The host call and the map update must be done in an atomic operation.
     locked = true;
     oe_mutex_lock(&epoll->lock);
 
+    if (!(mapping = _map_find(epoll, fd)))
+        OE_RAISE_ERRNO(OE_ENOENT);
+
+    if (mapping->watch)
+    {
+        _watch_free(mapping->watch);
+        mapping->watch = NULL;
+        _map_update(mapping, false, NULL);
+
+        ret = 0;
+        goto done;
+    }
+
+    /* Get the host fd for the device. */
+    if ((host_fd = desc->ops.fd.get_host_fd(desc)) == -1)
+        OE_RAISE_ERRNO(oe_errno);
+
     if (oe_syscall_epoll_ctl_ocall(
             &retval, host_epfd, OE_EPOLL_CTL_DEL, host_fd, NULL) != OE_OK)
     {
@@ -361,29 +895,19 @@ static int _epoll_ctl_del(epoll_t* epoll, int fd)
     /* Delete the mapping. */
     if (retval == 0)
     {
-        bool found = false;
-
-        for (size_t i = 0; i < epoll->map_size; i++)
-        {
-            if (epoll->map[i].fd == fd)
-            {
-                /* Swap with last element of array. */
-                epoll->map[i] = epoll->map[--epoll->map_size];
-                found = true;
-                break;
-            }
-        }
-
-        if (!found)
-            OE_RAISE_ERRNO(OE_ENOENT);
+        _map_update(mapping, false, NULL);
+        __atomic_sub_fetch(&epoll->num_host_fds, 1, __ATOMIC_RELEASE);
     }
 
-    ret = 0;
+    ret = retval;
 
 done:
     if (locked)
         oe_mutex_unlock(&epoll->lock);
 
+    if (desc)
+        oe_fdtable_put(desc);
+
     return ret;
 }
 
@@ -433,30 +957,25 @@ done:
     return ret;
 }
 
-/* Called by oe_epoll_wait(). */
-static int _epoll_wait(
-    oe_fd_t* epoll_,
+/* Waits in the host epoll and maps the returned events. */
+static int _host_wait(
+    epoll_t* epoll,
     struct oe_epoll_event* events,
     int maxevents,
     int timeout)
 {
     int ret = -1;
     int retval;
-    bool locked = false;
-    epoll_t* epoll = _cast_epoll(epoll_);
-    oe_host_fd_t host_epfd = -1;
-
-    if (!epoll || !events || maxevents <= 0)
-        OE_RAISE_ERRNO(OE_EINVAL);
-
-    oe_errno = 0;
-
-    if ((host_epfd = epoll_->ops.fd.get_host_fd(epoll_)) == -1)
-        OE_RAISE_ERRNO(oe_errno);
 
-    if (oe_syscall_epoll_wait_ocall(
-            &retval, host_epfd, events, (unsigned int)maxevents, timeout) !=
-        OE_OK)
+    /* Only a poll that does not wait may be made switchless. */
+    if (OE_SWITCHLESS_OCALL(
+            timeout == 0,
+            oe_syscall_epoll_wait_ocall(
+                &retval,
+                epoll->host_fd,
+                events,
+                (unsigned int)maxevents,
+                timeout)) != OE_OK)
     {
         OE_RAISE_ERRNO(OE_EINVAL);
     }
@@ -466,20 +985,17 @@ static int _epoll_wait(
         if (retval > maxevents)
             OE_RAISE_ERRNO(OE_EINVAL);
 
-        locked = true;
-        oe_mutex_lock(&epoll->lock);
-
         for (int i = 0; i < retval; i++)
         {
             struct oe_epoll_event* const event = &events[i];
-            const mapping_t* const mapping = _map_find(epoll, event->data.fd);
+            uint64_t data;
 
-            if (mapping)
-                event->data.u64 = mapping->event.data.u64;
+            if (_map_lookup(epoll, event->data.fd, &data))
+                event->data.u64 = data;
             else
             {
                 // fd has been deleted between the return of epoll_wait and the
-                // acquisition of the lock.
+                // lookup, or this is the wake eventfd.
                 --retval;
                 *event = events[retval];
                 --i;
@@ -490,9 +1006,133 @@ static int _epoll_wait(
     ret = (int)retval;
 
 done:
-    if (locked)
-        oe_mutex_unlock(&epoll->lock);
+    return ret;
+}
+
+/* Called by oe_epoll_wait(). */
+static int _epoll_wait(
+    oe_fd_t* epoll_,
+    struct oe_epoll_event* events,
+    int maxevents,
+    int timeout)
+{
+    int ret = -1;
+    epoll_t* epoll = _cast_epoll(epoll_);
+    uint64_t deadline = 0;
+    int n = 0;
+    int reserved = 0;
+
+    if (!epoll || !events || maxevents <= 0)
+        OE_RAISE_ERRNO(OE_EINVAL);
+
+    oe_errno = 0;
+
+    if (timeout > 0)
+        deadline = oe_get_time() + (uint64_t)timeout;
+
+    if (maxevents > 1 &&
+        __atomic_load_n(&epoll->num_host_fds, __ATOMIC_ACQUIRE) &&
+        __atomic_add_fetch(&epoll->streak, 1, __ATOMIC_RELAXED) %
+                HOST_POLL_INTERVAL ==
+            0)
+        reserved = 1;
+
+    for (;;)
+    {
+        const bool host_fds =
+            __atomic_load_n(&epoll->num_host_fds, __ATOMIC_ACQUIRE) != 0;
+        int remaining = timeout;
+
+        if ((n = _collect(epoll, events, maxevents - reserved)) == maxevents)
+            break;
+
+        if (n > 0 || timeout == 0)
+        {
+            int host_n;
+
+            if (!host_fds)
+                break;
+
+            if ((host_n = _host_wait(epoll, events + n, maxevents - n, 0)) ==
+                -1)
+            {
+                if (n > 0)
+                    break;
+
+                OE_RAISE_ERRNO(oe_errno);
+            }
+
+            n += host_n;
+            break;
+        }
+
+        if (timeout > 0)
+        {
+            const uint64_t now = oe_get_time();
+
+            if (now >= deadline)
+                break;
 
+            remaining = (int)(deadline - now);
+        }
+
+        if (host_fds)
+        {
+            /* Wait in the host epoll. _watch_queue() writes the wake eventfd
+             * when a watch becomes ready meanwhile. */
+            oe_mutex_lock(&epoll->ready_lock);
+
+            if (epoll->ready_head)
+            {
+                oe_mutex_unlock(&epoll->ready_lock);
+                continue;
+            }
+
+            epoll->host_waiters++;
+            oe_mutex_unlock(&epoll->ready_lock);
+
+            n = _host_wait(epoll, events, maxevents, remaining);
+
+            oe_mutex_lock(&epoll->ready_lock);
+            epoll->host_waiters--;
+            epoll->wake_pending = false;
+            oe_mutex_unlock(&epoll->ready_lock);
+
+            if (n == -1)
+                OE_RAISE_ERRNO(oe_errno);
+
+            if ((n += _collect(epoll, events + n, maxevents - n)) > 0)
+                break;
+        }
+        else
+        {
+            /* Only watches are added, so wait in the enclave. */
+            struct oe_timespec abstime = {
+                .tv_sec = (time_t)(deadline / 1000),
+                .tv_nsec = (long)(deadline % 1000) * 1000000,
+            };
+
+            oe_mutex_lock(&epoll->ready_lock);
+
+            while (!epoll->ready_head &&
+                   !__atomic_load_n(&epoll->num_host_fds, __ATOMIC_ACQUIRE))
+            {
+                if (timeout < 0)
+                    oe_cond_wait(&epoll->ready_cond, &epoll->ready_lock);
+                else if (
+                    oe_cond_timedwait(
+                        &epoll->ready_cond, &epoll->ready_lock, &abstime) ==
+                    OE_TIMEDOUT)
+                    break;
+            }
+
+            oe_mutex_unlock(&epoll->ready_lock);
+        }
+    }
+
+    ret = n;
+
+done:
     return ret;
 }
 
@@ -515,10 +1155,7 @@ static int _epoll_close(oe_fd_t* epoll_)
     if (retval == -1)
         OE_RAISE_ERRNO(oe_errno);
 
-    if (epoll->map)
-        oe_free(epoll->map);
-
-    oe_free(epoll);
+    _epoll_free(epoll);
 
     ret = 0;
 
@@ -783,19 +1420,76 @@ static int _epoll_dup(oe_fd_t* epoll_, oe_fd_t** new_epoll_out)
         new_epoll->base.ops.epoll = _get_epoll_ops();
         new_epoll->magic = EPOLL_MAGIC;
         new_epoll->host_fd = retval;
+        new_epoll->wake_fd = -1;
+
+        oe_mutex_lock(&epoll->lock);
+
+        new_epoll->num_host_fds = epoll->num_host_fds;
 
-        if (epoll->map && epoll->map_size)
+        if (epoll->map)
         {
-            mapping_t* map;
+            const size_t capacity = epoll->map->capacity;
+            map_t* map;
 
-            if (!(map = oe_calloc(epoll->map_size, sizeof(mapping_t))))
+            if (!(map = oe_calloc(
+                      1, sizeof(map_t) + capacity * sizeof(mapping_t))))
+            {
+                oe_mutex_unlock(&epoll->lock);
                 OE_RAISE_ERRNO(OE_ENOMEM);
+            }
 
-            memcpy(map, epoll->map, epoll->map_size * sizeof(mapping_t));
+            map->capacity = capacity;
+            memcpy(
+                map->mappings,
+                epoll->map->mappings,
+                capacity * sizeof(mapping_t));
             new_epoll->map = map;
-            new_epoll->map_size = epoll->map_size;
+
+            /* The watches are not shared with the old epoll object. */
+            for (size_t i = 0; i < capacity; i++)
+            {
+                mapping_t* const mapping = &map->mappings[i];
+                oe_fd_t* desc;
+
+                if (!mapping->in_use || !mapping->watch)
+                    continue;
+
+                /* Like in _watch_free(), a reference keeps the descriptor
+                 * alive while the new watch is added. */
+                oe_mutex_lock(&epoll->ready_lock);
+                desc = mapping->watch->desc;
+                if (desc && !oe_fdtable_ref(desc))
+                    desc = NULL;
+                oe_mutex_unlock(&epoll->ready_lock);
+
+                /* The descriptor is being closed. */
+                if (!desc)
+                {
+                    mapping->in_use = false;
+                    mapping->watch = NULL;
+                    continue;
+                }
+
+                mapping->watch = _watch_new(new_epoll, desc, &mapping->event);
+                oe_fdtable_put(desc);
+
+                if (!mapping->watch)
+                {
+                    /* The remaining watches belong to the old object. */
+                    for (size_t j = i; j < capacity; j++)
+                    {
+                        if (map->mappings[j].watch)
+                            map->mappings[j].in_use = false;
+                    }
+
+                    oe_mutex_unlock(&epoll->lock);
+                    OE_RAISE_ERRNO(oe_errno);
+                }
+            }
         }
 
+        oe_mutex_unlock(&epoll->lock);
+
         *new_epoll_out = &new_epoll->base;
         new_epoll = NULL;
     }
@@ -805,7 +1499,12 @@ static int _epoll_dup(oe_fd_t* epoll_, oe_fd_t** new_epoll_out)
 done:
 
     if (new_epoll)
-        oe_free(new_epoll);
+    {
+        if (new_epoll->host_fd != -1)
+            oe_close_hostfd(new_epoll->host_fd);
+
+        _epoll_free(new_epoll);
+    }
 
     return ret;
 }
@@ -820,13 +1519,19 @@ static void _epoll_on_close(oe_fd_t* epoll_, int fd)
     oe_mutex_lock(&epoll->lock);
 
     /* Delete the mapping if it exists. */
-    for (size_t i = 0; i < epoll->map_size; i++)
     {
-        if (epoll->map[i].fd == fd)
+        mapping_t* const mapping = _map_find(epoll, fd);
+        if (mapping)
         {
-            /* Swap with last element of array. */
-            epoll->map[i] = epoll->map[--epoll->map_size];
-            break;
+            if (mapping->watch)
+            {
+                _watch_free(mapping->watch);
+                mapping->watch = NULL;
+            }
+            else
+                __atomic_sub_fetch(&epoll->num_host_fds, 1, __ATOMIC_RELEASE);
+
+            _map_update(mapping, false, NULL);
         }
     }
 
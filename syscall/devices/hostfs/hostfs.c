@@ -21,6 +21,7 @@
 #include <openenclave/enclave.h>
 // clang-format on
 
+#include <openenclave/internal/calls.h>
 #include <openenclave/internal/syscall/device.h>
 #include <openenclave/internal/thread.h>
 #include <openenclave/internal/syscall/dirent.h>
@@ -78,6 +79,10 @@ typedef struct _file
 
     /* The file descriptor for an open directory if non-null. */
     oe_fd_t* dir;
+
+    /* The status flags shared with dups. Tells whether O_NONBLOCK is set, so
+     * that read() and write() do not block. Null for directory files. */
+    oe_fd_status_t* status;
 } file_t;
 
 /* Created by opendir(), updated by readdir(), closed by closedir(). */
@@ -141,6 +146,11 @@ done:
     return ret;
 }
 
+static bool _is_nonblocking(const file_t* file)
+{
+    return file->status && (oe_fd_status_get(file->status) & OE_O_NONBLOCK);
+}
+
 static dir_t* _cast_dir(const oe_fd_t* desc)
 {
     dir_t* ret = NULL;
@@ -344,6 +354,9 @@ static oe_fd_t* _hostfs_open_file(
         file->base.type = OE_FD_TYPE_FILE;
         file->magic = FILE_MAGIC;
         file->base.ops.file = _get_file_ops();
+
+        if (!(file->status = oe_fd_status_new(flags & OE_O_NONBLOCK)))
+            OE_RAISE_ERRNO(OE_ENOMEM);
     }
 
     /* Ask the host to open the file. */
@@ -366,7 +379,10 @@ static oe_fd_t* _hostfs_open_file(
 done:
 
     if (file)
+    {
+        oe_fd_status_put(file->status);
         oe_free(file);
+    }
 
     return ret;
 }
@@ -473,6 +489,9 @@ static int _hostfs_dup(oe_fd_t* desc, oe_fd_t** new_file_out)
             OE_RAISE_ERRNO(oe_errno);
 
         new_file->host_fd = retval;
+
+        if (file->status)
+            new_file->status = oe_fd_status_ref(file->status);
     }
 
     *new_file_out = &new_file->base;
@@ -496,7 +515,9 @@ static ssize_t _hostfs_read(oe_fd_t* desc, void* buf, size_t count)
         OE_RAISE_ERRNO(OE_EINVAL);
 
     /* Call the host to perform the read(). */
-    if (oe_syscall_read_ocall(&ret, file->host_fd, buf, count) != OE_OK)
+    if (OE_SWITCHLESS_OCALL(
+            _is_nonblocking(file),
+            oe_syscall_read_ocall(&ret, file->host_fd, buf, count)) != OE_OK)
         OE_RAISE_ERRNO(OE_EINVAL);
 
 done:
@@ -557,7 +578,9 @@ static ssize_t _hostfs_write(oe_fd_t* desc, const void* buf, size_t count)
         OE_RAISE_ERRNO(OE_EINVAL);
 
     /* Call the host. */
-    if (oe_syscall_write_ocall(&ret, file->host_fd, buf, count) != OE_OK)
+    if (OE_SWITCHLESS_OCALL(
+            _is_nonblocking(file),
+            oe_syscall_write_ocall(&ret, file->host_fd, buf, count)) != OE_OK)
         OE_RAISE_ERRNO(OE_EINVAL);
 
 done:
@@ -577,28 +600,33 @@ static ssize_t _hostfs_readv(
     if (!file || (!iov && iovcnt) || iovcnt < 0 || iovcnt > OE_IOV_MAX)
         OE_RAISE_ERRNO(OE_EINVAL);
 
-    /* Flatten the IO vector into contiguous heap memory. */
-    if (oe_iov_pack(iov, iovcnt, &buf, &buf_size) != 0)
+    /* Let the host read directly into a staging buffer in host memory. */
+    if (oe_iov_stage(iov, iovcnt, false, &buf, &buf_size) != 0)
         OE_RAISE_ERRNO(OE_ENOMEM);
 
     /* Call the host. */
-    if (oe_syscall_readv_ocall(&ret, file->host_fd, buf, iovcnt, buf_size) !=
-        OE_OK)
+    if (OE_SWITCHLESS_OCALL(
+            _is_nonblocking(file),
+            oe_syscall_read_staged_ocall(
+                &ret, file->host_fd, buf, buf_size)) != OE_OK)
     {
         OE_RAISE_ERRNO(OE_EINVAL);
     }
 
-    /* Synchronize data read with IO vector. */
+    /* Scatter the data read into the IO vector. */
     if (ret > 0)
     {
-        if (oe_iov_sync(iov, iovcnt, buf, buf_size) != 0)
+        if (oe_iov_unstage(iov, iovcnt, buf, buf_size, (size_t)ret) != 0)
+        {
+            ret = -1;
             OE_RAISE_ERRNO(OE_EINVAL);
+        }
     }
 
 done:
 
     if (buf)
-        oe_free(buf);
+        oe_iov_free_stage(buf);
 
     return ret;
 }
@@ -616,21 +644,30 @@ static ssize_t _hostfs_writev(
     if (!file || !iov || iovcnt < 0 || iovcnt > OE_IOV_MAX)
         OE_RAISE_ERRNO(OE_EINVAL);
 
-    /* Flatten the IO vector into contiguous heap memory. */
-    if (oe_iov_pack(iov, iovcnt, &buf, &buf_size) != 0)
+    /* Gather the IO vector into a staging buffer in host memory. */
+    if (oe_iov_stage(iov, iovcnt, true, &buf, &buf_size) != 0)
         OE_RAISE_ERRNO(OE_ENOMEM);
 
     /* Call the host. */
-    if (oe_syscall_writev_ocall(&ret, file->host_fd, buf, iovcnt, buf_size) !=
-        OE_OK)
+    if (OE_SWITCHLESS_OCALL(
+            _is_nonblocking(file),
+            oe_syscall_write_staged_ocall(
+                &ret, file->host_fd, buf, buf_size)) != OE_OK)
+    {
+        OE_RAISE_ERRNO(OE_EINVAL);
+    }
+
+    /* The host cannot have written more than it was given. */
+    if (ret > (ssize_t)buf_size)
     {
+        ret = -1;
         OE_RAISE_ERRNO(OE_EINVAL);
     }
 
 done:
 
     if (buf)
-        oe_free(buf);
+        oe_iov_free_stage(buf);
 
     return ret;
 }
@@ -713,8 +750,11 @@ static ssize_t _hostfs_pread(
     if (!file)
         OE_RAISE_ERRNO(OE_EINVAL);
 
-    if (oe_syscall_pread_ocall(&ret, file->host_fd, buf, count, offset) !=
-        OE_OK)
+    /* Positional I/O needs a seekable file, so it does not block. */
+    if (OE_SWITCHLESS_OCALL(
+            true,
+            oe_syscall_pread_ocall(
+                &ret, file->host_fd, buf, count, offset)) != OE_OK)
         OE_RAISE_ERRNO(OE_EINVAL);
 
 done:
@@ -733,8 +773,10 @@ static ssize_t _hostfs_pwrite(
     if (!file)
         OE_RAISE_ERRNO(OE_EINVAL);
 
-    if (oe_syscall_pwrite_ocall(&ret, file->host_fd, buf, count, offset) !=
-        OE_OK)
+    if (OE_SWITCHLESS_OCALL(
+            true,
+            oe_syscall_pwrite_ocall(
+                &ret, file->host_fd, buf, count, offset)) != OE_OK)
         OE_RAISE_ERRNO(OE_EINVAL);
 
 done:
@@ -756,6 +798,7 @@ static int _hostfs_close_file(oe_fd_t* desc)
     if (retval == -1)
         OE_RAISE_ERRNO(oe_errno);
 
+    oe_fd_status_put(file->status);
     oe_free(file);
 
     ret = retval;
@@ -898,6 +941,9 @@ static int _hostfs_fcntl(oe_fd_t* desc, int cmd, uint64_t arg)
             &ret, file->host_fd, cmd, arg, argsize, argout) != OE_OK)
         OE_RAISE_ERRNO(OE_EINVAL);
 
+    if (cmd == OE_F_SETFL && ret == 0 && file->status)
+        oe_fd_status_set(file->status, (int)arg & OE_O_NONBLOCK);
+
 done:
     return ret;
 }
@@ -1251,6 +1297,7 @@ static oe_file_ops_t _file_ops =
     .fd.fcntl = _hostfs_fcntl,
     .fd.close = _hostfs_close,
     .fd.get_host_fd = _hostfs_get_host_fd,
+    .fd.get_direct_host_fd = _hostfs_get_host_fd,
     .lseek = _hostfs_lseek,
     .pread = _hostfs_pread,
     .pwrite = _hostfs_pwrite,
@@ -7,6 +7,7 @@
 #include <openenclave/enclave.h>
 // clang-format on
 
+#include <openenclave/internal/calls.h>
 #include <openenclave/internal/syscall/device.h>
 #include <openenclave/internal/thread.h>
 #include <openenclave/corelibc/string.h>
@@ -17,6 +18,7 @@
 #include <openenclave/internal/syscall/fd.h>
 #include <openenclave/internal/syscall/iov.h>
 #include <openenclave/internal/syscall/fcntl.h>
+#include <openenclave/internal/syscall/sys/ioctl.h>
 #include <openenclave/corelibc/stdlib.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/safecrt.h>
@@ -51,9 +53,21 @@ sock_t* oe_hostsock_new_sock(void)
     sock->magic = SOCK_MAGIC;
     sock->host_fd = -1;
 
+    if (!(sock->status = oe_fd_status_new(0)))
+    {
+        oe_free(sock);
+        return NULL;
+    }
+
     return sock;
 }
 
+void oe_hostsock_free_sock(sock_t* sock)
+{
+    oe_fd_status_put(sock->status);
+    oe_free(sock);
+}
+
 static device_t* _cast_device(const oe_device_t* device)
 {
     device_t* p = (device_t*)device;
@@ -76,6 +90,13 @@ done:
     return sock;
 }
 
+/* Whether a call with these flags cannot block and may be made switchless. */
+static bool _is_nonblocking(const sock_t* sock, int flags)
+{
+    return (flags & OE_MSG_DONTWAIT) ||
+           (oe_fd_status_get(sock->status) & OE_O_NONBLOCK);
+}
+
 static ssize_t _hostsock_read(oe_fd_t*, void* buf, size_t count);
 
 static int _hostsock_close(oe_fd_t*);
@@ -117,14 +138,17 @@ static oe_fd_t* _hostsock_device_socket(
 
     // EDG: remember flag for internal socket
     if (type & SOCK_NONBLOCK)
+    {
         new_sock->internal.flags = OE_O_NONBLOCK;
+        oe_fd_status_set(new_sock->status, OE_O_NONBLOCK);
+    }
 
     new_sock = NULL;
 
 done:
 
     if (new_sock)
-        oe_free(new_sock);
+        oe_hostsock_free_sock(new_sock);
 
     return ret;
 }
@@ -174,6 +198,12 @@ static ssize_t _hostsock_device_socketpair(
         pair[1]->host_fd = host_sv[1];
     }
 
+    if (type & SOCK_NONBLOCK)
+    {
+        oe_fd_status_set(pair[0]->status, OE_O_NONBLOCK);
+        oe_fd_status_set(pair[1]->status, OE_O_NONBLOCK);
+    }
+
     sv[0] = &pair[0]->base;
     sv[1] = &pair[1]->base;
 
@@ -184,10 +214,10 @@ static ssize_t _hostsock_device_socketpair(
 done:
 
     if (pair[0])
-        oe_free(pair[0]);
+        oe_hostsock_free_sock(pair[0]);
 
     if (pair[1])
-        oe_free(pair[1]);
+        oe_hostsock_free_sock(pair[1]);
 
     return ret;
 }
@@ -302,7 +332,7 @@ static oe_fd_t* _hostsock_accept(
 done:
 
     if (new_sock)
-        oe_free(new_sock);
+        oe_hostsock_free_sock(new_sock);
 
     return ret;
 }
@@ -377,7 +407,10 @@ static ssize_t _hostsock_recv(
             OE_RAISE_ERRNO(OE_EINVAL);
     }
 
-    if (oe_syscall_recv_ocall(&ret, sock->host_fd, buf, count, flags) != OE_OK)
+    if (OE_SWITCHLESS_OCALL(
+            _is_nonblocking(sock, flags),
+            oe_syscall_recv_ocall(
+                &ret, sock->host_fd, buf, count, flags)) != OE_OK)
         OE_RAISE_ERRNO(OE_EINVAL);
 
 done:
@@ -404,15 +437,17 @@ static ssize_t _hostsock_recvfrom(
     if (addrlen)
         addrlen_in = *addrlen;
 
-    if (oe_syscall_recvfrom_ocall(
-            &ret,
-            sock->host_fd,
-            buf,
-            count,
-            flags,
-            (struct oe_sockaddr*)src_addr,
-            addrlen_in,
-            addrlen) != OE_OK)
+    if (OE_SWITCHLESS_OCALL(
+            _is_nonblocking(sock, flags),
+            oe_syscall_recvfrom_ocall(
+                &ret,
+                sock->host_fd,
+                buf,
+                count,
+                flags,
+                (struct oe_sockaddr*)src_addr,
+                addrlen_in,
+                addrlen)) != OE_OK)
     {
         OE_RAISE_ERRNO(OE_EINVAL);
     }
@@ -442,19 +477,21 @@ static ssize_t _hostsock_recvmsg(
 
     /* Call the host. */
     {
-        if (oe_syscall_recvmsg_ocall(
-                &ret,
-                sock->host_fd,
-                msg->msg_name,
-                msg->msg_namelen,
-                &msg->msg_namelen,
-                buf,
-                msg->msg_iovlen,
-                buf_size,
-                msg->msg_control,
-                msg->msg_controllen,
-                &msg->msg_controllen,
-                flags) != OE_OK)
+        if (OE_SWITCHLESS_OCALL(
+                _is_nonblocking(sock, flags),
+                oe_syscall_recvmsg_ocall(
+                    &ret,
+                    sock->host_fd,
+                    msg->msg_name,
+                    msg->msg_namelen,
+                    &msg->msg_namelen,
+                    buf,
+                    msg->msg_iovlen,
+                    buf_size,
+                    msg->msg_control,
+                    msg->msg_controllen,
+                    &msg->msg_controllen,
+                    flags)) != OE_OK)
         {
             OE_RAISE_ERRNO(OE_EINVAL);
         }
@@ -489,7 +526,10 @@ static ssize_t _hostsock_send(
     if (!sock || (count && !buf))
         OE_RAISE_ERRNO(OE_EINVAL);
 
-    if (oe_syscall_send_ocall(&ret, sock->host_fd, buf, count, flags) != OE_OK)
+    if (OE_SWITCHLESS_OCALL(
+            _is_nonblocking(sock, flags),
+            oe_syscall_send_ocall(
+                &ret, sock->host_fd, buf, count, flags)) != OE_OK)
         OE_RAISE_ERRNO(OE_EINVAL);
 
 done:
@@ -512,14 +552,16 @@ static ssize_t _hostsock_sendto(
     if (!sock || (count && !buf))
         OE_RAISE_ERRNO(OE_EINVAL);
 
-    if (oe_syscall_sendto_ocall(
-            &ret,
-            sock->host_fd,
-            buf,
-            count,
-            flags,
-            (struct oe_sockaddr*)dest_addr,
-            addrlen) != OE_OK)
+    if (OE_SWITCHLESS_OCALL(
+            _is_nonblocking(sock, flags),
+            oe_syscall_sendto_ocall(
+                &ret,
+                sock->host_fd,
+                buf,
+                count,
+                flags,
+                (struct oe_sockaddr*)dest_addr,
+                addrlen)) != OE_OK)
     {
         OE_RAISE_ERRNO(OE_EINVAL);
     }
@@ -549,17 +591,19 @@ static ssize_t _hostsock_sendmsg(
         OE_RAISE_ERRNO(OE_ENOMEM);
 
     /* Call the host. */
-    if (oe_syscall_sendmsg_ocall(
-            &ret,
-            sock->host_fd,
-            msg->msg_name,
-            msg->msg_namelen,
-            buf,
-            msg->msg_iovlen,
-            buf_size,
-            msg->msg_control,
-            msg->msg_controllen,
-            flags) != OE_OK)
+    if (OE_SWITCHLESS_OCALL(
+            _is_nonblocking(sock, flags),
+            oe_syscall_sendmsg_ocall(
+                &ret,
+                sock->host_fd,
+                msg->msg_name,
+                msg->msg_namelen,
+                buf,
+                msg->msg_iovlen,
+                buf_size,
+                msg->msg_control,
+                msg->msg_controllen,
+                flags)) != OE_OK)
     {
         OE_RAISE_ERRNO(OE_EINVAL);
     }
@@ -586,7 +630,7 @@ static int _hostsock_close(oe_fd_t* sock_)
         OE_RAISE_ERRNO(OE_EINVAL);
 
     if (ret == 0)
-        oe_free(sock);
+        oe_hostsock_free_sock(sock);
 
 done:
 
@@ -648,6 +692,12 @@ static int _hostsock_fcntl(oe_fd_t* sock_, int cmd, uint64_t arg)
     if (oe_syscall_fcntl_ocall(
             &ret, sock->host_fd, cmd, arg, argsize, argout) != OE_OK)
         OE_RAISE_ERRNO(OE_EINVAL);
+
+    if (cmd == OE_F_SETFL && ret == 0)
+    {
+        sock->internal.flags = (int)arg;
+        oe_fd_status_set(sock->status, (int)arg & OE_O_NONBLOCK);
+    }
 done:
 
     return ret;
@@ -683,6 +733,11 @@ static int _hostsock_dup(oe_fd_t* sock_, oe_fd_t** new_sock_out)
         new_sock->host_fd = retval;
     }
 
+    /* The dup shares the status flags of the host socket. */
+    oe_fd_status_put(new_sock->status);
+    new_sock->status = oe_fd_status_ref(sock->status);
+    new_sock->internal.flags = sock->internal.flags;
+
     *new_sock_out = &new_sock->base;
     new_sock = NULL;
     ret = 0;
@@ -690,7 +745,7 @@ static int _hostsock_dup(oe_fd_t* sock_, oe_fd_t** new_sock_out)
 done:
 
     if (new_sock)
-        oe_free(new_sock);
+        oe_hostsock_free_sock(new_sock);
 
     return ret;
 }
@@ -747,6 +802,10 @@ static int _hostsock_setsockopt(
         OE_RAISE_ERRNO(OE_EINVAL);
     }
 
+    // EDG: remember buffer sizes for internal socket
+    if (ret == 0)
+        oe_internalsock_setsockopt(sock, level, optname, optval, optlen);
+
 done:
 
     return ret;
@@ -762,6 +821,33 @@ static int _hostsock_ioctl(oe_fd_t* sock_, unsigned long request, uint64_t arg)
     if (!sock)
         OE_RAISE_ERRNO(OE_EINVAL);
 
+    /* FIONBIO takes a pointer to an int, which must be copied to the host. It
+     * also changes the status flags, so update the shared ones. */
+    if (request == OE_FIONBIO)
+    {
+        int value;
+
+        if (!arg)
+            OE_RAISE_ERRNO(OE_EFAULT);
+
+        value = *(const int*)arg;
+
+        if (oe_syscall_ioctl_ocall(
+                &ret, sock->host_fd, request, 0, sizeof(value), &value) !=
+            OE_OK)
+            OE_RAISE_ERRNO(OE_EINVAL);
+
+        if (ret == 0)
+        {
+            const int flags = value ? OE_O_NONBLOCK : 0;
+            sock->internal.flags =
+                (sock->internal.flags & ~OE_O_NONBLOCK) | flags;
+            oe_fd_status_set(sock->status, flags);
+        }
+
+        goto done;
+    }
+
     if (oe_syscall_ioctl_ocall(&ret, sock->host_fd, request, arg, 0, NULL) !=
         OE_OK)
         OE_RAISE_ERRNO(OE_EINVAL);
@@ -858,28 +944,33 @@ static ssize_t _hostsock_readv(
     if (!sock || (!iov && iovcnt) || iovcnt < 0 || iovcnt > OE_IOV_MAX)
         OE_RAISE_ERRNO(OE_EINVAL);
 
-    /* Flatten the IO vector into contiguous heap memory. */
-    if (oe_iov_pack(iov, iovcnt, &buf, &buf_size) != 0)
+    /* Let the host read directly into a staging buffer in host memory. */
+    if (oe_iov_stage(iov, iovcnt, false, &buf, &buf_size) != 0)
         OE_RAISE_ERRNO(OE_ENOMEM);
 
     /* Call the host. */
-    if (oe_syscall_recvv_ocall(&ret, sock->host_fd, buf, iovcnt, buf_size) !=
-        OE_OK)
+    if (OE_SWITCHLESS_OCALL(
+            _is_nonblocking(sock, 0),
+            oe_syscall_recv_staged_ocall(
+                &ret, sock->host_fd, buf, buf_size, 0)) != OE_OK)
     {
         OE_RAISE_ERRNO(OE_EINVAL);
     }
 
-    /* Synchronize data read with IO vector. */
+    /* Scatter the data read into the IO vector. */
     if (ret > 0)
     {
-        if (oe_iov_sync(iov, iovcnt, buf, buf_size) != 0)
+        if (oe_iov_unstage(iov, iovcnt, buf, buf_size, (size_t)ret) != 0)
+        {
+            ret = -1;
             OE_RAISE_ERRNO(OE_EINVAL);
+        }
     }
 
 done:
 
     if (buf)
-        oe_free(buf);
+        oe_iov_free_stage(buf);
 
     return ret;
 }
@@ -897,21 +988,30 @@ static ssize_t _hostsock_writev(
     if (!sock || !iov || iovcnt < 0 || iovcnt > OE_IOV_MAX)
         OE_RAISE_ERRNO(OE_EINVAL);
 
-    /* Flatten the IO vector into contiguous heap memory. */
-    if (oe_iov_pack(iov, iovcnt, &buf, &buf_size) != 0)
+    /* Gather the IO vector into a staging buffer in host memory. */
+    if (oe_iov_stage(iov, iovcnt, true, &buf, &buf_size) != 0)
         OE_RAISE_ERRNO(OE_ENOMEM);
 
     /* Call the host. */
-    if (oe_syscall_sendv_ocall(&ret, sock->host_fd, buf, iovcnt, buf_size) !=
-        OE_OK)
+    if (OE_SWITCHLESS_OCALL(
+            _is_nonblocking(sock, 0),
+            oe_syscall_send_staged_ocall(
+                &ret, sock->host_fd, buf, buf_size, 0)) != OE_OK)
     {
         OE_RAISE_ERRNO(OE_EINVAL);
     }
 
+    /* The host cannot have written more than it was given. */
+    if (ret > (ssize_t)buf_size)
+    {
+        ret = -1;
+        OE_RAISE_ERRNO(OE_EINVAL);
+    }
+
 done:
 
     if (buf)
-        oe_free(buf);
+        oe_iov_free_stage(buf);
 
     return ret;
 }
@@ -970,6 +1070,7 @@ static oe_socket_ops_t _sock_ops = {
     .fd.readv = _hostsock_readv,
     .fd.writev = _hostsock_writev,
     .fd.get_host_fd = _hostsock_get_host_fd,
+    .fd.get_direct_host_fd = _hostsock_get_host_fd,
     .fd.close = _hostsock_close,
     .accept = _hostsock_accept,
     .bind = _hostsock_bind,
@@ -5,8 +5,16 @@
 The internal sockets transfer data between each other without leaving the
 enclave. A socket becomes internal by being bound or connected to any port on
 255.0.0.1. These sockets than behave as usal.
-To support waiting on nonblocking sockets, the internal socket will create an
-eventfd if any poller requests its host fd.
+The readiness of a socket is tracked in enclave memory:
+- epoll watches the socket through get_events and watch (see fd.h). Sending
+  and receiving notify the watches, so epoll_wait() does not need the host.
+- poll() waits on the host fd. The internal socket creates an eventfd when its
+  host fd is requested and from then on keeps it readable exactly while the
+  socket is.
+Each direction of a connection has a ring buffer that starts small and grows
+up to SO_RCVBUF of the receiver plus SO_SNDBUF of the sender. A blocking send
+that does not fit into it hands the rest over by reference: the receivers copy
+it directly from the memory of the sender, which waits until it is consumed.
 */
 
 #include <openenclave/corelibc/assert.h>
@@ -39,6 +47,8 @@ static ssize_t _sock_write(oe_fd_t* sock_, const void* buf, size_t count);
 STUBS(readv)
 STUBS(writev)
 static oe_host_fd_t _sock_get_host_fd(oe_fd_t* sock_);
+static uint32_t _sock_get_events(oe_fd_t* sock_);
+static void _sock_watch(oe_fd_t* sock_, oe_fd_watch_t* watch, bool add);
 static int _sock_close(oe_fd_t* sock_);
 static oe_fd_t* _sock_accept(
     oe_fd_t* sock_,
@@ -47,7 +57,12 @@ static oe_fd_t* _sock_accept(
 STUB(bind)
 static int _sock_listen(oe_fd_t* sock_, int backlog);
 static int _sock_shutdown(oe_fd_t* sock_, int how);
-STUB(getsockopt)
+static int _sock_getsockopt(
+    oe_fd_t* sock_,
+    int level,
+    int optname,
+    void* optval,
+    oe_socklen_t* optlen);
 static int _sock_setsockopt(
     oe_fd_t* sock_,
     int level,
@@ -91,12 +106,14 @@ static oe_socket_ops_t _sock_ops = {
     .fd.readv = _stub_readv,
     .fd.writev = _stub_writev,
     .fd.get_host_fd = _sock_get_host_fd,
+    .fd.get_events = _sock_get_events,
+    .fd.watch = _sock_watch,
     .fd.close = _sock_close,
     .accept = _sock_accept,
     .bind = _stub_bind,
     .listen = _sock_listen,
     .shutdown = _sock_shutdown,
-    .getsockopt = _stub_getsockopt,
+    .getsockopt = _sock_getsockopt,
     .setsockopt = _sock_setsockopt,
     .getpeername = _sock_getsockname,
     .getsockname = _sock_getsockname,
@@ -109,6 +126,23 @@ static oe_socket_ops_t _sock_ops = {
     .connect = _stub_connect,
 };
 
+// Defaults of SO_SNDBUF and SO_RCVBUF like TCP on Linux.
+// cat /proc/sys/net/ipv4/tcp_wmem /proc/sys/net/ipv4/tcp_rmem
+#define SNDBUF_DEFAULT 16384
+#define RCVBUF_DEFAULT 131072
+
+// Limits of SO_SNDBUF and SO_RCVBUF, which bound the enclave memory used by
+// a connection.
+#define BUFSIZE_MIN 4096
+#define BUFSIZE_MAX (8 * 1024 * 1024)
+
+// Initial size of the ring buffer of each direction.
+#define RING_SIZE 16384
+
+// Sends of at least this size that do not fit into the ring buffer are handed
+// over by reference.
+#define DIRECT_MIN 65536
+
 static const uint32_t _ipaddr = 0xFF000001;      // 255.0.0.1
 static const uint16_t _client_port = 1024;       // >= 1024 to satisfy test
 static internalsock_boundsock_t* _bound_sockets; // linked list
@@ -150,41 +184,205 @@ static internalsock_boundsock_t* _find_bound_socket(uint16_t port)
     return p;
 }
 
+// Returns the buffer that the socket reads from, or null if the socket is
+// neither bound nor connected.
+static internalsock_buffer_t* _get_read_buffer(sock_t* sock)
+{
+    oe_assert(sock);
+
+    if (sock->internal.connection)
+        return &sock->internal.connection->buf[sock->internal.side];
+    if (sock->internal.boundsock)
+        return &sock->internal.boundsock->backlog;
+    return NULL;
+}
+
+// caller must hold buffer->mutex
+static bool _is_readable(const internalsock_buffer_t* buffer)
+{
+    oe_assert(buffer);
+    return buffer->hangup || buffer->direct ||
+           (buffer->buf && !oe_ringbuffer_empty(buffer->buf));
+}
+
+// caller must hold buffer->mutex
+// Reads the ring buffer and then the payload of a blocked sender.
+static size_t _buffer_read(
+    internalsock_buffer_t* buffer,
+    void* data,
+    size_t size)
+{
+    oe_assert(buffer);
+
+    size_t n = oe_ringbuffer_read(buffer->buf, data, size);
+
+    if (n < size && buffer->direct)
+    {
+        size_t direct_n = size - n;
+        if (direct_n > buffer->direct_size)
+            direct_n = buffer->direct_size;
+
+        memcpy((uint8_t*)data + n, buffer->direct, direct_n);
+        n += direct_n;
+
+        buffer->direct += direct_n;
+        buffer->direct_size -= direct_n;
+        if (!buffer->direct_size)
+            buffer->direct = NULL; // tells the sender that it is done
+    }
+
+    return n;
+}
+
 // caller must hold buffer->mutex
-// Updates the eventfds of the sockets associated with this buffer so that
-// threads waiting on these sockets wake up if data is available to read.
-static void _update_events(internalsock_buffer_t* buffer, bool force_notify)
+// Writes to the ring buffer. A full ring buffer grows up to its limit.
+static size_t _buffer_write(
+    internalsock_buffer_t* buffer,
+    const void* data,
+    size_t size)
 {
     oe_assert(buffer);
-    const bool needs_notification =
-        force_notify || !oe_ringbuffer_empty(buffer->buf);
+
+    const size_t n = oe_ringbuffer_write(buffer->buf, data, size);
+    if (n == size)
+        return n;
+
+    const size_t capacity = oe_ringbuffer_capacity(buffer->buf);
+    const size_t limit = buffer->rcvbuf + buffer->sndbuf;
+    if (capacity >= limit)
+        return n;
+
+    // The ring buffer is full, so this much is needed for the rest.
+    size_t new_capacity = capacity + (size - n);
+    if (new_capacity < capacity * 2)
+        new_capacity = capacity * 2;
+    if (new_capacity > limit)
+        new_capacity = limit;
+
+    // If this fails, the sender waits for the receiver as usual.
+    oe_ringbuffer_t* const rb =
+        oe_ringbuffer_resize(buffer->buf, new_capacity);
+    if (!rb)
+        return n;
+    buffer->buf = rb;
+
+    return n + oe_ringbuffer_write(rb, (const uint8_t*)data + n, size - n);
+}
+
+// Returns the value of SO_SNDBUF or SO_RCVBUF like Linux does, which doubles
+// the requested size to allow for bookkeeping overhead.
+static size_t _bufsize(int value)
+{
+    if (value > BUFSIZE_MAX / 2)
+        return BUFSIZE_MAX;
+    if (value < BUFSIZE_MIN / 2)
+        return BUFSIZE_MIN;
+    return (size_t)value * 2;
+}
+
+static size_t _get_sndbuf(const sock_t* sock)
+{
+    return sock->internal.sndbuf ? sock->internal.sndbuf : SNDBUF_DEFAULT;
+}
+
+static size_t _get_rcvbuf(const sock_t* sock)
+{
+    return sock->internal.rcvbuf ? sock->internal.rcvbuf : RCVBUF_DEFAULT;
+}
+
+void oe_internalsock_setsockopt(
+    sock_t* sock,
+    int level,
+    int optname,
+    const void* optval,
+    oe_socklen_t optlen)
+{
+    oe_assert(sock);
+
+    if (level != OE_SOL_SOCKET || !optval || optlen != sizeof(int))
+        return;
+
+    if (optname == OE_SO_SNDBUF)
+        sock->internal.sndbuf = _bufsize(*(const int*)optval);
+    else if (optname == OE_SO_RCVBUF)
+        sock->internal.rcvbuf = _bufsize(*(const int*)optval);
+}
+
+// Sets SO_SNDBUF or SO_RCVBUF of a connected socket. They are kept in the
+// buffer that the socket writes to or reads from, respectively, so that dup()ed
+// sockets share them.
+static void _set_bufsize(sock_t* sock, int optname, size_t value)
+{
+    oe_assert(sock);
+
+    const con_t con = _get_con(sock);
+    internalsock_buffer_t* const buffer =
+        optname == OE_SO_SNDBUF ? con.other : con.self;
+
+    oe_mutex_lock(&buffer->mutex);
+
+    if (optname == OE_SO_SNDBUF)
+        buffer->sndbuf = value;
+    else
+        buffer->rcvbuf = value;
+
+    // a sender may be waiting for space
+    oe_cond_broadcast(&buffer->cond);
+
+    oe_mutex_unlock(&buffer->mutex);
+}
+
+// caller must hold the mutex of the socket's read buffer
+// Updates the eventfd of the socket if it has been passed to poll().
+static void _update_event(sock_t* sock, bool readable)
+{
+    oe_assert(sock);
+
+    bool* const notified = &sock->internal.event_notified;
+
+    if (sock->host_fd < 0 || !sock->internal.polled)
+        return;
+
+    if (readable)
+    {
+        if (*notified)
+            return;
+
+        const int res = oe_host_eventfd_write(sock->host_fd, 1);
+        oe_assert(res == 0);
+        (void)res;
+        *notified = true;
+    }
+    else if (*notified)
+    {
+        oe_eventfd_t value = 0;
+        const int res = oe_host_eventfd_read(sock->host_fd, &value);
+        oe_assert(res == 0 && value > 0);
+        (void)res;
+        *notified = false;
+    }
+}
+
+// caller must hold buffer->mutex
+// Updates the eventfds and notifies the epoll watches of the sockets associated
+// with this buffer so that threads waiting on these sockets wake up if data is
+// available to read.
+static void _update_events(internalsock_buffer_t* buffer)
+{
+    oe_assert(buffer);
+    const bool readable = _is_readable(buffer);
 
     for (size_t i = 0; i < OE_COUNTOF(buffer->socks); ++i)
     {
         sock_t* const sock = buffer->socks[i];
-        if (!sock || sock->host_fd < 0)
+        if (!sock)
             continue;
 
-        bool* const notified = &sock->internal.event_notified;
+        _update_event(sock, readable);
 
-        if (needs_notification)
-        {
-            // Even if the eventfd is already notified, it must be notified
-            // again because the poller might be edge-triggered (see
-            // http://man7.org/linux/man-pages/man7/epoll.7.html).
-            const int res = oe_host_eventfd_write(sock->host_fd, 1);
-            oe_assert(res == 0);
-            (void)res;
-            *notified = true;
-        }
-        else if (*notified)
-        {
-            oe_eventfd_t value = 0;
-            const int res = oe_host_eventfd_read(sock->host_fd, &value);
-            oe_assert(res == 0 && value > 0);
-            (void)res;
-            *notified = false;
-        }
+        if (readable)
+            for (oe_fd_watch_t* w = sock->internal.watches; w; w = w->next)
+                w->notify(w, false);
     }
 }
 
@@ -192,28 +390,29 @@ static internalsock_connection_t* _connection_alloc(sock_t* sock)
 {
     oe_assert(sock && sock->internal.side == CONNECTION_CLIENT);
 
-    // This is the default write buffer size on Linux.
-    // cat /proc/sys/net/ipv4/tcp_wmem
-    // Not sure if this is the best value to use here.
-    const size_t buffer_size = 16384;
-
     internalsock_connection_t* const res = oe_calloc(1, sizeof *res);
     if (!res)
         return NULL;
 
-    if (!(res->buf[0].buf = oe_ringbuffer_alloc(buffer_size)))
+    if (!(res->buf[0].buf = oe_ringbuffer_alloc(RING_SIZE)))
     {
         oe_free(res);
         return NULL;
     }
 
-    if (!(res->buf[1].buf = oe_ringbuffer_alloc(buffer_size)))
+    if (!(res->buf[1].buf = oe_ringbuffer_alloc(RING_SIZE)))
     {
         oe_ringbuffer_free(res->buf[0].buf);
         oe_free(res);
         return NULL;
     }
 
+    // The server side uses the defaults until it is accepted.
+    res->buf[CONNECTION_CLIENT].rcvbuf = _get_rcvbuf(sock);
+    res->buf[CONNECTION_CLIENT].sndbuf = SNDBUF_DEFAULT;
+    res->buf[CONNECTION_SERVER].rcvbuf = RCVBUF_DEFAULT;
+    res->buf[CONNECTION_SERVER].sndbuf = _get_sndbuf(sock);
+
     res->buf[CONNECTION_CLIENT].refcount = 1;
     res->buf[CONNECTION_CLIENT].socks[0] = sock;
     return res;
@@ -307,10 +506,16 @@ static void _connection_remove(sock_t* sock)
         return;
     }
 
+    // wake senders of the other side, which stop sending now
+    oe_mutex_lock(&con.self->mutex);
+    oe_cond_broadcast(&con.self->cond);
+    oe_mutex_unlock(&con.self->mutex);
+
     // notify other side of the connection
     oe_mutex_lock(&con.other->mutex);
+    con.other->hangup = true;
     oe_cond_broadcast(&con.other->cond);
-    _update_events(con.other, true);
+    _update_events(con.other);
     oe_mutex_unlock(&con.other->mutex);
 }
 
@@ -426,7 +631,7 @@ oe_result_t oe_internalsock_connect(
 
     // notify listener that a new connection is available
     oe_cond_signal(&bound->backlog.cond);
-    _update_events(&bound->backlog, false);
+    _update_events(&bound->backlog);
 
     result = OE_OK;
 
@@ -457,7 +662,10 @@ static int _sock_dup(oe_fd_t* sock_, oe_fd_t** new_sock_out)
 
     *new_sock = *sock;
     new_sock->host_fd = -1;
+    oe_fd_status_ref(new_sock->status);
     new_sock->internal.event_notified = false;
+    new_sock->internal.polled = false;
+    new_sock->internal.watches = NULL;
     _connection_add(new_sock, true);
     *new_sock_out = (oe_fd_t*)new_sock;
 
@@ -477,10 +685,12 @@ static int _sock_fcntl(oe_fd_t* sock_, int cmd, uint64_t arg)
     switch (cmd)
     {
         case OE_F_GETFL:
-            result = sock->internal.flags;
+            result = (sock->internal.flags & ~OE_O_NONBLOCK) |
+                     oe_fd_status_get(sock->status);
             break;
         case OE_F_SETFL:
             sock->internal.flags = (int)arg;
+            oe_fd_status_set(sock->status, (int)arg & OE_O_NONBLOCK);
             result = 0;
             break;
         default:
@@ -501,23 +711,88 @@ static ssize_t _sock_write(oe_fd_t* sock_, const void* buf, size_t count)
     return _sock_sendto(sock_, buf, count, 0, NULL, 0);
 }
 
+// Called by poll(), which waits on the eventfd without telling when it stops.
 static oe_host_fd_t _sock_get_host_fd(oe_fd_t* sock_)
 {
     oe_assert(sock_);
     sock_t* const sock = (sock_t*)sock_;
+    internalsock_buffer_t* const buffer = _get_read_buffer(sock);
+
+    if (buffer)
+        oe_mutex_lock(&buffer->mutex);
 
     if (sock->host_fd == -1)
-    {
         sock->host_fd = oe_host_eventfd(0, 0);
 
-        if (sock->internal.connection)
-            _update_events(
-                &sock->internal.connection->buf[sock->internal.side], false);
+    sock->internal.polled = true;
+
+    if (buffer)
+    {
+        _update_event(sock, _is_readable(buffer));
+        oe_mutex_unlock(&buffer->mutex);
     }
 
     return sock->host_fd;
 }
 
+// Called by epoll_wait().
+static uint32_t _sock_get_events(oe_fd_t* sock_)
+{
+    oe_assert(sock_);
+    sock_t* const sock = (sock_t*)sock_;
+    internalsock_buffer_t* const buffer = _get_read_buffer(sock);
+    uint32_t events = 0;
+
+    if (!buffer)
+        return 0;
+
+    oe_mutex_lock(&buffer->mutex);
+
+    if (_is_readable(buffer))
+        events |= OE_EPOLLIN;
+    if (buffer->hangup)
+        events |= OE_EPOLLRDHUP;
+
+    oe_mutex_unlock(&buffer->mutex);
+
+    // send() blocks instead of failing with EAGAIN, so a connected socket is
+    // always writable.
+    if (sock->internal.connection)
+        events |= OE_EPOLLOUT;
+
+    return events;
+}
+
+// Called by epoll_ctl().
+static void _sock_watch(oe_fd_t* sock_, oe_fd_watch_t* watch, bool add)
+{
+    oe_assert(sock_);
+    oe_assert(watch);
+    sock_t* const sock = (sock_t*)sock_;
+    internalsock_buffer_t* const buffer = _get_read_buffer(sock);
+
+    if (buffer)
+        oe_mutex_lock(&buffer->mutex);
+
+    if (add)
+    {
+        watch->next = sock->internal.watches;
+        sock->internal.watches = watch;
+    }
+    else
+    {
+        for (oe_fd_watch_t** p = &sock->internal.watches; *p; p = &(*p)->next)
+            if (*p == watch)
+            {
+                *p = watch->next;
+                break;
+            }
+    }
+
+    if (buffer)
+        oe_mutex_unlock(&buffer->mutex);
+}
+
 static void _free_boundsock(internalsock_boundsock_t* bound)
 {
     if (!bound)
@@ -578,6 +853,21 @@ static int _sock_close(oe_fd_t* sock_)
     // socket can be either bound or connected
     oe_assert(!sock->internal.boundsock != !sock->internal.connection);
 
+    // Detach the epoll watches before the buffers go away. The epolls do not
+    // call get_events anymore when notify returns.
+    internalsock_buffer_t* const buffer = _get_read_buffer(sock);
+    oe_mutex_lock(&buffer->mutex);
+    oe_fd_watch_t* watch = sock->internal.watches;
+    sock->internal.watches = NULL;
+    oe_mutex_unlock(&buffer->mutex);
+
+    while (watch)
+    {
+        oe_fd_watch_t* const next = watch->next;
+        watch->notify(watch, true);
+        watch = next;
+    }
+
     _free_boundsock(sock->internal.boundsock);
     _connection_remove(sock);
 
@@ -589,7 +879,7 @@ static int _sock_close(oe_fd_t* sock_)
         (void)res;
     }
 
-    oe_free(sock);
+    oe_hostsock_free_sock(sock);
 
     return 0;
 }
@@ -614,7 +904,7 @@ static oe_fd_t* _sock_accept(
     if (!bound->backlog.buf)
         OE_RAISE_ERRNO(OE_EINVAL); // not listening
 
-    const bool block = !(sock->internal.flags & OE_O_NONBLOCK);
+    const bool block = !(oe_fd_status_get(sock->status) & OE_O_NONBLOCK);
 
     sock_t* const newsock = oe_hostsock_new_sock();
     if (!newsock)
@@ -622,6 +912,8 @@ static oe_fd_t* _sock_accept(
 
     newsock->base.ops.socket = _sock_ops;
     newsock->internal.side = CONNECTION_SERVER;
+    newsock->internal.sndbuf = sock->internal.sndbuf;
+    newsock->internal.rcvbuf = sock->internal.rcvbuf;
 
     internalsock_connection_t* con = NULL;
 
@@ -637,7 +929,7 @@ static oe_fd_t* _sock_accept(
     if (bytes_read)
     {
         oe_assert(bytes_read == sizeof con);
-        _update_events(&bound->backlog, false);
+        _update_events(&bound->backlog);
     }
 
     oe_mutex_unlock(&bound->backlog.mutex);
@@ -651,6 +943,8 @@ static oe_fd_t* _sock_accept(
     oe_assert(con);
     newsock->internal.connection = con;
     _connection_add(newsock, false);
+    _set_bufsize(newsock, OE_SO_SNDBUF, _get_sndbuf(newsock));
+    _set_bufsize(newsock, OE_SO_RCVBUF, _get_rcvbuf(newsock));
 
     if (addr)
     {
@@ -734,7 +1028,6 @@ static int _sock_setsockopt(
     oe_socklen_t optlen)
 {
     oe_assert(sock_);
-    (void)sock_;
     int result = -1;
 
     if (level == OE_SOL_SOCKET && optname == OE_SO_KEEPALIVE && optval &&
@@ -744,6 +1037,20 @@ static int _sock_setsockopt(
         // so we don't have to do anything.
         result = 0;
     }
+    else if (
+        level == OE_SOL_SOCKET &&
+        (optname == OE_SO_SNDBUF || optname == OE_SO_RCVBUF) && optval &&
+        optlen == sizeof(int))
+    {
+        sock_t* const sock = (sock_t*)sock_;
+
+        if (sock->internal.connection)
+            _set_bufsize(sock, optname, _bufsize(*(const int*)optval));
+        else
+            oe_internalsock_setsockopt(sock, level, optname, optval, optlen);
+
+        result = 0;
+    }
     else
         OE_RAISE_ERRNO(OE_ENOSYS);
 
@@ -751,6 +1058,48 @@ done:
     return result;
 }
 
+static int _sock_getsockopt(
+    oe_fd_t* sock_,
+    int level,
+    int optname,
+    void* optval,
+    oe_socklen_t* optlen)
+{
+    oe_assert(sock_);
+    const sock_t* const sock = (sock_t*)sock_;
+    int result = -1;
+
+    if (level != OE_SOL_SOCKET ||
+        (optname != OE_SO_SNDBUF && optname != OE_SO_RCVBUF))
+        OE_RAISE_ERRNO(OE_ENOSYS);
+
+    if (!optval || !optlen || *optlen < sizeof(int))
+        OE_RAISE_ERRNO(OE_EINVAL);
+
+    size_t value;
+
+    if (sock->internal.connection)
+    {
+        // the options of a connected socket are kept in the buffers
+        const con_t con = _get_con((sock_t*)sock);
+        internalsock_buffer_t* const buffer =
+            optname == OE_SO_SNDBUF ? con.other : con.self;
+
+        oe_mutex_lock(&buffer->mutex);
+        value = optname == OE_SO_SNDBUF ? buffer->sndbuf : buffer->rcvbuf;
+        oe_mutex_unlock(&buffer->mutex);
+    }
+    else
+        value = optname == OE_SO_SNDBUF ? _get_sndbuf(sock) : _get_rcvbuf(sock);
+
+    *(int*)optval = (int)value;
+    *optlen = sizeof(int);
+    result = 0;
+
+done:
+    return result;
+}
+
 static int _sock_getsockname(
     oe_fd_t* sock_,
     struct oe_sockaddr* addr,
@@ -828,19 +1177,19 @@ static ssize_t _sock_recvfrom(
 
     sock_t* const sock = (sock_t*)sock_;
     const con_t con = _get_con(sock);
-    const bool block = !(sock->internal.flags & OE_O_NONBLOCK);
+    const bool block = !(oe_fd_status_get(sock->status) & OE_O_NONBLOCK);
 
     oe_mutex_lock(&con.self->mutex);
 
     size_t bytes_read;
-    while (!(bytes_read = oe_ringbuffer_read(con.self->buf, buf, count)) &&
-           block && _get_refcount(sock->internal.connection, con.other))
+    while (!(bytes_read = _buffer_read(con.self, buf, count)) && block &&
+           _get_refcount(sock->internal.connection, con.other))
         oe_cond_wait(&con.self->cond, &con.self->mutex);
 
     if (bytes_read)
     {
         oe_cond_broadcast(&con.self->cond);
-        _update_events(con.self, false);
+        _update_events(con.self);
         oe_assert(bytes_read <= OE_SSIZE_MAX);
         result = (ssize_t)bytes_read;
     }
@@ -871,6 +1220,7 @@ static ssize_t _sock_sendto(
         count = OE_SSIZE_MAX;
 
     size_t written = 0;
+    bool direct = false; // the rest is handed over by reference
     ssize_t result = -1;
 
     oe_mutex_lock(&con.other->mutex);
@@ -886,20 +1236,57 @@ static ssize_t _sock_sendto(
 
     for (;;)
     {
+        // The receivers reset direct when they have consumed the payload.
+        if (direct && !con.other->direct)
+        {
+            written = count;
+            break;
+        }
+
+        // If the receiver has been closed, report the bytes that it has
+        // accepted so far like a partial write.
         if (!_get_refcount(sock->internal.connection, con.other))
-            OE_RAISE_ERRNO(OE_EPIPE);
-        written += oe_ringbuffer_write(
-            con.other->buf, (uint8_t*)buf + written, count - written);
-        oe_cond_broadcast(&con.other->cond);
-        _update_events(con.other, false);
-        if (written == count)
+        {
+            if (direct)
+                written = count - con.other->direct_size;
+            if (!written)
+                OE_RAISE_ERRNO(OE_EPIPE);
             break;
+        }
+
+        // Wait while the payload of another sender is pending so that the
+        // receivers get the data in order.
+        if (!direct && !con.other->direct)
+        {
+            written += _buffer_write(
+                con.other, (uint8_t*)buf + written, count - written);
+
+            if (count - written >= DIRECT_MIN)
+            {
+                con.other->direct = (uint8_t*)buf + written;
+                con.other->direct_size = count - written;
+                direct = true;
+            }
+
+            oe_cond_broadcast(&con.other->cond);
+            _update_events(con.other);
+            if (written == count)
+                break;
+        }
+
         oe_cond_wait(&con.other->cond, &con.other->mutex);
     }
 
-    result = (ssize_t)count;
+    result = (ssize_t)written;
 
 done:
+    // The receiver has been closed before consuming the payload.
+    if (direct && con.other->direct)
+    {
+        con.other->direct = NULL;
+        con.other->direct_size = 0;
+    }
+
     oe_mutex_unlock(&con.other->mutex);
     return result;
 }
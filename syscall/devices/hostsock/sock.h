@@ -18,6 +18,20 @@ typedef struct _internalsock_buffer
     oe_mutex_t mutex;
     oe_cond_t cond;
 
+    // The readiness of the buffer is tracked here. It is only mirrored to the
+    // eventfds of the sockets that have been passed to poll().
+    bool hangup; // the writing side of the connection has been closed
+
+    // buf grows up to the sum of these, which are SO_RCVBUF of the reading and
+    // SO_SNDBUF of the writing sockets.
+    size_t rcvbuf;
+    size_t sndbuf;
+
+    // The rest of a large send that did not fit into buf. Readers copy it from
+    // the memory of the blocked sender after the contents of buf.
+    const uint8_t* direct;
+    size_t direct_size;
+
     // This array contains either client or server or bound sockets, but not
     // mixed types. Usually it contains only one socket, but there may be
     // dup()ed sockets. The array size can be increased or made dynamic if we
@@ -50,6 +64,9 @@ typedef struct _sock
     uint32_t magic;
     oe_host_fd_t host_fd;
 
+    // status flags of the host socket, shared with its dups
+    oe_fd_status_t* status;
+
     struct
     {
         // used if the socket is bound internally; otherwise null
@@ -60,13 +77,26 @@ typedef struct _sock
 
         internalsock_connection_side_t side; // client or server
         int flags;                           // set by fcntl()
-        bool event_notified; // state of the eventfd referred by host_fd
+        bool event_notified;    // state of the eventfd referred by host_fd
+        bool polled;            // host_fd has been passed to poll()
+        oe_fd_watch_t* watches; // epolls watching the socket
+        size_t sndbuf;          // SO_SNDBUF until connected; 0 if not set
+        size_t rcvbuf;          // SO_RCVBUF until connected; 0 if not set
     } internal;
 } sock_t;
 
 sock_t* oe_hostsock_new_sock(void);
+void oe_hostsock_free_sock(sock_t* sock);
 
 oe_result_t oe_internalsock_bind(sock_t* sock, const struct oe_sockaddr* addr);
 oe_result_t oe_internalsock_connect(
     sock_t* sock,
     const struct oe_sockaddr* addr);
+
+// Remembers the options of a host socket that apply to internal sockets.
+void oe_internalsock_setsockopt(
+    sock_t* sock,
+    int level,
+    int optname,
+    const void* optval,
+    oe_socklen_t optlen);
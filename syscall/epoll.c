@@ -73,17 +73,25 @@ done:
 int oe_epoll_ctl(int epfd, int op, int fd, struct oe_epoll_event* event)
 {
     int ret = -1;
-    oe_fd_t* epoll;
+    oe_fd_t* epoll = NULL;
+    oe_fd_t* desc = NULL;
 
     if (!(epoll = oe_fdtable_get(epfd, OE_FD_TYPE_EPOLL)))
         OE_RAISE_ERRNO(oe_errno);
 
-    if (!oe_fdtable_get(fd, OE_FD_TYPE_ANY))
+    if (!(desc = oe_fdtable_get(fd, OE_FD_TYPE_ANY)))
         OE_RAISE_ERRNO(oe_errno);
 
     ret = epoll->ops.epoll.epoll_ctl(epoll, op, fd, event);
 
 done:
+
+    if (desc)
+        oe_fdtable_put(desc);
+
+    if (epoll)
+        oe_fdtable_put(epoll);
+
     return ret;
 }
 
@@ -94,7 +102,7 @@ int oe_epoll_wait(
     int timeout)
 {
     int ret = -1;
-    oe_fd_t* epoll;
+    oe_fd_t* epoll = NULL;
 
     if (!(epoll = oe_fdtable_get(epfd, OE_FD_TYPE_EPOLL)))
         OE_RAISE_ERRNO(oe_errno);
@@ -103,6 +111,9 @@ int oe_epoll_wait(
 
 done:
 
+    if (epoll)
+        oe_fdtable_put(epoll);
+
     return ret;
 }
 
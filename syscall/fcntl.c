@@ -3,6 +3,7 @@
 
 #include <openenclave/corelibc/errno.h>
 #include <openenclave/corelibc/limits.h>
+#include <openenclave/corelibc/stdlib.h>
 #include <openenclave/internal/syscall/device.h>
 #include <openenclave/internal/syscall/fcntl.h>
 #include <openenclave/internal/syscall/fdtable.h>
@@ -12,10 +13,46 @@
 #include "mount.h"
 #include "syscall_t.h"
 
+oe_fd_status_t* oe_fd_status_new(int flags)
+{
+    oe_fd_status_t* status;
+
+    if ((status = oe_calloc(1, sizeof(*status))))
+    {
+        status->refcount = 1;
+        status->flags = flags;
+    }
+
+    return status;
+}
+
+oe_fd_status_t* oe_fd_status_ref(oe_fd_status_t* status)
+{
+    __atomic_add_fetch(&status->refcount, 1, __ATOMIC_RELAXED);
+    return status;
+}
+
+void oe_fd_status_put(oe_fd_status_t* status)
+{
+    if (status &&
+        __atomic_sub_fetch(&status->refcount, 1, __ATOMIC_ACQ_REL) == 0)
+        oe_free(status);
+}
+
+int oe_fd_status_get(const oe_fd_status_t* status)
+{
+    return __atomic_load_n(&status->flags, __ATOMIC_RELAXED);
+}
+
+void oe_fd_status_set(oe_fd_status_t* status, int flags)
+{
+    __atomic_store_n(&status->flags, flags, __ATOMIC_RELAXED);
+}
+
 int __oe_fcntl(int fd, int cmd, uint64_t arg)
 {
     int ret = -1;
-    oe_fd_t* desc;
+    oe_fd_t* desc = NULL;
 
     if (cmd == OE_F_DUPFD)
     {
@@ -28,6 +65,10 @@ int __oe_fcntl(int fd, int cmd, uint64_t arg)
     ret = desc->ops.fd.fcntl(desc, cmd, arg);
 
 done:
+
+    if (desc)
+        oe_fdtable_put(desc);
+
     return ret;
 }
 
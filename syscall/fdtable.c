@@ -23,65 +23,91 @@
 **
 ** Local definitions:
 **
+** The table is a fixed directory of chunks. Chunks are allocated when the
+** table grows and are never moved, so lookups read the table without taking
+** the lock. Writers are serialized by the lock.
+**
+** Each descriptor has a reference count. The table holds one reference, and
+** oe_fdtable_get() takes another one that oe_fdtable_put() drops. The last
+** oe_fdtable_put() closes the descriptor. Before that, it waits until all
+** lookups that may have read the descriptor from the table have finished (see
+** _synchronize()), so a lookup never touches a closed descriptor.
+**
 **==============================================================================
 */
 
-/* The table allocation grows in multiples of the chunk size. */
+/* The table grows in multiples of the chunk size. */
 #define TABLE_CHUNK_SIZE 1024
 
+/* The table holds at most TABLE_MAX_CHUNKS * TABLE_CHUNK_SIZE descriptors. */
+#define TABLE_MAX_CHUNKS 1024
+
+/* Lookups are counted in per-thread shards to avoid a shared cache line. */
+#define READER_SHARDS 64
+
 /* Define a table of file-descriptors. */
 typedef oe_fd_t* entry_t;
-static entry_t* _table;
-static size_t _table_size;
+static entry_t* _chunks[TABLE_MAX_CHUNKS];
+static size_t _num_chunks;
+static bool _initialized;
+
+/* Serializes the writers. No free entry is below _lowest_free. */
 static oe_spinlock_t _lock = OE_SPINLOCK_INITIALIZER;
+static size_t _lowest_free;
+
+/* The number of lookups in progress per epoch. */
+typedef struct _shard
+{
+    uint64_t readers[2];
+} OE_ALIGNED(64) shard_t;
+
+static shard_t _shards[READER_SHARDS];
+static uint32_t _epoch;
+static oe_mutex_t _synchronize_lock = OE_MUTEX_INITIALIZER;
 
 static void _atexit_handler(void)
 {
     /* Free the standard fds (but do not close them). */
     for (size_t i = 0; i <= OE_STDERR_FILENO; i++)
     {
-        oe_fd_t* desc = _table[i];
+        oe_fd_t* desc = _chunks[0][i];
 
         if (desc)
             desc->ops.fd.close(desc);
     }
 
-    oe_free(_table);
+    for (size_t i = 0; i < _num_chunks; i++)
+        oe_free(_chunks[i]);
 }
 
-static int _resize_table(size_t new_size)
+static size_t _table_size(void)
 {
-    int ret = -1;
+    return __atomic_load_n(&_num_chunks, __ATOMIC_ACQUIRE) * TABLE_CHUNK_SIZE;
+}
 
-    /* The fdtable cannot be bigger than the maximum int file descriptor. */
-    if (new_size > OE_INT_MAX)
-        goto done;
+static entry_t* _entry(size_t fd)
+{
+    return &_chunks[fd / TABLE_CHUNK_SIZE][fd % TABLE_CHUNK_SIZE];
+}
 
-    /* Round the new capacity up to the next multiple of the chunk size. */
-    new_size = oe_round_up_to_multiple(new_size, TABLE_CHUNK_SIZE);
+/* Make the table large enough to hold the given fd. Requires _lock. */
+static int _resize_table(size_t fd)
+{
+    int ret = -1;
 
-    if (new_size > OE_INT_MAX)
-        new_size = OE_INT_MAX;
+    if (fd >= TABLE_MAX_CHUNKS * TABLE_CHUNK_SIZE)
+        goto done;
 
-    if (new_size > _table_size)
+    while (_num_chunks <= fd / TABLE_CHUNK_SIZE)
     {
-        entry_t* p;
-        size_t n = new_size;
+        entry_t* chunk;
 
-        /* Reallocate the table. */
-        if (!(p = oe_realloc(_table, n * sizeof(entry_t))))
+        if (!(chunk = oe_calloc(TABLE_CHUNK_SIZE, sizeof(entry_t))))
             goto done;
 
-        /* Zero-fill the unused portion. */
-        {
-            const size_t num_bytes = (n - _table_size) * sizeof(entry_t);
-
-            if (oe_memset_s(p + _table_size, num_bytes, 0, num_bytes) != OE_OK)
-                goto done;
-        }
-
-        _table = p;
-        _table_size = new_size;
+        /* Publish the chunk before the lookups can see it. */
+        _chunks[_num_chunks] = chunk;
+        __atomic_store_n(&_num_chunks, _num_chunks + 1, __ATOMIC_RELEASE);
     }
 
     ret = 0;
@@ -90,52 +116,36 @@ done:
     return ret;
 }
 
+/* Requires _lock. */
 static int _initialize(void)
 {
     int ret = -1;
-    static bool _initialized;
 
     /* Do this the first time only. */
     if (!_initialized)
     {
         /* Make the table more than large enough for standard files. */
-        if (_resize_table(TABLE_CHUNK_SIZE) != 0)
+        if (_resize_table(OE_STDERR_FILENO) != 0)
             OE_RAISE_ERRNO(OE_ENOMEM);
 
-        /* Create the STDIN file. */
-        {
-            oe_fd_t* file;
-
-            if (!(file = oe_consolefs_create_file(OE_STDIN_FILENO)))
-                OE_RAISE_ERRNO(OE_ENOMEM);
-
-            _table[OE_STDIN_FILENO] = file;
-        }
-
-        /* Create the STDOUT file. */
+        /* Create the standard files. */
+        for (int fd = OE_STDIN_FILENO; fd <= OE_STDERR_FILENO; fd++)
         {
             oe_fd_t* file;
 
-            if (!(file = oe_consolefs_create_file(OE_STDOUT_FILENO)))
+            if (!(file = oe_consolefs_create_file(fd)))
                 OE_RAISE_ERRNO(OE_ENOMEM);
 
-            _table[OE_STDOUT_FILENO] = file;
+            file->refcount = 1;
+            *_entry((size_t)fd) = file;
         }
 
-        /* Create the STDERR file. */
-        {
-            oe_fd_t* file;
-
-            if (!(file = oe_consolefs_create_file(OE_STDERR_FILENO)))
-                OE_RAISE_ERRNO(OE_ENOMEM);
-
-            _table[OE_STDERR_FILENO] = file;
-        }
+        _lowest_free = OE_STDERR_FILENO + 1;
 
         /* Install the atexit handler that will release the table. */
         oe_atexit(_atexit_handler);
 
-        _initialized = true;
+        __atomic_store_n(&_initialized, true, __ATOMIC_RELEASE);
     }
 
     ret = 0;
@@ -145,6 +155,106 @@ done:
     return ret;
 }
 
+static int _initialize_once(void)
+{
+    int ret;
+
+    if (__atomic_load_n(&_initialized, __ATOMIC_ACQUIRE))
+        return 0;
+
+    oe_spin_lock(&_lock);
+    ret = _initialize();
+    oe_spin_unlock(&_lock);
+
+    return ret;
+}
+
+/* Replaces the entry of the given fd. Requires _lock. */
+static void _set_entry(size_t fd, oe_fd_t* desc)
+{
+    /* Sequentially consistent, so that _synchronize() either sees the lookups
+     * that may have read the old descriptor or these do not read it. */
+    __atomic_store_n(_entry(fd), desc, __ATOMIC_SEQ_CST);
+
+    if (!desc && fd < _lowest_free)
+        _lowest_free = fd;
+}
+
+/* Starts a lookup. Returns the value to pass to _read_unlock(). */
+static uint64_t* _read_lock(void)
+{
+    const uint64_t hash = (uint64_t)oe_thread_self() * 0x9E3779B97F4A7C15;
+    shard_t* const shard = &_shards[(hash >> 32) % READER_SHARDS];
+    const uint32_t epoch = __atomic_load_n(&_epoch, __ATOMIC_RELAXED);
+    uint64_t* const readers = &shard->readers[epoch & 1];
+
+    __atomic_add_fetch(readers, 1, __ATOMIC_SEQ_CST);
+
+    return readers;
+}
+
+static void _read_unlock(uint64_t* readers)
+{
+    __atomic_sub_fetch(readers, 1, __ATOMIC_RELEASE);
+}
+
+/* Waits until all lookups that started before have finished. New lookups
+ * count in the other epoch, so this does not wait for them. */
+static void _synchronize(void)
+{
+    oe_mutex_lock(&_synchronize_lock);
+
+    const uint32_t epoch =
+        __atomic_fetch_add(&_epoch, 1, __ATOMIC_SEQ_CST) & 1;
+
+    for (size_t i = 0; i < READER_SHARDS; i++)
+    {
+        while (__atomic_load_n(&_shards[i].readers[epoch], __ATOMIC_ACQUIRE))
+            __builtin_ia32_pause();
+    }
+
+    oe_mutex_unlock(&_synchronize_lock);
+}
+
+/* Takes a reference unless the descriptor is being closed. */
+static bool _try_ref(oe_fd_t* desc)
+{
+    uint32_t refcount = __atomic_load_n(&desc->refcount, __ATOMIC_RELAXED);
+
+    do
+    {
+        if (refcount == 0)
+            return false;
+    } while (!__atomic_compare_exchange_n(
+        &desc->refcount,
+        &refcount,
+        refcount + 1,
+        true,
+        __ATOMIC_ACQUIRE,
+        __ATOMIC_RELAXED));
+
+    return true;
+}
+
+/* Looks up a descriptor and takes a reference without taking the lock. */
+static oe_fd_t* _acquire(size_t fd)
+{
+    oe_fd_t* desc = NULL;
+
+    if (fd >= _table_size())
+        return NULL;
+
+    uint64_t* const readers = _read_lock();
+
+    desc = __atomic_load_n(_entry(fd), __ATOMIC_SEQ_CST);
+    if (desc && !_try_ref(desc))
+        desc = NULL;
+
+    _read_unlock(readers);
+
+    return desc;
+}
+
 #if !defined(NDEBUG)
 static void _assert_fd(oe_fd_t* desc)
 {
@@ -229,20 +339,24 @@ int oe_fdtable_assign(oe_fd_t* desc)
 #endif
 
     /* Find the first available file descriptor. */
-    for (index = 0; index < _table_size; index++)
+    for (index = _lowest_free; index < _table_size(); index++)
     {
-        if (!_table[index])
+        if (!*_entry(index))
             break;
     }
 
     /* If no free slot found, expand size of the file descriptor table. */
-    if (index == _table_size)
+    if (index == _table_size())
     {
-        if (_resize_table(_table_size + 1) != 0)
+        if (_resize_table(index) != 0)
             OE_RAISE_ERRNO(OE_ENOMEM);
     }
 
-    _table[index] = desc;
+    /* The table holds the first reference. */
+    desc->refcount = 1;
+    _set_entry(index, desc);
+    _lowest_free = index + 1;
+
     ret = (int)index;
 
 done:
@@ -256,6 +370,7 @@ done:
 int oe_fdtable_release(int fd)
 {
     int ret = -1;
+    oe_fd_t* desc = NULL;
 
     oe_spin_lock(&_lock);
 
@@ -263,14 +378,14 @@ int oe_fdtable_release(int fd)
         OE_RAISE_ERRNO(oe_errno);
 
     /* Fail if fd is out of range. */
-    if (!(fd >= 0 && (size_t)fd < _table_size))
+    if (!(fd >= 0 && (size_t)fd < _table_size()))
         OE_RAISE_ERRNO(OE_EBADF);
 
     /* Fail if entry was never assigned. */
-    if (!_table[fd])
+    if (!(desc = *_entry((size_t)fd)))
         OE_RAISE_ERRNO(OE_EINVAL);
 
-    _table[fd] = NULL;
+    _set_entry((size_t)fd, NULL);
 
     ret = 0;
 
@@ -278,6 +393,10 @@ done:
 
     oe_spin_unlock(&_lock);
 
+    /* Drop the reference of the table. */
+    if (desc)
+        ret = oe_fdtable_put(desc);
+
     return ret;
 }
 
@@ -303,14 +422,16 @@ int oe_fdtable_reassign(int fd, oe_fd_t* new_desc, oe_fd_t** old_desc)
 
     /* Make table big enough to contain this file-descriptor. */
     if (fd >= 0)
-        _resize_table((size_t)fd + 1);
+        _resize_table((size_t)fd);
 
-    if (fd < 0 || (size_t)fd >= _table_size)
+    if (fd < 0 || (size_t)fd >= _table_size())
         OE_RAISE_ERRNO(OE_EBADF);
 
-    *old_desc = _table[fd];
+    /* The reference of the table passes to the caller. */
+    *old_desc = *_entry((size_t)fd);
 
-    _table[fd] = new_desc;
+    new_desc->refcount = 1;
+    _set_entry((size_t)fd, new_desc);
 
     ret = 0;
 
@@ -326,23 +447,17 @@ static oe_fd_t* _get_fd(int fd)
 {
     oe_fd_t* ret = NULL;
 
-    oe_spin_lock(&_lock);
-
-    if (_initialize() != 0)
+    if (_initialize_once() != 0)
         OE_RAISE_ERRNO(oe_errno);
 
-    if (fd < 0 || (size_t)fd >= _table_size)
+    if (fd < 0)
         OE_RAISE_ERRNO(OE_EBADF);
 
-    if (_table[fd] == NULL)
+    if (!(ret = _acquire((size_t)fd)))
         OE_RAISE_ERRNO(OE_EBADF);
 
-    ret = _table[fd];
-
 done:
 
-    oe_spin_unlock(&_lock);
-
     return ret;
 }
 
@@ -356,8 +471,11 @@ oe_fd_t* oe_fdtable_get(int fd, oe_fd_type_t type)
 
     if (type != OE_FD_TYPE_ANY && desc->type != type)
     {
+        const oe_fd_type_t desc_type = desc->type;
+
+        oe_fdtable_put(desc);
         OE_RAISE_ERRNO_MSG(
-            OE_EINVAL, "fd=%d type=%u fd->type=%u", fd, type, desc->type);
+            OE_EINVAL, "fd=%d type=%u fd->type=%u", fd, type, desc_type);
     }
 
     ret = desc;
@@ -366,6 +484,35 @@ done:
     return ret;
 }
 
+bool oe_fdtable_ref(oe_fd_t* desc)
+{
+    oe_assert(desc);
+    return _try_ref(desc);
+}
+
+int oe_fdtable_put(oe_fd_t* desc)
+{
+    int ret = 0;
+    int errnum;
+
+    oe_assert(desc);
+
+    if (__atomic_sub_fetch(&desc->refcount, 1, __ATOMIC_ACQ_REL) != 0)
+        return 0;
+
+    /* The descriptor is not in the table anymore. Wait for the lookups that
+     * may have read it before closing it. */
+    _synchronize();
+
+    /* Keep the errno of the operation that dropped the reference. */
+    errnum = oe_errno;
+
+    if ((ret = desc->ops.fd.close(desc)) == 0)
+        oe_errno = errnum;
+
+    return ret;
+}
+
 void oe_fdtable_foreach(
     oe_fd_type_t type,
     void* arg,
@@ -373,14 +520,16 @@ void oe_fdtable_foreach(
 {
     oe_assert(callback);
 
-    oe_spin_lock(&_lock);
-
-    for (size_t i = 0; i < _table_size; ++i)
+    for (size_t i = 0; i < _table_size(); ++i)
     {
-        oe_fd_t* const desc = _table[i];
-        if (desc && (type == OE_FD_TYPE_ANY || desc->type == type))
+        oe_fd_t* const desc = _acquire(i);
+
+        if (!desc)
+            continue;
+
+        if (type == OE_FD_TYPE_ANY || desc->type == type)
             callback(desc, arg);
-    }
 
-    oe_spin_unlock(&_lock);
+        oe_fdtable_put(desc);
+    }
 }
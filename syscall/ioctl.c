@@ -13,7 +13,7 @@
 int __oe_ioctl(int fd, unsigned long request, uint64_t arg)
 {
     int ret = -1;
-    oe_fd_t* desc;
+    oe_fd_t* desc = NULL;
 
     if (!(desc = oe_fdtable_get(fd, OE_FD_TYPE_ANY)))
         OE_RAISE_ERRNO(oe_errno);
@@ -21,6 +21,10 @@ int __oe_ioctl(int fd, unsigned long request, uint64_t arg)
     ret = desc->ops.fd.ioctl(desc, request, arg);
 
 done:
+
+    if (desc)
+        oe_fdtable_put(desc);
+
     return ret;
 }
 
@@ -5,6 +5,7 @@
 #include <openenclave/corelibc/stdio.h>
 #include <openenclave/corelibc/stdlib.h>
 #include <openenclave/corelibc/string.h>
+#include <openenclave/internal/hostpool.h>
 #include <openenclave/internal/print.h>
 #include <openenclave/internal/safecrt.h>
 #include <openenclave/internal/safemath.h>
@@ -172,3 +173,106 @@ done:
 
     return ret;
 }
+
+int oe_iov_stage(
+    const struct oe_iovec* iov,
+    int iovcnt,
+    bool copy_data,
+    void** buf_out,
+    size_t* buf_size_out)
+{
+    int ret = -1;
+    uint8_t* buf = NULL;
+    size_t buf_size = 0;
+
+    if (buf_out)
+        *buf_out = NULL;
+
+    if (buf_size_out)
+        *buf_size_out = 0;
+
+    /* Reject invalid parameters. */
+    if (iovcnt < 0 || (iovcnt > 0 && !iov) || !buf_out || !buf_size_out)
+        goto done;
+
+    /* Calculate the total number of data bytes. */
+    for (int i = 0; i < iovcnt; i++)
+    {
+        if (iov[i].iov_len && !iov[i].iov_base)
+            goto done;
+
+        if (oe_safe_add_sizet(buf_size, iov[i].iov_len, &buf_size) != OE_OK)
+            goto done;
+    }
+
+    /* Handle zero-sized data up front. */
+    if (buf_size == 0)
+    {
+        ret = 0;
+        goto done;
+    }
+
+    /* Allocate the staging buffer in host memory. */
+    if (!(buf = oe_host_pool_malloc(buf_size)))
+        goto done;
+
+    /* Gather the data directly into the staging buffer. */
+    if (copy_data)
+    {
+        uint8_t* p = buf;
+
+        for (int i = 0; i < iovcnt; i++)
+        {
+            memcpy(p, iov[i].iov_base, iov[i].iov_len);
+            p += iov[i].iov_len;
+        }
+    }
+
+    *buf_out = buf;
+    *buf_size_out = buf_size;
+    buf = NULL;
+    ret = 0;
+
+done:
+
+    if (buf)
+        oe_host_pool_free(buf);
+
+    return ret;
+}
+
+int oe_iov_unstage(
+    const struct oe_iovec* iov,
+    int iovcnt,
+    const void* buf,
+    size_t buf_size,
+    size_t count)
+{
+    int ret = -1;
+    const uint8_t* p = (const uint8_t*)buf;
+
+    /* Reject invalid parameters. The count is returned by the host. */
+    if (iovcnt < 0 || (iovcnt > 0 && !iov) || count > buf_size)
+        goto done;
+
+    /* Scatter the data that was read into the IO vector. */
+    for (int i = 0; i < iovcnt && count; i++)
+    {
+        const size_t n = iov[i].iov_len < count ? iov[i].iov_len : count;
+
+        memcpy(iov[i].iov_base, p, n);
+        p += n;
+        count -= n;
+    }
+
+    ret = 0;
+
+done:
+
+    return ret;
+}
+
+void oe_iov_free_stage(void* buf)
+{
+    oe_host_pool_free(buf);
+}
@@ -14,6 +14,7 @@ int oe_poll(struct oe_pollfd* fds, oe_nfds_t nfds, int timeout)
     int ret = -1;
     int retval = -1;
     struct oe_host_pollfd* host_fds = NULL;
+    oe_fd_t** descs = NULL;
     oe_nfds_t i;
 
     // EDG: poll with nfds=0 can be used as sleep. (Python uses it this way and
@@ -24,18 +25,24 @@ int oe_poll(struct oe_pollfd* fds, oe_nfds_t nfds, int timeout)
     if (!(host_fds = oe_calloc(nfds, sizeof(struct oe_host_pollfd))))
         OE_RAISE_ERRNO(OE_ENOMEM);
 
+    /* Hold the descriptors until the host returns so that a concurrent close
+     * cannot close or reuse their host fds meanwhile. */
+    if (!(descs = oe_calloc(nfds, sizeof(oe_fd_t*))))
+        OE_RAISE_ERRNO(OE_ENOMEM);
+
     /* Convert enclave fds to host fds. */
     for (i = 0; i < nfds; i++)
     {
         oe_host_fd_t host_fd;
-        oe_fd_t* desc;
 
         /* Fetch the fd struct for this fd struct. */
-        if (!(desc = oe_fdtable_get(fds[i].fd, OE_FD_TYPE_ANY)))
+        if (!(descs[i] = oe_fdtable_get(fds[i].fd, OE_FD_TYPE_ANY)))
             OE_RAISE_ERRNO(OE_EBADF);
 
         /* Get the host fd for this fd struct. */
-        if ((host_fd = desc->ops.fd.get_host_fd(desc)) == -1)
+        host_fd = descs[i]->ops.fd.get_host_fd(descs[i]);
+
+        if (host_fd == -1)
             OE_RAISE_ERRNO(OE_EBADF);
 
         host_fds[i].events = fds[i].events;
@@ -53,6 +60,15 @@ int oe_poll(struct oe_pollfd* fds, oe_nfds_t nfds, int timeout)
 
 done:
 
+    if (descs)
+    {
+        for (i = 0; i < nfds; i++)
+            if (descs[i])
+                oe_fdtable_put(descs[i]);
+
+        oe_free(descs);
+    }
+
     if (host_fds)
         oe_free(host_fds);
 
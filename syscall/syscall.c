@@ -358,6 +358,28 @@ static long _syscall(
             ret = oe_truncate(path, length);
             goto done;
         }
+        case OE_SYS_ftruncate:
+        {
+            const int fd = (int)arg1;
+            const oe_off_t length = (oe_off_t)arg2;
+
+            ret = oe_ftruncate(fd, length);
+            goto done;
+        }
+        case OE_SYS_fsync:
+        {
+            const int fd = (int)arg1;
+
+            ret = oe_fsync(fd);
+            goto done;
+        }
+        case OE_SYS_fdatasync:
+        {
+            const int fd = (int)arg1;
+
+            ret = oe_fdatasync(fd);
+            goto done;
+        }
 #if defined(OE_SYS_mkdir)
         case OE_SYS_mkdir:
         {
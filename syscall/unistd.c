@@ -231,7 +231,7 @@ done:
 ssize_t oe_read(int fd, void* buf, size_t count)
 {
     ssize_t ret = -1;
-    oe_fd_t* desc;
+    oe_fd_t* desc = NULL;
 
     if (!(desc = oe_fdtable_get(fd, OE_FD_TYPE_ANY)))
         OE_RAISE_ERRNO(oe_errno);
@@ -239,13 +239,17 @@ ssize_t oe_read(int fd, void* buf, size_t count)
     ret = desc->ops.fd.read(desc, buf, count);
 
 done:
+
+    if (desc)
+        oe_fdtable_put(desc);
+
     return ret;
 }
 
 ssize_t oe_write(int fd, const void* buf, size_t count)
 {
     ssize_t ret = -1;
-    oe_fd_t* desc;
+    oe_fd_t* desc = NULL;
 
     if (!(desc = oe_fdtable_get(fd, OE_FD_TYPE_ANY)))
         OE_RAISE_ERRNO(oe_errno);
@@ -253,6 +257,10 @@ ssize_t oe_write(int fd, const void* buf, size_t count)
     ret = desc->ops.fd.write(desc, buf, count);
 
 done:
+
+    if (desc)
+        oe_fdtable_put(desc);
+
     return ret;
 }
 
@@ -270,21 +278,29 @@ static void _close_epoll_callback(oe_fd_t* desc, void* arg)
 int oe_close(int fd)
 {
     int ret = -1;
-    oe_fd_t* desc;
+    oe_fd_t* desc = NULL;
 
     if (!(desc = oe_fdtable_get(fd, OE_FD_TYPE_ANY)))
         OE_RAISE_ERRNO(oe_errno);
 
-    if ((ret = desc->ops.fd.close(desc)) == 0)
-    {
-        // Notify epoll instances that this fd has been closed.
-        oe_fdtable_foreach(
-            OE_FD_TYPE_EPOLL, (void*)(intptr_t)fd, _close_epoll_callback);
+    // Notify epoll instances that this fd is being closed.
+    oe_fdtable_foreach(
+        OE_FD_TYPE_EPOLL, (void*)(intptr_t)fd, _close_epoll_callback);
 
-        oe_fdtable_release(fd);
-    }
+    // Fails if another thread closed the fd concurrently.
+    if (oe_fdtable_release(fd) != 0)
+        OE_RAISE_ERRNO(OE_EBADF);
+
+    // Dropping the last reference closes the descriptor. If other threads
+    // are still using it, the last of them closes it.
+    ret = oe_fdtable_put(desc);
+    desc = NULL;
 
 done:
+
+    if (desc)
+        oe_fdtable_put(desc);
+
     return ret;
 }
 
@@ -308,7 +324,7 @@ done:
 int oe_dup(int oldfd)
 {
     int ret = -1;
-    oe_fd_t* old_desc;
+    oe_fd_t* old_desc = NULL;
     oe_fd_t* new_desc = NULL;
     int newfd;
 
@@ -326,6 +342,9 @@ int oe_dup(int oldfd)
 
 done:
 
+    if (old_desc)
+        oe_fdtable_put(old_desc);
+
     if (new_desc)
         new_desc->ops.fd.close(new_desc);
 
@@ -334,7 +353,7 @@ done:
 
 int oe_dup2(int oldfd, int newfd)
 {
-    oe_fd_t* old_desc;
+    oe_fd_t* old_desc = NULL;
     oe_fd_t* new_desc = NULL;
     oe_fd_t* reassigned_desc;
     int retval = -1;
@@ -351,13 +370,17 @@ int oe_dup2(int oldfd, int newfd)
     if (oe_fdtable_reassign(newfd, new_desc, &reassigned_desc) == -1)
         OE_RAISE_ERRNO(OE_EINVAL);
 
+    // Drop the reference of the table to the replaced descriptor.
     if (reassigned_desc)
-        reassigned_desc->ops.fd.close(reassigned_desc);
+        oe_fdtable_put(reassigned_desc);
 
     new_desc = NULL;
 
 done:
 
+    if (old_desc)
+        oe_fdtable_put(old_desc);
+
     if (new_desc)
         new_desc->ops.fd.close(new_desc);
 
@@ -520,10 +543,61 @@ done:
     return ret;
 }
 
+int oe_ftruncate(int fd, oe_off_t length)
+{
+    int ret = -1;
+    oe_fd_t* file = NULL;
+
+    if (length < 0)
+        OE_RAISE_ERRNO(OE_EINVAL);
+
+    if (!(file = oe_fdtable_get(fd, OE_FD_TYPE_FILE)))
+        OE_RAISE_ERRNO(oe_errno);
+
+    if (!file->ops.file.ftruncate)
+        OE_RAISE_ERRNO(OE_EINVAL);
+
+    ret = file->ops.file.ftruncate(file, length);
+
+done:
+
+    if (file)
+        oe_fdtable_put(file);
+
+    return ret;
+}
+
+int oe_fsync(int fd)
+{
+    int ret = -1;
+    oe_fd_t* file = NULL;
+
+    if (!(file = oe_fdtable_get(fd, OE_FD_TYPE_FILE)))
+        OE_RAISE_ERRNO(oe_errno);
+
+    if (!file->ops.file.fsync)
+        OE_RAISE_ERRNO(OE_EINVAL);
+
+    ret = file->ops.file.fsync(file);
+
+done:
+
+    if (file)
+        oe_fdtable_put(file);
+
+    return ret;
+}
+
+int oe_fdatasync(int fd)
+{
+    /* The file systems do not distinguish data from metadata. */
+    return oe_fsync(fd);
+}
+
 oe_off_t oe_lseek(int fd, oe_off_t offset, int whence)
 {
     oe_off_t ret = -1;
-    oe_fd_t* file;
+    oe_fd_t* file = NULL;
 
     if (!(file = oe_fdtable_get(fd, OE_FD_TYPE_FILE)))
         OE_RAISE_ERRNO(oe_errno);
@@ -531,13 +605,17 @@ oe_off_t oe_lseek(int fd, oe_off_t offset, int whence)
     ret = file->ops.file.lseek(file, offset, whence);
 
 done:
+
+    if (file)
+        oe_fdtable_put(file);
+
     return ret;
 }
 
 ssize_t oe_pread(int fd, void* buf, size_t count, oe_off_t offset)
 {
     ssize_t ret = -1;
-    oe_fd_t* file;
+    oe_fd_t* file = NULL;
 
     if (!(file = oe_fdtable_get(fd, OE_FD_TYPE_FILE)))
         OE_RAISE_ERRNO(oe_errno);
@@ -545,13 +623,17 @@ ssize_t oe_pread(int fd, void* buf, size_t count, oe_off_t offset)
     ret = file->ops.file.pread(file, buf, count, offset);
 
 done:
+
+    if (file)
+        oe_fdtable_put(file);
+
     return ret;
 }
 
 ssize_t oe_pwrite(int fd, const void* buf, size_t count, oe_off_t offset)
 {
     ssize_t ret = -1;
-    oe_fd_t* file;
+    oe_fd_t* file = NULL;
 
     if (!(file = oe_fdtable_get(fd, OE_FD_TYPE_FILE)))
         OE_RAISE_ERRNO(oe_errno);
@@ -559,13 +641,17 @@ ssize_t oe_pwrite(int fd, const void* buf, size_t count, oe_off_t offset)
     ret = file->ops.file.pwrite(file, buf, count, offset);
 
 done:
+
+    if (file)
+        oe_fdtable_put(file);
+
     return ret;
 }
 
 ssize_t oe_readv(int fd, const struct oe_iovec* iov, int iovcnt)
 {
     ssize_t ret = -1;
-    oe_fd_t* desc;
+    oe_fd_t* desc = NULL;
 
     if (!(desc = oe_fdtable_get(fd, OE_FD_TYPE_ANY)))
         OE_RAISE_ERRNO(oe_errno);
@@ -573,6 +659,10 @@ ssize_t oe_readv(int fd, const struct oe_iovec* iov, int iovcnt)
     ret = desc->ops.fd.readv(desc, iov, iovcnt);
 
 done:
+
+    if (desc)
+        oe_fdtable_put(desc);
+
     return ret;
 }
 
@@ -580,7 +670,7 @@ ssize_t oe_writev(int fd, const struct oe_iovec* iov, int iovcnt)
 {
     ssize_t ret = -1;
 
-    oe_fd_t* desc;
+    oe_fd_t* desc = NULL;
 
     if (!(desc = oe_fdtable_get(fd, OE_FD_TYPE_ANY)))
         OE_RAISE_ERRNO(oe_errno);
@@ -588,6 +678,10 @@ ssize_t oe_writev(int fd, const struct oe_iovec* iov, int iovcnt)
     ret = desc->ops.fd.writev(desc, iov, iovcnt);
 
 done:
+
+    if (desc)
+        oe_fdtable_put(desc);
+
     return ret;
 }
 
@@ -50,6 +50,43 @@ static void _test_random(size_t seq_length)
     printf("=== passed %s()\n", __FUNCTION__);
 }
 
+/* Large requests, which together exceed the reseed interval of the enclave
+ * generator. */
+static void _test_random_large(void)
+{
+    const size_t size = 256 * 1024;
+    const size_t iterations = 8;
+    size_t counts[256] = {0};
+
+    printf("=== begin %s()\n", __FUNCTION__);
+
+    uint8_t* buf = malloc(size);
+    OE_TEST(buf);
+
+    for (size_t n = 0; n < iterations; n++)
+    {
+        OE_TEST(oe_random_internal(buf, size) == OE_OK);
+
+        /* No block repeats its predecessor. */
+        for (size_t i = 16; i < size; i += 16)
+            OE_TEST(memcmp(buf + i - 16, buf + i, 16) != 0);
+
+        for (size_t i = 0; i < size; i++)
+            counts[buf[i]]++;
+    }
+
+    /* Every byte value occurs about equally often. */
+    for (size_t i = 0; i < OE_COUNTOF(counts); i++)
+    {
+        OE_TEST(counts[i] > size * iterations / 256 * 3 / 4);
+        OE_TEST(counts[i] < size * iterations / 256 * 5 / 4);
+    }
+
+    free(buf);
+
+    printf("=== passed %s()\n", __FUNCTION__);
+}
+
 void TestRandom(void)
 {
     _test_random(19);
@@ -59,5 +96,6 @@ void TestRandom(void)
     _test_random(2047);
     _test_random(2048);
     _test_random(2049);
+    _test_random_large();
     OE_STATIC_ASSERT(SEQ_LENGTH_MAX == 2049);
 }
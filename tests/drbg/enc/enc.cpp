@@ -0,0 +1,168 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/ecdh.h>
+#include <mbedtls/ecdsa.h>
+#include <mbedtls/entropy.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/crypto/ctr_drbg.h>
+#include <openenclave/internal/tests.h>
+#include <atomic>
+#include <cstring>
+#include "drbg_t.h"
+
+using namespace std;
+
+// Declared in enclave/crypto/ctr_drbg.h, which is not installed.
+extern "C" mbedtls_ctr_drbg_context* oe_mbedtls_get_drbg();
+
+void test_reseed_interval()
+{
+    OE_TEST(oe_ctr_drbg_set_reseed_interval(0) == OE_INVALID_PARAMETER);
+    OE_TEST(oe_ctr_drbg_set_reseed_interval(-1) == OE_INVALID_PARAMETER);
+
+    mbedtls_ctr_drbg_context* const drbg = oe_mbedtls_get_drbg();
+    OE_TEST(drbg);
+    OE_TEST(drbg->reseed_interval == OE_CTR_DRBG_DEFAULT_RESEED_INTERVAL);
+
+    // The new interval applies to the existing instance on its next use.
+    OE_TEST(oe_ctr_drbg_set_reseed_interval(2) == OE_OK);
+    OE_TEST(oe_mbedtls_get_drbg() == drbg);
+    OE_TEST(drbg->reseed_interval == 2);
+
+    unsigned char buf[16];
+    for (int i = 0; i < 5; i++)
+        OE_TEST(mbedtls_ctr_drbg_random(drbg, buf, sizeof buf) == 0);
+    OE_TEST(drbg->reseed_counter <= 3);
+
+    OE_TEST(
+        oe_ctr_drbg_set_reseed_interval(OE_CTR_DRBG_DEFAULT_RESEED_INTERVAL) ==
+        OE_OK);
+    OE_TEST(oe_mbedtls_get_drbg() == drbg);
+    OE_TEST(drbg->reseed_interval == OE_CTR_DRBG_DEFAULT_RESEED_INTERVAL);
+}
+
+static atomic<size_t> _entered;
+
+uint64_t get_thread_drbg(size_t thread_count)
+{
+    mbedtls_ctr_drbg_context* const drbg = oe_mbedtls_get_drbg();
+    OE_TEST(drbg);
+    OE_TEST(oe_mbedtls_get_drbg() == drbg);
+
+    unsigned char buf[2][32];
+    OE_TEST(mbedtls_ctr_drbg_random(drbg, buf[0], sizeof buf[0]) == 0);
+    OE_TEST(mbedtls_ctr_drbg_random(drbg, buf[1], sizeof buf[1]) == 0);
+    OE_TEST(memcmp(buf[0], buf[1], sizeof buf[0]) != 0);
+
+    // Wait until all threads have entered the enclave, so that each one runs
+    // on its own TCS while getting its instance.
+    ++_entered;
+    while (_entered < thread_count)
+        __builtin_ia32_pause();
+
+    return reinterpret_cast<uint64_t>(drbg);
+}
+
+// A single DRBG shared by all threads, as the enclave crypto library used to
+// have.
+static mbedtls_ctr_drbg_context* _get_shared_drbg()
+{
+    static struct shared_drbg
+    {
+        mbedtls_ctr_drbg_context drbg;
+        mbedtls_entropy_context entropy;
+
+        shared_drbg()
+        {
+            mbedtls_ctr_drbg_init(&drbg);
+            mbedtls_entropy_init(&entropy);
+            OE_TEST(
+                mbedtls_ctr_drbg_seed(
+                    &drbg, mbedtls_entropy_func, &entropy, nullptr, 0) == 0);
+        }
+    } shared;
+
+    return &shared.drbg;
+}
+
+// Performs the operations of the server side of ECDHE-ECDSA TLS handshakes
+// that draw from the DRBG: generating the ephemeral key, computing the shared
+// secret with blinding and signing the key exchange.
+void bench_handshakes(size_t count, bool shared)
+{
+    mbedtls_ctr_drbg_context* const drbg =
+        shared ? _get_shared_drbg() : oe_mbedtls_get_drbg();
+    OE_TEST(drbg);
+
+    mbedtls_ecdsa_context signing_key;
+    mbedtls_ecp_keypair peer;
+    mbedtls_ecp_keypair ephemeral;
+    mbedtls_mpi secret;
+
+    mbedtls_ecdsa_init(&signing_key);
+    mbedtls_ecp_keypair_init(&peer);
+    mbedtls_ecp_keypair_init(&ephemeral);
+    mbedtls_mpi_init(&secret);
+
+    OE_TEST(
+        mbedtls_ecdsa_genkey(
+            &signing_key,
+            MBEDTLS_ECP_DP_SECP256R1,
+            mbedtls_ctr_drbg_random,
+            drbg) == 0);
+    OE_TEST(
+        mbedtls_ecp_gen_key(
+            MBEDTLS_ECP_DP_SECP256R1, &peer, mbedtls_ctr_drbg_random, drbg) ==
+        0);
+    OE_TEST(
+        mbedtls_ecp_group_load(&ephemeral.grp, MBEDTLS_ECP_DP_SECP256R1) == 0);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        OE_TEST(
+            mbedtls_ecdh_gen_public(
+                &ephemeral.grp,
+                &ephemeral.d,
+                &ephemeral.Q,
+                mbedtls_ctr_drbg_random,
+                drbg) == 0);
+        OE_TEST(
+            mbedtls_ecdh_compute_shared(
+                &ephemeral.grp,
+                &secret,
+                &peer.Q,
+                &ephemeral.d,
+                mbedtls_ctr_drbg_random,
+                drbg) == 0);
+
+        unsigned char hash[32];
+        unsigned char sig[MBEDTLS_ECDSA_MAX_LEN];
+        size_t sig_len = 0;
+        OE_TEST(mbedtls_ctr_drbg_random(drbg, hash, sizeof hash) == 0);
+        OE_TEST(
+            mbedtls_ecdsa_write_signature(
+                &signing_key,
+                MBEDTLS_MD_SHA256,
+                hash,
+                sizeof hash,
+                sig,
+                &sig_len,
+                mbedtls_ctr_drbg_random,
+                drbg) == 0);
+    }
+
+    mbedtls_mpi_free(&secret);
+    mbedtls_ecp_keypair_free(&ephemeral);
+    mbedtls_ecp_keypair_free(&peer);
+    mbedtls_ecdsa_free(&signing_key);
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    4096, /* NumHeapPages */
+    64,   /* NumStackPages */
+    33);  /* NumTCS */
@@ -0,0 +1,106 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/tests.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+#include "drbg_u.h"
+
+using namespace std;
+
+// Runs count handshakes on each of thread_count threads and returns the number
+// of handshakes per second.
+static double _run_handshakes(
+    oe_enclave_t* enclave,
+    size_t thread_count,
+    size_t count,
+    bool shared)
+{
+    vector<thread> threads;
+
+    const auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < thread_count; i++)
+        threads.emplace_back([=] {
+            OE_TEST(bench_handshakes(enclave, count, shared) == OE_OK);
+        });
+    for (auto& t : threads)
+        t.join();
+    const chrono::duration<double> seconds =
+        chrono::steady_clock::now() - start;
+
+    return thread_count * count / seconds.count();
+}
+
+// Measures the handshake throughput with a DRBG instance per thread and with
+// a single shared instance.
+static void _bench(oe_enclave_t* enclave)
+{
+    const size_t count = 200;
+
+    printf("%10s %14s %14s\n", "threads", "per-thread/s", "shared/s");
+
+    for (const size_t thread_count : {1, 8, 32})
+    {
+        const double per_thread =
+            _run_handshakes(enclave, thread_count, count, false);
+        const double shared =
+            _run_handshakes(enclave, thread_count, count, true);
+        printf("%10zu %14.0f %14.0f\n", thread_count, per_thread, shared);
+    }
+}
+
+static void _test(oe_enclave_t* enclave)
+{
+    const size_t thread_count = 8;
+
+    OE_TEST(test_reseed_interval(enclave) == OE_OK);
+
+    // Threads that are in the enclave at the same time get distinct instances.
+    vector<uint64_t> drbgs(thread_count);
+    vector<thread> threads;
+    for (size_t i = 0; i < thread_count; i++)
+        threads.emplace_back([=, &drbgs] {
+            OE_TEST(
+                get_thread_drbg(enclave, &drbgs[i], thread_count) == OE_OK);
+        });
+    for (auto& t : threads)
+        t.join();
+    OE_TEST(set<uint64_t>(drbgs.begin(), drbgs.end()).size() == thread_count);
+
+    _run_handshakes(enclave, thread_count, 4, false);
+    _run_handshakes(enclave, thread_count, 4, true);
+}
+
+int main(int argc, const char* argv[])
+{
+    const uint32_t flags = oe_get_create_flags();
+    const oe_enclave_type_t type = OE_ENCLAVE_TYPE_SGX;
+
+    if (argc != 2 && !(argc == 3 && strcmp(argv[2], "--bench") == 0))
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH [--bench]\n", argv[0]);
+        return 1;
+    }
+
+    oe_enclave_t* enclave;
+    OE_TEST(
+        oe_create_drbg_enclave(argv[1], type, flags, NULL, 0, &enclave) ==
+        OE_OK);
+
+    if (argc == 3)
+        _bench(enclave);
+    else
+        _test(enclave);
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    printf("=== passed all tests (drbg)\n");
+    fflush(stdout);
+
+    return 0;
+}
@@ -0,0 +1,250 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/syscall/fdtable.h>
+#include <openenclave/internal/tests.h>
+#include <unistd.h>
+#include <atomic>
+#include <cerrno>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "fdtable_t.h"
+
+using namespace std;
+
+static const uint64_t _magic = 0x6664746573746664;
+static const uint64_t _dead = 0xdeaddeaddeaddead;
+
+// A descriptor that counts how often it is closed. It is not freed on close,
+// so that a use after close is detected by the magic instead of crashing.
+struct test_fd
+{
+    oe_fd_t base;
+    uint64_t magic;
+};
+
+static mutex _descs_mutex;
+static vector<unique_ptr<test_fd>> _descs;
+static atomic<size_t> _closed;
+
+static vector<int> _fds;
+
+static test_fd* _check(oe_fd_t* desc)
+{
+    test_fd* const file = reinterpret_cast<test_fd*>(desc);
+    OE_TEST(file->magic == _magic);
+    return file;
+}
+
+static ssize_t _read(oe_fd_t* desc, void*, size_t)
+{
+    _check(desc);
+    return 0;
+}
+
+static ssize_t _write(oe_fd_t* desc, const void*, size_t count)
+{
+    _check(desc);
+    return (ssize_t)count;
+}
+
+static ssize_t _readv(oe_fd_t* desc, const oe_iovec*, int)
+{
+    _check(desc);
+    return 0;
+}
+
+static ssize_t _writev(oe_fd_t* desc, const oe_iovec*, int)
+{
+    _check(desc);
+    return 0;
+}
+
+static oe_fd_t* _new_fd();
+
+static int _dup(oe_fd_t* desc, oe_fd_t** new_fd)
+{
+    _check(desc);
+    *new_fd = _new_fd();
+    return 0;
+}
+
+static int _ioctl(oe_fd_t* desc, unsigned long, uint64_t)
+{
+    _check(desc);
+    errno = ENOTTY;
+    return -1;
+}
+
+static int _fcntl(oe_fd_t* desc, int, uint64_t)
+{
+    _check(desc);
+    return 0;
+}
+
+static int _close(oe_fd_t* desc)
+{
+    _check(desc)->magic = _dead;
+    ++_closed;
+    return 0;
+}
+
+static oe_host_fd_t _get_host_fd(oe_fd_t* desc)
+{
+    _check(desc);
+    return -1;
+}
+
+static oe_fd_t* _new_fd()
+{
+    auto file = make_unique<test_fd>();
+    file->base.type = OE_FD_TYPE_NONE;
+    file->base.ops.fd.read = _read;
+    file->base.ops.fd.write = _write;
+    file->base.ops.fd.readv = _readv;
+    file->base.ops.fd.writev = _writev;
+    file->base.ops.fd.dup = _dup;
+    file->base.ops.fd.ioctl = _ioctl;
+    file->base.ops.fd.fcntl = _fcntl;
+    file->base.ops.fd.close = _close;
+    file->base.ops.fd.get_host_fd = _get_host_fd;
+    file->magic = _magic;
+
+    oe_fd_t* const desc = &file->base;
+    const lock_guard lock(_descs_mutex);
+    _descs.push_back(move(file));
+    return desc;
+}
+
+// Checks that every created descriptor has been closed exactly once.
+static void _check_all_closed()
+{
+    const lock_guard lock(_descs_mutex);
+
+    for (const auto& file : _descs)
+        OE_TEST(file->magic == _dead);
+    OE_TEST(_closed == _descs.size());
+
+    _descs.clear();
+    _closed = 0;
+}
+
+void test_refcount()
+{
+    oe_fd_t* const desc = _new_fd();
+    const int fd = oe_fdtable_assign(desc);
+    OE_TEST(fd >= 0);
+
+    // A lookup of the wrong type does not leak a reference.
+    OE_TEST(!oe_fdtable_get(fd, OE_FD_TYPE_SOCKET));
+    OE_TEST(errno == EINVAL);
+
+    OE_TEST(oe_fdtable_get(fd, OE_FD_TYPE_ANY) == desc);
+
+    // Closing the fd removes it from the table, but the descriptor is only
+    // closed when the reference is dropped.
+    OE_TEST(close(fd) == 0);
+    OE_TEST(_closed == 0);
+    OE_TEST(!oe_fdtable_get(fd, OE_FD_TYPE_ANY));
+    OE_TEST(errno == EBADF);
+    OE_TEST(close(fd) == -1);
+    OE_TEST(errno == EBADF);
+
+    OE_TEST(write(fd, "x", 1) == -1);
+    OE_TEST(_check(desc)->magic == _magic);
+
+    OE_TEST(oe_fdtable_put(desc) == 0);
+    OE_TEST(_closed == 1);
+
+    // The table grows to hold large fds, and dup2 drops the reference of the
+    // table to the replaced descriptor.
+    const int fd1 = oe_fdtable_assign(_new_fd());
+    OE_TEST(fd1 >= 0);
+    const int fd2 = 5000;
+    OE_TEST(dup2(fd1, fd2) == fd2);
+    OE_TEST(write(fd2, "x", 1) == 1);
+    OE_TEST(dup2(fd1, fd2) == fd2);
+    OE_TEST(_closed == 2);
+
+    OE_TEST(close(fd2) == 0);
+    OE_TEST(close(fd1) == 0);
+    _check_all_closed();
+}
+
+void setup(size_t nfds)
+{
+    OE_TEST(_fds.empty());
+
+    for (size_t i = 0; i < nfds; i++)
+    {
+        const int fd = oe_fdtable_assign(_new_fd());
+        OE_TEST(fd >= 0);
+        _fds.push_back(fd);
+    }
+}
+
+void teardown()
+{
+    for (const int fd : _fds)
+        OE_TEST(close(fd) == 0);
+    _fds.clear();
+
+    _check_all_closed();
+}
+
+void stress_replace(size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        oe_fd_t* old_desc = nullptr;
+
+        OE_TEST(
+            oe_fdtable_reassign(_fds[i % _fds.size()], _new_fd(), &old_desc) ==
+            0);
+        OE_TEST(old_desc);
+        OE_TEST(oe_fdtable_put(old_desc) == 0);
+    }
+}
+
+void stress_lookup(size_t count)
+{
+    char buf[1];
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const int fd = _fds[i % _fds.size()];
+
+        // Through the fdtable ...
+        oe_fd_t* const desc = oe_fdtable_get(fd, OE_FD_TYPE_ANY);
+        OE_TEST(desc);
+        _check(desc);
+        OE_TEST(desc->ops.fd.write(desc, buf, 1) == 1);
+        _check(desc);
+        OE_TEST(oe_fdtable_put(desc) == 0);
+
+        // ... and through libc.
+        OE_TEST(read(fd, buf, 1) == 0);
+    }
+}
+
+void bench_lookup(size_t index, size_t count)
+{
+    const int fd = _fds[index % _fds.size()];
+
+    for (size_t i = 0; i < count; i++)
+    {
+        oe_fd_t* const desc = oe_fdtable_get(fd, OE_FD_TYPE_ANY);
+        OE_TEST(desc);
+        oe_fdtable_put(desc);
+    }
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    2048, /* NumHeapPages */
+    64,   /* NumStackPages */
+    16);  /* NumTCS */
@@ -0,0 +1,104 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/tests.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "fdtable_u.h"
+
+using namespace std;
+
+// Replaces the descriptors on one thread while the other threads use them.
+static void _stress(oe_enclave_t* enclave, size_t num_threads, size_t count)
+{
+    OE_TEST(setup(enclave, 4) == OE_OK);
+
+    vector<thread> threads;
+    for (size_t i = 0; i < num_threads; i++)
+        threads.emplace_back(
+            [=] { OE_TEST(stress_lookup(enclave, count) == OE_OK); });
+    OE_TEST(stress_replace(enclave, count) == OE_OK);
+    for (auto& t : threads)
+        t.join();
+
+    OE_TEST(teardown(enclave) == OE_OK);
+}
+
+// Looks up fds on num_threads threads in parallel and returns the mean time
+// of a lookup in nanoseconds. With shared, all threads use the same fd.
+static double _lookup(
+    oe_enclave_t* enclave,
+    size_t num_threads,
+    bool shared,
+    size_t count)
+{
+    OE_TEST(setup(enclave, num_threads) == OE_OK);
+
+    const auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (size_t i = 0; i < num_threads; i++)
+        threads.emplace_back([=] {
+            OE_TEST(bench_lookup(enclave, shared ? 0 : i, count) == OE_OK);
+        });
+    for (auto& t : threads)
+        t.join();
+    const chrono::duration<double, nano> ns =
+        chrono::steady_clock::now() - start;
+
+    OE_TEST(teardown(enclave) == OE_OK);
+
+    return ns.count() / count;
+}
+
+static void _bench(oe_enclave_t* enclave)
+{
+    const size_t count = 10000000;
+
+    printf("%10s %16s %16s\n", "threads", "shared fd ns", "own fd ns");
+    for (const size_t num_threads : {1, 2, 4, 8})
+        printf(
+            "%10zu %16.1f %16.1f\n",
+            num_threads,
+            _lookup(enclave, num_threads, true, count),
+            _lookup(enclave, num_threads, false, count));
+}
+
+static void _test(oe_enclave_t* enclave)
+{
+    OE_TEST(test_refcount(enclave) == OE_OK);
+    _stress(enclave, 4, 10000);
+    _lookup(enclave, 4, true, 1000);
+}
+
+int main(int argc, const char* argv[])
+{
+    const uint32_t flags = oe_get_create_flags();
+    const oe_enclave_type_t type = OE_ENCLAVE_TYPE_SGX;
+
+    if (argc != 2 && !(argc == 3 && strcmp(argv[2], "--bench") == 0))
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH [--bench]\n", argv[0]);
+        return 1;
+    }
+
+    oe_enclave_t* enclave;
+    OE_TEST(
+        oe_create_fdtable_enclave(argv[1], type, flags, NULL, 0, &enclave) ==
+        OE_OK);
+
+    if (argc == 3)
+        _bench(enclave);
+    else
+        _test(enclave);
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    printf("=== passed all tests (fdtable)\n");
+    fflush(stdout);
+
+    return 0;
+}
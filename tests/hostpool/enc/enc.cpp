@@ -0,0 +1,205 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/hostpool.h>
+#include <openenclave/internal/tests.h>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <set>
+#include <utility>
+#include <vector>
+#include "hostpool_t.h"
+
+using namespace std;
+
+static const size_t _max_block_size = 1 << 20;
+
+static mutex _shared_mutex;
+static vector<void*> _shared;
+static deque<pair<uint8_t*, size_t>> _queue;
+static void* _one;
+
+static void _fill(uint8_t* p, size_t size)
+{
+    memset(p, (int)(size % 251), size);
+}
+
+static void _check(const uint8_t* p, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        OE_TEST(p[i] == size % 251);
+}
+
+void test_size_classes()
+{
+    // free()-like functions should accept null
+    oe_host_pool_free(nullptr);
+
+    for (const size_t size : {size_t{1},
+                              size_t{64},
+                              size_t{65},
+                              size_t{4096},
+                              _max_block_size,
+                              _max_block_size + 1})
+    {
+        uint8_t* const a = static_cast<uint8_t*>(oe_host_pool_malloc(size));
+        uint8_t* const b = static_cast<uint8_t*>(oe_host_pool_malloc(size));
+        OE_TEST(a && b && a != b);
+        OE_TEST(oe_is_outside_enclave(a, size));
+        OE_TEST(oe_is_outside_enclave(b, size));
+
+        // Blocks of the same class do not overlap.
+        if (size <= _max_block_size)
+        {
+            size_t block_size = 64;
+            while (block_size < size)
+                block_size *= 2;
+            OE_TEST(
+                static_cast<size_t>(a > b ? a - b : b - a) >= block_size);
+        }
+
+        _fill(a, size);
+        _fill(b, size);
+        _check(a, size);
+        oe_host_pool_free(a);
+        oe_host_pool_free(b);
+
+        // A freed block is reused by the next allocation of its class.
+        if (size <= _max_block_size)
+        {
+            void* const c = oe_host_pool_malloc(size);
+            OE_TEST(c == a || c == b);
+            oe_host_pool_free(c);
+        }
+    }
+
+    // 65 and 128 bytes share a class, 64 and 65 do not.
+    void* const a = oe_host_pool_malloc(65);
+    oe_host_pool_free(a);
+    void* const b = oe_host_pool_malloc(128);
+    OE_TEST(b == a);
+    void* const c = oe_host_pool_malloc(64);
+    OE_TEST(c != b);
+    oe_host_pool_free(b);
+    oe_host_pool_free(c);
+}
+
+void test_refill_flush(size_t count)
+{
+    vector<uint8_t*> blocks;
+    set<uint8_t*> distinct;
+
+    for (int round = 0; round < 2; round++)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            uint8_t* const p = static_cast<uint8_t*>(oe_host_pool_malloc(100));
+            OE_TEST(p);
+            _fill(p, i % 100);
+            blocks.push_back(p);
+            distinct.insert(p);
+        }
+
+        OE_TEST(distinct.size() == count);
+
+        for (size_t i = 0; i < count; i++)
+        {
+            _check(blocks[i], i % 100);
+            oe_host_pool_free(blocks[i]);
+        }
+
+        blocks.clear();
+        distinct.clear();
+    }
+}
+
+void alloc_shared(size_t count)
+{
+    lock_guard<mutex> lock(_shared_mutex);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const size_t size = 64 << (i % 8);
+        uint8_t* const p = static_cast<uint8_t*>(oe_host_pool_malloc(size));
+        OE_TEST(p);
+        _fill(p, size);
+        _shared.push_back(p);
+    }
+}
+
+void free_shared()
+{
+    lock_guard<mutex> lock(_shared_mutex);
+
+    for (size_t i = 0; i < _shared.size(); i++)
+    {
+        const size_t size = 64 << (i % 8);
+        _check(static_cast<uint8_t*>(_shared[i]), size);
+        oe_host_pool_free(_shared[i]);
+    }
+
+    _shared.clear();
+}
+
+void stress(size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const size_t size = (i * 37) % 20000 + 1;
+        uint8_t* p = static_cast<uint8_t*>(oe_host_pool_malloc(size));
+        OE_TEST(p);
+        _fill(p, size);
+
+        {
+            lock_guard<mutex> lock(_shared_mutex);
+            _queue.emplace_back(p, size);
+            p = nullptr;
+
+            // Free the oldest block, which another thread likely allocated.
+            if (_queue.size() > 64)
+            {
+                p = _queue.front().first;
+                _check(p, _queue.front().second);
+                _queue.pop_front();
+            }
+        }
+
+        oe_host_pool_free(p);
+    }
+
+    lock_guard<mutex> lock(_shared_mutex);
+    while (!_queue.empty())
+    {
+        _check(_queue.front().first, _queue.front().second);
+        oe_host_pool_free(_queue.front().first);
+        _queue.pop_front();
+    }
+}
+
+void double_free()
+{
+    void* const p = oe_host_pool_malloc(100);
+    OE_TEST(p);
+    oe_host_pool_free(p);
+    oe_host_pool_free(p);
+}
+
+void alloc_one()
+{
+    OE_TEST((_one = oe_host_pool_malloc(100)));
+}
+
+void free_one()
+{
+    oe_host_pool_free(_one);
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    2048, /* NumHeapPages */
+    64,   /* NumStackPages */
+    8);   /* NumTCS */
@@ -0,0 +1,73 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/tests.h>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "hostpool_u.h"
+
+using namespace std;
+
+static oe_enclave_t* _create(const char* path)
+{
+    oe_enclave_t* enclave = nullptr;
+    OE_TEST(
+        oe_create_hostpool_enclave(
+            path,
+            OE_ENCLAVE_TYPE_SGX,
+            oe_get_create_flags(),
+            nullptr,
+            0,
+            &enclave) == OE_OK);
+    return enclave;
+}
+
+static void _test(oe_enclave_t* enclave)
+{
+    OE_TEST(test_size_classes(enclave) == OE_OK);
+    OE_TEST(test_refill_flush(enclave, 1000) == OE_OK);
+
+    // Blocks allocated on one thread are freed on another.
+    OE_TEST(alloc_shared(enclave, 100) == OE_OK);
+    thread([=] { OE_TEST(free_shared(enclave) == OE_OK); }).join();
+
+    vector<thread> threads;
+    for (int i = 0; i < 4; i++)
+        threads.emplace_back(
+            [=] { OE_TEST(stress(enclave, 10000) == OE_OK); });
+    for (auto& t : threads)
+        t.join();
+}
+
+int main(int argc, const char* argv[])
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    oe_enclave_t* enclave = _create(argv[1]);
+    _test(enclave);
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    // A double free aborts the enclave. There are no guarantees that an
+    // aborted enclave can be terminated cleanly, so the result is ignored.
+    enclave = _create(argv[1]);
+    OE_TEST(double_free(enclave) == OE_ENCLAVE_ABORTING);
+    oe_terminate_enclave(enclave);
+
+    enclave = _create(argv[1]);
+    OE_TEST(alloc_one(enclave) == OE_OK);
+    OE_TEST(free_one(enclave) == OE_OK);
+    thread([=] { OE_TEST(free_one(enclave) == OE_ENCLAVE_ABORTING); })
+        .join();
+    oe_terminate_enclave(enclave);
+
+    printf("=== passed all tests (hostpool)\n");
+    fflush(stdout);
+
+    return 0;
+}
@@ -0,0 +1,477 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include "internalsock_t.h"
+
+using namespace std;
+
+static const uint16_t _port = 4433;
+
+static int _bench_client = -1;
+static int _bench_server = -1;
+static bool _bench_epoll;
+
+static void _load_modules()
+{
+    OE_TEST(oe_load_module_host_socket_interface() == OE_OK);
+    OE_TEST(oe_load_module_host_epoll() == OE_OK);
+}
+
+// Creates a pair of sockets connected over 255.0.0.1. The server socket is
+// accepted with accept_flags.
+static void _connect(int* client, int* server, int accept_flags = 0)
+{
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(0xFF000001);
+    addr.sin_port = htons(_port);
+
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    OE_TEST(listener >= 0);
+    OE_TEST(bind(listener, (const sockaddr*)&addr, sizeof addr) == 0);
+    OE_TEST(listen(listener, 1) == 0);
+
+    *client = socket(AF_INET, SOCK_STREAM, 0);
+    OE_TEST(*client >= 0);
+    OE_TEST(connect(*client, (const sockaddr*)&addr, sizeof addr) == 0);
+
+    *server = accept4(listener, nullptr, nullptr, accept_flags);
+    OE_TEST(*server >= 0);
+    OE_TEST(close(listener) == 0);
+}
+
+static int _epoll_create(int fd, uint32_t events)
+{
+    const int epfd = epoll_create1(0);
+    OE_TEST(epfd >= 0);
+
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    OE_TEST(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &event) == 0);
+
+    return epfd;
+}
+
+// Returns whether the epoll reports its socket as readable without waiting.
+static bool _epoll_readable(int epfd)
+{
+    epoll_event event{};
+    const int n = epoll_wait(epfd, &event, 1, 0);
+    OE_TEST(n >= 0);
+    return n == 1 && (event.events & EPOLLIN);
+}
+
+// Returns whether poll() reports the socket as readable without waiting.
+static bool _poll_readable(int fd)
+{
+    pollfd p{};
+    p.fd = fd;
+    p.events = POLLIN;
+    const int n = poll(&p, 1, 0);
+    OE_TEST(n >= 0);
+    return n == 1 && (p.revents & POLLIN);
+}
+
+static void _test_eagain(int fd)
+{
+    char c;
+    OE_TEST(recv(fd, &c, 1, 0) == -1 && errno == EAGAIN);
+}
+
+static void _test_level_triggered()
+{
+    int client;
+    int server;
+    _connect(&client, &server);
+    OE_TEST(fcntl(server, F_SETFL, O_NONBLOCK) == 0);
+
+    // data that has been sent before the socket is watched
+    OE_TEST(send(client, "a", 1, 0) == 1);
+    const int epfd = _epoll_create(server, EPOLLIN);
+    OE_TEST(_epoll_readable(epfd));
+    OE_TEST(_epoll_readable(epfd));
+
+    char buf[8];
+    OE_TEST(recv(server, buf, sizeof buf, 0) == 1);
+    OE_TEST(!_epoll_readable(epfd));
+    _test_eagain(server);
+
+    OE_TEST(send(client, "bc", 2, 0) == 2);
+    OE_TEST(send(client, "d", 1, 0) == 1);
+    OE_TEST(_epoll_readable(epfd));
+    OE_TEST(_poll_readable(server));
+    OE_TEST(recv(server, buf, sizeof buf, 0) == 3);
+    OE_TEST(!_epoll_readable(epfd));
+    OE_TEST(!_poll_readable(server));
+
+    // hangup
+    OE_TEST(close(client) == 0);
+    OE_TEST(_epoll_readable(epfd));
+    OE_TEST(_poll_readable(server));
+    OE_TEST(recv(server, buf, sizeof buf, 0) == 0);
+
+    OE_TEST(close(epfd) == 0);
+    OE_TEST(close(server) == 0);
+}
+
+static void _test_edge_triggered()
+{
+    int client;
+    int server;
+    _connect(&client, &server);
+    OE_TEST(fcntl(server, F_SETFL, O_NONBLOCK) == 0);
+
+    const int epfd = _epoll_create(server, EPOLLIN | EPOLLET);
+    OE_TEST(!_epoll_readable(epfd));
+
+    // Each message that arrives after the reader got EAGAIN is a new edge.
+    for (int i = 0; i < 3; i++)
+    {
+        char c = 0;
+        OE_TEST(send(client, "a", 1, 0) == 1);
+        OE_TEST(_epoll_readable(epfd));
+        OE_TEST(!_epoll_readable(epfd));
+        OE_TEST(recv(server, &c, 1, 0) == 1);
+        OE_TEST(c == 'a');
+        _test_eagain(server);
+    }
+
+    // Switching to level-triggered makes the state visible again.
+    OE_TEST(send(client, "b", 1, 0) == 1);
+    OE_TEST(_epoll_readable(epfd));
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = server;
+    OE_TEST(epoll_ctl(epfd, EPOLL_CTL_MOD, server, &event) == 0);
+    OE_TEST(_epoll_readable(epfd));
+    OE_TEST(_epoll_readable(epfd));
+
+    OE_TEST(close(client) == 0);
+    OE_TEST(close(epfd) == 0);
+    OE_TEST(close(server) == 0);
+}
+
+// An epoll can watch internal sockets and host fds at the same time.
+static void _test_mixed()
+{
+    int client;
+    int server;
+    _connect(&client, &server);
+    OE_TEST(fcntl(server, F_SETFL, O_NONBLOCK) == 0);
+
+    // Only internal sockets are watched, so the timeout elapses in the
+    // enclave.
+    const int epfd = _epoll_create(server, EPOLLIN);
+    epoll_event events[2]{};
+    OE_TEST(epoll_wait(epfd, events, 2, 10) == 0);
+
+    const int efd = eventfd(0, EFD_NONBLOCK);
+    OE_TEST(efd >= 0);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = efd;
+    OE_TEST(epoll_ctl(epfd, EPOLL_CTL_ADD, efd, &event) == 0);
+    OE_TEST(epoll_wait(epfd, events, 2, 10) == 0);
+
+    const uint64_t value = 1;
+    OE_TEST(write(efd, &value, sizeof value) == sizeof value);
+    OE_TEST(epoll_wait(epfd, events, 2, -1) == 1);
+    OE_TEST(events[0].data.fd == efd);
+
+    OE_TEST(send(client, "a", 1, 0) == 1);
+    OE_TEST(epoll_wait(epfd, events, 2, -1) == 2);
+    OE_TEST(events[0].data.fd != events[1].data.fd);
+    for (const epoll_event& e : events)
+        OE_TEST(e.data.fd == efd || e.data.fd == server);
+
+    // A closed socket is removed from the epoll.
+    OE_TEST(close(client) == 0);
+    OE_TEST(close(server) == 0);
+    OE_TEST(epoll_wait(epfd, events, 2, 0) == 1);
+    OE_TEST(events[0].data.fd == efd);
+
+    OE_TEST(close(efd) == 0);
+    OE_TEST(close(epfd) == 0);
+}
+
+void test_readiness()
+{
+    _load_modules();
+    _test_level_triggered();
+    _test_edge_triggered();
+    _test_mixed();
+}
+
+// Receives count bytes. A nonblocking socket is read until EAGAIN and then
+// waits for the next edge, like the Go netpoller does.
+static void _recv_all(int fd, int epfd, char* buf, size_t count)
+{
+    size_t received = 0;
+
+    while (received < count)
+    {
+        const ssize_t n = recv(fd, buf + received, count - received, 0);
+        if (n > 0)
+        {
+            received += (size_t)n;
+            continue;
+        }
+
+        OE_TEST(n == -1 && errno == EAGAIN && epfd >= 0);
+        epoll_event event{};
+        OE_TEST(epoll_wait(epfd, &event, 1, -1) == 1);
+    }
+}
+
+static int _get_bufsize(int fd, int optname)
+{
+    int value = 0;
+    socklen_t len = sizeof value;
+    OE_TEST(getsockopt(fd, SOL_SOCKET, optname, &value, &len) == 0);
+    OE_TEST(len == sizeof value);
+    return value;
+}
+
+static void _set_bufsize(int fd, int optname, int value)
+{
+    OE_TEST(setsockopt(fd, SOL_SOCKET, optname, &value, sizeof value) == 0);
+}
+
+void test_bufsize()
+{
+    _load_modules();
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(0xFF000001);
+    addr.sin_port = htons(_port);
+
+    // The listener passes its options on to the accepted socket.
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    OE_TEST(listener >= 0);
+    OE_TEST(bind(listener, (const sockaddr*)&addr, sizeof addr) == 0);
+    _set_bufsize(listener, SO_RCVBUF, 8192);
+    OE_TEST(listen(listener, 1) == 0);
+
+    // Options that are set before connecting apply to the connection.
+    const int client = socket(AF_INET, SOCK_STREAM, 0);
+    OE_TEST(client >= 0);
+    _set_bufsize(client, SO_SNDBUF, 32768);
+    OE_TEST(connect(client, (const sockaddr*)&addr, sizeof addr) == 0);
+
+    const int server = accept(listener, nullptr, nullptr);
+    OE_TEST(server >= 0);
+    OE_TEST(close(listener) == 0);
+
+    // Linux doubles the values.
+    OE_TEST(_get_bufsize(client, SO_SNDBUF) == 65536);
+    OE_TEST(_get_bufsize(server, SO_RCVBUF) == 16384);
+    OE_TEST(_get_bufsize(client, SO_RCVBUF) == 131072);
+    OE_TEST(_get_bufsize(server, SO_SNDBUF) == 16384);
+
+    // The buffer grows to SO_SNDBUF of the sender plus SO_RCVBUF of the
+    // receiver, so this does not block although nobody receives yet.
+    const size_t size = 65536 + 16384;
+    vector<char> data(size);
+    for (size_t i = 0; i < size; i++)
+        data[i] = (char)(i % 251);
+    OE_TEST(send(client, data.data(), size, 0) == (ssize_t)size);
+
+    vector<char> received(size);
+    OE_TEST(fcntl(server, F_SETFL, O_NONBLOCK) == 0);
+    _recv_all(server, -1, received.data(), size);
+    OE_TEST(received == data);
+    _test_eagain(server);
+
+    // The options of connected sockets can be changed.
+    _set_bufsize(server, SO_RCVBUF, 1 << 20);
+    OE_TEST(_get_bufsize(server, SO_RCVBUF) == 2 << 20);
+
+    OE_TEST(close(client) == 0);
+    OE_TEST(close(server) == 0);
+}
+
+static bool _is_nonblocking(int fd)
+{
+    const int flags = fcntl(fd, F_GETFL);
+    OE_TEST(flags != -1);
+    return flags & O_NONBLOCK;
+}
+
+// Checks that a dup sees O_NONBLOCK set on the original socket and vice versa.
+static void _test_dup_nonblocking(int fd)
+{
+    const int dupfd = dup(fd);
+    OE_TEST(dupfd >= 0);
+
+    OE_TEST(fcntl(fd, F_SETFL, O_NONBLOCK) == 0);
+    OE_TEST(_is_nonblocking(dupfd));
+    _test_eagain(dupfd);
+
+    OE_TEST(fcntl(dupfd, F_SETFL, 0) == 0);
+    OE_TEST(!_is_nonblocking(fd));
+
+    OE_TEST(close(dupfd) == 0);
+}
+
+void test_nonblocking()
+{
+    _load_modules();
+
+    int client;
+    int server;
+    _connect(&client, &server);
+    _test_dup_nonblocking(server);
+    OE_TEST(close(client) == 0);
+    OE_TEST(close(server) == 0);
+
+    _connect(&client, &server, SOCK_NONBLOCK);
+    OE_TEST(_is_nonblocking(server));
+    _test_eagain(server);
+    OE_TEST(close(client) == 0);
+    OE_TEST(close(server) == 0);
+
+    // host sockets
+    int sv[2];
+    OE_TEST(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    _test_dup_nonblocking(sv[0]);
+
+    int on = 1;
+    OE_TEST(ioctl(sv[1], FIONBIO, &on) == 0);
+    const int dupfd = dup(sv[1]);
+    OE_TEST(dupfd >= 0);
+    OE_TEST(_is_nonblocking(dupfd));
+    _test_eagain(dupfd);
+    int off = 0;
+    OE_TEST(ioctl(dupfd, FIONBIO, &off) == 0);
+    OE_TEST(!_is_nonblocking(sv[1]));
+    OE_TEST(close(dupfd) == 0);
+    OE_TEST(close(sv[0]) == 0);
+    OE_TEST(close(sv[1]) == 0);
+
+    OE_TEST(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) == 0);
+    _test_eagain(sv[0]);
+    _test_eagain(sv[1]);
+    OE_TEST(close(sv[0]) == 0);
+    OE_TEST(close(sv[1]) == 0);
+}
+
+void bench_setup(bool use_epoll)
+{
+    _load_modules();
+    _connect(&_bench_client, &_bench_server);
+    _bench_epoll = use_epoll;
+
+    if (use_epoll)
+    {
+        OE_TEST(fcntl(_bench_client, F_SETFL, O_NONBLOCK) == 0);
+        OE_TEST(fcntl(_bench_server, F_SETFL, O_NONBLOCK) == 0);
+    }
+}
+
+void bench_teardown()
+{
+    OE_TEST(close(_bench_client) == 0);
+    OE_TEST(_bench_server == -1 || close(_bench_server) == 0);
+    _bench_client = -1;
+    _bench_server = -1;
+}
+
+static void _ping_pong(int fd, size_t count, bool first)
+{
+    const int epfd = _bench_epoll ? _epoll_create(fd, EPOLLIN | EPOLLET) : -1;
+    char msg[64] = {};
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!first)
+            _recv_all(fd, epfd, msg, sizeof msg);
+        OE_TEST(send(fd, msg, sizeof msg, 0) == sizeof msg);
+        if (first)
+            _recv_all(fd, epfd, msg, sizeof msg);
+    }
+
+    if (epfd >= 0)
+        OE_TEST(close(epfd) == 0);
+}
+
+void bench_ping(size_t count)
+{
+    _ping_pong(_bench_client, count, true);
+}
+
+void bench_echo(size_t count)
+{
+    _ping_pong(_bench_server, count, false);
+}
+
+void bench_send(size_t size, size_t count)
+{
+    vector<char> msg(size);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        memset(msg.data(), (int)i, size);
+        OE_TEST(send(_bench_client, msg.data(), size, 0) == (ssize_t)size);
+    }
+}
+
+void bench_recv(size_t size, size_t count)
+{
+    vector<char> msg(size);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        _recv_all(_bench_server, -1, msg.data(), size);
+        for (const char c : msg)
+            OE_TEST(c == (char)i);
+    }
+}
+
+size_t partial_send(size_t size)
+{
+    const vector<char> data(size);
+    const ssize_t n = send(_bench_client, data.data(), size, 0);
+    OE_TEST(n > 0);
+    return (size_t)n;
+}
+
+size_t partial_recv(size_t size)
+{
+    vector<char> buf(65536);
+    size_t total = 0;
+
+    while (total < size)
+    {
+        const ssize_t n = recv(_bench_server, buf.data(), buf.size(), 0);
+        OE_TEST(n > 0);
+        total += (size_t)n;
+    }
+
+    OE_TEST(close(_bench_server) == 0);
+    _bench_server = -1;
+    return total;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    2048, /* NumHeapPages */
+    64,   /* NumStackPages */
+    3);   /* NumTCS */
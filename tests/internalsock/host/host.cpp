@@ -0,0 +1,122 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/tests.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include "internalsock_u.h"
+
+using namespace std;
+
+// Exchanges count messages between two enclave threads and returns the mean
+// round-trip time in microseconds.
+static double _ping_pong(oe_enclave_t* enclave, bool use_epoll, size_t count)
+{
+    OE_TEST(bench_setup(enclave, use_epoll) == OE_OK);
+
+    const auto start = chrono::steady_clock::now();
+    thread echo([=] { OE_TEST(bench_echo(enclave, count) == OE_OK); });
+    OE_TEST(bench_ping(enclave, count) == OE_OK);
+    echo.join();
+    const chrono::duration<double, micro> us =
+        chrono::steady_clock::now() - start;
+
+    OE_TEST(bench_teardown(enclave) == OE_OK);
+
+    return us.count() / count;
+}
+
+// Transfers count messages of the given size from one enclave thread to
+// another and returns the throughput in MB/s.
+static double _bulk(oe_enclave_t* enclave, size_t size, size_t count)
+{
+    OE_TEST(bench_setup(enclave, false) == OE_OK);
+
+    const auto start = chrono::steady_clock::now();
+    thread recv([=] { OE_TEST(bench_recv(enclave, size, count) == OE_OK); });
+    OE_TEST(bench_send(enclave, size, count) == OE_OK);
+    recv.join();
+    const chrono::duration<double, micro> us =
+        chrono::steady_clock::now() - start;
+
+    OE_TEST(bench_teardown(enclave) == OE_OK);
+
+    return (double)(size * count) / us.count();
+}
+
+// Closes the receiver while it is consuming a large send, which then returns
+// the number of bytes received like a partial write.
+static void _test_partial_send(oe_enclave_t* enclave)
+{
+    OE_TEST(bench_setup(enclave, false) == OE_OK);
+
+    size_t sent = 0;
+    thread sender(
+        [&] { OE_TEST(partial_send(enclave, &sent, 2 << 20) == OE_OK); });
+    size_t received = 0;
+    OE_TEST(partial_recv(enclave, &received, 512 << 10) == OE_OK);
+    sender.join();
+    OE_TEST(sent == received);
+
+    OE_TEST(bench_teardown(enclave) == OE_OK);
+}
+
+static void _bench(oe_enclave_t* enclave)
+{
+    const size_t count = 100000;
+
+    printf("%10s %16s\n", "waiting", "round trip us");
+    printf("%10s %16.2f\n", "blocking", _ping_pong(enclave, false, count));
+    printf("%10s %16.2f\n", "epoll", _ping_pong(enclave, true, count));
+
+    printf("\n%10s %16s\n", "send size", "MB/s");
+    for (const size_t size : {4096, 65536, 1048576})
+        printf(
+            "%10zu %16.0f\n",
+            size,
+            _bulk(enclave, size, ((size_t)1 << 30) / size));
+}
+
+static void _test(oe_enclave_t* enclave)
+{
+    OE_TEST(test_readiness(enclave) == OE_OK);
+    OE_TEST(test_bufsize(enclave) == OE_OK);
+    OE_TEST(test_nonblocking(enclave) == OE_OK);
+    _ping_pong(enclave, false, 100);
+    _ping_pong(enclave, true, 100);
+    _bulk(enclave, 4096, 100);
+    _bulk(enclave, 1048576, 8);
+    _test_partial_send(enclave);
+}
+
+int main(int argc, const char* argv[])
+{
+    const uint32_t flags = oe_get_create_flags();
+    const oe_enclave_type_t type = OE_ENCLAVE_TYPE_SGX;
+
+    if (argc != 2 && !(argc == 3 && strcmp(argv[2], "--bench") == 0))
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH [--bench]\n", argv[0]);
+        return 1;
+    }
+
+    oe_enclave_t* enclave;
+    OE_TEST(
+        oe_create_internalsock_enclave(
+            argv[1], type, flags, NULL, 0, &enclave) == OE_OK);
+
+    if (argc == 3)
+        _bench(enclave);
+    else
+        _test(enclave);
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    printf("=== passed all tests (internalsock)\n");
+    fflush(stdout);
+
+    return 0;
+}
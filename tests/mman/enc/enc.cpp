@@ -2,6 +2,7 @@
 #include <openenclave/internal/tests.h>
 #include <sys/mman.h>
 #include <algorithm>
+#include <cerrno>
 #include <cstdint>
 #include <cstring>
 #include "test_t.h"
@@ -63,6 +64,47 @@ void test_ecall()
     // internally instead of directly using the enclave heap memory.)
     OE_TEST(*a == 'a');
     delete a;
+
+    // test mremap
+    const auto m = static_cast<uint8_t*>(mmap(
+        nullptr, 3 * OE_PAGE_SIZE, PROT_READ | PROT_WRITE, flags, -1, 0));
+    OE_TEST(m != MAP_FAILED);
+    memset(m, 3, 3 * OE_PAGE_SIZE);
+
+    // shrink and grow in place
+    OE_TEST(mremap(m, 3 * OE_PAGE_SIZE, OE_PAGE_SIZE, 0) == m);
+    _test_filled(m, OE_PAGE_SIZE, 3);
+    OE_TEST(mremap(m, OE_PAGE_SIZE, 2 * OE_PAGE_SIZE, 0) == m);
+    _test_filled(m, OE_PAGE_SIZE, 3);
+    _test_filled(m + OE_PAGE_SIZE, OE_PAGE_SIZE, 0);
+
+    // the following page is in use, so growing requires moving
+    const auto fixed = static_cast<uint8_t*>(mmap(
+        m + 2 * OE_PAGE_SIZE,
+        OE_PAGE_SIZE,
+        PROT_READ | PROT_WRITE,
+        flags | MAP_FIXED,
+        -1,
+        0));
+    OE_TEST(fixed == m + 2 * OE_PAGE_SIZE);
+    OE_TEST(
+        mremap(m, 2 * OE_PAGE_SIZE, 3 * OE_PAGE_SIZE, 0) == MAP_FAILED &&
+        errno == ENOMEM);
+    const auto moved = static_cast<uint8_t*>(
+        mremap(m, 2 * OE_PAGE_SIZE, 3 * OE_PAGE_SIZE, MREMAP_MAYMOVE));
+    OE_TEST(moved != MAP_FAILED && moved != m);
+    _test_filled(moved, OE_PAGE_SIZE, 3);
+    _test_filled(moved + OE_PAGE_SIZE, 2 * OE_PAGE_SIZE, 0);
+
+    // test invalid args
+    OE_TEST(mremap(moved + 1, 1, 1, 0) == MAP_FAILED && errno == EINVAL);
+    OE_TEST(mremap(moved, 0, 1, 0) == MAP_FAILED && errno == EINVAL);
+    OE_TEST(
+        mremap(m, OE_PAGE_SIZE, OE_PAGE_SIZE, 0) == MAP_FAILED &&
+        errno == EFAULT); // no longer mapped
+
+    OE_TEST(munmap(moved, 3 * OE_PAGE_SIZE) == 0);
+    OE_TEST(munmap(fixed, OE_PAGE_SIZE) == 0);
 }
 
 OE_SET_ENCLAVE_SGX(
@@ -96,10 +96,19 @@ void enc_test_reentrancy()
     OE_TEST(OE_OK == result);
 }
 
-OE_SET_ENCLAVE_SGX(
+void enc_test_large_ocall()
+{
+    static uint8_t data[LARGE_OCALL_SIZE];
+    memset(data, 0xAA, sizeof(data));
+    OE_TEST(host_large_ocall(data, sizeof(data)) == OE_OK);
+}
+
+OE_SET_ENCLAVE_SGX_EX(
     1,    /* ProductID */
     1,    /* SecurityVersion */
     true, /* Debug */
     1024, /* NumHeapPages */
     128,  /* NumStackPages */
-    16);  /* NumTCS */
+    16,   /* NumTCS */
+    4,    /* OcallBufferPages */
+    64);  /* MaxOcallBufferPages */
@@ -32,6 +32,79 @@ void host_test_reentrancy()
     g_reentrancy_tested = true;
 }
 
+static size_t g_large_ocall_size = 0;
+void host_large_ocall(const void*, size_t size)
+{
+    g_large_ocall_size = size;
+}
+
+static oe_ocall_buffer_statistics_t _get_ocall_buffer_statistics(
+    oe_enclave_t* enclave)
+{
+    oe_ocall_buffer_statistics_t statistics[16];
+    oe_ocall_buffer_statistics_t total = {};
+    size_t count = OE_COUNTOF(statistics);
+
+    OE_TEST(
+        oe_get_ocall_buffer_statistics(enclave, statistics, &count) == OE_OK);
+    OE_TEST(count == OE_COUNTOF(statistics));
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (statistics[i].buffer_size > total.buffer_size)
+            total.buffer_size = statistics[i].buffer_size;
+        if (statistics[i].high_water > total.high_water)
+            total.high_water = statistics[i].high_water;
+        total.fallback_count += statistics[i].fallback_count;
+        total.grow_count += statistics[i].grow_count;
+    }
+
+    return total;
+}
+
+static void _test_ocall_buffer_growth(oe_enclave_t* enclave)
+{
+    size_t count = 0;
+    OE_TEST(
+        oe_get_ocall_buffer_statistics(enclave, NULL, &count) ==
+        OE_BUFFER_TOO_SMALL);
+    OE_TEST(count == 16);
+
+    const oe_ocall_buffer_statistics_t before =
+        _get_ocall_buffer_statistics(enclave);
+    OE_TEST(before.buffer_size == 4 * OE_PAGE_SIZE);
+
+    // The parameters do not fit into the buffer of 4 pages.
+    OE_TEST(enc_test_large_ocall(enclave) == OE_OK);
+    OE_TEST(g_large_ocall_size == LARGE_OCALL_SIZE);
+    const oe_ocall_buffer_statistics_t fallback =
+        _get_ocall_buffer_statistics(enclave);
+    OE_TEST(fallback.fallback_count == before.fallback_count + 1);
+    OE_TEST(fallback.high_water > LARGE_OCALL_SIZE);
+
+    // The buffer has grown to fit them before the next ecall.
+    OE_TEST(enc_test_large_ocall(enclave) == OE_OK);
+    const oe_ocall_buffer_statistics_t grown =
+        _get_ocall_buffer_statistics(enclave);
+    OE_TEST(grown.fallback_count == fallback.fallback_count);
+    OE_TEST(grown.grow_count == fallback.grow_count + 1);
+    OE_TEST(grown.buffer_size >= fallback.high_water);
+    OE_TEST(grown.buffer_size <= 64 * OE_PAGE_SIZE);
+
+    // The buffer shrinks again after a window of 1024 ecalls without large
+    // ocalls. The window that is already running may still see one.
+    for (size_t i = 0; i < 2 * 1024; i++)
+    {
+        uint64_t ret_val = 0;
+        OE_TEST(enc_test2(enclave, &ret_val, i) == OE_OK);
+    }
+    const oe_ocall_buffer_statistics_t shrunk =
+        _get_ocall_buffer_statistics(enclave);
+    OE_TEST(shrunk.buffer_size == 4 * OE_PAGE_SIZE);
+    OE_TEST(shrunk.grow_count == grown.grow_count);
+    OE_TEST(shrunk.high_water == grown.high_water);
+}
+
 int main(int argc, const char* argv[])
 {
     if (argc != 2)
@@ -116,6 +189,8 @@ int main(int argc, const char* argv[])
         OE_TEST(g_reentrancy_tested);
     }
 
+    _test_ocall_buffer_growth(enclave);
+
     oe_terminate_enclave(enclave);
 
     printf("=== passed all tests (%s)\n", argv[0]);
@@ -72,7 +72,8 @@ static void _check_properties(
     /* Check the SGX config */
     OE_TEST(config->product_id == product_id);
     OE_TEST(config->security_version == security_version);
-    OE_TEST(config->padding == 0);
+    OE_TEST(config->ocall_buffer_pages == 0);
+    OE_TEST(config->max_ocall_buffer_pages == 0);
     OE_TEST(config->attributes == attributes);
     OE_TEST(config->xfrm == cur_enclave_xfrm);
 
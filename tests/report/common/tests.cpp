@@ -1310,6 +1310,34 @@ void test_verify_report_with_collaterals()
                 NULL, // Validate using current time
                 NULL) == OE_OK);
 
+        /* The certificate and collateral checks of the report are cached now,
+         * but a modified quote must still fail its signature check. */
+        {
+            oe_report_header_t* header =
+                (oe_report_header_t*)report_buffer_ptr;
+            sgx_quote_t* quote = (sgx_quote_t*)header->report;
+
+            quote->report_body.report_data.field[0] ^= 1;
+            OE_TEST(
+                VerifyReportWithCollaterals(
+                    report_buffer_ptr,
+                    report_ptr_size,
+                    collaterals_buffer_ptr,
+                    collaterals_ptr_size,
+                    NULL,
+                    NULL) != OE_OK);
+
+            quote->report_body.report_data.field[0] ^= 1;
+            OE_TEST(
+                VerifyReportWithCollaterals(
+                    report_buffer_ptr,
+                    report_ptr_size,
+                    collaterals_buffer_ptr,
+                    collaterals_ptr_size,
+                    NULL,
+                    NULL) == OE_OK);
+        }
+
         /* Test with time in the past */
         time_t t;
         struct tm timeinfo;
@@ -41,6 +41,43 @@ void test_ecall()
     oe_ringbuffer_free(rb);
 }
 
+void test_resize()
+{
+    array<char, 16> buf;
+
+    auto rb = oe_ringbuffer_alloc(4);
+    OE_TEST(rb);
+    OE_TEST(oe_ringbuffer_capacity(rb) == 4);
+    OE_TEST(oe_ringbuffer_size(rb) == 0);
+
+    // wrap around before resizing
+    OE_TEST(oe_ringbuffer_write(rb, "abc", 3) == 3);
+    OE_TEST(oe_ringbuffer_read(rb, buf.data(), 2) == 2);
+    OE_TEST(oe_ringbuffer_write(rb, "def", 3) == 3);
+    OE_TEST(oe_ringbuffer_size(rb) == 4);
+    OE_TEST(oe_ringbuffer_write(rb, "g", 1) == 0);
+
+    rb = oe_ringbuffer_resize(rb, 8);
+    OE_TEST(rb);
+    OE_TEST(oe_ringbuffer_capacity(rb) == 8);
+    OE_TEST(oe_ringbuffer_size(rb) == 4);
+    OE_TEST(oe_ringbuffer_write(rb, "ghijk", 5) == 4);
+    OE_TEST(oe_ringbuffer_size(rb) == 8);
+    OE_TEST(oe_ringbuffer_read(rb, buf.data(), 16) == 8);
+    OE_TEST(memcmp(buf.data(), "cdefghij", 8) == 0);
+    OE_TEST(oe_ringbuffer_empty(rb));
+
+    // a full buffer can be moved to a buffer of the same capacity
+    OE_TEST(oe_ringbuffer_write(rb, "klmnopqr", 8) == 8);
+    rb = oe_ringbuffer_resize(rb, 8);
+    OE_TEST(rb);
+    OE_TEST(oe_ringbuffer_write(rb, "s", 1) == 0);
+    OE_TEST(oe_ringbuffer_read(rb, buf.data(), 16) == 8);
+    OE_TEST(memcmp(buf.data(), "klmnopqr", 8) == 0);
+
+    oe_ringbuffer_free(rb);
+}
+
 OE_SET_ENCLAVE_SGX(
     1,    /* ProductID */
     1,    /* SecurityVersion */
@@ -21,6 +21,7 @@ int main(int argc, char* argv[])
             argv[1], OE_ENCLAVE_TYPE_AUTO, flags, nullptr, 0, &enclave) ==
         OE_OK);
     OE_TEST(test_ecall(enclave) == OE_OK);
+    OE_TEST(test_resize(enclave) == OE_OK);
     OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
 
     cout << "=== passed all tests (" << argv[0] << ")\n";
@@ -0,0 +1,19 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/globals.h>
+#include "startup_t.h"
+
+uint64_t get_heap_size(void)
+{
+    return __oe_get_heap_size();
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,          /* ProductID */
+    1,          /* SecurityVersion */
+    true,       /* Debug */
+    HEAP_PAGES, /* NumHeapPages */
+    64,         /* NumStackPages */
+    4);         /* NumTCS */
@@ -0,0 +1,89 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/tests.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "startup_u.h"
+
+using namespace std;
+
+// Creates the enclave, checks that it runs and returns the time that the
+// creation took.
+static double _start(const char* path, uint64_t* heap_size)
+{
+    const uint32_t flags = oe_get_create_flags();
+    oe_enclave_t* enclave = nullptr;
+
+    const auto start = chrono::steady_clock::now();
+    OE_TEST(
+        oe_create_startup_enclave(
+            path, OE_ENCLAVE_TYPE_SGX, flags, nullptr, 0, &enclave) == OE_OK);
+    const chrono::duration<double> seconds =
+        chrono::steady_clock::now() - start;
+
+    OE_TEST(get_heap_size(enclave, heap_size) == OE_OK);
+    OE_TEST(*heap_size > 0);
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+
+    return seconds.count();
+}
+
+// Measures the startup time of enclaves with different heap sizes.
+static void _bench(const vector<const char*>& paths)
+{
+    const int runs = 3;
+
+    printf("%10s %12s\n", "heap MiB", "startup ms");
+
+    for (const char* path : paths)
+    {
+        uint64_t heap_size = 0;
+        double seconds = _start(path, &heap_size);
+
+        for (int i = 1; i < runs; i++)
+            seconds = min(seconds, _start(path, &heap_size));
+
+        printf("%10zu %12.1f\n", heap_size >> 20, seconds * 1000);
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    vector<const char*> paths;
+    bool bench = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--bench") == 0)
+            bench = true;
+        else
+            paths.push_back(argv[i]);
+    }
+
+    if (paths.empty())
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH... [--bench]\n", argv[0]);
+        return 1;
+    }
+
+    if (bench)
+        _bench(paths);
+    else
+    {
+        for (const char* path : paths)
+        {
+            uint64_t heap_size = 0;
+            _start(path, &heap_size);
+        }
+    }
+
+    printf("=== passed all tests (startup)\n");
+    fflush(stdout);
+
+    return 0;
+}
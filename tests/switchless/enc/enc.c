@@ -1,17 +1,22 @@
 // Copyright (c) Open Enclave SDK contributors.
 // Licensed under the MIT License.
 
+#include <fcntl.h>
 #include <openenclave/corelibc/string.h>
 #include <openenclave/enclave.h>
+#include <openenclave/internal/calls.h>
 #include <openenclave/internal/print.h>
 #include <openenclave/internal/tests.h>
 #include <string.h>
+#include <sys/mount.h>
+#include <unistd.h>
 #include "switchless_test_t.h"
 
 #define STRING_LEN 100
 #define STRING_HELLO "Hello World"
 #define HOST_PARAM_STRING "host string parameter"
 #define HOST_STACK_STRING "host string on stack"
+#define NUM_ASYNC_CALLS 16
 
 int enc_test_echo_switchless(const char* in, char out[STRING_LEN], int repeats)
 {
@@ -77,6 +82,86 @@ int enc_test_echo_regular(const char* in, char out[STRING_LEN], int repeats)
     return 0;
 }
 
+int enc_test_async_switchless(int repeats)
+{
+    oe_switchless_call_t calls[NUM_ASYNC_CALLS];
+    host_increment_switchless_args_t* args[NUM_ASYNC_CALLS];
+    size_t output_bytes_written[NUM_ASYNC_CALLS];
+    int retvals[NUM_ASYNC_CALLS];
+
+    // Marshal the calls by hand, as the generated stubs do.
+    for (int r = 0; r < repeats; r++)
+    {
+        for (int i = 0; i < NUM_ASYNC_CALLS; i++)
+        {
+            args[i] = (host_increment_switchless_args_t*)
+                oe_allocate_switchless_async_ocall_buffer(sizeof(*args[i]));
+            OE_TEST(args[i] != NULL);
+            memset(args[i], 0, sizeof(*args[i]));
+            args[i]->n = r + i;
+
+            OE_TEST(
+                oe_switchless_call_host_function_async(
+                    switchless_test_fcn_id_host_increment_switchless,
+                    args[i],
+                    sizeof(*args[i]),
+                    args[i],
+                    sizeof(*args[i]),
+                    &calls[i]) == OE_OK);
+        }
+
+        oe_result_t result = oe_switchless_call_poll(&calls[0]);
+        OE_TEST(result == OE_OK || result == OE_BUSY);
+
+        OE_TEST(
+            oe_switchless_call_wait_all(
+                calls, NUM_ASYNC_CALLS, output_bytes_written) == OE_OK);
+
+        for (int i = 0; i < NUM_ASYNC_CALLS; i++)
+        {
+            OE_TEST(calls[i].args == NULL);
+            OE_TEST(output_bytes_written[i] >= sizeof(*args[i]));
+            OE_TEST(args[i]->_result == OE_OK);
+            OE_TEST(args[i]->_retval == r + i + 1);
+            oe_free_switchless_async_ocall_buffer(args[i]);
+        }
+    }
+
+    OE_TEST(oe_switchless_call_poll(&calls[0]) == OE_INVALID_PARAMETER);
+
+    // The same with the stubs generated by oeedger8r.
+    for (int r = 0; r < repeats; r++)
+    {
+        for (int i = 0; i < NUM_ASYNC_CALLS; i++)
+            OE_TEST(
+                host_increment_switchless_async(
+                    &calls[i], &retvals[i], r + i) == OE_OK);
+
+        for (int i = 0; i < NUM_ASYNC_CALLS; i++)
+        {
+            retvals[i] = 0;
+            OE_TEST(
+                host_increment_switchless_async_complete(
+                    &calls[i], &retvals[i], r + i) == OE_OK);
+            OE_TEST(retvals[i] == r + i + 1);
+            OE_TEST(calls[i].args == NULL);
+        }
+    }
+
+    // The parameters must match those of the posted call.
+    OE_TEST(
+        host_increment_switchless_async(&calls[0], &retvals[0], 1) == OE_OK);
+    OE_TEST(
+        oe_switchless_call_get_buffer(&calls[0], 1) == NULL &&
+        calls[0].args != NULL);
+    OE_TEST(
+        host_increment_switchless_async_complete(
+            &calls[0], &retvals[0], 1) == OE_OK);
+    OE_TEST(retvals[0] == 2);
+
+    return 0;
+}
+
 int enc_echo_switchless(
     const char* in,
     char* out,
@@ -6,6 +6,7 @@
 #include <openenclave/host.h>
 #include <openenclave/internal/atomic.h>
 #include <openenclave/internal/error.h>
+#include <openenclave/internal/switchless.h>
 #include <openenclave/internal/tests.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -62,6 +63,11 @@ int host_echo_switchless(
     return 0;
 }
 
+int host_increment_switchless(int n)
+{
+    return n + 1;
+}
+
 int host_echo_regular(
     const char* in,
     char* out,
@@ -76,6 +82,23 @@ int host_echo_regular(
     return 0;
 }
 
+void print_worker_statistics(
+    const char* pool,
+    const oe_switchless_worker_statistics_t* statistics)
+{
+    printf(
+        "Switchless %s workers: %zu workers, %zu sleeping, %" PRIu64
+        " spins, %" PRIu64 " sleeps, %" PRIu64 " wakeups, %" PRIu64
+        " calls\n",
+        pool,
+        statistics->num_workers,
+        statistics->num_sleeping_workers,
+        statistics->total_spin_count,
+        statistics->total_sleep_count,
+        statistics->total_wakeup_count,
+        statistics->total_call_count);
+}
+
 double make_repeated_switchless_ocalls(oe_enclave_t* enclave)
 {
     char out[STRING_LEN];
@@ -187,6 +210,38 @@ void test_switchless_ocalls(oe_enclave_t* enclave, uint64_t num_enclave_threads)
     printf(
         "Slowest switchless thread speedup factor : %.2f\n",
         (double)regular_microseconds / switchless_max);
+
+    // All calls have completed, so nothing may be left in the ring.
+    oe_switchless_ring_statistics_t statistics;
+    OE_TEST(oe_get_switchless_ring_statistics(enclave, &statistics) == OE_OK);
+    printf(
+        "Switchless ocall ring: %" PRIu64 " enqueued, %" PRIu64
+        " missed, peak occupancy %" PRIu64 " of %" PRIu64 "\n",
+        statistics.total_enqueued,
+        statistics.total_missed,
+        statistics.peak_occupancy,
+        statistics.capacity);
+    OE_TEST(statistics.occupancy == 0);
+    OE_TEST(statistics.peak_occupancy <= statistics.capacity);
+    OE_TEST(statistics.total_enqueued > 0);
+    OE_TEST(statistics.total_missed <= num_enclave_threads * NUM_OCALLS);
+
+    // Every call was either handled by a worker or withdrawn and missed.
+    oe_switchless_statistics_t worker_statistics;
+    OE_TEST(oe_get_switchless_statistics(enclave, &worker_statistics) == OE_OK);
+    print_worker_statistics("host", &worker_statistics.host_workers);
+    OE_TEST(
+        worker_statistics.host_workers.total_call_count <=
+        statistics.total_enqueued);
+    OE_TEST(
+        worker_statistics.host_workers.total_call_count +
+            statistics.total_missed >=
+        statistics.total_enqueued);
+
+    // Asynchronous switchless ocalls.
+    int return_val;
+    OE_TEST(enc_test_async_switchless(enclave, &return_val, 64) == OE_OK);
+    OE_TEST(return_val == 0);
 }
 
 int host_test_echo_switchless(
@@ -372,6 +427,64 @@ void test_switchless_ecalls(oe_enclave_t* enclave, uint64_t num_host_threads)
     printf(
         "Slowest switchless thread speedup factor : %.2f\n",
         (double)regular_microseconds / switchless_max);
+
+    // Calls that found no free worker were dispatched as regular ecalls.
+    oe_switchless_statistics_t worker_statistics;
+    OE_TEST(oe_get_switchless_statistics(enclave, &worker_statistics) == OE_OK);
+    print_worker_statistics("enclave", &worker_statistics.enclave_workers);
+    OE_TEST(
+        worker_statistics.enclave_workers.total_call_count <=
+        num_host_threads * NUM_ECALLS);
+}
+
+void test_switchless_syscalls(oe_enclave_t* enclave, const char* path)
+{
+    oe_switchless_statistics_t statistics;
+    uint64_t call_count;
+    double regular_microseconds, switchless_microseconds;
+    double start, end;
+    int return_val;
+
+    OE_TEST(oe_get_switchless_statistics(enclave, &statistics) == OE_OK);
+    call_count = statistics.host_workers.total_call_count;
+
+    start = get_relative_time_in_microseconds();
+    OE_TEST(
+        enc_bench_syscalls(enclave, &return_val, path, NUM_OCALLS, false) ==
+        OE_OK);
+    OE_TEST(return_val == 0);
+    end = get_relative_time_in_microseconds();
+    regular_microseconds = end - start;
+
+    // Regular syscalls must not be handled by the host workers.
+    OE_TEST(oe_get_switchless_statistics(enclave, &statistics) == OE_OK);
+    OE_TEST(statistics.host_workers.total_call_count == call_count);
+
+    start = get_relative_time_in_microseconds();
+    OE_TEST(
+        enc_bench_syscalls(enclave, &return_val, path, NUM_OCALLS, true) ==
+        OE_OK);
+    OE_TEST(return_val == 0);
+    end = get_relative_time_in_microseconds();
+    switchless_microseconds = end - start;
+
+    OE_TEST(oe_get_switchless_statistics(enclave, &statistics) == OE_OK);
+    print_worker_statistics("host", &statistics.host_workers);
+    OE_TEST(statistics.host_workers.total_call_count > call_count);
+
+    printf(
+        "Time spent in %d pwrite/pread pairs with regular OCALLs : %d "
+        "milliseconds\n",
+        NUM_OCALLS,
+        (int)regular_microseconds / 1000);
+    printf(
+        "Time spent in %d pwrite/pread pairs with switchless OCALLs : %d "
+        "milliseconds\n",
+        NUM_OCALLS,
+        (int)switchless_microseconds / 1000);
+    printf(
+        "Switchless syscalls speedup factor : %.2f\n",
+        regular_microseconds / switchless_microseconds);
 }
 
 int main(int argc, const char* argv[])
@@ -385,7 +498,8 @@ int main(int argc, const char* argv[])
         fprintf(
             stderr,
             "Usage: %s ENCLAVE_PATH [--host-threads n] [--enclave-threads n] "
-            "[--ecalls]\n",
+            "[--ecalls] [--adaptive-spin] [--auto-scale] "
+            "[--bench-syscalls path]\n",
             argv[0]);
         return 1;
     }
@@ -393,6 +507,8 @@ int main(int argc, const char* argv[])
     uint64_t num_host_threads = 1;
     uint64_t num_enclave_threads = 2;
     bool test_ecalls = false;
+    const char* syscalls_path = NULL;
+    uint32_t policy = 0;
 
     {
         int i = 2;
@@ -414,6 +530,20 @@ int main(int argc, const char* argv[])
             {
                 test_ecalls = true;
             }
+            else if (strcmp(argv[i], "--adaptive-spin") == 0)
+            {
+                policy |= OE_SWITCHLESS_POLICY_ADAPTIVE_SPIN;
+            }
+            else if (strcmp(argv[i], "--auto-scale") == 0)
+            {
+                policy |= OE_SWITCHLESS_POLICY_AUTO_SCALE;
+            }
+            else if (strcmp(argv[i], "--bench-syscalls") == 0)
+            {
+                if (++i == argc)
+                    goto print_usage;
+                syscalls_path = argv[i];
+            }
             else
                 goto print_usage;
 
@@ -429,7 +559,8 @@ int main(int argc, const char* argv[])
     const uint32_t flags = oe_get_create_flags();
 
     // Enable switchless and configure host
-    oe_enclave_setting_context_switchless_t switchless_setting = {0, 0};
+    oe_enclave_setting_context_switchless_t switchless_setting = {0, 0, 0};
+    switchless_setting.policy = policy;
 
     if (test_ecalls)
         switchless_setting.max_enclave_workers = num_enclave_threads;
@@ -451,6 +582,8 @@ int main(int argc, const char* argv[])
 
     if (test_ecalls)
         test_switchless_ecalls(enclave, num_host_threads);
+    else if (syscalls_path)
+        test_switchless_syscalls(enclave, syscalls_path);
     else
         test_switchless_ocalls(enclave, num_enclave_threads);
 
@@ -0,0 +1,322 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <fcntl.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <openenclave/syscall_batch.h>
+#include <sys/mount.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "batch_t.h"
+
+using namespace std;
+
+static void _mount()
+{
+    static bool mounted;
+
+    if (!mounted)
+    {
+        OE_TEST(oe_load_module_host_file_system() == OE_OK);
+        OE_TEST(oe_load_module_host_socket_interface() == OE_OK);
+        OE_TEST(mount("/", "/", OE_HOST_FILE_SYSTEM, 0, nullptr) == 0);
+        mounted = true;
+    }
+}
+
+static oe_syscall_op_t _op(
+    int opcode,
+    int fd,
+    void* buf = nullptr,
+    size_t len = 0)
+{
+    oe_syscall_op_t op{};
+    op.opcode = opcode;
+    op.fd = fd;
+    op.buf = buf;
+    op.len = len;
+    op.result = 1234;
+    return op;
+}
+
+static oe_syscall_op_t _msg_op(int opcode, int fd, msghdr* msg)
+{
+    oe_syscall_op_t op = _op(opcode, fd);
+    op.msg = msg;
+    return op;
+}
+
+// Writes, an fsync and a close in one batch, then reads in one batch.
+static void _test_file(const char* path)
+{
+    char hello[] = "hello";
+    char world[] = " world";
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    OE_TEST(fd >= 0);
+
+    vector<oe_syscall_op_t> ops{
+        _op(OE_BATCH_OP_WRITE, fd, hello, 5),
+        _op(OE_BATCH_OP_WRITE, fd, world, 6),
+        _op(OE_BATCH_OP_FSYNC, fd),
+        _op(OE_BATCH_OP_CLOSE, fd),
+        // The descriptor has been closed by the previous operation.
+        _op(OE_BATCH_OP_WRITE, fd, hello, 5),
+    };
+    OE_TEST(oe_batch_syscalls(ops.data(), ops.size()) == 0);
+    OE_TEST(ops[0].result == 5);
+    OE_TEST(ops[1].result == 6);
+    OE_TEST(ops[2].result == 0);
+    OE_TEST(ops[3].result == 0);
+    OE_TEST(ops[4].result == -EBADF);
+
+    fd = open(path, O_RDONLY);
+    OE_TEST(fd >= 0);
+
+    char buf[2][8]{};
+    ops = {
+        _op(OE_BATCH_OP_READ, fd, buf[0], 5),
+        _op(OE_BATCH_OP_READ, fd, buf[1], sizeof buf[1]),
+        _op(OE_BATCH_OP_READ, fd, buf[1], sizeof buf[1]),
+        _op(OE_BATCH_OP_CLOSE, fd),
+    };
+    OE_TEST(oe_batch_syscalls(ops.data(), ops.size()) == 0);
+    OE_TEST(ops[0].result == 5);
+    OE_TEST(ops[1].result == 6);
+    OE_TEST(ops[2].result == 0);
+    OE_TEST(ops[3].result == 0);
+    OE_TEST(memcmp(buf[0], "hello", 5) == 0);
+    OE_TEST(memcmp(buf[1], " world", 6) == 0);
+}
+
+// Positional reads and writes, which the io_uring backend may run
+// concurrently unless their ranges overlap.
+static void _test_positional(const char* path)
+{
+    const size_t count = 100;
+    vector<char> data(count);
+    vector<char> read_data(count);
+    vector<oe_syscall_op_t> ops;
+
+    const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    OE_TEST(fd >= 0);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        data[i] = static_cast<char>('a' + i % 26);
+        ops.push_back(_op(OE_BATCH_OP_PWRITE, fd, &data[i], 1));
+        ops.back().offset = static_cast<off_t>(count - 1 - i);
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        ops.push_back(_op(OE_BATCH_OP_PREAD, fd, &read_data[i], 1));
+        ops.back().offset = static_cast<off_t>(i);
+    }
+
+    // Overwrite the first two bytes and read them back.
+    char xy[] = "XY";
+    char read_xy[2]{};
+    ops.push_back(_op(OE_BATCH_OP_PWRITE, fd, xy, 2));
+    ops.push_back(_op(OE_BATCH_OP_PREAD, fd, read_xy, 2));
+    ops.push_back(_op(OE_BATCH_OP_PREAD, fd, read_xy, 2));
+    ops.back().offset = -1;
+
+    OE_TEST(oe_batch_syscalls(ops.data(), ops.size()) == 0);
+    for (size_t i = 0; i < 2 * count + 2; i++)
+        OE_TEST(ops[i].result == static_cast<ssize_t>(ops[i].len));
+    OE_TEST(ops.back().result == -EINVAL);
+
+    for (size_t i = 0; i < count; i++)
+        OE_TEST(read_data[i] == data[count - 1 - i]);
+    OE_TEST(memcmp(read_xy, "XY", 2) == 0);
+
+    // A duplicate refers to the same file, so a pwrite through it completes
+    // before an overlapping pread through the original descriptor.
+    const int fd2 = dup(fd);
+    OE_TEST(fd2 >= 0);
+    char z[] = "Z";
+    char read_z = 0;
+    ops = {
+        _op(OE_BATCH_OP_PWRITE, fd2, z, 1),
+        _op(OE_BATCH_OP_PREAD, fd, &read_z, 1),
+    };
+    OE_TEST(oe_batch_syscalls(ops.data(), ops.size()) == 0);
+    OE_TEST(ops[0].result == 1);
+    OE_TEST(ops[1].result == 1);
+    OE_TEST(read_z == 'Z');
+
+    OE_TEST(close(fd2) == 0);
+    OE_TEST(close(fd) == 0);
+}
+
+// More operations and more data than fit into a single submission.
+static void _test_large(const char* path)
+{
+    const size_t count = 200;
+    vector<char> big(3 << 20);
+    vector<oe_syscall_op_t> ops;
+    vector<char> expected;
+
+    for (size_t i = 0; i < big.size(); i++)
+        big[i] = static_cast<char>(i * 7);
+
+    const int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    OE_TEST(fd >= 0);
+
+    vector<string> records;
+    for (size_t i = 0; i < count; i++)
+        records.push_back(to_string(i) + ",");
+    for (size_t i = 0; i < count; i++)
+    {
+        ops.push_back(_op(
+            OE_BATCH_OP_WRITE, fd, &records[i][0], records[i].size()));
+        expected.insert(expected.end(), records[i].begin(), records[i].end());
+
+        if (i == count / 2)
+        {
+            ops.push_back(_op(OE_BATCH_OP_WRITE, fd, big.data(), big.size()));
+            expected.insert(expected.end(), big.begin(), big.end());
+        }
+    }
+
+    OE_TEST(oe_batch_syscalls(ops.data(), ops.size()) == 0);
+    for (const auto& op : ops)
+        OE_TEST(op.result == static_cast<ssize_t>(op.len));
+
+    vector<char> data(expected.size() + 1);
+    OE_TEST(lseek(fd, 0, SEEK_SET) == 0);
+    oe_syscall_op_t read_op =
+        _op(OE_BATCH_OP_READ, fd, data.data(), data.size());
+    OE_TEST(oe_batch_syscalls(&read_op, 1) == 0);
+    OE_TEST(read_op.result == static_cast<ssize_t>(expected.size()));
+    OE_TEST(memcmp(data.data(), expected.data(), expected.size()) == 0);
+
+    OE_TEST(close(fd) == 0);
+}
+
+// sendmsg and recvmsg with differently split IO vectors, and write and read
+// on the same socket pair.
+static void _test_socket()
+{
+    int sv[2];
+    OE_TEST(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+    char out1[] = "abc";
+    char out2[] = "defgh";
+    iovec out_iov[] = {{out1, 3}, {out2, 5}};
+    msghdr out_msg{};
+    out_msg.msg_iov = out_iov;
+    out_msg.msg_iovlen = 2;
+
+    char in1[5]{};
+    char in2[5]{};
+    iovec in_iov[] = {{in1, 5}, {in2, 5}};
+    msghdr in_msg{};
+    in_msg.msg_iov = in_iov;
+    in_msg.msg_iovlen = 2;
+
+    char ping[] = "ping";
+    char pong[4]{};
+
+    vector<oe_syscall_op_t> ops{
+        _msg_op(OE_BATCH_OP_SENDMSG, sv[0], &out_msg),
+        _msg_op(OE_BATCH_OP_RECVMSG, sv[1], &in_msg),
+        _op(OE_BATCH_OP_WRITE, sv[1], ping, 4),
+        _op(OE_BATCH_OP_READ, sv[0], pong, 4),
+        // Sockets cannot be synchronized and unknown operations fail.
+        _op(OE_BATCH_OP_FSYNC, sv[0]),
+        _op(0, sv[0]),
+        _op(OE_BATCH_OP_CLOSE, sv[0]),
+        _op(OE_BATCH_OP_CLOSE, sv[1]),
+    };
+    OE_TEST(oe_batch_syscalls(ops.data(), ops.size()) == 0);
+    OE_TEST(ops[0].result == 8);
+    OE_TEST(ops[1].result == 8);
+    OE_TEST(memcmp(in1, "abcde", 5) == 0);
+    OE_TEST(memcmp(in2, "fgh", 3) == 0);
+    OE_TEST(ops[2].result == 4);
+    OE_TEST(ops[3].result == 4);
+    OE_TEST(memcmp(pong, "ping", 4) == 0);
+    OE_TEST(ops[4].result == -EINVAL);
+    OE_TEST(ops[5].result == -EINVAL);
+    OE_TEST(ops[6].result == 0);
+    OE_TEST(ops[7].result == 0);
+}
+
+void test_batch(const char* path)
+{
+    _mount();
+    _test_file(path);
+    _test_positional(path);
+    _test_large(path);
+    _test_socket();
+
+    OE_TEST(oe_batch_syscalls(nullptr, 0) == 0);
+    OE_TEST(oe_batch_syscalls(nullptr, 1) == -1);
+}
+
+void bench_batch(
+    const char* path,
+    size_t len,
+    size_t count,
+    size_t batch_size,
+    bool preads)
+{
+    _mount();
+
+    vector<char> data(len * (batch_size ? batch_size : 1), 'a');
+    vector<oe_syscall_op_t> ops;
+    const int fd =
+        preads ? open(path, O_RDONLY) : open(path, O_WRONLY | O_CREAT, 0644);
+    OE_TEST(fd >= 0);
+
+    // The preads read the file written by the previous run with the same
+    // parameters, spreading the offsets over the whole file.
+    if (batch_size == 0)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            const auto offset = static_cast<off_t>(i * 7919 % count * len);
+            OE_TEST(
+                (preads ? pread(fd, data.data(), len, offset)
+                        : write(fd, data.data(), len)) ==
+                static_cast<ssize_t>(len));
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < batch_size; i++)
+            ops.push_back(_op(
+                preads ? OE_BATCH_OP_PREAD : OE_BATCH_OP_WRITE,
+                fd,
+                &data[i * len],
+                len));
+
+        for (size_t i = 0; i < count; i += batch_size)
+        {
+            for (size_t j = 0; j < batch_size; j++)
+                ops[j].offset =
+                    static_cast<off_t>((i + j) * 7919 % count * len);
+
+            OE_TEST(oe_batch_syscalls(ops.data(), ops.size()) == 0);
+
+            for (const auto& op : ops)
+                OE_TEST(op.result == static_cast<ssize_t>(len));
+        }
+    }
+
+    OE_TEST(close(fd) == 0);
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    4096, /* NumHeapPages */
+    64,   /* NumStackPages */
+    1);   /* NumTCS */
@@ -0,0 +1,141 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/tests.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include "batch_u.h"
+
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#endif
+
+#define SKIP_RETURN_CODE 2
+
+using namespace std;
+
+// Returns whether the host executes batches with io_uring if OE_IO_URING is
+// set. The conditions are the same as in host/linux/uring.c.
+static bool _is_io_uring_supported()
+{
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(__NR_io_uring_setup)
+    const uint32_t features = IORING_FEAT_NODROP | IORING_FEAT_RW_CUR_POS;
+    io_uring_params params{};
+
+    const int fd = (int)syscall(__NR_io_uring_setup, 1, &params);
+    if (fd < 0)
+        return false;
+
+    close(fd);
+    return (params.features & features) == features;
+#else
+    return false;
+#endif
+}
+
+// Measures the rate of small writes and of random preads on a host file issued
+// one by one and in batches of different sizes.
+static void _bench(oe_enclave_t* enclave, const char* path)
+{
+    const size_t count = 256 * 1024;
+
+    printf("%10s %10s %14s %14s\n", "len", "batch", "writes/s", "preads/s");
+
+    for (size_t len = 16; len <= 4096; len *= 16)
+    {
+        // A batch size of 0 issues one write() or pread() per record.
+        for (const size_t batch_size : {0, 1, 4, 16, 64})
+        {
+            double ops_per_s[2];
+
+            // The preads read the file written before.
+            for (const bool preads : {false, true})
+            {
+                const auto start = chrono::steady_clock::now();
+                OE_TEST(
+                    bench_batch(
+                        enclave, path, len, count, batch_size, preads) ==
+                    OE_OK);
+                const chrono::duration<double> seconds =
+                    chrono::steady_clock::now() - start;
+
+                ops_per_s[preads] = count / seconds.count();
+            }
+
+            printf(
+                "%10zu %10zu %14.0f %14.0f\n",
+                len,
+                batch_size,
+                ops_per_s[false],
+                ops_per_s[true]);
+        }
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    const uint32_t flags = oe_get_create_flags();
+    const oe_enclave_type_t type = OE_ENCLAVE_TYPE_SGX;
+
+    bool bench = false;
+
+    if (argc < 2)
+    {
+        fprintf(
+            stderr, "Usage: %s ENCLAVE_PATH [--io-uring] [--bench]\n", argv[0]);
+        return 1;
+    }
+
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--bench") == 0)
+            bench = true;
+        // Let the host execute batches with io_uring. The host would fall
+        // back to executing them one by one if the kernel does not support
+        // it, which would not test the backend.
+        else if (strcmp(argv[i], "--io-uring") == 0)
+        {
+            if (!_is_io_uring_supported())
+            {
+                printf("io_uring is not supported, skipping the test\n");
+                return SKIP_RETURN_CODE;
+            }
+
+            setenv("OE_IO_URING", "64", 1);
+        }
+        else
+        {
+            fprintf(stderr, "Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    char path[] = "/tmp/oe_batch_XXXXXX";
+    const int fd = mkstemp(path);
+    OE_TEST(fd >= 0);
+    close(fd);
+
+    oe_enclave_t* enclave;
+    OE_TEST(
+        oe_create_batch_enclave(argv[1], type, flags, NULL, 0, &enclave) ==
+        OE_OK);
+
+    if (bench)
+        _bench(enclave, path);
+    else
+        OE_TEST(test_batch(enclave, path) == OE_OK);
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+    unlink(path);
+
+    printf("=== passed all tests (batch)\n");
+    fflush(stdout);
+
+    return 0;
+}
@@ -1,7 +1,12 @@
+#include <errno.h>
+#include <fcntl.h>
 #include <openenclave/enclave.h>
 #include <openenclave/internal/tests.h>
 #include <string.h>
 #include <sys/mount.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 static char _filebuf[27];
 
@@ -51,6 +56,181 @@ static bool _fs_write(
     return true;
 }
 
+/* A file system that implements version 2. */
+static char _v2_filebuf[64];
+static uint64_t _v2_size;
+static size_t _v2_get_size_calls;
+static size_t _v2_readv_calls;
+static size_t _v2_writev_calls;
+static size_t _v2_flush_calls;
+static size_t _v2_fsync_calls;
+static bool _v2_flush_fails;
+
+static uintptr_t _v2_open(const char* path, bool must_exist)
+{
+    OE_TEST(strcmp(path, "/foo") == 0);
+    return must_exist && !_v2_size ? 0 : 2;
+}
+
+static void _v2_close(uintptr_t handle)
+{
+    OE_TEST(handle == 2);
+}
+
+static uint64_t _v2_get_size(uintptr_t handle)
+{
+    OE_TEST(handle == 2);
+    ++_v2_get_size_calls;
+    return _v2_size;
+}
+
+static void _v2_unlink(const char* path)
+{
+    OE_TEST(strcmp(path, "/foo") == 0);
+    _v2_size = 0;
+}
+
+static void _v2_readv(
+    uintptr_t handle,
+    const oe_customfs_iovec_t* iov,
+    int iovcnt,
+    uint64_t offset)
+{
+    OE_TEST(handle == 2);
+    ++_v2_readv_calls;
+
+    for (int i = 0; i < iovcnt; i++)
+    {
+        OE_TEST(offset + iov[i].len <= _v2_size);
+        memcpy(iov[i].base, _v2_filebuf + offset, iov[i].len);
+        offset += iov[i].len;
+    }
+}
+
+static bool _v2_writev(
+    uintptr_t handle,
+    const oe_customfs_iovec_t* iov,
+    int iovcnt,
+    uint64_t offset)
+{
+    OE_TEST(handle == 2);
+    ++_v2_writev_calls;
+
+    for (int i = 0; i < iovcnt; i++)
+    {
+        if (offset + iov[i].len > sizeof _v2_filebuf)
+            return false;
+        memcpy(_v2_filebuf + offset, iov[i].base, iov[i].len);
+        offset += iov[i].len;
+    }
+
+    if (offset > _v2_size)
+        _v2_size = offset;
+    return true;
+}
+
+static bool _v2_truncate(uintptr_t handle, uint64_t size)
+{
+    OE_TEST(handle == 2);
+    if (size > sizeof _v2_filebuf)
+        return false;
+    if (size > _v2_size)
+        memset(_v2_filebuf + _v2_size, 0, size - _v2_size);
+    _v2_size = size;
+    return true;
+}
+
+static bool _v2_flush(uintptr_t handle)
+{
+    OE_TEST(handle == 2);
+    ++_v2_flush_calls;
+    return !_v2_flush_fails;
+}
+
+static bool _v2_fsync(uintptr_t handle)
+{
+    OE_TEST(handle == 2);
+    ++_v2_fsync_calls;
+    return true;
+}
+
+static void _test_version2(const char* path)
+{
+    char a[4];
+    char b[8];
+    struct stat buf;
+
+    /* Opening with O_TRUNC truncates instead of unlinking. */
+    _v2_size = 3;
+    int fd = open(path, O_CREAT | O_TRUNC | O_RDWR, 0);
+    OE_TEST(fd >= 0);
+    OE_TEST(_v2_size == 0);
+
+    /* writev() and readv() are passed as one request each. */
+    const struct iovec out[] = {
+        {"abc", 3},
+        {"defgh", 5},
+        {"ij", 2},
+    };
+    OE_TEST(writev(fd, out, 3) == 10);
+    OE_TEST(_v2_writev_calls == 1);
+
+    const struct iovec in[] = {{a, sizeof a}, {b, sizeof b}};
+    OE_TEST(lseek(fd, 0, SEEK_SET) == 0);
+    OE_TEST(readv(fd, in, 2) == 10);
+    OE_TEST(memcmp(a, "abcd", 4) == 0);
+    OE_TEST(memcmp(b, "efghij", 6) == 0);
+
+    /* One request for the buffer within the file, one for the rest. */
+    OE_TEST(_v2_readv_calls == 2);
+
+    OE_TEST(pwrite(fd, "xy", 2, 10) == 2);
+    OE_TEST(pread(fd, b, sizeof b, 4) == 8);
+    OE_TEST(memcmp(b, "efghijxy", 8) == 0);
+    OE_TEST(_v2_writev_calls == 2);
+    OE_TEST(_v2_readv_calls == 3);
+
+    /* The size is only queried on open. */
+    OE_TEST(lseek(fd, 0, SEEK_END) == 12);
+    OE_TEST(stat(path, &buf) == 0);
+    OE_TEST(buf.st_size == 12);
+    OE_TEST(_v2_get_size_calls == 1);
+
+    OE_TEST(fsync(fd) == 0);
+    OE_TEST(fdatasync(fd) == 0);
+    OE_TEST(_v2_fsync_calls == 2);
+
+    OE_TEST(ftruncate(fd, 4) == 0);
+    OE_TEST(lseek(fd, 0, SEEK_END) == 4);
+    OE_TEST(truncate(path, 6) == 0);
+    OE_TEST(lseek(fd, 0, SEEK_END) == 6);
+    OE_TEST(_v2_size == 6);
+
+    /* A second file of the path shares the cached size. */
+    const int fd2 = open(path, O_RDWR);
+    OE_TEST(fd2 >= 0);
+    OE_TEST(pwrite(fd2, "z", 1, 9) == 1);
+    OE_TEST(lseek(fd, 0, SEEK_END) == 10);
+    OE_TEST(close(fd2) == 0);
+    OE_TEST(_v2_get_size_calls == 1);
+
+    OE_TEST(close(fd) == 0);
+    OE_TEST(_v2_flush_calls == 2);
+
+    /* close() reports a failed flush, but closes the file anyway. */
+    fd = open(path, O_RDONLY);
+    OE_TEST(fd >= 0);
+    _v2_flush_fails = true;
+    OE_TEST(close(fd) == -1);
+    OE_TEST(errno == EIO);
+    OE_TEST(close(fd) == -1);
+    OE_TEST(errno == EBADF);
+    _v2_flush_fails = false;
+
+    OE_TEST(unlink(path) == 0);
+    OE_TEST(stat(path, &buf) == -1);
+}
+
 void test_customfs(void)
 {
     extern int run_main(const char* path, bool readonly);
@@ -74,6 +254,19 @@ void test_customfs(void)
         .write = _fs_write,
     };
 
+    oe_customfs_t v2fs = {
+        .open = _v2_open,
+        .close = _v2_close,
+        .get_size = _v2_get_size,
+        .unlink = _v2_unlink,
+        .version = OE_CUSTOMFS_VERSION,
+        .readv = _v2_readv,
+        .writev = _v2_writev,
+        .truncate = _v2_truncate,
+        .flush = _v2_flush,
+        .fsync = _v2_fsync,
+    };
+
     OE_TEST(oe_load_module_custom_file_system(rodev, &rofs) == OE_OK);
     OE_TEST(mount("/", "/ro", rodev, MS_RDONLY, NULL) == 0);
     OE_TEST(oe_load_module_custom_file_system(rwdev, &rwfs) == OE_OK);
@@ -82,6 +275,16 @@ void test_customfs(void)
     OE_TEST(run_main("/ro/foo", true) == 0);
     OE_TEST(umount("/ro") == 0);
     OE_TEST(umount("/rw") == 0);
+
+    OE_TEST(oe_load_module_custom_file_system("v2dev", &v2fs) == OE_OK);
+    OE_TEST(mount("/", "/v2", "v2dev", 0, NULL) == 0);
+    OE_TEST(run_main("/v2/foo", false) == 0);
+    _v2_get_size_calls = 0;
+    _v2_readv_calls = 0;
+    _v2_writev_calls = 0;
+    _v2_flush_calls = 0;
+    _test_version2("/v2/foo");
+    OE_TEST(umount("/v2") == 0);
 }
 
 OE_SET_ENCLAVE_SGX(
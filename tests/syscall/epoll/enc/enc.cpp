@@ -9,6 +9,7 @@
 #include <unistd.h>
 #include <cerrno>
 #include <cstdio>
+#include <vector>
 
 enum class action_t : uint8_t
 {
@@ -144,10 +145,68 @@ extern "C" void test_close_without_delete()
     OE_TEST(close(fd2) == 0);
 }
 
+static std::vector<int> _bench_fds;
+static std::vector<epoll_event> _bench_events;
+static int _bench_epfd;
+
+extern "C" void bench_set_up(size_t num_fds)
+{
+    _bench_epfd = epoll_create1(0);
+    OE_TEST(_bench_epfd >= 0);
+
+    // Unconnected stream sockets are always ready, so every registered fd is
+    // reported by each epoll_wait.
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLOUT;
+
+    for (size_t i = 0; i < num_fds; ++i)
+    {
+        const int fd = socket(AF_INET, SOCK_STREAM, 0);
+        OE_TEST(fd >= 0);
+        event.data.u64 = i;
+        OE_TEST(epoll_ctl(_bench_epfd, EPOLL_CTL_ADD, fd, &event) == 0);
+        _bench_fds.push_back(fd);
+    }
+
+    _bench_events.resize(num_fds < 1024 ? num_fds : 1024);
+}
+
+extern "C" size_t bench_wait(size_t iterations)
+{
+    size_t count = 0;
+
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        const int n = epoll_wait(
+            _bench_epfd,
+            _bench_events.data(),
+            static_cast<int>(_bench_events.size()),
+            0);
+        OE_TEST(n == static_cast<int>(_bench_events.size()));
+
+        for (int j = 0; j < n; ++j)
+            OE_TEST(_bench_events[j].data.u64 < _bench_fds.size());
+
+        count += static_cast<size_t>(n);
+    }
+
+    return count;
+}
+
+extern "C" void bench_tear_down()
+{
+    for (const int fd : _bench_fds)
+        OE_TEST(close(fd) == 0);
+    OE_TEST(close(_bench_epfd) == 0);
+
+    _bench_fds.clear();
+    _bench_events.clear();
+}
+
 OE_SET_ENCLAVE_SGX(
-    1,    /* ProductID */
-    1,    /* SecurityVersion */
-    true, /* Debug */
-    1024, /* NumHeapPages */
-    256,  /* NumStackPages */
-    9);   /* NumTCS */
+    1,     /* ProductID */
+    1,     /* SecurityVersion */
+    true,  /* Debug */
+    16384, /* NumHeapPages */
+    256,   /* NumStackPages */
+    9);    /* NumTCS */
@@ -3,21 +3,62 @@
 
 #include <openenclave/host.h>
 #include <openenclave/internal/tests.h>
+#include <sys/resource.h>
+#include <chrono>
 #include <cstdio>
+#include <cstring>
 #include <thread>
 #include "epoll_u.h"
 
 using namespace std;
 
+// Measures epoll_wait while the number of registered fds grows.
+static void _bench(oe_enclave_t* enclave)
+{
+    // Each registered fd is a host socket.
+    rlimit limit{};
+    OE_TEST(getrlimit(RLIMIT_NOFILE, &limit) == 0);
+    limit.rlim_cur = limit.rlim_max;
+    OE_TEST(setrlimit(RLIMIT_NOFILE, &limit) == 0);
+
+    const size_t iterations = 1000;
+
+    for (size_t num_fds = 10; num_fds <= 100000; num_fds *= 10)
+    {
+        if (num_fds + 64 > limit.rlim_cur)
+        {
+            printf("skipping %zu fds: RLIMIT_NOFILE is too low\n", num_fds);
+            continue;
+        }
+
+        OE_TEST(bench_set_up(enclave, num_fds) == OE_OK);
+
+        size_t count = 0;
+        const auto start = chrono::steady_clock::now();
+        OE_TEST(bench_wait(enclave, &count, iterations) == OE_OK);
+        const chrono::duration<double, micro> elapsed =
+            chrono::steady_clock::now() - start;
+
+        OE_TEST(bench_tear_down(enclave) == OE_OK);
+
+        printf(
+            "%6zu registered fds: %8.2f us per epoll_wait, %6.3f us per "
+            "event\n",
+            num_fds,
+            elapsed.count() / iterations,
+            elapsed.count() / count);
+    }
+}
+
 int main(int argc, const char* argv[])
 {
     oe_result_t r;
     const uint32_t flags = oe_get_create_flags();
     const oe_enclave_type_t type = OE_ENCLAVE_TYPE_SGX;
 
-    if (argc != 2)
+    if (argc != 2 && !(argc == 3 && strcmp(argv[2], "--bench") == 0))
     {
-        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH [--bench]\n", argv[0]);
         return 1;
     }
 
@@ -25,6 +66,13 @@ int main(int argc, const char* argv[])
     r = oe_create_epoll_enclave(argv[1], type, flags, NULL, 0, &enclave);
     OE_TEST(r == OE_OK);
 
+    if (argc == 3)
+    {
+        _bench(enclave);
+        OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+        return 0;
+    }
+
     // Test concurrent use of epoll
 
     set_up(enclave);
@@ -0,0 +1,243 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <fcntl.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/syscall/iov.h>
+#include <openenclave/internal/tests.h>
+#include <sys/mount.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "iov_t.h"
+
+using namespace std;
+
+// A file opened either through the host file system device, whose readv and
+// writev stage the data in host memory, or directly on the host with the
+// packed path that the device used before.
+class file_t
+{
+  public:
+    file_t(const char* path, int flags, bool staged) : _staged(staged)
+    {
+        if (_staged)
+        {
+            _fd = open(path, flags, 0644);
+            OE_TEST(_fd >= 0);
+        }
+        else
+        {
+            OE_TEST(
+                oe_syscall_open_ocall(&_host_fd, path, flags, 0644) == OE_OK);
+            OE_TEST(_host_fd >= 0);
+        }
+    }
+
+    ~file_t()
+    {
+        if (_staged)
+            OE_TEST(close(_fd) == 0);
+        else
+        {
+            int ret = -1;
+            OE_TEST(oe_syscall_close_ocall(&ret, _host_fd) == OE_OK);
+            OE_TEST(ret == 0);
+        }
+    }
+
+    ssize_t readv(const iovec* iov, int iovcnt)
+    {
+        if (_staged)
+            return ::readv(_fd, iov, iovcnt);
+
+        ssize_t ret = -1;
+        void* buf = nullptr;
+        size_t buf_size = 0;
+        const auto* oe_iov = reinterpret_cast<const oe_iovec*>(iov);
+
+        OE_TEST(oe_iov_pack(oe_iov, iovcnt, &buf, &buf_size) == 0);
+        OE_TEST(
+            oe_syscall_readv_ocall(&ret, _host_fd, buf, iovcnt, buf_size) ==
+            OE_OK);
+        if (ret > 0)
+            OE_TEST(oe_iov_sync(oe_iov, iovcnt, buf, buf_size) == 0);
+        free(buf);
+
+        return ret;
+    }
+
+    ssize_t writev(const iovec* iov, int iovcnt)
+    {
+        if (_staged)
+            return ::writev(_fd, iov, iovcnt);
+
+        ssize_t ret = -1;
+        void* buf = nullptr;
+        size_t buf_size = 0;
+        const auto* oe_iov = reinterpret_cast<const oe_iovec*>(iov);
+
+        OE_TEST(oe_iov_pack(oe_iov, iovcnt, &buf, &buf_size) == 0);
+        OE_TEST(
+            oe_syscall_writev_ocall(&ret, _host_fd, buf, iovcnt, buf_size) ==
+            OE_OK);
+        free(buf);
+
+        return ret;
+    }
+
+  private:
+    bool _staged;
+    int _fd = -1;
+    oe_host_fd_t _host_fd = -1;
+};
+
+static void _mount()
+{
+    static bool mounted;
+
+    if (!mounted)
+    {
+        OE_TEST(oe_load_module_host_file_system() == OE_OK);
+        OE_TEST(oe_load_module_host_socket_interface() == OE_OK);
+        OE_TEST(mount("/", "/", OE_HOST_FILE_SYSTEM, 0, nullptr) == 0);
+        mounted = true;
+    }
+}
+
+static vector<iovec> _make_iov(
+    vector<uint8_t>& data,
+    const vector<size_t>& lens)
+{
+    vector<iovec> iov;
+    size_t offset = 0;
+
+    for (size_t len : lens)
+    {
+        iov.push_back({data.data() + offset, len});
+        offset += len;
+    }
+
+    OE_TEST(offset == data.size());
+    return iov;
+}
+
+// Write with one path and read back with the other.
+static void _test_round_trip(const char* path, bool staged_write)
+{
+    const vector<size_t> lens{1, 0, 4096, 100000, 7};
+    vector<uint8_t> data(1 + 4096 + 100000 + 7);
+
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<uint8_t>(i * 31 + staged_write);
+
+    {
+        file_t file(path, O_WRONLY | O_CREAT | O_TRUNC, staged_write);
+        const vector<iovec> iov = _make_iov(data, lens);
+        OE_TEST(
+            file.writev(iov.data(), static_cast<int>(iov.size())) ==
+            static_cast<ssize_t>(data.size()));
+    }
+
+    {
+        // The last element extends past the end of the file and must only
+        // receive the remaining bytes.
+        file_t file(path, O_RDONLY, !staged_write);
+        vector<uint8_t> read_data(data.size() + 10, 0xff);
+        vector<size_t> read_lens = lens;
+        read_lens.back() += 10;
+        const vector<iovec> iov = _make_iov(read_data, read_lens);
+
+        OE_TEST(
+            file.readv(iov.data(), static_cast<int>(iov.size())) ==
+            static_cast<ssize_t>(data.size()));
+        OE_TEST(memcmp(read_data.data(), data.data(), data.size()) == 0);
+        OE_TEST(read_data[data.size()] == 0xff);
+
+        // End of file
+        OE_TEST(file.readv(iov.data(), static_cast<int>(iov.size())) == 0);
+    }
+}
+
+// writev and readv on a host socket pair, which stage the data like files.
+static void _test_socket()
+{
+    const vector<size_t> lens{1, 0, 4096, 7};
+    vector<uint8_t> data(1 + 4096 + 7);
+    int sv[2];
+
+    for (size_t i = 0; i < data.size(); i++)
+        data[i] = static_cast<uint8_t>(i * 17);
+
+    OE_TEST(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+
+    const vector<iovec> iov = _make_iov(data, lens);
+    OE_TEST(
+        writev(sv[0], iov.data(), static_cast<int>(iov.size())) ==
+        static_cast<ssize_t>(data.size()));
+    OE_TEST(close(sv[0]) == 0);
+
+    // The stream may be received in pieces, each scattered from the start of
+    // the IO vector.
+    vector<uint8_t> read_data;
+    vector<uint8_t> chunk(data.size());
+    const vector<iovec> read_iov = _make_iov(chunk, lens);
+    ssize_t n;
+
+    while ((n = readv(
+                sv[1], read_iov.data(), static_cast<int>(read_iov.size()))) >
+           0)
+        read_data.insert(read_data.end(), chunk.begin(), chunk.begin() + n);
+
+    OE_TEST(n == 0);
+    OE_TEST(read_data == data);
+    OE_TEST(close(sv[1]) == 0);
+}
+
+void test_iov(const char* path)
+{
+    _mount();
+    _test_round_trip(path, true);
+    _test_round_trip(path, false);
+    _test_socket();
+}
+
+void bench_iov(
+    const char* path,
+    size_t iov_len,
+    int iovcnt,
+    size_t iterations,
+    bool staged,
+    bool write)
+{
+    _mount();
+
+    vector<uint8_t> data(iov_len * static_cast<size_t>(iovcnt), 0xaa);
+    const vector<iovec> iov =
+        _make_iov(data, vector<size_t>(static_cast<size_t>(iovcnt), iov_len));
+    const auto expected = static_cast<ssize_t>(data.size());
+
+    if (write)
+    {
+        file_t file(path, O_WRONLY | O_CREAT | O_TRUNC, staged);
+        for (size_t i = 0; i < iterations; i++)
+            OE_TEST(file.writev(iov.data(), iovcnt) == expected);
+    }
+    else
+    {
+        file_t file(path, O_RDONLY, staged);
+        for (size_t i = 0; i < iterations; i++)
+            OE_TEST(file.readv(iov.data(), iovcnt) == expected);
+    }
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    4096, /* NumHeapPages */
+    64,   /* NumStackPages */
+    1);   /* NumTCS */
@@ -0,0 +1,107 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/tests.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include "iov_u.h"
+
+using namespace std;
+
+// Measures the throughput of readv and writev through the host file system
+// device against the packed path that copies the data into the ocall buffer.
+static void _bench(oe_enclave_t* enclave, const char* path)
+{
+    const int iovcnt = 4;
+    const size_t total = 64 * 1024 * 1024;
+
+    printf(
+        "%10s %10s %14s %14s\n", "iov_len", "op", "packed MB/s", "staged MB/s");
+
+    for (size_t iov_len = 512; iov_len <= 256 * 1024; iov_len *= 8)
+    {
+        const size_t iterations = total / (iov_len * iovcnt);
+
+        for (const bool write : {true, false})
+        {
+            double mb_per_s[2];
+
+            for (const bool staged : {false, true})
+            {
+                // The reads consume the file written before.
+                if (!write)
+                    OE_TEST(
+                        bench_iov(
+                            enclave,
+                            path,
+                            iov_len,
+                            iovcnt,
+                            iterations,
+                            staged,
+                            true) == OE_OK);
+
+                const auto start = chrono::steady_clock::now();
+                OE_TEST(
+                    bench_iov(
+                        enclave,
+                        path,
+                        iov_len,
+                        iovcnt,
+                        iterations,
+                        staged,
+                        write) == OE_OK);
+                const chrono::duration<double> seconds =
+                    chrono::steady_clock::now() - start;
+
+                mb_per_s[staged] = total / seconds.count() / (1024 * 1024);
+            }
+
+            printf(
+                "%10zu %10s %14.1f %14.1f\n",
+                iov_len,
+                write ? "writev" : "readv",
+                mb_per_s[false],
+                mb_per_s[true]);
+        }
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    const uint32_t flags = oe_get_create_flags();
+    const oe_enclave_type_t type = OE_ENCLAVE_TYPE_SGX;
+
+    if (argc != 2 && !(argc == 3 && strcmp(argv[2], "--bench") == 0))
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH [--bench]\n", argv[0]);
+        return 1;
+    }
+
+    char path[] = "/tmp/oe_iov_XXXXXX";
+    const int fd = mkstemp(path);
+    OE_TEST(fd >= 0);
+    close(fd);
+
+    oe_enclave_t* enclave;
+    OE_TEST(
+        oe_create_iov_enclave(argv[1], type, flags, NULL, 0, &enclave) ==
+        OE_OK);
+
+    if (argc == 3)
+        _bench(enclave, path);
+    else
+        OE_TEST(test_iov(enclave, path) == OE_OK);
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+    unlink(path);
+
+    printf("=== passed all tests (iov)\n");
+    fflush(stdout);
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <ctime>
+#include "test_t.h"
+
+using namespace std;
+
+// From <linux/futex.h>, which is not available in the enclave.
+#define FUTEX_WAKE 1
+
+// Calls each syscall of the table in libc/syscalls.c with its arguments in
+// the positions the handler reads them from.
+static void _test_handlers()
+{
+    timeval tv{};
+    OE_TEST(syscall(SYS_gettimeofday, &tv, nullptr) == 0);
+    OE_TEST(tv.tv_sec > 0);
+
+    timespec ts{};
+    OE_TEST(syscall(SYS_clock_gettime, CLOCK_MONOTONIC, &ts) == 0);
+    OE_TEST(ts.tv_sec > 0 || ts.tv_nsec > 0);
+
+    // mmap is not supported through the syscall.
+    OE_TEST(
+        syscall(SYS_mmap, nullptr, 4096, PROT_READ, MAP_PRIVATE, -1, 0) ==
+        EPERM);
+
+    uint8_t buf[32] = {};
+    OE_TEST(syscall(SYS_getrandom, buf, sizeof buf, 0) == sizeof buf);
+    OE_TEST(any_of(buf, buf + sizeof buf, [](uint8_t x) { return x != 0; }));
+
+    OE_TEST(syscall(SYS_madvise, buf, sizeof buf, MADV_DONTNEED) == 0);
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    OE_TEST(syscall(SYS_sched_getaffinity, 0, sizeof set, &set) > 0);
+    OE_TEST(CPU_COUNT(&set) >= 2);
+    errno = 0;
+    OE_TEST(syscall(SYS_sched_getaffinity, 1, sizeof set, &set) == -1);
+    OE_TEST(errno == ENOSYS);
+
+    OE_TEST(syscall(SYS_sched_yield) == 0);
+
+    int word = 0;
+    OE_TEST(syscall(SYS_futex, &word, FUTEX_WAKE, INT_MAX, nullptr, 0, 0) == 0);
+
+    sigset_t mask;
+    sigemptyset(&mask);
+    OE_TEST(syscall(SYS_rt_sigprocmask, SIG_BLOCK, &mask, nullptr, 8) == 0);
+    OE_TEST(syscall(SYS_sigaltstack, nullptr, nullptr) == 0);
+}
+
+// Numbers outside of the table are passed on and fail.
+static void _test_out_of_range()
+{
+    errno = 0;
+    OE_TEST(syscall(-1) == -1);
+    OE_TEST(errno == ENOSYS);
+
+    errno = 0;
+    OE_TEST(syscall(100000) == -1);
+    OE_TEST(errno == ENOSYS);
+}
+
+void test_ecall()
+{
+    _test_handlers();
+    _test_out_of_range();
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    64,   /* NumHeapPages */
+    64,   /* NumStackPages */
+    1);   /* NumTCS */
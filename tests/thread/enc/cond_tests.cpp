@@ -105,3 +105,53 @@ void cb_test_signal_thread_impl()
     // from either of the calls and then check the exit_thread flag and quit.
     oe_mutex_unlock(&mutex);
 }
+
+static oe_mutex_t unlocked_mutex = OE_MUTEX_INITIALIZER;
+static oe_cond_t unlocked_cond = OE_COND_INITIALIZER;
+static size_t num_unlocked_waiting = 0;
+static size_t num_unlocked_woken = 0;
+static bool unlocked_go = false;
+
+void cb_test_unlocked_waiter_thread_impl()
+{
+    oe_mutex_lock(&unlocked_mutex);
+
+    ++num_unlocked_waiting;
+    while (!unlocked_go)
+        oe_cond_wait(&unlocked_cond, &unlocked_mutex);
+    ++num_unlocked_woken;
+
+    oe_mutex_unlock(&unlocked_mutex);
+}
+
+void cb_test_unlocked_signal_thread_impl(size_t num_waiters)
+{
+    // Wait until all waiters are blocked on the condition variable.
+    for (;;)
+    {
+        oe_mutex_lock(&unlocked_mutex);
+        const size_t n = num_unlocked_waiting;
+        oe_mutex_unlock(&unlocked_mutex);
+
+        if (n == num_waiters)
+            break;
+    }
+
+    oe_mutex_lock(&unlocked_mutex);
+    unlocked_go = true;
+    oe_mutex_unlock(&unlocked_mutex);
+
+    // Broadcast without holding the mutex. Nobody else will unlock it, so the
+    // broadcast itself has to get the first waiter going.
+    oe_cond_broadcast(&unlocked_cond);
+
+    for (;;)
+    {
+        oe_mutex_lock(&unlocked_mutex);
+        const size_t n = num_unlocked_woken;
+        oe_mutex_unlock(&unlocked_mutex);
+
+        if (n == num_waiters)
+            break;
+    }
+}
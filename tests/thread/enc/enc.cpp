@@ -11,8 +11,11 @@
 #include <openenclave/internal/tests.h>
 #include <openenclave/internal/thread.h>
 #include <openenclave/internal/types.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/sysinfo.h>
+#include <unistd.h>
 #include <atomic>
 #include "thread_t.h"
 
@@ -317,6 +320,16 @@ size_t enc_tcs_used_thread_count()
     return g_tcs_used_thread_count;
 }
 
+void enc_test_cpu_count(size_t expected)
+{
+    cpu_set_t set;
+    OE_TEST(sched_getaffinity(0, sizeof(set), &set) == 0);
+    OE_TEST(static_cast<size_t>(CPU_COUNT(&set)) == expected);
+    OE_TEST(sysconf(_SC_NPROCESSORS_ONLN) == static_cast<long>(expected));
+    OE_TEST(sysconf(_SC_NPROCESSORS_CONF) == static_cast<long>(expected));
+    OE_TEST(get_nprocs() == static_cast<int>(expected));
+}
+
 OE_SET_ENCLAVE_SGX(
     1,    /* ProductID */
     1,    /* SecurityVersion */
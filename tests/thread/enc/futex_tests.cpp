@@ -0,0 +1,91 @@
+// Copyright (c) Edgeless Systems GmbH.
+// Licensed under the MIT License.
+
+#include <errno.h>
+#include <limits.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include "thread_t.h"
+
+// From <linux/futex.h>, which is not available in the enclave.
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+#define FUTEX_WAIT_BITSET 9
+#define FUTEX_PRIVATE_FLAG 128
+
+static volatile int futex_word = 0;
+static std::atomic<size_t> num_futex_waiting(0);
+static std::atomic<size_t> num_futex_woken(0);
+
+void enc_futex_waiter()
+{
+    ++num_futex_waiting;
+
+    // EAGAIN if the waker has already changed the word.
+    while (futex_word == 0)
+        syscall(
+            SYS_futex, &futex_word, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, 0, NULL);
+
+    ++num_futex_woken;
+}
+
+void enc_futex_waker(size_t num_waiters)
+{
+    while (num_futex_waiting < num_waiters)
+        ;
+
+    __atomic_store_n(&futex_word, 1, __ATOMIC_SEQ_CST);
+    OE_TEST(
+        syscall(
+            SYS_futex,
+            &futex_word,
+            FUTEX_WAKE | FUTEX_PRIVATE_FLAG,
+            INT_MAX) <= (long)num_waiters);
+
+    while (num_futex_woken < num_waiters)
+        ;
+}
+
+void enc_futex_errors()
+{
+    int word = 0;
+
+    // The value does not match.
+    errno = 0;
+    OE_TEST(syscall(SYS_futex, &word, FUTEX_WAIT, 1, NULL) == -1);
+    OE_TEST(errno == EAGAIN);
+
+    // Relative timeout.
+    struct timespec timeout = {0, 10 * 1000 * 1000};
+    errno = 0;
+    OE_TEST(syscall(SYS_futex, &word, FUTEX_WAIT, 0, &timeout) == -1);
+    OE_TEST(errno == ETIMEDOUT);
+
+    // Absolute timeout on CLOCK_MONOTONIC.
+    struct timespec abstime;
+    OE_TEST(clock_gettime(CLOCK_MONOTONIC, &abstime) == 0);
+    abstime.tv_nsec += 10 * 1000 * 1000;
+    if (abstime.tv_nsec >= 1000000000)
+    {
+        abstime.tv_sec++;
+        abstime.tv_nsec -= 1000000000;
+    }
+    errno = 0;
+    OE_TEST(
+        syscall(
+            SYS_futex, &word, FUTEX_WAIT_BITSET, 0, &abstime, NULL, 1) == -1);
+    OE_TEST(errno == ETIMEDOUT);
+
+    // A zero bitset is invalid.
+    errno = 0;
+    OE_TEST(
+        syscall(SYS_futex, &word, FUTEX_WAIT_BITSET, 0, NULL, NULL, 0) == -1);
+    OE_TEST(errno == EINVAL);
+
+    // Nobody is waiting.
+    OE_TEST(syscall(SYS_futex, &word, FUTEX_WAKE, 1) == 0);
+}
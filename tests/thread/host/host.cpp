@@ -4,6 +4,8 @@
 #include <openenclave/host.h>
 #include <openenclave/internal/error.h>
 #include <openenclave/internal/tests.h>
+#include <sched.h>
+#include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <chrono>
@@ -172,6 +174,69 @@ void test_cond_broadcast(oe_enclave_t* enclave)
     printf("test_cond_broadcast Complete\n");
 }
 
+void test_cond_broadcast_unlocked(oe_enclave_t* enclave)
+{
+    std::thread threads[NUM_THREADS];
+
+    printf("test_cond_broadcast_unlocked Starting\n");
+
+    for (size_t i = 0; i < NUM_THREADS; i++)
+    {
+        threads[i] = std::thread([enclave]() {
+            OE_TEST(cb_test_unlocked_waiter_thread_impl(enclave) == OE_OK);
+        });
+    }
+
+    OE_TEST(cb_test_unlocked_signal_thread_impl(enclave, NUM_THREADS) == OE_OK);
+
+    for (size_t i = 0; i < NUM_THREADS; i++)
+    {
+        threads[i].join();
+    }
+
+    printf("test_cond_broadcast_unlocked Complete\n");
+}
+
+void test_futex(oe_enclave_t* enclave)
+{
+    std::thread threads[NUM_THREADS];
+
+    printf("test_futex Starting\n");
+
+    OE_TEST(enc_futex_errors(enclave) == OE_OK);
+
+    for (size_t i = 0; i < NUM_THREADS; i++)
+    {
+        threads[i] = std::thread(
+            [enclave]() { OE_TEST(enc_futex_waiter(enclave) == OE_OK); });
+    }
+
+    OE_TEST(enc_futex_waker(enclave, NUM_THREADS) == OE_OK);
+
+    for (size_t i = 0; i < NUM_THREADS; i++)
+    {
+        threads[i].join();
+    }
+
+    printf("test_futex Complete\n");
+}
+
+void test_cpu_count(oe_enclave_t* enclave)
+{
+    cpu_set_t set;
+
+    printf("test_cpu_count Starting\n");
+
+    OE_TEST(sched_getaffinity(0, sizeof(set), &set) == 0);
+
+    // The enclave has 16 TCSs and reports at least 2 CPUs.
+    const size_t expected =
+        std::max<size_t>(2, std::min<size_t>(CPU_COUNT(&set), 16));
+    OE_TEST(enc_test_cpu_count(enclave, expected) == OE_OK);
+
+    printf("test_cpu_count Complete\n");
+}
+
 void* exclusive_access_thread(oe_enclave_t* enclave)
 {
     const size_t ITERS = 2;
@@ -392,6 +457,12 @@ int main(int argc, const char* argv[])
 
     test_cond_broadcast(enclave);
 
+    test_cond_broadcast_unlocked(enclave);
+
+    test_futex(enclave);
+
+    test_cpu_count(enclave);
+
     test_thread_wake_wait(enclave);
 
     test_thread_locking_patterns(enclave);
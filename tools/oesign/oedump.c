@@ -67,6 +67,11 @@ void dump_enclave_properties(const oe_sgx_enclave_properties_t* props)
 
     printf("num_tcs=%llu\n", OE_LLU(props->header.size_settings.num_tcs));
 
+    printf("ocall_buffer_pages=%u\n", props->config.ocall_buffer_pages);
+
+    printf(
+        "max_ocall_buffer_pages=%u\n", props->config.max_ocall_buffer_pages);
+
     sigstruct = (const sgx_sigstruct_t*)props->sigstruct;
 
     printf("mrenclave=");
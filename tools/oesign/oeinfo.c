@@ -118,3 +118,41 @@ done:
 
     return result;
 }
+
+oe_result_t oe_write_measurement_manifest(
+    const char* path,
+    const oe_sgx_measurement_manifest_t* manifest)
+{
+    oe_result_t result = OE_FAILURE;
+    char* signed_path = _make_signed_lib_name(path);
+    mem_t buf = MEM_DYNAMIC_INIT;
+    const char* p;
+
+    if (!signed_path ||
+        mem_append(&buf, signed_path, strlen(signed_path)) != 0 ||
+        mem_append(
+            &buf,
+            OE_SGX_MANIFEST_EXTENSION,
+            sizeof(OE_SGX_MANIFEST_EXTENSION)) != 0)
+    {
+        oe_err("Bad executable name: %s", path);
+        goto done;
+    }
+
+    p = (const char*)mem_ptr(&buf);
+
+    OE_CHECK_ERR(
+        oe_sgx_write_measurement_manifest(p, manifest),
+        "Cannot write measurement manifest: %s",
+        p);
+
+    printf("Created %s\n", p);
+
+    result = OE_OK;
+
+done:
+    free(signed_path);
+    mem_free(&buf);
+
+    return result;
+}
@@ -2,6 +2,7 @@
 // Licensed under the MIT License.
 
 #include <openenclave/internal/properties.h>
+#include <openenclave/internal/sgxcreate.h>
 
 oe_result_t oe_read_oeinfo_sgx(
     const char* path,
@@ -10,3 +11,9 @@ oe_result_t oe_read_oeinfo_sgx(
 oe_result_t oe_write_oeinfo_sgx(
     const char* path,
     const oe_sgx_enclave_properties_t* properties);
+
+// Write the manifest next to the signed image that oe_write_oeinfo_sgx()
+// creates for the enclave at path.
+oe_result_t oe_write_measurement_manifest(
+    const char* path,
+    const oe_sgx_measurement_manifest_t* manifest);
@@ -22,6 +22,8 @@ typedef struct _config_file_options
     uint64_t num_tcs;
     uint16_t product_id;
     uint16_t security_version;
+    uint16_t ocall_buffer_pages;
+    uint16_t max_ocall_buffer_pages;
 } ConfigFileOptions;
 
 #define CONFIG_FILE_OPTIONS_INITIALIZER                                 \
@@ -29,6 +31,8 @@ typedef struct _config_file_options
         .debug = false, .num_heap_pages = OE_UINT64_MAX,                \
         .num_stack_pages = OE_UINT64_MAX, .num_tcs = OE_UINT64_MAX,     \
         .product_id = OE_UINT16_MAX, .security_version = OE_UINT16_MAX, \
+        .ocall_buffer_pages = OE_UINT16_MAX,                            \
+        .max_ocall_buffer_pages = OE_UINT16_MAX,                        \
     }
 
 static int _load_config_file(const char* path, ConfigFileOptions* options)
@@ -149,6 +153,31 @@ static int _load_config_file(const char* path, ConfigFileOptions* options)
 
             options->security_version = n;
         }
+        else if (strcmp(str_ptr(&lhs), "OcallBufferPages") == 0)
+        {
+            uint16_t n;
+
+            if (str_u16(&rhs, &n) != 0 || n == OE_UINT16_MAX)
+            {
+                oe_err("%s(%zu): bad value for 'OcallBufferPages'", path, line);
+                goto done;
+            }
+
+            options->ocall_buffer_pages = n;
+        }
+        else if (strcmp(str_ptr(&lhs), "MaxOcallBufferPages") == 0)
+        {
+            uint16_t n;
+
+            if (str_u16(&rhs, &n) != 0 || n == OE_UINT16_MAX)
+            {
+                oe_err(
+                    "%s(%zu): bad value for 'MaxOcallBufferPages'", path, line);
+                goto done;
+            }
+
+            options->max_ocall_buffer_pages = n;
+        }
         else
         {
             oe_err("%s(%zu): unknown setting: %s", path, line, str_ptr(&rhs));
@@ -288,6 +317,15 @@ void _merge_config_file_options(
     /* If NumTCS option is present */
     if (options->num_tcs != OE_UINT64_MAX)
         properties->header.size_settings.num_tcs = options->num_tcs;
+
+    /* If OcallBufferPages option is present */
+    if (options->ocall_buffer_pages != OE_UINT16_MAX)
+        properties->config.ocall_buffer_pages = options->ocall_buffer_pages;
+
+    /* If MaxOcallBufferPages option is present */
+    if (options->max_ocall_buffer_pages != OE_UINT16_MAX)
+        properties->config.max_ocall_buffer_pages =
+            options->max_ocall_buffer_pages;
 }
 
 int oesign(
@@ -305,7 +343,7 @@ int oesign(
     size_t pem_size;
     ConfigFileOptions options = CONFIG_FILE_OPTIONS_INITIALIZER;
     oe_sgx_enclave_properties_t props;
-    oe_sgx_load_context_t context;
+    oe_sgx_load_context_t context = {0};
 
     /* Load the configuration file */
     if (conffile && _load_config_file(conffile, &options) != 0)
@@ -345,6 +383,16 @@ int oesign(
             &context, OE_SGX_LOAD_TYPE_MEASURE, props.config.attributes),
         "oe_sgx_initialize_load_context() failed");
 
+#if !defined(_WIN32)
+    /* Record a manifest of the measurement that lets the loader skip most of
+     * it. BCrypt cannot save the state of a hash, which the manifest needs. */
+    if (!(context.manifest = calloc(1, sizeof(*context.manifest))))
+    {
+        oe_err("Out of memory");
+        goto done;
+    }
+#endif
+
     /* Build an enclave to obtain the MRENCLAVE measurement */
     OE_CHECK_ERR(
         oe_sgx_build_enclave(&context, enclave, &props, &enc),
@@ -400,6 +448,13 @@ int oesign(
         oe_result_str(result),
         result);
 
+    if (context.manifest)
+        OE_CHECK_ERR(
+            oe_write_measurement_manifest(enclave, context.manifest),
+            "oe_write_measurement_manifest(): result=%s (%#x)",
+            oe_result_str(result),
+            result);
+
     ret = 0;
 
 done:
@@ -407,6 +462,7 @@ done:
     if (pem_data)
         free(pem_data);
 
+    oe_sgx_free_measurement_manifest(context.manifest);
     oe_sgx_cleanup_load_context(&context);
 
     return ret;